@@ -0,0 +1,132 @@
+#include "crn_analyze.h"
+#include "crn_core.h"
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+// Normal map pixels decode, as (RGB - 128) / 127, to vectors 0.75 to 1.25 long with z no lower than -1/16. Filtered
+// mips shorten the vectors, and encoders round them, so both bounds are loose. At most 1 pixel in
+// cCRNNormalMaxOutliers may fail, and the mean x and y must stay within cCRNNormalMaxMean of 128: a flat blue-ish
+// photo passes the length test, but its vectors don't average out to the surface normal.
+enum
+{
+	cCRNAnalyzeChunkPixels = 1024,
+	cCRNNormalMinLen2      = 9073,
+	cCRNNormalMaxLen2      = 25202,
+	cCRNNormalMinZ         = 120,
+	cCRNNormalMaxOutliers  = 20,
+	cCRNNormalMaxMean      = 16
+};
+
+typedef struct
+{
+	crn_uint32 classes;
+	crn_uint32 num_normal;
+	crn_uint64 sum_x;
+	crn_uint64 sum_y;
+} crn_analyze_state;
+
+static void crn_analyze_pixel(const crn_uint8* pPixel, const crn_uint8* pFirst, crn_uint32 alpha_component, crn_analyze_state* pState)
+{
+	const crn_uint32 a = pPixel[alpha_component];
+	const int x = pPixel[0] - 128, y = pPixel[1] - 128, z = pPixel[2] - 128, len2 = x * x + y * y + z * z;
+
+	if (a != 255)
+		pState->classes &= ~(crn_uint32)(a ? cCRNTextureOpaque | cCRNTextureBinaryAlpha : cCRNTextureOpaque);
+	if (pPixel[0] != pPixel[1] || pPixel[1] != pPixel[2])
+		pState->classes &= ~(crn_uint32)cCRNTextureGrayscale;
+	if (memcmp(pPixel, pFirst, 4))
+		pState->classes &= ~(crn_uint32)cCRNTextureConstant;
+	pState->num_normal += pPixel[2] >= cCRNNormalMinZ && len2 >= cCRNNormalMinLen2 && len2 <= cCRNNormalMaxLen2;
+	pState->sum_x += pPixel[0];
+	pState->sum_y += pPixel[1];
+}
+
+#if CRN_SSE2
+// Chunk of pixels [i, end), 4 at a time. Returns the index of the first pixel left for the scalar path.
+static crn_uint32 crn_analyze_chunk(const crn_uint8* pPixels, crn_uint32 i, crn_uint32 end, crn_uint32 alpha_component, crn_analyze_state* pState)
+{
+	const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi32(-1), byte_mask = _mm_set1_epi32(0xFF);
+	const __m128i first = _mm_set1_epi32((int)crn_read_le32(pPixels)), gray_ignore = _mm_set1_epi32((int)0xFFFF0000U);
+	const __m128i half = _mm_set1_epi16(128), rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i min_len2 = _mm_set1_epi32(cCRNNormalMinLen2 - 1), max_len2 = _mm_set1_epi32(cCRNNormalMaxLen2 + 1), min_z = _mm_set1_epi32(cCRNNormalMinZ - 1);
+	const crn_bool normal = (pState->classes & cCRNTextureNormalMap) != 0;
+	__m128i opaque = ones, binary = ones, gray = ones, constant = ones, num_normal = zero, sum_x = zero, sum_y = zero;
+	crn_uint32 lanes[4];
+
+	for (; i + 4 <= end; i += 4)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(pPixels + i * 4));
+		const __m128i a = _mm_and_si128(_mm_srli_epi32(v, (int)alpha_component * 8), byte_mask);
+		const __m128i is_opaque = _mm_cmpeq_epi32(a, byte_mask);
+		opaque = _mm_and_si128(opaque, is_opaque);
+		binary = _mm_and_si128(binary, _mm_or_si128(is_opaque, _mm_cmpeq_epi32(a, zero)));
+		// R == G and G == B land in the low 2 bytes of each pixel's compare.
+		gray = _mm_and_si128(gray, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_srli_epi32(v, 8)), gray_ignore));
+		constant = _mm_and_si128(constant, _mm_cmpeq_epi32(v, first));
+		if (normal)
+		{
+			const __m128i lo = _mm_and_si128(_mm_sub_epi16(_mm_unpacklo_epi8(v, zero), half), rgb_mask);
+			const __m128i hi = _mm_and_si128(_mm_sub_epi16(_mm_unpackhi_epi8(v, zero), half), rgb_mask);
+			const __m128 m_lo = _mm_castsi128_ps(_mm_madd_epi16(lo, lo)), m_hi = _mm_castsi128_ps(_mm_madd_epi16(hi, hi));
+			// madd leaves x^2 + y^2 and z^2 of each pixel in adjacent lanes.
+			const __m128i len2 = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(m_lo, m_hi, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(m_lo, m_hi, _MM_SHUFFLE(3, 1, 3, 1))));
+			const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), byte_mask);
+			const __m128i ok = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(len2, min_len2), _mm_cmplt_epi32(len2, max_len2)), _mm_cmpgt_epi32(b, min_z));
+			num_normal = _mm_sub_epi32(num_normal, ok);
+			sum_x = _mm_add_epi32(sum_x, _mm_and_si128(v, byte_mask));
+			sum_y = _mm_add_epi32(sum_y, _mm_and_si128(_mm_srli_epi32(v, 8), byte_mask));
+		}
+	}
+
+	if (_mm_movemask_epi8(opaque) != 0xFFFF)
+		pState->classes &= ~(crn_uint32)cCRNTextureOpaque;
+	if (_mm_movemask_epi8(binary) != 0xFFFF)
+		pState->classes &= ~(crn_uint32)cCRNTextureBinaryAlpha;
+	if (_mm_movemask_epi8(gray) != 0xFFFF)
+		pState->classes &= ~(crn_uint32)cCRNTextureGrayscale;
+	if (_mm_movemask_epi8(constant) != 0xFFFF)
+		pState->classes &= ~(crn_uint32)cCRNTextureConstant;
+	_mm_storeu_si128((__m128i*)lanes, num_normal);
+	pState->num_normal += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm_storeu_si128((__m128i*)lanes, sum_x);
+	pState->sum_x += (crn_uint64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm_storeu_si128((__m128i*)lanes, sum_y);
+	pState->sum_y += (crn_uint64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	return i;
+}
+#endif
+
+crn_uint32 crn_analyze_image(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint32 alpha_component, crn_uint32 classes)
+{
+	const crn_uint32 max_outliers = num_pixels / cCRNNormalMaxOutliers;
+	crn_analyze_state state;
+	crn_uint32 i = 0;
+
+	memset(&state, 0, sizeof(state));
+	state.classes = classes & cCRNTextureAllClasses;
+	if (!num_pixels)
+		return state.classes & ~(crn_uint32)cCRNTextureNormalMap;
+
+	while (i < num_pixels && state.classes)
+	{
+		const crn_uint32 end = CRN_MIN(i + cCRNAnalyzeChunkPixels, num_pixels);
+#if CRN_SSE2
+		i = crn_analyze_chunk(pPixels, i, end, alpha_component, &state);
+#endif
+		for (; i < end; i++)
+			crn_analyze_pixel(pPixels + i * 4, pPixels, alpha_component, &state);
+		if (i - state.num_normal > max_outliers)
+			state.classes &= ~(crn_uint32)cCRNTextureNormalMap;
+	}
+
+	if (state.classes & cCRNTextureNormalMap)
+	{
+		const crn_uint64 lo = (crn_uint64)(128 - cCRNNormalMaxMean) * num_pixels, hi = (crn_uint64)(128 + cCRNNormalMaxMean) * num_pixels;
+		if (state.sum_x < lo || state.sum_x > hi || state.sum_y < lo || state.sum_y > hi)
+			state.classes &= ~(crn_uint32)cCRNTextureNormalMap;
+	}
+	return state.classes;
+}
@@ -0,0 +1,17 @@
+// File: crn_analyze.h - Source image classification (crn_texture_class) for format choice and encoder fast paths.
+#ifndef CRN_ANALYZE_H
+#define CRN_ANALYZE_H
+
+#include "crnlib.h"
+
+enum
+{
+	cCRNTextureAllClasses = cCRNTextureOpaque | cCRNTextureBinaryAlpha | cCRNTextureGrayscale | cCRNTextureConstant | cCRNTextureNormalMap
+};
+
+// Returns the subset of the crn_texture_class bits in classes that hold for num_pixels RGBA pixels, with alpha read
+// from byte alpha_component of each pixel. One SSE2 pass, which stops as soon as every requested class is ruled out.
+// cCRNTextureConstant compares whole pixels; callers combining several images also have to compare their first pixels.
+crn_uint32 crn_analyze_image(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint32 alpha_component, crn_uint32 classes);
+
+#endif // CRN_ANALYZE_H
@@ -0,0 +1,753 @@
+#include "crn_bc6h.h"
+#include "crn_core.h"
+
+#include <float.h>
+#include <math.h>
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+enum
+{
+	cCRNBC6HNumModes          = 14,
+	cCRNBC6HFirstOneRegionMode = 10,
+	cCRNBC6HNumPartitions     = 32,
+	cCRNBC6HMaxLayoutBits     = 80,  // Header bits after a 2 bit mode
+	cCRNBC6HMaxRanked         = 8,   // Partitions tried at cCRNDXTQualityUber
+	cCRNBC6HFieldPartition    = 12,  // Header bit field of the partition, see g_crn_bc6h_layouts
+	cCRNBC6HMaxHalf           = 0x7BFF
+};
+
+typedef struct
+{
+	crn_uint8 code;         // Mode bits, read LSB first
+	crn_uint8 code_bits;
+	crn_uint8 regions;
+	crn_uint8 transformed;  // Endpoints other than w are stored as signed deltas from w
+	crn_uint8 prec;         // Bits of w
+	crn_uint8 delta[3];     // Bits of the other endpoints, per channel
+} crn_bc6h_mode;
+
+static const crn_bc6h_mode g_crn_bc6h_modes[cCRNBC6HNumModes] =
+{
+	{ 0x00, 2, 2, 1, 10, { 5, 5, 5 } }, { 0x01, 2, 2, 1, 7, { 6, 6, 6 } }, { 0x02, 5, 2, 1, 11, { 5, 4, 4 } },
+	{ 0x06, 5, 2, 1, 11, { 4, 5, 4 } }, { 0x0A, 5, 2, 1, 11, { 4, 4, 5 } }, { 0x0E, 5, 2, 1, 9, { 5, 5, 5 } },
+	{ 0x12, 5, 2, 1, 8, { 6, 5, 5 } }, { 0x16, 5, 2, 1, 8, { 5, 6, 5 } }, { 0x1A, 5, 2, 1, 8, { 5, 5, 6 } },
+	{ 0x1E, 5, 2, 0, 6, { 6, 6, 6 } },
+	{ 0x03, 5, 1, 0, 10, { 10, 10, 10 } }, { 0x07, 5, 1, 1, 11, { 9, 9, 9 } }, { 0x0B, 5, 1, 1, 12, { 8, 8, 8 } },
+	{ 0x0F, 5, 1, 1, 16, { 4, 4, 4 } }
+};
+
+// The header bits following each mode's code, in block order. Each is field << 4 | bit, where the field is
+// endpoint * 3 + channel (endpoints w and x of region 0, y and z of region 1, channels RGB) or the partition.
+static const crn_uint8 g_crn_bc6h_layouts[cCRNBC6HNumModes][cCRNBC6HMaxLayoutBits] =
+{
+	{ // Mode 1
+		0x74, 0x84, 0xB4, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12,
+		0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0xA4, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44,
+		0xB0, 0xA0, 0xA1, 0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60,
+		0x61, 0x62, 0x63, 0x64, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 2
+		0x75, 0xA4, 0xA5, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0xB0, 0xB1, 0x84, 0x10, 0x11, 0x12,
+		0x13, 0x14, 0x15, 0x16, 0x85, 0xB2, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0xB3, 0xB5,
+		0xB4, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44,
+		0x45, 0xA0, 0xA1, 0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60,
+		0x61, 0x62, 0x63, 0x64, 0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 3
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x0A, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x1A, 0xB0, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x2A, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 4
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x0A, 0xA4, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x1A, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x2A, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0xB0, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x74, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 5
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x0A, 0x84, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x1A, 0xB0, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0x2A, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0xB1, 0xB2, 0x90, 0x91, 0x92, 0x93, 0xB4, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 6
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0xB4, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0xA4, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xB0, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 7
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xA4, 0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0xB2, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xB3, 0xB4, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x35, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xB0, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 8
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xB0, 0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x75, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xA5, 0xB4, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0xA4, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0xB1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 9
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xB1, 0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x85, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xB5, 0xB4, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0xA4, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xB0, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0xB2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xB3, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 10
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0xA4, 0xB0, 0xB1, 0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x75, 0x85, 0xB2, 0x74, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0xA5, 0xB3, 0xB5, 0xB4, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x35, 0x70, 0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xA0, 0xA1,
+		0xA2, 0xA3, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63,
+		0x64, 0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4
+	},
+	{ // Mode 11
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+		0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59
+	},
+	{ // Mode 12
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x0A, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+		0x48, 0x1A, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x2A
+	},
+	{ // Mode 13
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x0B, 0x0A, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+		0x1B, 0x1A, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x2B, 0x2A
+	},
+	{ // Mode 14
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+		0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31,
+		0x32, 0x33, 0x0F, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x40, 0x41, 0x42, 0x43, 0x1F, 0x1E, 0x1D, 0x1C,
+		0x1B, 0x1A, 0x50, 0x51, 0x52, 0x53, 0x2F, 0x2E, 0x2D, 0x2C, 0x2B, 0x2A
+	},
+};
+
+// Two region partitions, bit i is the region of pixel i.
+static const crn_uint16 g_crn_bc6h_partitions[cCRNBC6HNumPartitions] =
+{
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C
+};
+
+// Region 1's anchor pixel, whose index drops its top bit. Region 0's is always pixel 0.
+static const crn_uint8 g_crn_bc6h_anchors[cCRNBC6HNumPartitions] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2
+};
+
+static const int g_crn_bc6h_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int g_crn_bc6h_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Partitions tried, least squares passes and whether overflowing deltas get clamped, per quality tier.
+static const struct
+{
+	crn_uint8 partitions;
+	crn_uint8 refines;
+	crn_uint8 clamp;
+} g_crn_bc6h_tiers[cCRNDXTQualityTotal] =
+{
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 2, 1, 0 }, { 4, 1, 1 }, { cCRNBC6HMaxRanked, 2, 1 }
+};
+
+// -------- Bit packing
+
+static crn_uint32 crn_bc6h_read_bits(const crn_uint8* pSrc, crn_uint32* pOfs, crn_uint32 num_bits)
+{
+	crn_uint32 v = 0;
+	for (crn_uint32 i = 0; i < num_bits; i++, (*pOfs)++)
+		v |= (crn_uint32)((pSrc[*pOfs >> 3] >> (*pOfs & 7)) & 1) << i;
+	return v;
+}
+
+static void crn_bc6h_write_bits(crn_uint8* pDst, crn_uint32* pOfs, crn_uint32 v, crn_uint32 num_bits)
+{
+	for (crn_uint32 i = 0; i < num_bits; i++, (*pOfs)++)
+		pDst[*pOfs >> 3] |= (crn_uint8)(((v >> i) & 1) << (*pOfs & 7));
+}
+
+static crn_uint32 crn_bc6h_header_bits(const crn_bc6h_mode* pMode)
+{
+	return (pMode->regions == 2) ? 82 : 65;
+}
+
+// -------- Endpoints
+
+static int crn_bc6h_unquantize(int q, crn_uint32 prec)
+{
+	if (prec >= 15)
+		return q;
+	if (!q)
+		return 0;
+	if (q == (1 << prec) - 1)
+		return 0xFFFF;
+	return ((q << 16) + 0x8000) >> prec;
+}
+
+// Codes below 15 bits decode to the middle of their 2^(16 - prec) wide step, so e rounds down to its step.
+static int crn_bc6h_quantize(float e, crn_uint32 prec)
+{
+	const int q = (prec >= 15) ? (int)(e + 0.5f) : (int)(e * (float)(1 << prec) * (1.0f / 65536.0f));
+	return CRN_CLAMP(q, 0, (1 << prec) - 1);
+}
+
+// Half floats of a region's palette, planar. Interpolation and the final 31/64 scale are the decoder's.
+static void crn_bc6h_palette(const crn_bc6h_mode* pMode, const int endpoints[2][3], crn_uint32 levels, float pal[3][16])
+{
+	const int* pWeights = (levels == 8) ? g_crn_bc6h_weights3 : g_crn_bc6h_weights4;
+	for (int c = 0; c < 3; c++)
+	{
+		const int a = crn_bc6h_unquantize(endpoints[0][c], pMode->prec), b = crn_bc6h_unquantize(endpoints[1][c], pMode->prec);
+		for (crn_uint32 i = 0; i < levels; i++)
+			pal[c][i] = (float)((((a * (64 - pWeights[i]) + b * pWeights[i] + 32) >> 6) * 31) >> 6);
+	}
+}
+
+// Checks that the endpoints of a transformed mode lie within their delta bits of w. With clamp, endpoints that don't
+// are moved toward w until they do.
+static crn_bool crn_bc6h_fit_deltas(const crn_bc6h_mode* pMode, int endpoints[2][2][3], crn_bool clamp)
+{
+	for (crn_uint32 k = 1; k < pMode->regions * 2U; k++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const int lo = -(1 << (pMode->delta[c] - 1)), hi = (1 << (pMode->delta[c] - 1)) - 1;
+			const int d = endpoints[k >> 1][k & 1][c] - endpoints[0][0][c];
+			if (d >= lo && d <= hi)
+				continue;
+			if (!clamp)
+				return crn_false;
+			endpoints[k >> 1][k & 1][c] = endpoints[0][0][c] + CRN_CLAMP(d, lo, hi);
+		}
+	}
+	return crn_true;
+}
+
+// -------- Encoding
+
+// A block's pixels, planar. Targets are in the domain the decoder interpolates in, before its 31/64 scale: the middle
+// of the range that rounds back to each half, (h + 0.5) * 64 / 31. products holds r, g, b, rr, gg, bb, rg, rb, gb of
+// the targets, for crn_bc6h_sum_moments().
+typedef struct
+{
+	float h[3][16];
+	float products[9][16];
+} crn_bc6h_block;
+
+typedef struct
+{
+	float n;
+	float sums[9];  // Same order as crn_bc6h_block's products
+} crn_bc6h_moments;
+
+typedef struct
+{
+	float      error;
+	crn_uint32 mode;
+	crn_uint32 partition;
+	int        endpoints[2][2][3];  // [region][end][channel], quantized to the mode's precision, not delta coded
+	crn_uint8  indices[16];
+} crn_bc6h_solution;
+
+static crn_uint32 crn_bc6h_float_to_half(float f)
+{
+	crn_uint32 u, e, m;
+	if (!(f > 0.0f))
+		return 0;
+	if (f >= 65504.0f)
+		return cCRNBC6HMaxHalf;
+	memcpy(&u, &f, 4);
+	e = u >> 23;
+	m = u & 0x7FFFFF;
+	if (e >= 113)
+		return ((e - 112) << 10) + (m >> 13) + ((m >> 12) & 1);
+	if (e < 102)
+		return 0;
+	m |= 0x800000;
+	return (m + (1U << (125 - e))) >> (126 - e);
+}
+
+// Sums the moments of the pixels in mask (bit i = pixel i). Lanes are summed separately and combined at the end on
+// both paths, so they agree exactly.
+static void crn_bc6h_sum_moments(const crn_bc6h_block* pBlock, crn_uint32 mask, crn_bc6h_moments* pM)
+{
+	float lanes[4];
+	crn_uint32 n = 0;
+#if CRN_SSE2
+	const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+	__m128 sums[9];
+	for (crn_uint32 k = 0; k < 9; k++)
+		sums[k] = _mm_setzero_ps();
+	for (crn_uint32 g = 0; g < 16; g += 4)
+	{
+		const __m128i sel = _mm_set1_epi32((int)(mask >> g));
+		const __m128 in = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(sel, bits), bits));
+		for (crn_uint32 k = 0; k < 9; k++)
+			sums[k] = _mm_add_ps(sums[k], _mm_and_ps(in, _mm_loadu_ps(&pBlock->products[k][g])));
+	}
+	for (crn_uint32 k = 0; k < 9; k++)
+	{
+		_mm_storeu_ps(lanes, sums[k]);
+		pM->sums[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+#else
+	for (crn_uint32 k = 0; k < 9; k++)
+	{
+		lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0.0f;
+		for (crn_uint32 i = 0; i < 16; i++)
+			if ((mask >> i) & 1)
+				lanes[i & 3] += pBlock->products[k][i];
+		pM->sums[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+#endif
+	for (crn_uint32 i = 0; i < 16; i++)
+		n += (mask >> i) & 1;
+	pM->n = (float)n;
+}
+
+// Returns the squared distance of a region's pixels from their principal axis (the trace of the scatter matrix less
+// its largest eigenvalue), and the axis. The eigenvector comes from a few power iterations, starting at the row of
+// the channel with the most variance.
+static float crn_bc6h_principal_axis(const crn_bc6h_moments* pM, float axis[3])
+{
+	const float inv_n = 1.0f / pM->n;
+	const float* s = pM->sums;
+	float scatter[3][3], len, lambda = 0.0f;
+	crn_uint32 k = 0;
+
+	scatter[0][0] = s[3] - s[0] * s[0] * inv_n;
+	scatter[1][1] = s[4] - s[1] * s[1] * inv_n;
+	scatter[2][2] = s[5] - s[2] * s[2] * inv_n;
+	scatter[0][1] = scatter[1][0] = s[6] - s[0] * s[1] * inv_n;
+	scatter[0][2] = scatter[2][0] = s[7] - s[0] * s[2] * inv_n;
+	scatter[1][2] = scatter[2][1] = s[8] - s[1] * s[2] * inv_n;
+
+	if (scatter[1][1] > scatter[k][k])
+		k = 1;
+	if (scatter[2][2] > scatter[k][k])
+		k = 2;
+	axis[0] = scatter[k][0];
+	axis[1] = scatter[k][1];
+	axis[2] = scatter[k][2];
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		float v[3], max_v;
+		for (int c = 0; c < 3; c++)
+			v[c] = scatter[c][0] * axis[0] + scatter[c][1] * axis[1] + scatter[c][2] * axis[2];
+		max_v = CRN_MAX(CRN_MAX(fabsf(v[0]), fabsf(v[1])), fabsf(v[2]));
+		if (!(max_v > 0.0f))
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = v[c] / max_v;
+	}
+
+	len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (len > 0.0f)
+	{
+		for (int c = 0; c < 3; c++)
+			axis[c] /= len;
+		for (int c = 0; c < 3; c++)
+			lambda += axis[c] * (scatter[c][0] * axis[0] + scatter[c][1] * axis[1] + scatter[c][2] * axis[2]);
+	}
+	else
+	{
+		axis[0] = axis[1] = axis[2] = 0.57735027f;
+	}
+	return CRN_MAX(scatter[0][0] + scatter[1][1] + scatter[2][2] - lambda, 0.0f);
+}
+
+static float crn_bc6h_target(const crn_bc6h_block* pBlock, int c, crn_uint32 i)
+{
+	return pBlock->products[c][i];
+}
+
+// Endpoints spanning the projections of the pixels in mask onto their principal axis, ordered so that the anchor
+// pixel is closer to the first.
+static void crn_bc6h_fit_line(const crn_bc6h_block* pBlock, crn_uint32 mask, crn_uint32 anchor, float e[2][3])
+{
+	crn_bc6h_moments m;
+	float axis[3], mean[3], t_min = FLT_MAX, t_max = -FLT_MAX, t_anchor = 0.0f;
+
+	crn_bc6h_sum_moments(pBlock, mask, &m);
+	crn_bc6h_principal_axis(&m, axis);
+	for (int c = 0; c < 3; c++)
+		mean[c] = m.sums[c] / m.n;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		if (!((mask >> i) & 1))
+			continue;
+		for (int c = 0; c < 3; c++)
+			t += (crn_bc6h_target(pBlock, c, i) - mean[c]) * axis[c];
+		t_min = CRN_MIN(t_min, t);
+		t_max = CRN_MAX(t_max, t);
+		if (i == anchor)
+			t_anchor = t;
+	}
+	if (t_anchor - t_min > t_max - t_anchor)
+	{
+		const float t = t_min;
+		t_min = t_max;
+		t_max = t;
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		e[0][c] = CRN_CLAMP(mean[c] + axis[c] * t_min, 0.0f, 65535.0f);
+		e[1][c] = CRN_CLAMP(mean[c] + axis[c] * t_max, 0.0f, 65535.0f);
+	}
+}
+
+// Ranks the partitions by the summed principal axis error of their regions, keeping the best num_ranked.
+static void crn_bc6h_rank_partitions(const crn_bc6h_block* pBlock, crn_uint32 num_ranked, crn_uint32* pRanked)
+{
+	float errors[cCRNBC6HMaxRanked], axis[3];
+	crn_bc6h_moments all;
+	crn_uint32 n = 0;
+
+	crn_bc6h_sum_moments(pBlock, 0xFFFF, &all);
+	for (crn_uint32 p = 0; p < cCRNBC6HNumPartitions; p++)
+	{
+		crn_bc6h_moments m[2];
+		float error;
+		crn_uint32 i;
+
+		// Region 0 is what region 1 leaves of the whole block.
+		crn_bc6h_sum_moments(pBlock, g_crn_bc6h_partitions[p], &m[1]);
+		m[0].n = all.n - m[1].n;
+		for (crn_uint32 k = 0; k < 9; k++)
+			m[0].sums[k] = all.sums[k] - m[1].sums[k];
+		error = crn_bc6h_principal_axis(&m[0], axis) + crn_bc6h_principal_axis(&m[1], axis);
+
+		if (n == num_ranked && error >= errors[n - 1])
+			continue;
+		n = CRN_MIN(n + 1, num_ranked);
+		for (i = n - 1; i && errors[i - 1] > error; i--)
+		{
+			errors[i] = errors[i - 1];
+			pRanked[i] = pRanked[i - 1];
+		}
+		errors[i] = error;
+		pRanked[i] = p;
+	}
+}
+
+// Picks each pixel's closest entry of its region's palette (pal[region][channel][index]) by squared error over the
+// half floats, returning the total. Lane sums are combined the same way on both paths.
+static float crn_bc6h_assign(const crn_bc6h_block* pBlock, crn_uint32 mask, const float pal[2][3][16], crn_uint32 levels, crn_uint8 indices[16])
+{
+	float lanes[4];
+#if CRN_SSE2
+	const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+	__m128 total = _mm_setzero_ps();
+	for (crn_uint32 g = 0; g < 16; g += 4)
+	{
+		const __m128i sel = _mm_set1_epi32((int)(mask >> g));
+		const __m128 region1 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(sel, bits), bits));
+		const __m128 r = _mm_loadu_ps(&pBlock->h[0][g]), gr = _mm_loadu_ps(&pBlock->h[1][g]), b = _mm_loadu_ps(&pBlock->h[2][g]);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i best_index = _mm_setzero_si128();
+		crn_uint32 lane_indices[4];
+		for (crn_uint32 i = 0; i < levels; i++)
+		{
+			const __m128 pr = _mm_or_ps(_mm_and_ps(region1, _mm_set1_ps(pal[1][0][i])), _mm_andnot_ps(region1, _mm_set1_ps(pal[0][0][i])));
+			const __m128 pg = _mm_or_ps(_mm_and_ps(region1, _mm_set1_ps(pal[1][1][i])), _mm_andnot_ps(region1, _mm_set1_ps(pal[0][1][i])));
+			const __m128 pb = _mm_or_ps(_mm_and_ps(region1, _mm_set1_ps(pal[1][2][i])), _mm_andnot_ps(region1, _mm_set1_ps(pal[0][2][i])));
+			const __m128 dr = _mm_sub_ps(r, pr), dg = _mm_sub_ps(gr, pg), db = _mm_sub_ps(b, pb);
+			const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			const __m128i lt = _mm_castps_si128(_mm_cmplt_ps(error, best));
+			best = _mm_min_ps(error, best);
+			best_index = _mm_or_si128(_mm_and_si128(lt, _mm_set1_epi32((int)i)), _mm_andnot_si128(lt, best_index));
+		}
+		total = _mm_add_ps(total, best);
+		_mm_storeu_si128((__m128i*)lane_indices, best_index);
+		for (crn_uint32 j = 0; j < 4; j++)
+			indices[g + j] = (crn_uint8)lane_indices[j];
+	}
+	_mm_storeu_ps(lanes, total);
+#else
+	lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0.0f;
+	for (crn_uint32 p = 0; p < 16; p++)
+	{
+		const crn_uint32 region = (mask >> p) & 1;
+		float best = FLT_MAX;
+		crn_uint32 best_index = 0;
+		for (crn_uint32 i = 0; i < levels; i++)
+		{
+			const float dr = pBlock->h[0][p] - pal[region][0][i], dg = pBlock->h[1][p] - pal[region][1][i], db = pBlock->h[2][p] - pal[region][2][i];
+			const float error = (dr * dr + dg * dg) + db * db;
+			if (error < best)
+			{
+				best = error;
+				best_index = i;
+			}
+		}
+		lanes[p & 3] += best;
+		indices[p] = (crn_uint8)best_index;
+	}
+#endif
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Quantizes endpoints (e[region][end][channel], target domain) to a mode and picks the indices. Anchor pixels must have
+// an index in the lower half of the palette, so regions whose anchor doesn't are flipped. pSol->error is FLT_MAX if
+// the endpoints don't fit the mode.
+static void crn_bc6h_eval(const crn_bc6h_block* pBlock, crn_uint32 mode, crn_uint32 partition, const float e[2][2][3], crn_bool clamp, crn_bc6h_solution* pSol)
+{
+	const crn_bc6h_mode* pMode = &g_crn_bc6h_modes[mode];
+	const crn_uint32 mask = (pMode->regions == 2) ? g_crn_bc6h_partitions[partition] : 0;
+	const crn_uint32 levels = (pMode->regions == 2) ? 8 : 16;
+	float pal[2][3][16];
+	float error;
+
+	pSol->error = FLT_MAX;
+	pSol->mode = mode;
+	pSol->partition = partition;
+	memset(pSol->endpoints, 0, sizeof(pSol->endpoints));
+	for (crn_uint32 s = 0; s < pMode->regions; s++)
+		for (crn_uint32 k = 0; k < 2; k++)
+			for (int c = 0; c < 3; c++)
+				pSol->endpoints[s][k][c] = crn_bc6h_quantize(e[s][k][c], pMode->prec);
+	if (pMode->transformed && !crn_bc6h_fit_deltas(pMode, pSol->endpoints, clamp))
+		return;
+
+	for (crn_uint32 s = 0; s < pMode->regions; s++)
+		crn_bc6h_palette(pMode, (const int (*)[3])pSol->endpoints[s], levels, pal[s]);
+	if (pMode->regions == 1)
+		memcpy(pal[1], pal[0], sizeof(pal[0]));
+	error = crn_bc6h_assign(pBlock, mask, (const float (*)[3][16])pal, levels, pSol->indices);
+
+	// The weights are symmetric, so swapping a region's endpoints and mirroring its indices decodes the same.
+	for (crn_uint32 s = 0; s < pMode->regions; s++)
+	{
+		const crn_uint32 anchor = s ? g_crn_bc6h_anchors[partition] : 0;
+		if (pSol->indices[anchor] < levels / 2)
+			continue;
+		for (int c = 0; c < 3; c++)
+		{
+			const int t = pSol->endpoints[s][0][c];
+			pSol->endpoints[s][0][c] = pSol->endpoints[s][1][c];
+			pSol->endpoints[s][1][c] = t;
+		}
+		for (crn_uint32 i = 0; i < 16; i++)
+			if (((mask >> i) & 1) == s)
+				pSol->indices[i] = (crn_uint8)(levels - 1 - pSol->indices[i]);
+		// A new w moves every delta.
+		if (!s && pMode->transformed && !crn_bc6h_fit_deltas(pMode, pSol->endpoints, crn_false))
+			return;
+	}
+	pSol->error = error;
+}
+
+// Least squares endpoints (target domain) for a solution's indices. Regions whose pixels share one index get their
+// mean for both endpoints.
+static void crn_bc6h_refine(const crn_bc6h_block* pBlock, const crn_bc6h_solution* pSol, float e[2][2][3])
+{
+	const crn_bc6h_mode* pMode = &g_crn_bc6h_modes[pSol->mode];
+	const crn_uint32 mask = (pMode->regions == 2) ? g_crn_bc6h_partitions[pSol->partition] : 0;
+	const int* pWeights = (pMode->regions == 2) ? g_crn_bc6h_weights3 : g_crn_bc6h_weights4;
+
+	for (crn_uint32 s = 0; s < pMode->regions; s++)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, det, n = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const float b = (float)pWeights[pSol->indices[i]] * (1.0f / 64.0f), a = 1.0f - b;
+			if (((mask >> i) & 1) != s)
+				continue;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			n += 1.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				ax[c] += a * crn_bc6h_target(pBlock, c, i);
+				bx[c] += b * crn_bc6h_target(pBlock, c, i);
+			}
+		}
+		det = aa * bb - ab * ab;
+		for (int c = 0; c < 3; c++)
+		{
+			if (det < 1e-4f)
+			{
+				e[s][0][c] = e[s][1][c] = (ax[c] + bx[c]) / n;
+				continue;
+			}
+			e[s][0][c] = CRN_CLAMP((bb * ax[c] - ab * bx[c]) / det, 0.0f, 65535.0f);
+			e[s][1][c] = CRN_CLAMP((aa * bx[c] - ab * ax[c]) / det, 0.0f, 65535.0f);
+		}
+	}
+}
+
+// Evaluates a mode and partition from the given endpoints, refining them as the tier allows, and keeps the result in
+// *pBest if it beats it.
+static void crn_bc6h_try(const crn_bc6h_block* pBlock, crn_uint32 mode, crn_uint32 partition, const float e[2][2][3], crn_dxt_quality quality,
+	crn_bc6h_solution* pBest)
+{
+	crn_bc6h_solution sol, next;
+	float refined[2][2][3];
+
+	crn_bc6h_eval(pBlock, mode, partition, e, g_crn_bc6h_tiers[quality].clamp, &sol);
+	for (crn_uint32 r = 0; r < g_crn_bc6h_tiers[quality].refines && sol.error > 0.0f && sol.error < FLT_MAX; r++)
+	{
+		crn_bc6h_refine(pBlock, &sol, refined);
+		crn_bc6h_eval(pBlock, mode, partition, (const float (*)[2][3])refined, g_crn_bc6h_tiers[quality].clamp, &next);
+		if (next.error >= sol.error)
+			break;
+		sol = next;
+	}
+	if (sol.error < pBest->error)
+		*pBest = sol;
+}
+
+static void crn_bc6h_write_block(const crn_bc6h_solution* pSol, crn_uint8* pDst)
+{
+	const crn_bc6h_mode* pMode = &g_crn_bc6h_modes[pSol->mode];
+	const crn_uint32 layout_bits = crn_bc6h_header_bits(pMode) - pMode->code_bits;
+	const crn_uint32 mask = (pMode->regions == 2) ? g_crn_bc6h_partitions[pSol->partition] : 0;
+	const crn_uint32 index_bits = (pMode->regions == 2) ? 3 : 4;
+	int fields[4][3];
+	crn_uint32 ofs = 0;
+
+	memcpy(fields, pSol->endpoints, sizeof(fields));
+	for (crn_uint32 k = 1; pMode->transformed && k < 4; k++)
+		for (int c = 0; c < 3; c++)
+			fields[k][c] = (fields[k][c] - fields[0][c]) & ((1 << pMode->delta[c]) - 1);
+
+	memset(pDst, 0, 16);
+	crn_bc6h_write_bits(pDst, &ofs, pMode->code, pMode->code_bits);
+	for (crn_uint32 i = 0; i < layout_bits; i++)
+	{
+		const crn_uint32 field = g_crn_bc6h_layouts[pSol->mode][i] >> 4, bit = g_crn_bc6h_layouts[pSol->mode][i] & 15;
+		const crn_uint32 v = (field == cCRNBC6HFieldPartition) ? pSol->partition : (crn_uint32)fields[field / 3][field % 3];
+		crn_bc6h_write_bits(pDst, &ofs, v >> bit, 1);
+	}
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const crn_bool anchor = !i || (mask && i == g_crn_bc6h_anchors[pSol->partition]);
+		crn_bc6h_write_bits(pDst, &ofs, pSol->indices[i], index_bits - anchor);
+	}
+}
+
+void crn_bc6h_encode_block(const float pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality)
+{
+	crn_bc6h_block block;
+	crn_bc6h_solution best;
+	crn_uint32 ranked[cCRNBC6HMaxRanked];
+	float e[2][2][3];
+
+	quality = CRN_MIN(quality, cCRNDXTQualityUber);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const crn_uint32 h = crn_bc6h_float_to_half(pixels[i][c]);
+			block.h[c][i] = (float)h;
+			block.products[c][i] = ((float)h + 0.5f) * (64.0f / 31.0f);
+		}
+		for (int c = 0; c < 3; c++)
+			block.products[3 + c][i] = block.products[c][i] * block.products[c][i];
+		block.products[6][i] = block.products[0][i] * block.products[1][i];
+		block.products[7][i] = block.products[0][i] * block.products[2][i];
+		block.products[8][i] = block.products[1][i] * block.products[2][i];
+	}
+
+	// Zeroed so a block no mode fits still writes a valid mode 0 block.
+	memset(&best, 0, sizeof(best));
+	best.error = FLT_MAX;
+	crn_bc6h_fit_line(&block, 0xFFFF, 0, e[0]);
+	for (crn_uint32 mode = cCRNBC6HFirstOneRegionMode; mode < cCRNBC6HNumModes && best.error > 0.0f; mode++)
+		crn_bc6h_try(&block, mode, 0, (const float (*)[2][3])e, quality, &best);
+
+	if (g_crn_bc6h_tiers[quality].partitions && best.error > 0.0f)
+	{
+		crn_bc6h_rank_partitions(&block, g_crn_bc6h_tiers[quality].partitions, ranked);
+		for (crn_uint32 r = 0; r < g_crn_bc6h_tiers[quality].partitions && best.error > 0.0f; r++)
+		{
+			const crn_uint32 mask = g_crn_bc6h_partitions[ranked[r]];
+			crn_bc6h_fit_line(&block, ~mask & 0xFFFF, 0, e[0]);
+			crn_bc6h_fit_line(&block, mask, g_crn_bc6h_anchors[ranked[r]], e[1]);
+			for (crn_uint32 mode = 0; mode < cCRNBC6HFirstOneRegionMode && best.error > 0.0f; mode++)
+				crn_bc6h_try(&block, mode, ranked[r], (const float (*)[2][3])e, quality, &best);
+		}
+	}
+
+	crn_bc6h_write_block(&best, pDst);
+}
+
+// -------- Decoding
+
+void crn_bc6h_decode_block(const crn_uint8* pSrc, crn_uint16 pixels[16][3])
+{
+	const crn_bc6h_mode* pMode = NULL;
+	crn_uint32 ofs = 0, code = crn_bc6h_read_bits(pSrc, &ofs, 2), mode, partition = 0, mask, index_bits;
+	int endpoints[4][3];
+	const int* pWeights;
+
+	if (code >= 2)
+		code |= crn_bc6h_read_bits(pSrc, &ofs, 3) << 2;
+	for (mode = 0; mode < cCRNBC6HNumModes; mode++)
+	{
+		if (g_crn_bc6h_modes[mode].code == code && (g_crn_bc6h_modes[mode].code_bits == 2) == (code < 2))
+		{
+			pMode = &g_crn_bc6h_modes[mode];
+			break;
+		}
+	}
+	if (!pMode)
+	{
+		memset(pixels, 0, 16 * sizeof(pixels[0]));
+		return;
+	}
+
+	memset(endpoints, 0, sizeof(endpoints));
+	for (crn_uint32 i = 0; i < crn_bc6h_header_bits(pMode) - pMode->code_bits; i++)
+	{
+		const crn_uint32 field = g_crn_bc6h_layouts[mode][i] >> 4, bit = g_crn_bc6h_layouts[mode][i] & 15;
+		const crn_uint32 v = crn_bc6h_read_bits(pSrc, &ofs, 1);
+		if (field == cCRNBC6HFieldPartition)
+			partition |= v << bit;
+		else
+			endpoints[field / 3][field % 3] |= (int)(v << bit);
+	}
+	for (crn_uint32 k = 1; pMode->transformed && k < pMode->regions * 2U; k++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const int sign = 1 << (pMode->delta[c] - 1);
+			endpoints[k][c] = (endpoints[0][c] + ((endpoints[k][c] ^ sign) - sign)) & ((1 << pMode->prec) - 1);
+		}
+	}
+	for (crn_uint32 k = 0; k < pMode->regions * 2U; k++)
+		for (int c = 0; c < 3; c++)
+			endpoints[k][c] = crn_bc6h_unquantize(endpoints[k][c], pMode->prec);
+
+	mask = (pMode->regions == 2) ? g_crn_bc6h_partitions[partition] : 0;
+	index_bits = (pMode->regions == 2) ? 3 : 4;
+	pWeights = (pMode->regions == 2) ? g_crn_bc6h_weights3 : g_crn_bc6h_weights4;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const crn_uint32 s = (mask >> i) & 1;
+		const crn_bool anchor = !i || (mask && i == g_crn_bc6h_anchors[partition]);
+		const int w = pWeights[crn_bc6h_read_bits(pSrc, &ofs, index_bits - anchor)];
+		for (int c = 0; c < 3; c++)
+			pixels[i][c] = (crn_uint16)((((endpoints[s * 2][c] * (64 - w) + endpoints[s * 2 + 1][c] * w + 32) >> 6) * 31) >> 6);
+	}
+}
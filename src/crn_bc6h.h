@@ -0,0 +1,20 @@
+// File: crn_bc6h.h - BC6H (unsigned half float) block encoding and decoding.
+#ifndef CRN_BC6H_H
+#define CRN_BC6H_H
+
+#include "crnlib.h"
+
+// Encodes 16 RGBA float pixels (alpha ignored) to a 16 byte BC6H_UF16 block. Pixels are rounded to half floats first:
+// negative values and NaNs become 0, anything beyond the largest half (65504) becomes it. Two region candidates come
+// from the partitions whose regions lie closest to a line each; the quality tier controls how many are tried:
+//  SuperFast: the 4 one region modes only.
+//  Fast:      + the 10 two region modes on the best partition.
+//  Normal:    + the 2 best partitions, and a least squares pass over each candidate's endpoints.
+//  Better:    the 4 best partitions, also trying modes whose endpoint deltas overflow, clamped.
+//  Uber:      the 8 best partitions, and up to 2 least squares passes.
+void crn_bc6h_encode_block(const float pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality);
+
+// Decodes a 16 byte BC6H_UF16 block to 16 RGB half floats. Blocks with a reserved mode decode to 0.
+void crn_bc6h_decode_block(const crn_uint8* pSrc, crn_uint16 pixels[16][3]);
+
+#endif // CRN_BC6H_H
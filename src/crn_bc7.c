@@ -0,0 +1,989 @@
+#include "crn_bc7.h"
+#include "crn_core.h"
+
+#include <float.h>
+#include <math.h>
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+enum
+{
+	cCRNBC7NumModes       = 8,
+	cCRNBC7NumPartitions  = 64,
+	cCRNBC7Mode0Partitions = 16,  // Mode 0 has 4 partition bits
+	cCRNBC7MaxRanked      = 16    // Two subset partitions tried at cCRNDXTQualityUber
+};
+
+typedef struct
+{
+	crn_uint8 subsets;
+	crn_uint8 partition_bits;
+	crn_uint8 rotation_bits;
+	crn_uint8 selection_bits;  // Mode 4's index selection: set if color takes the second index set
+	crn_uint8 color_bits;
+	crn_uint8 alpha_bits;      // 0 for opaque modes, which decode alpha as 255
+	crn_uint8 endpoint_pbits;  // A p-bit per endpoint
+	crn_uint8 shared_pbits;    // A p-bit per subset
+	crn_uint8 index_bits;
+	crn_uint8 index2_bits;     // Modes 4 and 5 index alpha (or the channel rotated into it) apart from color
+} crn_bc7_mode;
+
+static const crn_bc7_mode g_crn_bc7_modes[cCRNBC7NumModes] =
+{
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 }, { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 }, { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 }, { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 }, { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 }, { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+// Two subset partitions, bit i is the subset of pixel i. The first 32 are BC6H's.
+static const crn_uint16 g_crn_bc7_partitions2[cCRNBC7NumPartitions] =
+{
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Three subset partitions, bits 2i and 2i + 1 are the subset of pixel i.
+static const crn_uint32 g_crn_bc7_partitions3[cCRNBC7NumPartitions] =
+{
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+};
+
+// Anchor pixels of the subsets after the first, whose indices drop their top bit. Subset 0's is always pixel 0.
+static const crn_uint8 g_crn_bc7_anchors2[cCRNBC7NumPartitions] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+};
+
+static const crn_uint8 g_crn_bc7_anchors3[2][cCRNBC7NumPartitions] =
+{
+	{
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	},
+	{
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	}
+};
+
+static const int g_crn_bc7_weights2[4] = { 0, 21, 43, 64 };
+static const int g_crn_bc7_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int g_crn_bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Channel pairs of the second moments in crn_bc7_block's products.
+static const crn_uint8 g_crn_bc7_pairs[10][2] =
+{
+	{ 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 3 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 }
+};
+
+// Two and three subset partitions tried, least squares passes and whether modes 4 and 5 try every rotation, per
+// quality tier.
+static const struct
+{
+	crn_uint8 partitions2;
+	crn_uint8 partitions3;
+	crn_uint8 refines;
+	crn_uint8 rotations;
+} g_crn_bc7_tiers[cCRNDXTQualityTotal] =
+{
+	{ 1, 0, 0, 0 }, { 2, 1, 1, 0 }, { 4, 2, 1, 1 }, { 8, 4, 2, 1 }, { cCRNBC7MaxRanked, 8, 2, 1 }
+};
+
+// -------- Bit packing
+
+static crn_uint32 crn_bc7_read_bits(const crn_uint8* pSrc, crn_uint32* pOfs, crn_uint32 num_bits)
+{
+	crn_uint32 v = 0;
+	for (crn_uint32 i = 0; i < num_bits; i++, (*pOfs)++)
+		v |= (crn_uint32)((pSrc[*pOfs >> 3] >> (*pOfs & 7)) & 1) << i;
+	return v;
+}
+
+static void crn_bc7_write_bits(crn_uint8* pDst, crn_uint32* pOfs, crn_uint32 v, crn_uint32 num_bits)
+{
+	for (crn_uint32 i = 0; i < num_bits; i++, (*pOfs)++)
+		pDst[*pOfs >> 3] |= (crn_uint8)(((v >> i) & 1) << (*pOfs & 7));
+}
+
+// -------- Partitions
+
+// Pixel masks of a partition's subsets, bit i = pixel i.
+static void crn_bc7_masks(crn_uint32 subsets, crn_uint32 partition, crn_uint32 masks[3])
+{
+	masks[1] = masks[2] = 0;
+	if (subsets == 2)
+	{
+		masks[1] = g_crn_bc7_partitions2[partition];
+	}
+	else if (subsets == 3)
+	{
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const crn_uint32 s = (g_crn_bc7_partitions3[partition] >> (i * 2)) & 3;
+			if (s)
+				masks[s] |= 1U << i;
+		}
+	}
+	masks[0] = ~(masks[1] | masks[2]) & 0xFFFF;
+}
+
+static crn_uint32 crn_bc7_anchor(crn_uint32 subsets, crn_uint32 partition, crn_uint32 subset)
+{
+	if (!subset)
+		return 0;
+	return (subsets == 2) ? g_crn_bc7_anchors2[partition] : g_crn_bc7_anchors3[subset - 1][partition];
+}
+
+static const int* crn_bc7_weights(crn_uint32 index_bits)
+{
+	return (index_bits == 2) ? g_crn_bc7_weights2 : ((index_bits == 3) ? g_crn_bc7_weights3 : g_crn_bc7_weights4);
+}
+
+// -------- Endpoints
+
+// Expands a code of bits bits (p-bit included) to 8 bits by replicating its top bits.
+static int crn_bc7_expand(int code, crn_uint32 bits)
+{
+	return (code << (8 - bits)) | (code >> (2 * bits - 8));
+}
+
+// Quantizes an endpoint (0-255 per channel) to the mode's codes, with p-bit p below them in modes that have p-bits,
+// and returns the squared error of its expansion. Channels the mode doesn't store expand to 255.
+static float crn_bc7_quantize_endpoint(const crn_bc7_mode* pMode, const float e[4], crn_uint32 p, int codes[4], int expanded[4])
+{
+	const crn_uint32 has_p = pMode->endpoint_pbits | pMode->shared_pbits;
+	float error = 0.0f;
+
+	for (int c = 0; c < 4; c++)
+	{
+		const crn_uint32 bits = (c < 3) ? pMode->color_bits : pMode->alpha_bits, total = bits + has_p;
+		float d;
+		if (!bits)
+		{
+			codes[c] = 0;
+			expanded[c] = 255;
+		}
+		else
+		{
+			const float steps = e[c] * (float)((1 << total) - 1) * (1.0f / 255.0f) - (float)(p & has_p);
+			const int q = (int)floorf(steps / (float)(1 << has_p) + 0.5f);
+			codes[c] = CRN_CLAMP(q, 0, (1 << bits) - 1);
+			expanded[c] = crn_bc7_expand((codes[c] << has_p) | (int)(p & has_p), total);
+		}
+		d = e[c] - (float)expanded[c];
+		error += d * d;
+	}
+	return error;
+}
+
+// Quantizes an endpoint with whichever p-bit expands closer to it, and returns that p-bit.
+static crn_uint32 crn_bc7_quantize_best(const crn_bc7_mode* pMode, const float e[4], int codes[4], int expanded[4])
+{
+	int codes1[4], expanded1[4];
+	const float error0 = crn_bc7_quantize_endpoint(pMode, e, 0, codes, expanded);
+	if (!pMode->endpoint_pbits || crn_bc7_quantize_endpoint(pMode, e, 1, codes1, expanded1) >= error0)
+		return 0;
+	memcpy(codes, codes1, sizeof(codes1));
+	memcpy(expanded, expanded1, sizeof(expanded1));
+	return 1;
+}
+
+// -------- Encoding
+
+// A block's pixels, planar. products holds r, g, b, a and then the products of the channel pairs in g_crn_bc7_pairs,
+// for crn_bc7_sum_moments(). Modes 4 and 5 encode blocks with a channel rotated into alpha.
+typedef struct
+{
+	float products[14][16];
+} crn_bc7_block;
+
+typedef struct
+{
+	float n;
+	float sums[14];  // Same order as crn_bc7_block's products
+} crn_bc7_moments;
+
+typedef struct
+{
+	float      error;
+	crn_uint32 mode;
+	crn_uint32 partition;
+	crn_uint32 rotation;
+	crn_uint32 selection;
+	int        endpoints[3][2][4];  // [subset][end][channel] codes, without p-bits
+	crn_uint8  pbits[3][2];
+	crn_uint8  indices[16];         // The first index set
+	crn_uint8  indices2[16];        // Modes 4 and 5's second index set
+} crn_bc7_solution;
+
+// Rotation r swaps alpha with channel r - 1, which the decoder undoes.
+static void crn_bc7_init_block(const crn_uint8 pixels[16][4], crn_uint32 rotation, crn_bc7_block* pBlock)
+{
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		for (crn_uint32 c = 0; c < 4; c++)
+		{
+			crn_uint32 src = c;
+			if (rotation && c == 3)
+				src = rotation - 1;
+			else if (rotation && c == rotation - 1)
+				src = 3;
+			pBlock->products[c][i] = (float)pixels[i][src];
+		}
+		for (crn_uint32 k = 0; k < 10; k++)
+			pBlock->products[4 + k][i] = pBlock->products[g_crn_bc7_pairs[k][0]][i] * pBlock->products[g_crn_bc7_pairs[k][1]][i];
+	}
+}
+
+// Sums the moments of the pixels in mask (bit i = pixel i). Lanes are summed separately and combined at the end on
+// both paths, so they agree exactly.
+static void crn_bc7_sum_moments(const crn_bc7_block* pBlock, crn_uint32 mask, crn_bc7_moments* pM)
+{
+	float lanes[4];
+	crn_uint32 n = 0;
+#if CRN_SSE2
+	const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+	__m128 sums[14];
+	for (crn_uint32 k = 0; k < 14; k++)
+		sums[k] = _mm_setzero_ps();
+	for (crn_uint32 g = 0; g < 16; g += 4)
+	{
+		const __m128i sel = _mm_set1_epi32((int)(mask >> g));
+		const __m128 in = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(sel, bits), bits));
+		for (crn_uint32 k = 0; k < 14; k++)
+			sums[k] = _mm_add_ps(sums[k], _mm_and_ps(in, _mm_loadu_ps(&pBlock->products[k][g])));
+	}
+	for (crn_uint32 k = 0; k < 14; k++)
+	{
+		_mm_storeu_ps(lanes, sums[k]);
+		pM->sums[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+#else
+	for (crn_uint32 k = 0; k < 14; k++)
+	{
+		lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0.0f;
+		for (crn_uint32 i = 0; i < 16; i++)
+			if ((mask >> i) & 1)
+				lanes[i & 3] += pBlock->products[k][i];
+		pM->sums[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+#endif
+	for (crn_uint32 i = 0; i < 16; i++)
+		n += (mask >> i) & 1;
+	pM->n = (float)n;
+}
+
+// Returns the squared distance of a subset's pixels from their principal axis over the first channels (the trace of
+// the scatter matrix less its largest eigenvalue), and the axis. The eigenvector comes from a few power iterations,
+// starting at the row of the channel with the most variance.
+static float crn_bc7_principal_axis(const crn_bc7_moments* pM, crn_uint32 channels, float axis[4])
+{
+	const float inv_n = 1.0f / pM->n;
+	const float* s = pM->sums;
+	float scatter[4][4], len, trace = 0.0f, lambda = 0.0f;
+	crn_uint32 k = 0;
+
+	memset(scatter, 0, sizeof(scatter));
+	for (crn_uint32 j = 0; j < 10; j++)
+	{
+		const crn_uint32 a = g_crn_bc7_pairs[j][0], b = g_crn_bc7_pairs[j][1];
+		if (a < channels && b < channels)
+			scatter[a][b] = scatter[b][a] = s[4 + j] - s[a] * s[b] * inv_n;
+	}
+	for (crn_uint32 c = 0; c < channels; c++)
+	{
+		trace += scatter[c][c];
+		if (scatter[c][c] > scatter[k][k])
+			k = c;
+	}
+
+	memcpy(axis, scatter[k], sizeof(scatter[k]));
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		float v[4], max_v = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			v[c] = scatter[c][0] * axis[0] + scatter[c][1] * axis[1] + scatter[c][2] * axis[2] + scatter[c][3] * axis[3];
+			max_v = CRN_MAX(max_v, fabsf(v[c]));
+		}
+		if (!(max_v > 0.0f))
+			break;
+		for (int c = 0; c < 4; c++)
+			axis[c] = v[c] / max_v;
+	}
+
+	len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+	if (len > 0.0f)
+	{
+		for (int c = 0; c < 4; c++)
+			axis[c] /= len;
+		for (int c = 0; c < 4; c++)
+			lambda += axis[c] * (scatter[c][0] * axis[0] + scatter[c][1] * axis[1] + scatter[c][2] * axis[2] + scatter[c][3] * axis[3]);
+	}
+	else
+	{
+		for (crn_uint32 c = 0; c < 4; c++)
+			axis[c] = (c < channels) ? 1.0f / sqrtf((float)channels) : 0.0f;
+	}
+	return CRN_MAX(trace - lambda, 0.0f);
+}
+
+// Endpoints spanning the projections of the pixels in mask onto their principal axis over the first channels, ordered
+// so that the anchor pixel is closer to the first. Other channels get the pixels' mean.
+static void crn_bc7_fit_line(const crn_bc7_block* pBlock, crn_uint32 mask, crn_uint32 anchor, crn_uint32 channels, float e[2][4])
+{
+	crn_bc7_moments m;
+	float axis[4], mean[4], t_min = FLT_MAX, t_max = -FLT_MAX, t_anchor = 0.0f;
+
+	crn_bc7_sum_moments(pBlock, mask, &m);
+	crn_bc7_principal_axis(&m, channels, axis);
+	for (int c = 0; c < 4; c++)
+		mean[c] = m.sums[c] / m.n;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		if (!((mask >> i) & 1))
+			continue;
+		for (int c = 0; c < 4; c++)
+			t += (pBlock->products[c][i] - mean[c]) * axis[c];
+		t_min = CRN_MIN(t_min, t);
+		t_max = CRN_MAX(t_max, t);
+		if (i == anchor)
+			t_anchor = t;
+	}
+	if (t_anchor - t_min > t_max - t_anchor)
+	{
+		const float t = t_min;
+		t_min = t_max;
+		t_max = t;
+	}
+	for (int c = 0; c < 4; c++)
+	{
+		e[0][c] = CRN_CLAMP(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+		e[1][c] = CRN_CLAMP(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+	}
+}
+
+// Moments of 4 subsets at once, one per lane.
+typedef struct
+{
+	float n[4];
+	float sums[14][4];
+} crn_bc7_moments4;
+
+// Sums the moments of the pixels in each of 4 masks. Both paths add the pixels in order, so they agree exactly.
+static void crn_bc7_sum_moments4(const crn_bc7_block* pBlock, const crn_uint32 masks[4], crn_bc7_moments4* pM)
+{
+#if CRN_SSE2
+	const __m128i lane_masks = _mm_set_epi32((int)masks[3], (int)masks[2], (int)masks[1], (int)masks[0]);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 sums[14], n = _mm_setzero_ps();
+	for (crn_uint32 k = 0; k < 14; k++)
+		sums[k] = _mm_setzero_ps();
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const __m128i bit = _mm_set1_epi32(1 << i);
+		const __m128 in = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(lane_masks, bit), bit));
+		n = _mm_add_ps(n, _mm_and_ps(in, one));
+		for (crn_uint32 k = 0; k < 14; k++)
+			sums[k] = _mm_add_ps(sums[k], _mm_and_ps(in, _mm_set1_ps(pBlock->products[k][i])));
+	}
+	_mm_storeu_ps(pM->n, n);
+	for (crn_uint32 k = 0; k < 14; k++)
+		_mm_storeu_ps(pM->sums[k], sums[k]);
+#else
+	for (crn_uint32 j = 0; j < 4; j++)
+	{
+		pM->n[j] = 0.0f;
+		for (crn_uint32 k = 0; k < 14; k++)
+			pM->sums[k][j] = 0.0f;
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			if (!((masks[j] >> i) & 1))
+				continue;
+			pM->n[j] += 1.0f;
+			for (crn_uint32 k = 0; k < 14; k++)
+				pM->sums[k][j] += pBlock->products[k][i];
+		}
+	}
+#endif
+}
+
+// crn_bc7_principal_axis()'s error over all 4 channels for 4 subsets at once. The SSE2 path repeats the scalar one's
+// operations lane by lane, so both rank partitions the same.
+static void crn_bc7_line_errors4(const crn_bc7_moments4* pM, float errors[4])
+{
+#if CRN_SSE2
+	const __m128 zero = _mm_setzero_ps(), sign = _mm_set1_ps(-0.0f);
+	const __m128 inv_n = _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(pM->n));
+	__m128 scatter[4][4], axis[4], best, trace, lambda = zero, len, valid;
+
+	for (crn_uint32 j = 0; j < 10; j++)
+	{
+		const crn_uint32 a = g_crn_bc7_pairs[j][0], b = g_crn_bc7_pairs[j][1];
+		scatter[a][b] = scatter[b][a] = _mm_sub_ps(_mm_loadu_ps(pM->sums[4 + j]), _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(pM->sums[a]), _mm_loadu_ps(pM->sums[b])), inv_n));
+	}
+	best = scatter[0][0];
+	trace = _mm_add_ps(zero, scatter[0][0]);
+	for (int c = 0; c < 4; c++)
+		axis[c] = scatter[0][c];
+	for (int r = 1; r < 4; r++)
+	{
+		const __m128 gt = _mm_cmpgt_ps(scatter[r][r], best);
+		trace = _mm_add_ps(trace, scatter[r][r]);
+		best = _mm_or_ps(_mm_and_ps(gt, scatter[r][r]), _mm_andnot_ps(gt, best));
+		for (int c = 0; c < 4; c++)
+			axis[c] = _mm_or_ps(_mm_and_ps(gt, scatter[r][c]), _mm_andnot_ps(gt, axis[c]));
+	}
+
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		__m128 v[4], max_v = zero;
+		for (int c = 0; c < 4; c++)
+		{
+			v[c] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(scatter[c][0], axis[0]), _mm_mul_ps(scatter[c][1], axis[1])), _mm_mul_ps(scatter[c][2], axis[2])), _mm_mul_ps(scatter[c][3], axis[3]));
+			max_v = _mm_max_ps(max_v, _mm_andnot_ps(sign, v[c]));
+		}
+		valid = _mm_cmpgt_ps(max_v, zero);
+		for (int c = 0; c < 4; c++)
+			axis[c] = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(v[c], max_v)), _mm_andnot_ps(valid, axis[c]));
+	}
+
+	len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(axis[0], axis[0]), _mm_mul_ps(axis[1], axis[1])), _mm_mul_ps(axis[2], axis[2])), _mm_mul_ps(axis[3], axis[3])));
+	valid = _mm_cmpgt_ps(len, zero);
+	for (int c = 0; c < 4; c++)
+		axis[c] = _mm_div_ps(axis[c], len);
+	for (int c = 0; c < 4; c++)
+	{
+		const __m128 v = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(scatter[c][0], axis[0]), _mm_mul_ps(scatter[c][1], axis[1])), _mm_mul_ps(scatter[c][2], axis[2])), _mm_mul_ps(scatter[c][3], axis[3]));
+		lambda = _mm_add_ps(lambda, _mm_mul_ps(axis[c], v));
+	}
+	lambda = _mm_and_ps(valid, lambda);
+	_mm_storeu_ps(errors, _mm_max_ps(_mm_sub_ps(trace, lambda), zero));
+#else
+	for (crn_uint32 j = 0; j < 4; j++)
+	{
+		crn_bc7_moments m;
+		float axis[4];
+		m.n = pM->n[j];
+		for (crn_uint32 k = 0; k < 14; k++)
+			m.sums[k] = pM->sums[k][j];
+		errors[j] = crn_bc7_principal_axis(&m, 4, axis);
+	}
+#endif
+}
+
+// Fills errors with the summed distance of each partition's subsets from their principal axes. No encoding with the
+// partition can do better, which is what lets candidates be skipped. Partitions are measured 4 at a time.
+static void crn_bc7_partition_errors(const crn_bc7_block* pBlock, crn_uint32 subsets, float errors[cCRNBC7NumPartitions])
+{
+	crn_bc7_moments all;
+
+	crn_bc7_sum_moments(pBlock, 0xFFFF, &all);
+	for (crn_uint32 p = 0; p < cCRNBC7NumPartitions; p += 4)
+	{
+		crn_bc7_moments4 m[3];
+		crn_uint32 masks[3][4];
+		float subset_errors[4];
+
+		for (crn_uint32 j = 0; j < 4; j++)
+		{
+			crn_uint32 partition_masks[3];
+			crn_bc7_masks(subsets, p + j, partition_masks);
+			for (crn_uint32 s = 0; s < 3; s++)
+				masks[s][j] = partition_masks[s];
+			errors[p + j] = 0.0f;
+		}
+		// Subset 0 is what the others leave of the whole block.
+		for (crn_uint32 j = 0; j < 4; j++)
+		{
+			m[0].n[j] = all.n;
+			for (crn_uint32 k = 0; k < 14; k++)
+				m[0].sums[k][j] = all.sums[k];
+		}
+		for (crn_uint32 s = 1; s < subsets; s++)
+		{
+			crn_bc7_sum_moments4(pBlock, masks[s], &m[s]);
+			for (crn_uint32 j = 0; j < 4; j++)
+			{
+				m[0].n[j] -= m[s].n[j];
+				for (crn_uint32 k = 0; k < 14; k++)
+					m[0].sums[k][j] -= m[s].sums[k][j];
+			}
+		}
+		for (crn_uint32 s = 0; s < subsets; s++)
+		{
+			crn_bc7_line_errors4(&m[s], subset_errors);
+			for (crn_uint32 j = 0; j < 4; j++)
+				errors[p + j] += subset_errors[j];
+		}
+	}
+}
+
+// Keeps the num_ranked partitions below count with the lowest errors, best first.
+static void crn_bc7_rank_partitions(const float errors[cCRNBC7NumPartitions], crn_uint32 count, crn_uint32 num_ranked, crn_uint32* pRanked)
+{
+	crn_uint32 n = 0;
+	for (crn_uint32 p = 0; p < count; p++)
+	{
+		crn_uint32 i;
+		if (n == num_ranked && errors[p] >= errors[pRanked[n - 1]])
+			continue;
+		n = CRN_MIN(n + 1, num_ranked);
+		for (i = n - 1; i && errors[pRanked[i - 1]] > errors[p]; i--)
+			pRanked[i] = pRanked[i - 1];
+		pRanked[i] = p;
+	}
+}
+
+// Picks each pixel's closest entry of its subset's palette (pal[subset][channel][index]) by squared error over
+// num_channels channels from first, returning the total. Lane sums are combined the same way on both paths.
+static float crn_bc7_assign(const crn_bc7_block* pBlock, const crn_uint32 masks[3], const float pal[3][4][16], crn_uint32 levels, crn_uint32 first,
+	crn_uint32 num_channels, crn_uint8 indices[16])
+{
+	float lanes[4];
+#if CRN_SSE2
+	const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+	__m128 total = _mm_setzero_ps();
+	for (crn_uint32 g = 0; g < 16; g += 4)
+	{
+		const __m128i sel1 = _mm_set1_epi32((int)(masks[1] >> g)), sel2 = _mm_set1_epi32((int)(masks[2] >> g));
+		const __m128 in1 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(sel1, bits), bits));
+		const __m128 in2 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(sel2, bits), bits));
+		__m128 px[4], best = _mm_set1_ps(FLT_MAX);
+		__m128i best_index = _mm_setzero_si128();
+		crn_uint32 lane_indices[4];
+
+		for (crn_uint32 c = 0; c < num_channels; c++)
+			px[c] = _mm_loadu_ps(&pBlock->products[first + c][g]);
+		for (crn_uint32 i = 0; i < levels; i++)
+		{
+			__m128 error = _mm_setzero_ps();
+			__m128i lt;
+			for (crn_uint32 c = 0; c < num_channels; c++)
+			{
+				const crn_uint32 ch = first + c;
+				__m128 p = _mm_or_ps(_mm_and_ps(in1, _mm_set1_ps(pal[1][ch][i])), _mm_andnot_ps(in1, _mm_set1_ps(pal[0][ch][i])));
+				__m128 d;
+				p = _mm_or_ps(_mm_and_ps(in2, _mm_set1_ps(pal[2][ch][i])), _mm_andnot_ps(in2, p));
+				d = _mm_sub_ps(px[c], p);
+				error = _mm_add_ps(error, _mm_mul_ps(d, d));
+			}
+			lt = _mm_castps_si128(_mm_cmplt_ps(error, best));
+			best = _mm_min_ps(error, best);
+			best_index = _mm_or_si128(_mm_and_si128(lt, _mm_set1_epi32((int)i)), _mm_andnot_si128(lt, best_index));
+		}
+		total = _mm_add_ps(total, best);
+		_mm_storeu_si128((__m128i*)lane_indices, best_index);
+		for (crn_uint32 j = 0; j < 4; j++)
+			indices[g + j] = (crn_uint8)lane_indices[j];
+	}
+	_mm_storeu_ps(lanes, total);
+#else
+	lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0.0f;
+	for (crn_uint32 p = 0; p < 16; p++)
+	{
+		const crn_uint32 s = ((masks[1] >> p) & 1) ? 1 : (((masks[2] >> p) & 1) ? 2 : 0);
+		float best = FLT_MAX;
+		crn_uint32 best_index = 0;
+		for (crn_uint32 i = 0; i < levels; i++)
+		{
+			float error = 0.0f;
+			for (crn_uint32 c = first; c < first + num_channels; c++)
+			{
+				const float d = pBlock->products[c][p] - pal[s][c][i];
+				error += d * d;
+			}
+			if (error < best)
+			{
+				best = error;
+				best_index = i;
+			}
+		}
+		lanes[p & 3] += best;
+		indices[p] = (crn_uint8)best_index;
+	}
+#endif
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Quantizes endpoints (e[subset][end][channel], 0-255) to a mode and picks the indices. Modes 4 and 5 take their
+// separately indexed channel from alpha. Each anchor pixel must have an index in the lower half of the palette, so
+// subsets (and scalar channels) whose anchor doesn't are flipped.
+static void crn_bc7_eval(const crn_bc7_block* pBlock, crn_uint32 mode, crn_uint32 partition, crn_uint32 rotation, crn_uint32 selection,
+	const float e[3][2][4], crn_bc7_solution* pSol)
+{
+	const crn_bc7_mode* pMode = &g_crn_bc7_modes[mode];
+	const crn_bool separate = pMode->index2_bits != 0;
+	const crn_uint32 color_bits = selection ? pMode->index2_bits : pMode->index_bits;
+	const crn_uint32 scalar_bits = selection ? pMode->index_bits : pMode->index2_bits;
+	const crn_uint32 color_levels = 1U << color_bits, scalar_levels = 1U << scalar_bits;
+	crn_uint8* pColor = selection ? pSol->indices2 : pSol->indices;
+	crn_uint8* pScalar = selection ? pSol->indices : pSol->indices2;
+	crn_uint32 masks[3];
+	int expanded[3][2][4];
+	float pal[3][4][16];
+	float error;
+
+	pSol->mode = mode;
+	pSol->partition = partition;
+	pSol->rotation = rotation;
+	pSol->selection = selection;
+	memset(pSol->endpoints, 0, sizeof(pSol->endpoints));
+	memset(pSol->pbits, 0, sizeof(pSol->pbits));
+	memset(pSol->indices2, 0, sizeof(pSol->indices2));
+	memset(pal, 0, sizeof(pal));
+	crn_bc7_masks(pMode->subsets, partition, masks);
+
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		if (pMode->shared_pbits)
+		{
+			int codes[2][2][4], values[2][2][4];
+			float errors[2];
+			crn_uint32 p;
+			for (p = 0; p < 2; p++)
+				errors[p] = crn_bc7_quantize_endpoint(pMode, e[s][0], p, codes[p][0], values[p][0]) + crn_bc7_quantize_endpoint(pMode, e[s][1], p, codes[p][1], values[p][1]);
+			p = errors[1] < errors[0];
+			memcpy(pSol->endpoints[s], codes[p], sizeof(codes[p]));
+			memcpy(expanded[s], values[p], sizeof(values[p]));
+			pSol->pbits[s][0] = pSol->pbits[s][1] = (crn_uint8)p;
+			continue;
+		}
+		for (crn_uint32 k = 0; k < 2; k++)
+			pSol->pbits[s][k] = (crn_uint8)crn_bc7_quantize_best(pMode, e[s][k], pSol->endpoints[s][k], expanded[s][k]);
+	}
+
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		const int* pWeights = crn_bc7_weights(color_bits);
+		for (int c = 0; c < (separate ? 3 : 4); c++)
+			for (crn_uint32 i = 0; i < color_levels; i++)
+				pal[s][c][i] = (float)((expanded[s][0][c] * (64 - pWeights[i]) + expanded[s][1][c] * pWeights[i] + 32) >> 6);
+	}
+	if (separate)
+	{
+		// The color palette leaves alpha free for the scalar one.
+		const int* pWeights = crn_bc7_weights(scalar_bits);
+		for (crn_uint32 i = 0; i < scalar_levels; i++)
+			pal[0][3][i] = (float)((expanded[0][0][3] * (64 - pWeights[i]) + expanded[0][1][3] * pWeights[i] + 32) >> 6);
+		error = crn_bc7_assign(pBlock, masks, (const float (*)[4][16])pal, color_levels, 0, 3, pColor);
+		error += crn_bc7_assign(pBlock, masks, (const float (*)[4][16])pal, scalar_levels, 3, 1, pScalar);
+	}
+	else
+	{
+		error = crn_bc7_assign(pBlock, masks, (const float (*)[4][16])pal, color_levels, 0, 4, pColor);
+	}
+
+	// The weights are symmetric, so swapping endpoints and mirroring indices decodes the same.
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		crn_uint8 p;
+		if (pColor[crn_bc7_anchor(pMode->subsets, partition, s)] < color_levels / 2)
+			continue;
+		for (int c = 0; c < (separate ? 3 : 4); c++)
+		{
+			const int t = pSol->endpoints[s][0][c];
+			pSol->endpoints[s][0][c] = pSol->endpoints[s][1][c];
+			pSol->endpoints[s][1][c] = t;
+		}
+		p = pSol->pbits[s][0];
+		pSol->pbits[s][0] = pSol->pbits[s][1];
+		pSol->pbits[s][1] = p;
+		for (crn_uint32 i = 0; i < 16; i++)
+			if ((masks[s] >> i) & 1)
+				pColor[i] = (crn_uint8)(color_levels - 1 - pColor[i]);
+	}
+	if (separate && pScalar[0] >= scalar_levels / 2)
+	{
+		const int t = pSol->endpoints[0][0][3];
+		pSol->endpoints[0][0][3] = pSol->endpoints[0][1][3];
+		pSol->endpoints[0][1][3] = t;
+		for (crn_uint32 i = 0; i < 16; i++)
+			pScalar[i] = (crn_uint8)(scalar_levels - 1 - pScalar[i]);
+	}
+	pSol->error = error;
+}
+
+// Least squares endpoints for channels first to last - 1 of the pixels in mask, given their indices. Pixels that
+// share one index get their mean for both endpoints.
+static void crn_bc7_least_squares(const crn_bc7_block* pBlock, crn_uint32 mask, const crn_uint8 indices[16], const int* pWeights, crn_uint32 first,
+	crn_uint32 last, float e[2][4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f, det, n = 0.0f;
+	float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const float b = (float)pWeights[indices[i]] * (1.0f / 64.0f), a = 1.0f - b;
+		if (!((mask >> i) & 1))
+			continue;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		n += 1.0f;
+		for (crn_uint32 c = first; c < last; c++)
+		{
+			ax[c] += a * pBlock->products[c][i];
+			bx[c] += b * pBlock->products[c][i];
+		}
+	}
+	det = aa * bb - ab * ab;
+	for (crn_uint32 c = first; c < last; c++)
+	{
+		if (det < 1e-4f)
+		{
+			e[0][c] = e[1][c] = (ax[c] + bx[c]) / n;
+			continue;
+		}
+		e[0][c] = CRN_CLAMP((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+		e[1][c] = CRN_CLAMP((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+	}
+}
+
+static void crn_bc7_refine(const crn_bc7_block* pBlock, const crn_bc7_solution* pSol, float e[3][2][4])
+{
+	const crn_bc7_mode* pMode = &g_crn_bc7_modes[pSol->mode];
+	const crn_bool separate = pMode->index2_bits != 0;
+	crn_uint32 masks[3];
+
+	crn_bc7_masks(pMode->subsets, pSol->partition, masks);
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		const crn_uint8* pColor = pSol->selection ? pSol->indices2 : pSol->indices;
+		crn_bc7_least_squares(pBlock, masks[s], pColor, crn_bc7_weights(pSol->selection ? pMode->index2_bits : pMode->index_bits), 0, separate ? 3 : 4, e[s]);
+	}
+	if (separate)
+	{
+		const crn_uint8* pScalar = pSol->selection ? pSol->indices : pSol->indices2;
+		crn_bc7_least_squares(pBlock, 0xFFFF, pScalar, crn_bc7_weights(pSol->selection ? pMode->index_bits : pMode->index2_bits), 3, 4, e[0]);
+	}
+}
+
+// Evaluates a mode and partition from the given endpoints, refining them as the tier allows, and keeps the result in
+// *pBest if it beats it.
+static void crn_bc7_try(const crn_bc7_block* pBlock, crn_uint32 mode, crn_uint32 partition, crn_uint32 rotation, crn_uint32 selection,
+	const float e[3][2][4], crn_dxt_quality quality, crn_bc7_solution* pBest)
+{
+	crn_bc7_solution sol, next;
+	float refined[3][2][4];
+
+	crn_bc7_eval(pBlock, mode, partition, rotation, selection, e, &sol);
+	for (crn_uint32 r = 0; r < g_crn_bc7_tiers[quality].refines && sol.error > 0.0f; r++)
+	{
+		memcpy(refined, e, sizeof(refined));
+		crn_bc7_refine(pBlock, &sol, refined);
+		crn_bc7_eval(pBlock, mode, partition, rotation, selection, (const float (*)[2][4])refined, &next);
+		if (next.error >= sol.error)
+			break;
+		sol = next;
+	}
+	if (sol.error < pBest->error)
+		*pBest = sol;
+}
+
+static void crn_bc7_write_block(const crn_bc7_solution* pSol, crn_uint8* pDst)
+{
+	const crn_bc7_mode* pMode = &g_crn_bc7_modes[pSol->mode];
+	crn_uint32 ofs = 0;
+
+	memset(pDst, 0, 16);
+	crn_bc7_write_bits(pDst, &ofs, 1U << pSol->mode, pSol->mode + 1);
+	crn_bc7_write_bits(pDst, &ofs, pSol->partition, pMode->partition_bits);
+	crn_bc7_write_bits(pDst, &ofs, pSol->rotation, pMode->rotation_bits);
+	crn_bc7_write_bits(pDst, &ofs, pSol->selection, pMode->selection_bits);
+	for (int c = 0; c < 4; c++)
+		for (crn_uint32 s = 0; s < pMode->subsets; s++)
+			for (crn_uint32 k = 0; k < 2; k++)
+				crn_bc7_write_bits(pDst, &ofs, (crn_uint32)pSol->endpoints[s][k][c], (c < 3) ? pMode->color_bits : pMode->alpha_bits);
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		crn_bc7_write_bits(pDst, &ofs, pSol->pbits[s][0], pMode->endpoint_pbits | pMode->shared_pbits);
+		crn_bc7_write_bits(pDst, &ofs, pSol->pbits[s][1], pMode->endpoint_pbits);
+	}
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_bool anchor = !i;
+		for (crn_uint32 s = 1; s < pMode->subsets; s++)
+			anchor = anchor || i == crn_bc7_anchor(pMode->subsets, pSol->partition, s);
+		crn_bc7_write_bits(pDst, &ofs, pSol->indices[i], pMode->index_bits - anchor);
+	}
+	for (crn_uint32 i = 0; pMode->index2_bits && i < 16; i++)
+		crn_bc7_write_bits(pDst, &ofs, pSol->indices2[i], pMode->index2_bits - !i);
+}
+
+void crn_bc7_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality)
+{
+	crn_bc7_block block;
+	crn_bc7_solution best;
+	crn_uint32 ranked[cCRNBC7MaxRanked], masks[3];
+	float errors[cCRNBC7NumPartitions], e[3][2][4];
+	crn_bool opaque = crn_true;
+
+	quality = CRN_MIN(quality, cCRNDXTQualityUber);
+	for (crn_uint32 i = 0; i < 16; i++)
+		opaque = opaque && pixels[i][3] == 255;
+	crn_bc7_init_block(pixels, 0, &block);
+	memset(e, 0, sizeof(e));
+
+	best.error = FLT_MAX;
+	crn_bc7_fit_line(&block, 0xFFFF, 0, 4, e[0]);
+	crn_bc7_try(&block, 6, 0, 0, 0, (const float (*)[2][4])e, quality, &best);
+
+	// Modes 4 and 5 fit color and the channel rotated into alpha apart, which suits alpha that doesn't follow color.
+	for (crn_uint32 r = 0; !opaque && r < (g_crn_bc7_tiers[quality].rotations ? 4U : 1U) && best.error > 0.0f; r++)
+	{
+		crn_bc7_block rotated;
+		const crn_bc7_block* pRotated = &block;
+		float lo = 255.0f, hi = 0.0f;
+		if (r)
+		{
+			crn_bc7_init_block(pixels, r, &rotated);
+			pRotated = &rotated;
+		}
+		crn_bc7_fit_line(pRotated, 0xFFFF, 0, 3, e[0]);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			lo = CRN_MIN(lo, pRotated->products[3][i]);
+			hi = CRN_MAX(hi, pRotated->products[3][i]);
+		}
+		e[0][0][3] = lo;
+		e[0][1][3] = hi;
+		crn_bc7_try(pRotated, 4, 0, r, 0, (const float (*)[2][4])e, quality, &best);
+		crn_bc7_try(pRotated, 4, 0, r, 1, (const float (*)[2][4])e, quality, &best);
+		crn_bc7_try(pRotated, 5, 0, r, 0, (const float (*)[2][4])e, quality, &best);
+	}
+
+	// Partitions come best first, so the first whose subsets' line errors alone reach the best error ends the search.
+	if (g_crn_bc7_tiers[quality].partitions2 && best.error > 0.0f)
+	{
+		crn_bc7_partition_errors(&block, 2, errors);
+		crn_bc7_rank_partitions(errors, cCRNBC7NumPartitions, g_crn_bc7_tiers[quality].partitions2, ranked);
+		for (crn_uint32 r = 0; r < g_crn_bc7_tiers[quality].partitions2 && errors[ranked[r]] < best.error; r++)
+		{
+			crn_bc7_masks(2, ranked[r], masks);
+			for (crn_uint32 s = 0; s < 2; s++)
+				crn_bc7_fit_line(&block, masks[s], crn_bc7_anchor(2, ranked[r], s), 4, e[s]);
+			if (opaque)
+			{
+				crn_bc7_try(&block, 1, ranked[r], 0, 0, (const float (*)[2][4])e, quality, &best);
+				crn_bc7_try(&block, 3, ranked[r], 0, 0, (const float (*)[2][4])e, quality, &best);
+			}
+			else
+			{
+				crn_bc7_try(&block, 7, ranked[r], 0, 0, (const float (*)[2][4])e, quality, &best);
+			}
+		}
+	}
+
+	// No three subset mode stores alpha. Mode 0 only has the first 16 partitions.
+	if (opaque && g_crn_bc7_tiers[quality].partitions3 && best.error > 0.0f)
+	{
+		crn_bc7_partition_errors(&block, 3, errors);
+		for (crn_uint32 mode = 0; mode <= 2; mode += 2)
+		{
+			crn_bc7_rank_partitions(errors, mode ? cCRNBC7NumPartitions : cCRNBC7Mode0Partitions, g_crn_bc7_tiers[quality].partitions3, ranked);
+			for (crn_uint32 r = 0; r < g_crn_bc7_tiers[quality].partitions3 && errors[ranked[r]] < best.error; r++)
+			{
+				crn_bc7_masks(3, ranked[r], masks);
+				for (crn_uint32 s = 0; s < 3; s++)
+					crn_bc7_fit_line(&block, masks[s], crn_bc7_anchor(3, ranked[r], s), 4, e[s]);
+				crn_bc7_try(&block, mode, ranked[r], 0, 0, (const float (*)[2][4])e, quality, &best);
+			}
+		}
+	}
+
+	crn_bc7_write_block(&best, pDst);
+}
+
+// -------- Decoding
+
+void crn_bc7_decode_block(const crn_uint8* pSrc, crn_uint8 pixels[16][4])
+{
+	const crn_bc7_mode* pMode;
+	crn_uint32 mode = 0, ofs, partition, rotation, selection, masks[3], has_p;
+	int endpoints[3][2][4];
+	crn_uint8 pbits[3][2], indices[16], indices2[16];
+
+	while (mode < cCRNBC7NumModes && !((pSrc[0] >> mode) & 1))
+		mode++;
+	if (mode == cCRNBC7NumModes)
+	{
+		memset(pixels, 0, 16 * sizeof(pixels[0]));
+		return;
+	}
+	pMode = &g_crn_bc7_modes[mode];
+	ofs = mode + 1;
+	partition = crn_bc7_read_bits(pSrc, &ofs, pMode->partition_bits);
+	rotation = crn_bc7_read_bits(pSrc, &ofs, pMode->rotation_bits);
+	selection = crn_bc7_read_bits(pSrc, &ofs, pMode->selection_bits);
+	for (int c = 0; c < 4; c++)
+		for (crn_uint32 s = 0; s < pMode->subsets; s++)
+			for (crn_uint32 k = 0; k < 2; k++)
+				endpoints[s][k][c] = (int)crn_bc7_read_bits(pSrc, &ofs, (c < 3) ? pMode->color_bits : pMode->alpha_bits);
+	has_p = pMode->endpoint_pbits | pMode->shared_pbits;
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		pbits[s][0] = (crn_uint8)crn_bc7_read_bits(pSrc, &ofs, has_p);
+		pbits[s][1] = pMode->endpoint_pbits ? (crn_uint8)crn_bc7_read_bits(pSrc, &ofs, 1) : pbits[s][0];
+	}
+	for (crn_uint32 s = 0; s < pMode->subsets; s++)
+	{
+		for (crn_uint32 k = 0; k < 2; k++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				const crn_uint32 bits = (c < 3) ? pMode->color_bits : pMode->alpha_bits;
+				endpoints[s][k][c] = bits ? crn_bc7_expand((endpoints[s][k][c] << has_p) | pbits[s][k], bits + has_p) : 255;
+			}
+		}
+	}
+
+	crn_bc7_masks(pMode->subsets, partition, masks);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_bool anchor = !i;
+		for (crn_uint32 s = 1; s < pMode->subsets; s++)
+			anchor = anchor || i == crn_bc7_anchor(pMode->subsets, partition, s);
+		indices[i] = (crn_uint8)crn_bc7_read_bits(pSrc, &ofs, pMode->index_bits - anchor);
+	}
+	for (crn_uint32 i = 0; i < 16; i++)
+		indices2[i] = pMode->index2_bits ? (crn_uint8)crn_bc7_read_bits(pSrc, &ofs, pMode->index2_bits - !i) : indices[i];
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const crn_uint32 s = ((masks[1] >> i) & 1) ? 1 : (((masks[2] >> i) & 1) ? 2 : 0);
+		const int w1 = crn_bc7_weights(pMode->index_bits)[indices[i]];
+		const int w2 = pMode->index2_bits ? crn_bc7_weights(pMode->index2_bits)[indices2[i]] : w1;
+		const int wc = selection ? w2 : w1, wa = selection ? w1 : w2;
+		for (int c = 0; c < 4; c++)
+		{
+			const int w = (c < 3) ? wc : wa;
+			pixels[i][c] = (crn_uint8)((endpoints[s][0][c] * (64 - w) + endpoints[s][1][c] * w + 32) >> 6);
+		}
+		if (rotation)
+		{
+			const crn_uint8 t = pixels[i][3];
+			pixels[i][3] = pixels[i][rotation - 1];
+			pixels[i][rotation - 1] = t;
+		}
+	}
+}
@@ -0,0 +1,22 @@
+// File: crn_bc7.h - BC7 block encoding and decoding.
+#ifndef CRN_BC7_H
+#define CRN_BC7_H
+
+#include "crnlib.h"
+
+// Encodes 16 RGBA pixels to a 16 byte BC7 block. Mode 6 (one subset, RGBA) is always tried, and blocks with alpha
+// also try modes 4 and 5, which index alpha separately. Two and three subset modes (7 for alpha; 1, 3, 0 and 2 for
+// opaque blocks) are tried on the partitions whose subsets lie closest to a line each, skipping any whose distance
+// from those lines alone can't beat the best block so far. The quality tier controls how many are tried:
+//  SuperFast: the best two subset partition.
+//  Fast:      the 2 best two subset partitions and the best three subset one, and a least squares pass over each
+//             candidate's endpoints.
+//  Normal:    4 and 2 partitions, and modes 4 and 5 with every channel rotated into alpha.
+//  Better:    8 and 4 partitions, and up to 2 least squares passes.
+//  Uber:      16 and 8 partitions.
+void crn_bc7_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality);
+
+// Decodes a 16 byte BC7 block to 16 RGBA pixels. Blocks with a reserved mode decode to 0.
+void crn_bc7_decode_block(const crn_uint8* pSrc, crn_uint8 pixels[16][4]);
+
+#endif // CRN_BC7_H
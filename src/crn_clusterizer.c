@@ -0,0 +1,317 @@
+#include "crn_clusterizer.h"
+#include "crn_core.h"
+
+typedef struct
+{
+	const float* pVecs;
+	const float* pWeights;
+	crn_uint32   dims;
+	crn_uint32*  pPerm;       // training vectors, each node covers a contiguous range
+	crn_uint32*  pBegin;
+	crn_uint32*  pEnd;
+	double*      pSSE;        // weighted distortion of each node around its centroid
+	crn_uint32*  pHeap;       // max-heap of splittable leaves, keyed by SSE
+	crn_uint32   heap_size;
+	crn_uint8*   pSide;
+} crn_vq_builder;
+
+static float crn_vq_dist2(const float* a, const float* b, crn_uint32 dims)
+{
+	float d = 0.0f;
+	for (crn_uint32 i = 0; i < dims; i++)
+		d += (a[i] - b[i]) * (a[i] - b[i]);
+	return d;
+}
+
+static void crn_vq_heap_push(crn_vq_builder* pB, crn_uint32 node)
+{
+	crn_uint32 i = pB->heap_size++;
+	while (i)
+	{
+		const crn_uint32 parent = (i - 1) >> 1;
+		if (pB->pSSE[pB->pHeap[parent]] >= pB->pSSE[node])
+			break;
+		pB->pHeap[i] = pB->pHeap[parent];
+		i = parent;
+	}
+	pB->pHeap[i] = node;
+}
+
+static crn_uint32 crn_vq_heap_pop(crn_vq_builder* pB)
+{
+	const crn_uint32 top = pB->pHeap[0];
+	const crn_uint32 last = pB->pHeap[--pB->heap_size];
+	crn_uint32 i = 0;
+	for (;;)
+	{
+		crn_uint32 child = i * 2 + 1;
+		if (child >= pB->heap_size)
+			break;
+		if (child + 1 < pB->heap_size && pB->pSSE[pB->pHeap[child + 1]] > pB->pSSE[pB->pHeap[child]])
+			child++;
+		if (pB->pSSE[pB->pHeap[child]] <= pB->pSSE[last])
+			break;
+		pB->pHeap[i] = pB->pHeap[child];
+		i = child;
+	}
+	if (pB->heap_size)
+		pB->pHeap[i] = last;
+	return top;
+}
+
+// Computes the weighted centroid and distortion of a node's range.
+static void crn_vq_compute_stats(crn_vq_builder* pB, crn_vq_tree* pTree, crn_uint32 node)
+{
+	const crn_uint32 dims = pB->dims;
+	float* pCentroid = pTree->pCentroids + node * dims;
+	double sum[cCRNVQMaxDims] = { 0 }, total_weight = 0.0, sse = 0.0;
+
+	for (crn_uint32 i = pB->pBegin[node]; i < pB->pEnd[node]; i++)
+	{
+		const crn_uint32 v = pB->pPerm[i];
+		const float w = pB->pWeights ? pB->pWeights[v] : 1.0f;
+		for (crn_uint32 d = 0; d < dims; d++)
+			sum[d] += (double)pB->pVecs[v * dims + d] * w;
+		total_weight += w;
+	}
+	for (crn_uint32 d = 0; d < dims; d++)
+		pCentroid[d] = total_weight > 0.0 ? (float)(sum[d] / total_weight) : 0.0f;
+
+	for (crn_uint32 i = pB->pBegin[node]; i < pB->pEnd[node]; i++)
+	{
+		const crn_uint32 v = pB->pPerm[i];
+		const float w = pB->pWeights ? pB->pWeights[v] : 1.0f;
+		sse += (double)crn_vq_dist2(pB->pVecs + v * dims, pCentroid, dims) * w;
+	}
+	pB->pSSE[node] = sse;
+}
+
+// Splits a leaf in two along its principal axis, followed by a few 2-means iterations.
+// Returns false if the node's vectors can't be separated.
+static crn_bool crn_vq_split(crn_vq_builder* pB, crn_vq_tree* pTree, crn_uint32 node)
+{
+	const crn_uint32 dims = pB->dims;
+	const crn_uint32 begin = pB->pBegin[node], end = pB->pEnd[node];
+	const float* pMean = pTree->pCentroids + node * dims;
+	const crn_uint32 left = pTree->num_nodes, right = pTree->num_nodes + 1;
+	float axis[cCRNVQMaxDims], centers[2][cCRNVQMaxDims];
+	float max_dist = -1.0f;
+	crn_uint32 mid;
+
+	if (end - begin < 2)
+		return crn_false;
+
+	// Seed the axis with the vector farthest from the centroid, then power iterate: v = sum(w * x * dot(x, v)).
+	for (crn_uint32 i = begin; i < end; i++)
+	{
+		const crn_uint32 v = pB->pPerm[i];
+		const float dist = crn_vq_dist2(pB->pVecs + v * dims, pMean, dims);
+		if (dist > max_dist)
+		{
+			max_dist = dist;
+			for (crn_uint32 d = 0; d < dims; d++)
+				axis[d] = pB->pVecs[v * dims + d] - pMean[d];
+		}
+	}
+	if (max_dist <= 0.0f)
+		return crn_false;
+
+	for (int iter = 0; iter < 2; iter++)
+	{
+		float next[cCRNVQMaxDims] = { 0 }, len = 0.0f;
+		for (crn_uint32 i = begin; i < end; i++)
+		{
+			const crn_uint32 v = pB->pPerm[i];
+			const float w = pB->pWeights ? pB->pWeights[v] : 1.0f;
+			float x[cCRNVQMaxDims], dot = 0.0f;
+			for (crn_uint32 d = 0; d < dims; d++)
+			{
+				x[d] = pB->pVecs[v * dims + d] - pMean[d];
+				dot += x[d] * axis[d];
+			}
+			dot *= w;
+			for (crn_uint32 d = 0; d < dims; d++)
+				next[d] += x[d] * dot;
+		}
+		for (crn_uint32 d = 0; d < dims; d++)
+			len += next[d] * next[d];
+		if (len <= 1e-12f)
+			break;
+		for (crn_uint32 d = 0; d < dims; d++)
+			axis[d] = next[d];
+	}
+
+	for (crn_uint32 i = begin; i < end; i++)
+	{
+		const crn_uint32 v = pB->pPerm[i];
+		float dot = 0.0f;
+		for (crn_uint32 d = 0; d < dims; d++)
+			dot += (pB->pVecs[v * dims + d] - pMean[d]) * axis[d];
+		pB->pSide[v] = dot > 0.0f;
+	}
+
+	for (int iter = 0; iter < 3; iter++)
+	{
+		double sum[2][cCRNVQMaxDims] = { { 0 } }, weight[2] = { 0 };
+		crn_bool changed = crn_false;
+		for (crn_uint32 i = begin; i < end; i++)
+		{
+			const crn_uint32 v = pB->pPerm[i];
+			const float w = pB->pWeights ? pB->pWeights[v] : 1.0f;
+			const crn_uint32 s = pB->pSide[v];
+			for (crn_uint32 d = 0; d < dims; d++)
+				sum[s][d] += (double)pB->pVecs[v * dims + d] * w;
+			weight[s] += w;
+		}
+		if (weight[0] <= 0.0 || weight[1] <= 0.0)
+			break;
+		for (crn_uint32 s = 0; s < 2; s++)
+			for (crn_uint32 d = 0; d < dims; d++)
+				centers[s][d] = (float)(sum[s][d] / weight[s]);
+
+		for (crn_uint32 i = begin; i < end; i++)
+		{
+			const crn_uint32 v = pB->pPerm[i];
+			const crn_uint8 s = crn_vq_dist2(pB->pVecs + v * dims, centers[1], dims) < crn_vq_dist2(pB->pVecs + v * dims, centers[0], dims);
+			changed |= s != pB->pSide[v];
+			pB->pSide[v] = s;
+		}
+		if (!changed)
+			break;
+	}
+
+	// Partition the range in place, side 0 first.
+	mid = begin;
+	for (crn_uint32 i = begin; i < end; i++)
+	{
+		const crn_uint32 v = pB->pPerm[i];
+		if (!pB->pSide[v])
+		{
+			pB->pPerm[i] = pB->pPerm[mid];
+			pB->pPerm[mid++] = v;
+		}
+	}
+	if (mid == begin || mid == end)
+		return crn_false;
+
+	pB->pBegin[left] = begin;
+	pB->pEnd[left] = mid;
+	pB->pBegin[right] = mid;
+	pB->pEnd[right] = end;
+	for (crn_uint32 n = left; n <= right; n++)
+	{
+		pTree->pParent[n] = node;
+		pTree->pSplit[n] = CRN_VQ_NONE;
+		crn_vq_compute_stats(pB, pTree, n);
+	}
+	pTree->pChildren[node * 2 + 0] = left;
+	pTree->pChildren[node * 2 + 1] = right;
+	pTree->pSplit[node] = pTree->num_splits++;
+	pTree->num_nodes += 2;
+	return crn_true;
+}
+
+crn_bool crn_vq_tree_build(crn_vq_tree* pTree, const float* pVecs, const float* pWeights, crn_uint32 num_vecs, crn_uint32 dims, crn_uint32 max_leaves)
+{
+	crn_vq_builder b;
+	crn_uint32 max_nodes;
+	crn_bool ok;
+
+	memset(pTree, 0, sizeof(*pTree));
+	memset(&b, 0, sizeof(b));
+	if (!dims || dims > cCRNVQMaxDims)
+		return crn_false;
+
+	max_leaves = CRN_MAX(CRN_MIN(max_leaves, CRN_MAX(num_vecs, 1U)), 1U);
+	max_nodes = max_leaves * 2 - 1;
+	pTree->dims = dims;
+	pTree->num_vecs = num_vecs;
+	pTree->pCentroids = (float*)crn_calloc(max_nodes * dims, sizeof(float));
+	pTree->pParent = (crn_uint32*)crn_malloc(max_nodes * sizeof(crn_uint32));
+	pTree->pChildren = (crn_uint32*)crn_malloc(max_nodes * 2 * sizeof(crn_uint32));
+	pTree->pSplit = (crn_uint32*)crn_malloc(max_nodes * sizeof(crn_uint32));
+	pTree->pVec_leaf = (crn_uint32*)crn_malloc(CRN_MAX(num_vecs, 1U) * sizeof(crn_uint32));
+
+	b.pVecs = pVecs;
+	b.pWeights = pWeights;
+	b.dims = dims;
+	b.pPerm = (crn_uint32*)crn_malloc(CRN_MAX(num_vecs, 1U) * sizeof(crn_uint32));
+	b.pBegin = (crn_uint32*)crn_malloc(max_nodes * sizeof(crn_uint32));
+	b.pEnd = (crn_uint32*)crn_malloc(max_nodes * sizeof(crn_uint32));
+	b.pSSE = (double*)crn_malloc(max_nodes * sizeof(double));
+	b.pHeap = (crn_uint32*)crn_malloc(max_nodes * sizeof(crn_uint32));
+	b.pSide = (crn_uint8*)crn_malloc(CRN_MAX(num_vecs, 1U));
+
+	ok = pTree->pCentroids && pTree->pParent && pTree->pChildren && pTree->pSplit && pTree->pVec_leaf &&
+		b.pPerm && b.pBegin && b.pEnd && b.pSSE && b.pHeap && b.pSide;
+	if (ok)
+	{
+		for (crn_uint32 i = 0; i < num_vecs; i++)
+			b.pPerm[i] = i;
+		pTree->num_nodes = 1;
+		pTree->pParent[0] = CRN_VQ_NONE;
+		pTree->pSplit[0] = CRN_VQ_NONE;
+		b.pBegin[0] = 0;
+		b.pEnd[0] = num_vecs;
+		crn_vq_compute_stats(&b, pTree, 0);
+		if (b.pSSE[0] > 0.0)
+			crn_vq_heap_push(&b, 0);
+
+		while (b.heap_size && pTree->num_splits + 1 < max_leaves)
+		{
+			const crn_uint32 node = crn_vq_heap_pop(&b);
+			if (!crn_vq_split(&b, pTree, node))
+				continue;
+			for (crn_uint32 n = pTree->num_nodes - 2; n < pTree->num_nodes; n++)
+				if (b.pSSE[n] > 0.0)
+					crn_vq_heap_push(&b, n);
+		}
+
+		for (crn_uint32 n = 0; n < pTree->num_nodes; n++)
+			if (pTree->pSplit[n] == CRN_VQ_NONE)
+				for (crn_uint32 i = b.pBegin[n]; i < b.pEnd[n]; i++)
+					pTree->pVec_leaf[b.pPerm[i]] = n;
+	}
+
+	crn_free(b.pPerm);
+	crn_free(b.pBegin);
+	crn_free(b.pEnd);
+	crn_free(b.pSSE);
+	crn_free(b.pHeap);
+	crn_free(b.pSide);
+	if (!ok)
+		crn_vq_tree_free(pTree);
+	return ok;
+}
+
+void crn_vq_tree_free(crn_vq_tree* pTree)
+{
+	crn_free(pTree->pCentroids);
+	crn_free(pTree->pParent);
+	crn_free(pTree->pChildren);
+	crn_free(pTree->pSplit);
+	crn_free(pTree->pVec_leaf);
+	memset(pTree, 0, sizeof(*pTree));
+}
+
+crn_uint32 crn_vq_tree_classify(const crn_vq_tree* pTree, const float* pVec, crn_uint32 num_entries)
+{
+	const crn_uint32 dims = pTree->dims;
+	crn_uint32 node = 0;
+	while (pTree->pSplit[node] < num_entries - 1)
+	{
+		const crn_uint32 l = pTree->pChildren[node * 2 + 0], r = pTree->pChildren[node * 2 + 1];
+		node = crn_vq_dist2(pVec, pTree->pCentroids + r * dims, dims) < crn_vq_dist2(pVec, pTree->pCentroids + l * dims, dims) ? r : l;
+	}
+	return node;
+}
+
+crn_uint32 crn_vq_tree_get_codebook(const crn_vq_tree* pTree, crn_uint32 num_entries, crn_uint32* pNodes)
+{
+	crn_uint32 n = 0;
+	num_entries = CRN_MAX(CRN_MIN(num_entries, crn_vq_tree_num_leaves(pTree)), 1U);
+	for (crn_uint32 node = 0; node < pTree->num_nodes && n < num_entries; node++)
+		if (crn_vq_tree_is_leaf(pTree, node, num_entries))
+			pNodes[n++] = node;
+	return n;
+}
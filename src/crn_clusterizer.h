@@ -0,0 +1,58 @@
+// File: crn_clusterizer.h - Tree structured vector quantizer used to build CRN palettes.
+//
+// The tree is grown by repeatedly splitting the leaf with the largest weighted distortion, and
+// every split is recorded. A codebook of any size up to the number of leaves is therefore just a
+// prefix of the split history, which lets several quality levels share one clustering run.
+#ifndef CRN_CLUSTERIZER_H
+#define CRN_CLUSTERIZER_H
+
+#include "crnlib.h"
+
+enum { cCRNVQMaxDims = 16 };
+
+typedef struct
+{
+	crn_uint32  dims;
+	crn_uint32  num_vecs;
+	crn_uint32  num_nodes;
+	crn_uint32  num_splits;
+	float*      pCentroids;   // dims floats per node
+	crn_uint32* pParent;      // UINT32_MAX for the root
+	crn_uint32* pChildren;    // 2 per node, only valid if the node was split
+	crn_uint32* pSplit;       // index of the split that divided the node, UINT32_MAX if it's a leaf of the whole tree
+	crn_uint32* pVec_leaf;    // leaf of the whole tree each training vector ended up in
+} crn_vq_tree;
+
+#define CRN_VQ_NONE 0xFFFFFFFFU
+
+// Grows a tree with up to max_leaves leaves from num_vecs weighted training vectors.
+crn_bool crn_vq_tree_build(crn_vq_tree* pTree, const float* pVecs, const float* pWeights, crn_uint32 num_vecs, crn_uint32 dims, crn_uint32 max_leaves);
+void crn_vq_tree_free(crn_vq_tree* pTree);
+
+static inline crn_uint32 crn_vq_tree_num_leaves(const crn_vq_tree* pTree) { return pTree->num_splits + 1; }
+
+// Node ids are allocated in split order: the root is 0, split s creates nodes 2s+1 and 2s+2.
+// A node is part of the codebook with num_entries entries if it was created by one of the first
+// num_entries-1 splits and wasn't split by any of them.
+static inline crn_bool crn_vq_tree_is_leaf(const crn_vq_tree* pTree, crn_uint32 node, crn_uint32 num_entries)
+{
+	return ((node + 1) >> 1) < num_entries && pTree->pSplit[node] >= num_entries - 1;
+}
+
+// Returns the codebook node of a training vector, for a codebook with num_entries entries.
+static inline crn_uint32 crn_vq_tree_vec_node(const crn_vq_tree* pTree, crn_uint32 vec_index, crn_uint32 num_entries)
+{
+	crn_uint32 node = pTree->pVec_leaf[vec_index];
+	while (((node + 1) >> 1) >= num_entries)
+		node = pTree->pParent[node];
+	return node;
+}
+
+// Finds the codebook node of an arbitrary vector by descending the tree, for a codebook with num_entries entries.
+crn_uint32 crn_vq_tree_classify(const crn_vq_tree* pTree, const float* pVec, crn_uint32 num_entries);
+
+// Enumerates the nodes of the codebook with num_entries entries (clamped to the number of leaves) into pNodes,
+// returning the actual number of entries.
+crn_uint32 crn_vq_tree_get_codebook(const crn_vq_tree* pTree, crn_uint32 num_entries, crn_uint32* pNodes);
+
+#endif // CRN_CLUSTERIZER_H
@@ -0,0 +1,1979 @@
+#include "crn_comp.h"
+#include "crn_core.h"
+#include "crn_clusterizer.h"
+#include "crn_decomp.h"
+#include "crn_dxt.h"
+#include "crn_huffman.h"
+#include "crn_swizzle.h"
+#include "crn_threading.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+enum
+{
+	cCRNCompColorEndpoints,
+	cCRNCompColorSelectors,
+	cCRNCompAlphaEndpoints,
+	cCRNCompAlphaSelectors,
+	cCRNCompNumPalettes
+};
+
+enum
+{
+	cCRNCompModelChunkEncoding,
+	cCRNCompModelColorEndpoints,
+	cCRNCompModelColorSelectors,
+	cCRNCompModelAlphaEndpoints,
+	cCRNCompModelAlphaSelectors,
+	cCRNCompNumModels
+};
+
+enum
+{
+	cCRNCompChunkBatchSize    = 256,
+	cCRNCompMaxProbeRounds    = 16,
+	cCRNCompNumPhases         = 3,
+	cCRNCompMaxTexels         = 1 << 28,  // Across all slices, keeps training vector indices (in floats) within 32 bits
+	cCRNCompMinSharedFraction = 16        // Array slices share palettes once 1/16 of their endpoints recur across slices
+};
+
+// Relative distance to the target bitrate at which the quality search stops early.
+#define CRN_COMP_BITRATE_TOLERANCE 0.01f
+
+typedef struct
+{
+	crn_uint8  level;
+	crn_uint8  face;
+	crn_uint16 slice;
+	crn_uint16 x;
+	crn_uint16 y;
+} crn_comp_chunk;
+
+// Array slices share the training vectors and therefore the palettes. Their chunks follow each other slice by slice,
+// each slice's in the order of a single texture's.
+typedef struct
+{
+	const crn_comp_params* pParams;     // pSlices[0], which holds the settings all slices share
+	const crn_comp_params* pSlices;
+	crn_uint32      num_slices;
+	crn_uint32      num_helper_threads;
+	crn_bool        has_color;
+	crn_uint32      num_alpha_comps;
+	crn_uint32      alpha_channels[2];
+	const crn_uint8* pColor_weights;    // crn_dxt1_get_weights() of the params' flags
+
+	crn_uint32      num_chunks;
+	crn_comp_chunk* pChunks;
+	crn_uint32      chunks_per_slice;
+	crn_uint32      level_first_chunk[cCRNMaxLevels + 1];  // Within a slice
+	crn_uint32      total_texels;
+
+	crn_uint8*      pChunk_encodings;
+	crn_uint32*     pChunk_first_tile;  // num_chunks + 1 entries
+	crn_uint32      num_tiles;
+
+	// Training vectors: endpoints per tile, selectors per block (chunk * 4 + block).
+	// The second DXN component's alpha vectors follow the first component's.
+	float*          pVecs[cCRNCompNumPalettes];
+	float*          pWeights[cCRNCompNumPalettes];
+	crn_uint32      num_vecs[cCRNCompNumPalettes];
+	crn_uint32      max_entries[cCRNCompNumPalettes];
+	crn_vq_tree     trees[cCRNCompNumPalettes];
+} crn_comp_context;
+
+static const crn_uint32 g_crn_comp_palette_dims[cCRNCompNumPalettes] = { 6, 16, 2, 16 };
+
+static crn_bool crn_comp_uses_palette(const crn_comp_context* pCtx, crn_uint32 pal)
+{
+	return (pal <= cCRNCompColorSelectors) ? pCtx->has_color : (pCtx->num_alpha_comps != 0);
+}
+
+// -------- Block access
+
+static crn_bool crn_comp_block_in_bounds(const crn_comp_context* pCtx, crn_uint32 chunk_index, crn_uint32 block)
+{
+	const crn_comp_chunk* pChunk = &pCtx->pChunks[chunk_index];
+	const crn_uint32 width = CRN_MAX(pCtx->pParams->width >> pChunk->level, 1U);
+	const crn_uint32 height = CRN_MAX(pCtx->pParams->height >> pChunk->level, 1U);
+	return (pChunk->x * 2U + (block & 1)) * 4 < width && (pChunk->y * 2U + (block >> 1)) * 4 < height;
+}
+
+// Gathers a 4x4 block, replicating the edge texels of partial blocks and applying the swizzled DXT5 formats' channel
+// swizzles row by row. 16-bit images are rounded to 8 bits here. Returns false if the block is entirely outside the
+// image.
+static crn_bool crn_comp_get_block(const crn_comp_context* pCtx, crn_uint32 chunk_index, crn_uint32 block, crn_uint8 pixels[16][4])
+{
+	const crn_format fmt = pCtx->pParams->format;
+	const crn_comp_chunk* pChunk = &pCtx->pChunks[chunk_index];
+	const crn_uint32 width = CRN_MAX(pCtx->pParams->width >> pChunk->level, 1U);
+	const crn_uint32 height = CRN_MAX(pCtx->pParams->height >> pChunk->level, 1U);
+	const crn_uint32 x0 = (pChunk->x * 2U + (block & 1)) * 4, y0 = (pChunk->y * 2U + (block >> 1)) * 4;
+	const crn_uint8* pImage = (const crn_uint8*)pCtx->pSlices[pChunk->slice].pImages[pChunk->face][pChunk->level];
+	const crn_bool wide = (pCtx->pParams->flags & cCRNCompFlagSource16) != 0;
+
+	if (x0 >= width || y0 >= height)
+		return crn_false;
+	for (crn_uint32 y = 0; y < 4; y++)
+	{
+		const size_t row = (size_t)CRN_MIN(y0 + y, height - 1) * width * 4;
+		for (crn_uint32 x = 0; x < 4; x++)
+		{
+			const crn_uint32 ofs = CRN_MIN(x0 + x, width - 1) * 4;
+			if (wide)
+			{
+				for (crn_uint32 c = 0; c < 4; c++)
+					pixels[y * 4 + x][c] = crn_narrow16(((const crn_uint16*)pImage)[row + ofs + c]);
+			}
+			else
+			{
+				memcpy(pixels[y * 4 + x], pImage + row + ofs, 4);
+			}
+		}
+		if (crn_is_swizzled_dxt5(fmt))
+			crn_swizzle_row(fmt, pCtx->pParams->alpha_component, pixels[y * 4], pixels[y * 4]);
+	}
+	return crn_true;
+}
+
+// -------- Selector evaluation
+
+// Finds the best DXT1 selector of each pixel for the given endpoints by weighted error, returned as linear selectors.
+static void crn_comp_color_selectors(const crn_uint8 pixels[16][4], crn_uint32 endpoints, const crn_uint8* pWeights, crn_uint8* pLinear)
+{
+	crn_uint8 colors[4][4];
+	crn_dxt1_get_block_colors((crn_uint16)endpoints, (crn_uint16)(endpoints >> 16), colors);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_uint32 best = 0, best_err = 0xFFFFFFFF;
+		for (crn_uint32 s = 0; s < 4; s++)
+		{
+			const int dr = pixels[i][0] - colors[s][0], dg = pixels[i][1] - colors[s][1], db = pixels[i][2] - colors[s][2];
+			const crn_uint32 err = (crn_uint32)(dr * dr * pWeights[0] + dg * dg * pWeights[1] + db * db * pWeights[2]);
+			if (err < best_err)
+			{
+				best_err = err;
+				best = s;
+			}
+		}
+		pLinear[i] = g_crnd_dxt1_to_linear[best];
+	}
+}
+
+// Finds the best DXT5 alpha selector of each pixel's channel for the given endpoints, returned as linear selectors.
+static void crn_comp_alpha_selectors(const crn_uint8 pixels[16][4], crn_uint32 channel, crn_uint32 endpoints, crn_uint8* pLinear)
+{
+	crn_uint8 values[8];
+	crn_dxt5_get_block_values(endpoints & 0xFF, endpoints >> 8, values);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_uint32 best = 0, best_err = 0xFFFFFFFF;
+		for (crn_uint32 s = 0; s < 8; s++)
+		{
+			const int d = pixels[i][channel] - values[s];
+			if ((crn_uint32)(d * d) < best_err)
+			{
+				best_err = (crn_uint32)(d * d);
+				best = s;
+			}
+		}
+		pLinear[i] = g_crnd_dxt5_to_linear[best];
+	}
+}
+
+// Packs two 565 colors as a 4 color mode endpoint pair (color0 > color1).
+static crn_uint32 crn_comp_pack_color_endpoints(crn_uint16 c0, crn_uint16 c1)
+{
+	if (c0 < c1)
+	{
+		const crn_uint16 t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+	else if (c0 == c1)
+	{
+		if (c1)
+			c1--;
+		else
+			c0++;
+	}
+	return c0 | ((crn_uint32)c1 << 16);
+}
+
+// Packs two alpha values as an 8 value mode endpoint pair (alpha0 > alpha1).
+static crn_uint32 crn_comp_pack_alpha_endpoints(int a0, int a1)
+{
+	a0 = CRN_CLAMP(a0, 0, 255);
+	a1 = CRN_CLAMP(a1, 0, 255);
+	if (a0 < a1)
+	{
+		const int t = a0;
+		a0 = a1;
+		a1 = t;
+	}
+	else if (a0 == a1)
+	{
+		if (a1)
+			a1--;
+		else
+			a0++;
+	}
+	return (crn_uint32)a0 | ((crn_uint32)a1 << 8);
+}
+
+// -------- Training
+
+static void crn_comp_train_chunks(crn_uint32 batch, crn_uint32 thread_index, void* pData)
+{
+	crn_comp_context* pCtx = (crn_comp_context*)pData;
+	const crn_uint32 first = batch * cCRNCompChunkBatchSize;
+	const crn_uint32 last = CRN_MIN(first + cCRNCompChunkBatchSize, pCtx->num_chunks);
+	(void)thread_index;
+
+	for (crn_uint32 c = first; c < last; c++)
+	{
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[pCtx->pChunk_encodings[c]];
+		const crn_uint32 first_tile = pCtx->pChunk_first_tile[c];
+		const crn_uint32 num_tiles = pCtx->pChunk_first_tile[c + 1] - first_tile;
+		crn_uint8 blocks[4][16][4];
+		crn_bool valid[4];
+		crn_uint32 tile_color[4], tile_alpha[2][4];
+
+		for (crn_uint32 b = 0; b < 4; b++)
+			valid[b] = crn_comp_get_block(pCtx, c, b, blocks[b]);
+
+		for (crn_uint32 t = 0; t < num_tiles; t++)
+		{
+			const crn_uint32 tile = first_tile + t;
+			crn_uint8 pixels[64][4];
+			crn_uint32 n = 0;
+			for (crn_uint32 b = 0; b < 4; b++)
+			{
+				if (valid[b] && pTiles[b] == t)
+				{
+					memcpy(pixels[n], blocks[b], sizeof(blocks[b]));
+					n += 16;
+				}
+			}
+
+			if (pCtx->has_color)
+			{
+				float* pVec = pCtx->pVecs[cCRNCompColorEndpoints] + tile * 6;
+				if (n)
+					crn_dxt1_fit_endpoints(&pixels[0][0], n, pCtx->pColor_weights, pVec);
+				else
+					memset(pVec, 0, 6 * sizeof(float));
+				pCtx->pWeights[cCRNCompColorEndpoints][tile] = (float)n;
+				tile_color[t] = crn_comp_pack_color_endpoints(crn_dxt_quantize565(pVec), crn_dxt_quantize565(pVec + 3));
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				const crn_uint32 ch = pCtx->alpha_channels[a];
+				const crn_uint32 v = a * pCtx->num_tiles + tile;
+				crn_uint32 lo = 255, hi = 0;
+				for (crn_uint32 i = 0; i < n; i++)
+				{
+					lo = CRN_MIN(lo, (crn_uint32)pixels[i][ch]);
+					hi = CRN_MAX(hi, (crn_uint32)pixels[i][ch]);
+				}
+				pCtx->pVecs[cCRNCompAlphaEndpoints][v * 2 + 0] = n ? (float)hi : 0.0f;
+				pCtx->pVecs[cCRNCompAlphaEndpoints][v * 2 + 1] = n ? (float)lo : 0.0f;
+				pCtx->pWeights[cCRNCompAlphaEndpoints][v] = (float)n;
+				tile_alpha[a][t] = crn_comp_pack_alpha_endpoints((int)hi, (int)lo);
+			}
+		}
+
+		// Selector training vectors use the endpoints fitted to the block's tile, the same endpoints the
+		// selectors are later assigned against, while staying independent of the endpoint palette and
+		// therefore reusable by every quality level.
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			crn_uint8 linear[16];
+
+			if (pCtx->has_color)
+			{
+				float* pVec = pCtx->pVecs[cCRNCompColorSelectors] + block * 16;
+				if (valid[b])
+				{
+					crn_comp_color_selectors((const crn_uint8 (*)[4])blocks[b], tile_color[pTiles[b]], pCtx->pColor_weights, linear);
+					for (crn_uint32 i = 0; i < 16; i++)
+						pVec[i] = linear[i];
+				}
+				else
+					memset(pVec, 0, 16 * sizeof(float));
+				pCtx->pWeights[cCRNCompColorSelectors][block] = valid[b] ? 1.0f : 0.0f;
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				const crn_uint32 ch = pCtx->alpha_channels[a];
+				const crn_uint32 v = a * pCtx->num_chunks * 4 + block;
+				float* pVec = pCtx->pVecs[cCRNCompAlphaSelectors] + v * 16;
+				if (valid[b])
+				{
+					crn_comp_alpha_selectors((const crn_uint8 (*)[4])blocks[b], ch, tile_alpha[a][pTiles[b]], linear);
+					for (crn_uint32 i = 0; i < 16; i++)
+						pVec[i] = linear[i];
+				}
+				else
+					memset(pVec, 0, 16 * sizeof(float));
+				pCtx->pWeights[cCRNCompAlphaSelectors][v] = valid[b] ? 1.0f : 0.0f;
+			}
+		}
+	}
+}
+
+static int crn_comp_key_compare(const void* a, const void* b)
+{
+	const crn_uint64 ka = *(const crn_uint64*)a, kb = *(const crn_uint64*)b;
+	return ka < kb ? -1 : (ka > kb);
+}
+
+// Whether enough tile endpoints recur across array slices for shared palettes to pay off. Slices without much in
+// common compress better with palettes of their own. Quantized endpoints are counted once per slice using them
+// and once overall, from keys sorted by endpoints and then slice.
+static crn_bool crn_comp_slices_share_endpoints(const crn_comp_context* pCtx)
+{
+	crn_uint64* pKeys = (crn_uint64*)crn_malloc(CRN_MAX(pCtx->num_tiles, 1U) * sizeof(crn_uint64));
+	crn_uint32 n = 0, distinct = 0, per_slice = 0;
+
+	if (!pKeys)
+		return crn_true;
+	for (crn_uint32 c = 0; c < pCtx->num_chunks; c++)
+	{
+		for (crn_uint32 t = pCtx->pChunk_first_tile[c]; t < pCtx->pChunk_first_tile[c + 1]; t++)
+		{
+			crn_uint32 endpoints = 0;
+			if (pCtx->has_color)
+			{
+				const float* pVec = pCtx->pVecs[cCRNCompColorEndpoints] + t * 6;
+				if (pCtx->pWeights[cCRNCompColorEndpoints][t] <= 0.0f)
+					continue;
+				endpoints = crn_comp_pack_color_endpoints(crn_dxt_quantize565(pVec), crn_dxt_quantize565(pVec + 3));
+			}
+			else
+			{
+				if (pCtx->pWeights[cCRNCompAlphaEndpoints][t] <= 0.0f)
+					continue;
+				for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+				{
+					const float* pVec = pCtx->pVecs[cCRNCompAlphaEndpoints] + (a * pCtx->num_tiles + t) * 2;
+					endpoints |= crn_comp_pack_alpha_endpoints((int)pVec[0], (int)pVec[1]) << (a * 16);
+				}
+			}
+			pKeys[n++] = ((crn_uint64)endpoints << 16) | pCtx->pChunks[c].slice;
+		}
+	}
+
+	qsort(pKeys, n, sizeof(crn_uint64), crn_comp_key_compare);
+	for (crn_uint32 i = 0; i < n; i++)
+	{
+		per_slice += !i || pKeys[i] != pKeys[i - 1];
+		distinct += !i || (pKeys[i] >> 16) != (pKeys[i - 1] >> 16);
+	}
+	crn_free(pKeys);
+	return per_slice - distinct > distinct / cCRNCompMinSharedFraction;
+}
+
+// -------- Adaptive tiling
+
+// Peak signal to noise ratio of a sum of squared errors over num_samples 8-bit samples, capped for lossless tiles.
+static float crn_comp_psnr(crn_uint64 error, crn_uint32 num_samples)
+{
+	const double mse = (double)error / CRN_MAX(num_samples, 1U);
+	return (mse > 1e-10) ? (float)CRN_MIN(10.0 * log10(255.0 * 255.0 / mse), 100.0) : 100.0f;
+}
+
+// Picks the chunk encoding (tiling of the chunk's 2x2 blocks) with the fewest tiles whose PSNR stays within
+// the adaptive tile derating of the 4 tile encoding. Only 9 distinct tile shapes occur across the 8 encodings,
+// so every shape is fitted once and encodings are scored by summing the errors of their tiles.
+static void crn_comp_choose_tiles(crn_uint32 batch, crn_uint32 thread_index, void* pData)
+{
+	crn_comp_context* pCtx = (crn_comp_context*)pData;
+	const crn_comp_params* pParams = pCtx->pParams;
+	const crn_uint32 first = batch * cCRNCompChunkBatchSize;
+	const crn_uint32 last = CRN_MIN(first + cCRNCompChunkBatchSize, pCtx->num_chunks);
+	(void)thread_index;
+
+	for (crn_uint32 c = first; c < last; c++)
+	{
+		crn_uint8 blocks[4][16][4];
+		crn_bool valid[4];
+		crn_uint32 num_pixels = 0, best = cCRNNumChunkEncodings - 1;
+		crn_uint64 best_error = 0;
+		crn_uint32 shape_color_error[16], shape_alpha_error[16];
+		crn_uint16 shape_done = 0;
+		crn_uint64 color_error[cCRNNumChunkEncodings], alpha_error[cCRNNumChunkEncodings];
+		float color_psnr_limit, alpha_psnr_limit;
+
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			valid[b] = crn_comp_get_block(pCtx, c, b, blocks[b]);
+			num_pixels += valid[b] ? 16 : 0;
+		}
+
+		for (crn_uint32 e = 0; e < cCRNNumChunkEncodings; e++)
+		{
+			const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[e];
+			color_error[e] = alpha_error[e] = 0;
+			for (crn_uint32 t = 0; t < g_crnd_chunk_encoding_num_tiles[e]; t++)
+			{
+				crn_uint32 shape = 0;
+				for (crn_uint32 b = 0; b < 4; b++)
+					shape |= (pTiles[b] == t && valid[b]) ? (1U << b) : 0;
+
+				if (!(shape_done & (1U << shape)))
+				{
+					crn_uint8 pixels[64][4];
+					crn_uint32 n = 0;
+					for (crn_uint32 b = 0; b < 4; b++)
+					{
+						if (shape & (1U << b))
+						{
+							memcpy(pixels[n], blocks[b], sizeof(blocks[b]));
+							n += 16;
+						}
+					}
+
+					shape_color_error[shape] = shape_alpha_error[shape] = 0;
+					if (n && pCtx->has_color)
+					{
+						float endpoints[6];
+						crn_uint32 packed;
+						crn_uint8 colors[4][4];
+						crn_dxt1_fit_endpoints(&pixels[0][0], n, pCtx->pColor_weights, endpoints);
+						packed = crn_comp_pack_color_endpoints(crn_dxt_quantize565(endpoints), crn_dxt_quantize565(endpoints + 3));
+						crn_dxt1_get_block_colors((crn_uint16)packed, (crn_uint16)(packed >> 16), colors);
+						shape_color_error[shape] = crn_dxt1_color_error(&pixels[0][0], n, (const crn_uint8 (*)[4])colors, pCtx->pColor_weights);
+					}
+					for (crn_uint32 a = 0; n && a < pCtx->num_alpha_comps; a++)
+					{
+						const crn_uint32 ch = pCtx->alpha_channels[a];
+						crn_uint32 packed;
+						int lo = 255, hi = 0;
+						crn_uint8 values[8];
+						for (crn_uint32 i = 0; i < n; i++)
+						{
+							lo = CRN_MIN(lo, (int)pixels[i][ch]);
+							hi = CRN_MAX(hi, (int)pixels[i][ch]);
+						}
+						packed = crn_comp_pack_alpha_endpoints(hi, lo);
+						crn_dxt5_get_block_values(packed & 0xFF, packed >> 8, values);
+						shape_alpha_error[shape] += crn_dxt5_alpha_error(&pixels[0][0], n, ch, values);
+					}
+					shape_done |= (crn_uint16)(1U << shape);
+				}
+				color_error[e] += shape_color_error[shape];
+				alpha_error[e] += shape_alpha_error[shape];
+			}
+		}
+
+		color_psnr_limit = crn_comp_psnr(color_error[cCRNNumChunkEncodings - 1], num_pixels * 3) - pParams->crn_adaptive_tile_color_psnr_derating;
+		alpha_psnr_limit = crn_comp_psnr(alpha_error[cCRNNumChunkEncodings - 1], num_pixels * pCtx->num_alpha_comps) - pParams->crn_adaptive_tile_alpha_psnr_derating;
+
+		// Encodings are ordered by tile count, so the first acceptable tile count wins and ties go to the lowest error.
+		for (crn_uint32 e = 0; e < cCRNNumChunkEncodings - 1; e++)
+		{
+			const crn_uint64 error = color_error[e] + alpha_error[e];
+			if (best != cCRNNumChunkEncodings - 1 && g_crnd_chunk_encoding_num_tiles[e] > g_crnd_chunk_encoding_num_tiles[best])
+				break;
+			if (pCtx->has_color && crn_comp_psnr(color_error[e], num_pixels * 3) < color_psnr_limit)
+				continue;
+			if (pCtx->num_alpha_comps && crn_comp_psnr(alpha_error[e], num_pixels * pCtx->num_alpha_comps) < alpha_psnr_limit)
+				continue;
+			if (best == cCRNNumChunkEncodings - 1 || error < best_error)
+			{
+				best = e;
+				best_error = error;
+			}
+		}
+		pCtx->pChunk_encodings[c] = (crn_uint8)best;
+	}
+}
+
+typedef struct
+{
+	crn_comp_context* pCtx;
+	crn_uint32 num_leaves[cCRNCompNumPalettes];
+	volatile crn_uint32 failed;
+} crn_comp_tree_job;
+
+static void crn_comp_build_tree(crn_uint32 pal, crn_uint32 thread_index, void* pData)
+{
+	crn_comp_tree_job* pJob = (crn_comp_tree_job*)pData;
+	crn_comp_context* pCtx = pJob->pCtx;
+	(void)thread_index;
+
+	if (!crn_comp_uses_palette(pCtx, pal))
+		return;
+	if (!crn_vq_tree_build(&pCtx->trees[pal], pCtx->pVecs[pal], pCtx->pWeights[pal], pCtx->num_vecs[pal], g_crn_comp_palette_dims[pal], pJob->num_leaves[pal]))
+		pJob->failed = 1;
+}
+
+// -------- Quality levels
+
+static crn_uint32 crn_comp_palette_size(const crn_comp_context* pCtx, crn_uint32 pal, crn_uint32 quality_level)
+{
+	static const float s_power[cCRNCompNumPalettes] = { 1.8f, 1.6f, 1.8f, 1.6f };
+	const crn_comp_params* pParams = pCtx->pParams;
+	const crn_uint32 max_entries = pCtx->max_entries[pal];
+	float q;
+
+	if (pParams->flags & cCRNCompFlagManualPaletteSizes)
+	{
+		const crn_uint32 sizes[cCRNCompNumPalettes] =
+		{
+			pParams->crn_color_endpoint_palette_size, pParams->crn_color_selector_palette_size,
+			pParams->crn_alpha_endpoint_palette_size, pParams->crn_alpha_selector_palette_size
+		};
+		if (sizes[pal])
+			return CRN_MIN(sizes[pal], max_entries);
+	}
+
+	q = powf((float)quality_level / cCRNMaxQualityLevel, s_power[pal]);
+	if (max_entries <= cCRNMinPaletteSize)
+		return max_entries;
+	return cCRNMinPaletteSize + (crn_uint32)((max_entries - cCRNMinPaletteSize) * q + 0.5f);
+}
+
+// -------- Probes
+
+typedef struct
+{
+	crn_uint32  quality_level;
+	crn_uint32  num_helper_threads;
+	crn_uint8*  pData;
+	crn_uint32  data_size;
+	crn_uint64  error;               // Squared error of the written blocks, over their stored channels
+	crn_bool    failed;
+
+	// Palettes and indices, valid while the probe runs.
+	crn_uint32  num_entries[cCRNCompNumPalettes];
+	crn_uint32* pNode_entry[cCRNCompNumPalettes];
+	crn_uint32* pColor_endpoints;     // color0 | color1 << 16
+	crn_uint32* pAlpha_endpoints;     // alpha0 | alpha1 << 8
+	crn_uint8*  pColor_selectors;     // 16 linear selectors per entry
+	crn_uint8*  pAlpha_selectors;
+	crn_uint32* pTile_endpoints[3];   // color, alpha comp 0, alpha comp 1
+	crn_uint32* pBlock_selectors[3];
+} crn_comp_probe;
+
+typedef struct
+{
+	const crn_comp_context* pCtx;
+	crn_comp_probe* pProbe;
+} crn_comp_probe_job;
+
+static void crn_comp_assign_selectors(crn_uint32 batch, crn_uint32 thread_index, void* pData)
+{
+	const crn_comp_probe_job* pJob = (const crn_comp_probe_job*)pData;
+	const crn_comp_context* pCtx = pJob->pCtx;
+	crn_comp_probe* pProbe = pJob->pProbe;
+	const crn_uint32 first = batch * cCRNCompChunkBatchSize;
+	const crn_uint32 last = CRN_MIN(first + cCRNCompChunkBatchSize, pCtx->num_chunks);
+	(void)thread_index;
+
+	for (crn_uint32 c = first; c < last; c++)
+	{
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[pCtx->pChunk_encodings[c]];
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			const crn_uint32 tile = pCtx->pChunk_first_tile[c] + pTiles[b];
+			crn_uint8 pixels[16][4], linear[16];
+			float vec[16];
+
+			if (!crn_comp_get_block(pCtx, c, b, pixels))
+				continue;
+
+			if (pCtx->has_color)
+			{
+				const crn_uint32 e = pProbe->pTile_endpoints[0][tile];
+				crn_comp_color_selectors((const crn_uint8 (*)[4])pixels, pProbe->pColor_endpoints[e], pCtx->pColor_weights, linear);
+				for (crn_uint32 i = 0; i < 16; i++)
+					vec[i] = linear[i];
+				pProbe->pBlock_selectors[0][block] = pProbe->pNode_entry[cCRNCompColorSelectors][
+					crn_vq_tree_classify(&pCtx->trees[cCRNCompColorSelectors], vec, pProbe->num_entries[cCRNCompColorSelectors])];
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				const crn_uint32 e = pProbe->pTile_endpoints[1 + a][tile];
+				crn_comp_alpha_selectors((const crn_uint8 (*)[4])pixels, pCtx->alpha_channels[a], pProbe->pAlpha_endpoints[e], linear);
+				for (crn_uint32 i = 0; i < 16; i++)
+					vec[i] = linear[i];
+				pProbe->pBlock_selectors[1 + a][block] = pProbe->pNode_entry[cCRNCompAlphaSelectors][
+					crn_vq_tree_classify(&pCtx->trees[cCRNCompAlphaSelectors], vec, pProbe->num_entries[cCRNCompAlphaSelectors])];
+			}
+		}
+	}
+}
+
+// Re-solves every endpoint palette entry by least squares over all the texels that use it, given their selectors.
+static crn_bool crn_comp_refine_endpoints(const crn_comp_context* pCtx, crn_comp_probe* pProbe)
+{
+	crn_dxt1_ls* pColor_ls = NULL;
+	float* pAlpha_ls = NULL;
+
+	if (pCtx->has_color)
+	{
+		pColor_ls = (crn_dxt1_ls*)crn_calloc(pProbe->num_entries[cCRNCompColorEndpoints], sizeof(crn_dxt1_ls));
+		if (!pColor_ls)
+			return crn_false;
+	}
+	if (pCtx->num_alpha_comps)
+	{
+		pAlpha_ls = (float*)crn_calloc(pProbe->num_entries[cCRNCompAlphaEndpoints] * 5, sizeof(float));
+		if (!pAlpha_ls)
+		{
+			crn_free(pColor_ls);
+			return crn_false;
+		}
+	}
+
+	for (crn_uint32 c = 0; c < pCtx->num_chunks; c++)
+	{
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[pCtx->pChunk_encodings[c]];
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			const crn_uint32 tile = pCtx->pChunk_first_tile[c] + pTiles[b];
+			crn_uint8 pixels[16][4];
+			if (!crn_comp_get_block(pCtx, c, b, pixels))
+				continue;
+
+			if (pColor_ls)
+			{
+				crn_dxt1_ls* pLS = &pColor_ls[pProbe->pTile_endpoints[0][tile]];
+				const crn_uint8* pSel = pProbe->pColor_selectors + pProbe->pBlock_selectors[0][block] * 16;
+				for (crn_uint32 i = 0; i < 16; i++)
+					crn_dxt1_ls_add(pLS, pixels[i], pSel[i], 1.0f);
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				float* pLS = pAlpha_ls + pProbe->pTile_endpoints[1 + a][tile] * 5;
+				const crn_uint8* pSel = pProbe->pAlpha_selectors + pProbe->pBlock_selectors[1 + a][block] * 16;
+				for (crn_uint32 i = 0; i < 16; i++)
+				{
+					const float wb = pSel[i] * (1.0f / 7.0f), wa = 1.0f - wb, x = pixels[i][pCtx->alpha_channels[a]];
+					pLS[0] += wa * wa;
+					pLS[1] += wa * wb;
+					pLS[2] += wb * wb;
+					pLS[3] += wa * x;
+					pLS[4] += wb * x;
+				}
+			}
+		}
+	}
+
+	// Solutions that would flip the endpoint order are rejected, the selector palette assumes it.
+	for (crn_uint32 e = 0; pColor_ls && e < pProbe->num_entries[cCRNCompColorEndpoints]; e++)
+	{
+		float endpoints[6];
+		if (crn_dxt1_ls_solve(&pColor_ls[e], endpoints))
+		{
+			const crn_uint16 c0 = crn_dxt_quantize565(endpoints), c1 = crn_dxt_quantize565(endpoints + 3);
+			if (c0 > c1)
+				pProbe->pColor_endpoints[e] = c0 | ((crn_uint32)c1 << 16);
+		}
+	}
+	for (crn_uint32 e = 0; pAlpha_ls && e < pProbe->num_entries[cCRNCompAlphaEndpoints]; e++)
+	{
+		const float* pLS = pAlpha_ls + e * 5;
+		const float det = pLS[0] * pLS[2] - pLS[1] * pLS[1];
+		if (fabsf(det) > 1e-6f)
+		{
+			const float a0 = (pLS[2] * pLS[3] - pLS[1] * pLS[4]) / det;
+			const float a1 = (pLS[0] * pLS[4] - pLS[1] * pLS[3]) / det;
+			const int i0 = (int)(CRN_CLAMP(a0, 0.0f, 255.0f) + 0.5f), i1 = (int)(CRN_CLAMP(a1, 0.0f, 255.0f) + 0.5f);
+			if (i0 > i1)
+				pProbe->pAlpha_endpoints[e] = (crn_uint32)i0 | ((crn_uint32)i1 << 8);
+		}
+	}
+
+	crn_free(pColor_ls);
+	crn_free(pAlpha_ls);
+	return crn_true;
+}
+
+// Re-solves every selector palette entry texel by texel: each texel takes the selector with the least total error
+// over the blocks that use the entry, given their final endpoints. The tree centroids the entries start from are
+// averages of selectors trained against unquantized tile fits, this matches them to what the blocks really get.
+static crn_bool crn_comp_refine_selectors(const crn_comp_context* pCtx, crn_comp_probe* pProbe)
+{
+	crn_uint64* pColor_err = NULL;
+	crn_uint64* pAlpha_err = NULL;
+
+	if (pCtx->has_color)
+	{
+		pColor_err = (crn_uint64*)crn_calloc(pProbe->num_entries[cCRNCompColorSelectors] * 16 * 4, sizeof(crn_uint64));
+		if (!pColor_err)
+			return crn_false;
+	}
+	if (pCtx->num_alpha_comps)
+	{
+		pAlpha_err = (crn_uint64*)crn_calloc(pProbe->num_entries[cCRNCompAlphaSelectors] * 16 * 8, sizeof(crn_uint64));
+		if (!pAlpha_err)
+		{
+			crn_free(pColor_err);
+			return crn_false;
+		}
+	}
+
+	for (crn_uint32 c = 0; c < pCtx->num_chunks; c++)
+	{
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[pCtx->pChunk_encodings[c]];
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			const crn_uint32 tile = pCtx->pChunk_first_tile[c] + pTiles[b];
+			crn_uint8 pixels[16][4];
+			if (!crn_comp_get_block(pCtx, c, b, pixels))
+				continue;
+
+			if (pColor_err)
+			{
+				const crn_uint32 endpoints = pProbe->pColor_endpoints[pProbe->pTile_endpoints[0][tile]];
+				const crn_uint8* pWeights = pCtx->pColor_weights;
+				crn_uint64* pErr = pColor_err + pProbe->pBlock_selectors[0][block] * 16 * 4;
+				crn_uint8 colors[4][4];
+				crn_dxt1_get_block_colors((crn_uint16)endpoints, (crn_uint16)(endpoints >> 16), colors);
+				for (crn_uint32 i = 0; i < 16; i++)
+				{
+					for (crn_uint32 s = 0; s < 4; s++)
+					{
+						const crn_uint8* pColor = colors[g_crnd_dxt1_from_linear[s]];
+						const int dr = pixels[i][0] - pColor[0], dg = pixels[i][1] - pColor[1], db = pixels[i][2] - pColor[2];
+						pErr[i * 4 + s] += (crn_uint32)(dr * dr * pWeights[0] + dg * dg * pWeights[1] + db * db * pWeights[2]);
+					}
+				}
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				const crn_uint32 endpoints = pProbe->pAlpha_endpoints[pProbe->pTile_endpoints[1 + a][tile]];
+				const crn_uint32 ch = pCtx->alpha_channels[a];
+				crn_uint64* pErr = pAlpha_err + pProbe->pBlock_selectors[1 + a][block] * 16 * 8;
+				crn_uint8 values[8];
+				crn_dxt5_get_block_values(endpoints & 0xFF, endpoints >> 8, values);
+				for (crn_uint32 i = 0; i < 16; i++)
+				{
+					for (crn_uint32 s = 0; s < 8; s++)
+					{
+						const int d = pixels[i][ch] - values[g_crnd_dxt5_from_linear[s]];
+						pErr[i * 8 + s] += (crn_uint32)(d * d);
+					}
+				}
+			}
+		}
+	}
+
+	// Unused entries have all-zero errors and keep their selectors.
+	for (crn_uint32 e = 0; pColor_err && e < pProbe->num_entries[cCRNCompColorSelectors] * 16; e++)
+	{
+		const crn_uint64* pErr = pColor_err + e * 4;
+		crn_uint32 best = pProbe->pColor_selectors[e];
+		for (crn_uint32 s = 0; s < 4; s++)
+			best = (pErr[s] < pErr[best]) ? s : best;
+		pProbe->pColor_selectors[e] = (crn_uint8)best;
+	}
+	for (crn_uint32 e = 0; pAlpha_err && e < pProbe->num_entries[cCRNCompAlphaSelectors] * 16; e++)
+	{
+		const crn_uint64* pErr = pAlpha_err + e * 8;
+		crn_uint32 best = pProbe->pAlpha_selectors[e];
+		for (crn_uint32 s = 0; s < 8; s++)
+			best = (pErr[s] < pErr[best]) ? s : best;
+		pProbe->pAlpha_selectors[e] = (crn_uint8)best;
+	}
+
+	crn_free(pColor_err);
+	crn_free(pAlpha_err);
+	return crn_true;
+}
+
+// Sums the squared error of every block as written, over the channels the format stores.
+static crn_uint64 crn_comp_probe_error(const crn_comp_context* pCtx, const crn_comp_probe* pProbe)
+{
+	crn_uint64 error = 0;
+	for (crn_uint32 c = 0; c < pCtx->num_chunks; c++)
+	{
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[pCtx->pChunk_encodings[c]];
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			const crn_uint32 tile = pCtx->pChunk_first_tile[c] + pTiles[b];
+			crn_uint8 pixels[16][4];
+			if (!crn_comp_get_block(pCtx, c, b, pixels))
+				continue;
+
+			if (pCtx->has_color)
+			{
+				const crn_uint32 endpoints = pProbe->pColor_endpoints[pProbe->pTile_endpoints[0][tile]];
+				const crn_uint8* pSel = pProbe->pColor_selectors + pProbe->pBlock_selectors[0][block] * 16;
+				crn_uint8 colors[4][4];
+				crn_dxt1_get_block_colors((crn_uint16)endpoints, (crn_uint16)(endpoints >> 16), colors);
+				for (crn_uint32 i = 0; i < 16; i++)
+				{
+					const crn_uint8* pColor = colors[g_crnd_dxt1_from_linear[pSel[i]]];
+					for (crn_uint32 ch = 0; ch < 3; ch++)
+						error += (crn_uint32)((pixels[i][ch] - pColor[ch]) * (pixels[i][ch] - pColor[ch]));
+				}
+			}
+
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+			{
+				const crn_uint32 endpoints = pProbe->pAlpha_endpoints[pProbe->pTile_endpoints[1 + a][tile]];
+				const crn_uint8* pSel = pProbe->pAlpha_selectors + pProbe->pBlock_selectors[1 + a][block] * 16;
+				const crn_uint32 ch = pCtx->alpha_channels[a];
+				crn_uint8 values[8];
+				crn_dxt5_get_block_values(endpoints & 0xFF, endpoints >> 8, values);
+				for (crn_uint32 i = 0; i < 16; i++)
+				{
+					const int d = pixels[i][ch] - values[g_crnd_dxt5_from_linear[pSel[i]]];
+					error += (crn_uint32)(d * d);
+				}
+			}
+		}
+	}
+	return error;
+}
+
+// Orders a palette as a greedy nearest neighbour chain so consecutive entries (and thus index deltas) stay small.
+// pRemap receives the new index of each entry.
+static crn_bool crn_comp_order_palette(const crn_int32* pVecs, crn_uint32 dims, crn_uint32 num, crn_uint32* pRemap)
+{
+	crn_uint8* pUsed = (crn_uint8*)crn_calloc(CRN_MAX(num, 1U), 1);
+	crn_uint32 cur = 0;
+	crn_int32 best_sum = 0x7FFFFFFF;
+	if (!pUsed)
+		return crn_false;
+
+	for (crn_uint32 i = 0; i < num; i++)
+	{
+		crn_int32 sum = 0;
+		for (crn_uint32 d = 0; d < dims; d++)
+			sum += pVecs[i * dims + d];
+		if (sum < best_sum)
+		{
+			best_sum = sum;
+			cur = i;
+		}
+	}
+
+	for (crn_uint32 n = 0; n < num; n++)
+	{
+		crn_uint32 next = 0;
+		crn_uint32 best_dist = 0xFFFFFFFF;
+		pUsed[cur] = 1;
+		pRemap[cur] = n;
+		for (crn_uint32 i = 0; i < num; i++)
+		{
+			crn_uint32 dist = 0;
+			if (pUsed[i])
+				continue;
+			for (crn_uint32 d = 0; d < dims && dist < best_dist; d++)
+			{
+				const crn_int32 delta = pVecs[i * dims + d] - pVecs[cur * dims + d];
+				dist += (crn_uint32)(delta * delta);
+			}
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				next = i;
+			}
+		}
+		cur = next;
+	}
+
+	crn_free(pUsed);
+	return crn_true;
+}
+
+static crn_bool crn_comp_reorder_palettes(const crn_comp_context* pCtx, crn_comp_probe* pProbe)
+{
+	for (crn_uint32 pal = 0; pal < cCRNCompNumPalettes; pal++)
+	{
+		const crn_uint32 num = pProbe->num_entries[pal];
+		const crn_uint32 dims = (pal == cCRNCompColorEndpoints) ? 6 : g_crn_comp_palette_dims[pal];
+		crn_int32* pVecs;
+		crn_uint32* pRemap;
+		crn_bool ok;
+
+		if (!crn_comp_uses_palette(pCtx, pal))
+			continue;
+
+		pVecs = (crn_int32*)crn_malloc(num * dims * sizeof(crn_int32));
+		pRemap = (crn_uint32*)crn_malloc(num * sizeof(crn_uint32));
+		if (!pVecs || !pRemap)
+		{
+			crn_free(pVecs);
+			crn_free(pRemap);
+			return crn_false;
+		}
+
+		for (crn_uint32 e = 0; e < num; e++)
+		{
+			crn_int32* pVec = pVecs + e * dims;
+			switch (pal)
+			{
+			case cCRNCompColorEndpoints:
+			{
+				crn_uint8 rgba[2][4];
+				crn_dxt_unpack565((crn_uint16)pProbe->pColor_endpoints[e], rgba[0]);
+				crn_dxt_unpack565((crn_uint16)(pProbe->pColor_endpoints[e] >> 16), rgba[1]);
+				for (crn_uint32 d = 0; d < 6; d++)
+					pVec[d] = rgba[d / 3][d % 3];
+				break;
+			}
+			case cCRNCompAlphaEndpoints:
+				pVec[0] = pProbe->pAlpha_endpoints[e] & 0xFF;
+				pVec[1] = pProbe->pAlpha_endpoints[e] >> 8;
+				break;
+			default:
+			{
+				const crn_uint8* pSel = (pal == cCRNCompColorSelectors ? pProbe->pColor_selectors : pProbe->pAlpha_selectors) + e * 16;
+				for (crn_uint32 d = 0; d < 16; d++)
+					pVec[d] = pSel[d];
+				break;
+			}
+			}
+		}
+
+		ok = crn_comp_order_palette(pVecs, dims, num, pRemap);
+		crn_free(pVecs);
+		if (!ok)
+		{
+			crn_free(pRemap);
+			return crn_false;
+		}
+
+		// Apply the permutation to the palette and every index referring to it.
+		if (pal == cCRNCompColorEndpoints || pal == cCRNCompAlphaEndpoints)
+		{
+			crn_uint32* pEntries = (pal == cCRNCompColorEndpoints) ? pProbe->pColor_endpoints : pProbe->pAlpha_endpoints;
+			crn_uint32* pTmp = (crn_uint32*)crn_malloc(num * sizeof(crn_uint32));
+			if (!pTmp)
+			{
+				crn_free(pRemap);
+				return crn_false;
+			}
+			for (crn_uint32 e = 0; e < num; e++)
+				pTmp[pRemap[e]] = pEntries[e];
+			memcpy(pEntries, pTmp, num * sizeof(crn_uint32));
+			crn_free(pTmp);
+
+			if (pal == cCRNCompColorEndpoints)
+				for (crn_uint32 t = 0; t < pCtx->num_tiles; t++)
+					pProbe->pTile_endpoints[0][t] = pRemap[pProbe->pTile_endpoints[0][t]];
+			else
+				for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+					for (crn_uint32 t = 0; t < pCtx->num_tiles; t++)
+						pProbe->pTile_endpoints[1 + a][t] = pRemap[pProbe->pTile_endpoints[1 + a][t]];
+		}
+		else
+		{
+			crn_uint8* pEntries = (pal == cCRNCompColorSelectors) ? pProbe->pColor_selectors : pProbe->pAlpha_selectors;
+			crn_uint8* pTmp = (crn_uint8*)crn_malloc(num * 16);
+			if (!pTmp)
+			{
+				crn_free(pRemap);
+				return crn_false;
+			}
+			for (crn_uint32 e = 0; e < num; e++)
+				memcpy(pTmp + pRemap[e] * 16, pEntries + e * 16, 16);
+			memcpy(pEntries, pTmp, num * 16);
+			crn_free(pTmp);
+
+			if (pal == cCRNCompColorSelectors)
+				for (crn_uint32 b = 0; b < pCtx->num_chunks * 4; b++)
+					pProbe->pBlock_selectors[0][b] = pRemap[pProbe->pBlock_selectors[0][b]];
+			else
+				for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+					for (crn_uint32 b = 0; b < pCtx->num_chunks * 4; b++)
+						pProbe->pBlock_selectors[1 + a][b] = pRemap[pProbe->pBlock_selectors[1 + a][b]];
+		}
+		crn_free(pRemap);
+	}
+	return crn_true;
+}
+
+// -------- Bitstream
+
+static crn_bool crn_comp_write_color_endpoints(crn_bit_writer* pWriter, const crn_uint32* pEndpoints, crn_uint32 num)
+{
+	crn_uint32 freq[2][64] = { { 0 } };
+	crn_huff_encoder dm[2] = { { 0 } };
+	crn_bool ok = crn_true;
+	for (int pass = 0; ok && pass < 2; pass++)
+	{
+		crn_uint32 prev[6] = { 0 };
+		if (pass)
+		{
+			ok = crn_huff_encoder_init(&dm[0], 32, freq[0], 16) && crn_huff_encoder_init(&dm[1], 64, freq[1], 16);
+			if (!ok)
+				break;
+			crn_bit_writer_send_model(pWriter, &dm[0]);
+			crn_bit_writer_send_model(pWriter, &dm[1]);
+		}
+		for (crn_uint32 i = 0; i < num; i++)
+		{
+			const crn_uint32 c0 = pEndpoints[i] & 0xFFFF, c1 = pEndpoints[i] >> 16;
+			const crn_uint32 comps[6] = { c0 >> 11, (c0 >> 5) & 63, c0 & 31, c1 >> 11, (c1 >> 5) & 63, c1 & 31 };
+			for (crn_uint32 j = 0; j < 6; j++)
+			{
+				const crn_uint32 m = (j == 1 || j == 4), mask = m ? 63 : 31;
+				const crn_uint32 delta = (comps[j] - prev[j]) & mask;
+				prev[j] = comps[j];
+				if (pass)
+					crn_bit_writer_encode(pWriter, &dm[m], delta);
+				else
+					freq[m][delta]++;
+			}
+		}
+	}
+	crn_huff_encoder_free(&dm[0]);
+	crn_huff_encoder_free(&dm[1]);
+	return ok;
+}
+
+static crn_bool crn_comp_write_alpha_endpoints(crn_bit_writer* pWriter, const crn_uint32* pEndpoints, crn_uint32 num)
+{
+	crn_uint32 freq[256] = { 0 };
+	crn_huff_encoder dm = { 0 };
+	crn_bool ok = crn_true;
+	for (int pass = 0; ok && pass < 2; pass++)
+	{
+		crn_uint32 prev[2] = { 0 };
+		if (pass)
+		{
+			ok = crn_huff_encoder_init(&dm, 256, freq, 16);
+			if (!ok)
+				break;
+			crn_bit_writer_send_model(pWriter, &dm);
+		}
+		for (crn_uint32 i = 0; i < num; i++)
+		{
+			for (crn_uint32 j = 0; j < 2; j++)
+			{
+				const crn_uint32 v = (pEndpoints[i] >> (j * 8)) & 0xFF, delta = (v - prev[j]) & 0xFF;
+				prev[j] = v;
+				if (pass)
+					crn_bit_writer_encode(pWriter, &dm, delta);
+				else
+					freq[delta]++;
+			}
+		}
+	}
+	crn_huff_encoder_free(&dm);
+	return ok;
+}
+
+// Selector palettes code pairs of per-texel linear selector deltas, max_delta is 3 for DXT1 and 7 for DXT5.
+static crn_bool crn_comp_write_selectors(crn_bit_writer* pWriter, const crn_uint8* pSelectors, crn_uint32 num, int max_delta)
+{
+	const int n = max_delta * 2 + 1;
+	crn_uint32 freq[15 * 15] = { 0 };
+	crn_huff_encoder dm = { 0 };
+	crn_bool ok = crn_true;
+	for (int pass = 0; ok && pass < 2; pass++)
+	{
+		int prev[16] = { 0 };
+		if (pass)
+		{
+			ok = crn_huff_encoder_init(&dm, (crn_uint32)(n * n), freq, 16);
+			if (!ok)
+				break;
+			crn_bit_writer_send_model(pWriter, &dm);
+		}
+		for (crn_uint32 i = 0; i < num; i++)
+		{
+			const crn_uint8* pSel = pSelectors + i * 16;
+			for (crn_uint32 j = 0; j < 8; j++)
+			{
+				const int d0 = pSel[j * 2] - prev[j * 2], d1 = pSel[j * 2 + 1] - prev[j * 2 + 1];
+				const crn_uint32 sym = (crn_uint32)((d0 + max_delta) + (d1 + max_delta) * n);
+				if (pass)
+					crn_bit_writer_encode(pWriter, &dm, sym);
+				else
+					freq[sym]++;
+			}
+			for (crn_uint32 j = 0; j < 16; j++)
+				prev[j] = pSel[j];
+		}
+	}
+	crn_huff_encoder_free(&dm);
+	return ok;
+}
+
+typedef struct
+{
+	crn_uint32* pSyms;   // (model << 16) | symbol
+	crn_uint32  num_syms;
+	crn_uint32  prev_endpoint[2];
+	crn_uint32  prev_selector[2];
+	crn_uint32  chunk_encoding_sym;
+	crn_uint32  chunk_encoding_count;
+} crn_comp_symbols;
+
+static void crn_comp_push_index(crn_comp_symbols* pSyms, crn_uint32 model, crn_uint32* pPrev, crn_uint32 index, crn_uint32 num)
+{
+	pSyms->pSyms[pSyms->num_syms++] = (model << 16) | ((index + num - *pPrev) % num);
+	*pPrev = index;
+}
+
+// Generates a slice's level's symbols in the exact order crnd_unpack_level() consumes them.
+// Indices of blocks and tiles outside the image repeat the previous index, so they cost a zero delta.
+static void crn_comp_level_symbols(const crn_comp_context* pCtx, const crn_comp_probe* pProbe, crn_uint32 slice, crn_uint32 level, crn_comp_symbols* pSyms)
+{
+	const crn_uint32 first_chunk = slice * pCtx->chunks_per_slice;
+	crn_uint32 encoding_pos = 0;
+
+	pSyms->chunk_encoding_count = 0;
+	memset(pSyms->prev_endpoint, 0, sizeof(pSyms->prev_endpoint));
+	memset(pSyms->prev_selector, 0, sizeof(pSyms->prev_selector));
+
+	for (crn_uint32 c = first_chunk + pCtx->level_first_chunk[level]; c < first_chunk + pCtx->level_first_chunk[level + 1]; c++)
+	{
+		const crn_uint32 encoding = pCtx->pChunk_encodings[c];
+		const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[encoding];
+		const crn_uint32 first_tile = pCtx->pChunk_first_tile[c];
+		const crn_uint32 num_tiles = pCtx->pChunk_first_tile[c + 1] - first_tile;
+		crn_bool tile_valid[4] = { crn_false, crn_false, crn_false, crn_false };
+		crn_bool block_valid[4];
+
+		if (!pSyms->chunk_encoding_count)
+		{
+			encoding_pos = pSyms->num_syms++;
+			pSyms->chunk_encoding_sym = 0;
+		}
+		pSyms->chunk_encoding_sym |= encoding << (pSyms->chunk_encoding_count * 3);
+		pSyms->pSyms[encoding_pos] = (cCRNCompModelChunkEncoding << 16) | pSyms->chunk_encoding_sym;
+		pSyms->chunk_encoding_count = (pSyms->chunk_encoding_count + 1) % 3;
+
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			block_valid[b] = crn_comp_block_in_bounds(pCtx, c, b);
+			tile_valid[pTiles[b]] |= block_valid[b];
+		}
+
+		if (pCtx->has_color)
+		{
+			for (crn_uint32 t = 0; t < num_tiles; t++)
+				crn_comp_push_index(pSyms, cCRNCompModelColorEndpoints, &pSyms->prev_endpoint[0],
+					tile_valid[t] ? pProbe->pTile_endpoints[0][first_tile + t] : pSyms->prev_endpoint[0], pProbe->num_entries[cCRNCompColorEndpoints]);
+		}
+		for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+		{
+			for (crn_uint32 t = 0; t < num_tiles; t++)
+				crn_comp_push_index(pSyms, cCRNCompModelAlphaEndpoints, &pSyms->prev_endpoint[1],
+					tile_valid[t] ? pProbe->pTile_endpoints[1 + a][first_tile + t] : pSyms->prev_endpoint[1], pProbe->num_entries[cCRNCompAlphaEndpoints]);
+		}
+
+		for (crn_uint32 b = 0; b < 4; b++)
+		{
+			const crn_uint32 block = c * 4 + b;
+			for (crn_uint32 a = 0; a < pCtx->num_alpha_comps; a++)
+				crn_comp_push_index(pSyms, cCRNCompModelAlphaSelectors, &pSyms->prev_selector[1],
+					block_valid[b] ? pProbe->pBlock_selectors[1 + a][block] : pSyms->prev_selector[1], pProbe->num_entries[cCRNCompAlphaSelectors]);
+			if (pCtx->has_color)
+				crn_comp_push_index(pSyms, cCRNCompModelColorSelectors, &pSyms->prev_selector[0],
+					block_valid[b] ? pProbe->pBlock_selectors[0][block] : pSyms->prev_selector[0], pProbe->num_entries[cCRNCompColorSelectors]);
+		}
+	}
+}
+
+// Appends a slice's CRN file to the probe's data. Only the first slice's file holds the shared palettes, already
+// encoded to pPalettes, the others flag them as shared. Each file fits its own Huffman models to its own symbols.
+static crn_bool crn_comp_write_slice(const crn_comp_context* pCtx, crn_comp_probe* pProbe, crn_uint32 slice, const crn_bit_writer* pPalettes)
+{
+	const crn_comp_params* pParams = &pCtx->pSlices[slice];
+	const crn_uint32 header_size = cCRNHeaderMinSize + pParams->levels * 4;
+	crn_bit_writer tables, levels[cCRNMaxLevels];
+	crn_uint32 level_num_syms[cCRNMaxLevels];
+	crn_uint32 num_model_syms[cCRNCompNumModels];
+	crn_uint32* pFreq[cCRNCompNumModels] = { NULL };
+	crn_huff_encoder models[cCRNCompNumModels];
+	crn_comp_symbols syms;
+	crn_uint32 total_size, ofs;
+	crn_uint8* pData = NULL;
+	crn_bool ok = crn_true;
+
+	memset(models, 0, sizeof(models));
+	crn_bit_writer_init(&tables);
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+		crn_bit_writer_init(&levels[l]);
+
+	num_model_syms[cCRNCompModelChunkEncoding] = 512;
+	num_model_syms[cCRNCompModelColorEndpoints] = pProbe->num_entries[cCRNCompColorEndpoints];
+	num_model_syms[cCRNCompModelColorSelectors] = pProbe->num_entries[cCRNCompColorSelectors];
+	num_model_syms[cCRNCompModelAlphaEndpoints] = pProbe->num_entries[cCRNCompAlphaEndpoints];
+	num_model_syms[cCRNCompModelAlphaSelectors] = pProbe->num_entries[cCRNCompAlphaSelectors];
+
+	// Worst case: one chunk encoding symbol, 4 tiles and 4 blocks for each of 2 components per chunk.
+	syms.num_syms = 0;
+	syms.pSyms = (crn_uint32*)crn_malloc((size_t)pCtx->chunks_per_slice * 17 * sizeof(crn_uint32));
+	ok = syms.pSyms != NULL;
+	for (crn_uint32 m = 0; ok && m < cCRNCompNumModels; m++)
+		ok = (pFreq[m] = (crn_uint32*)crn_calloc(CRN_MAX(num_model_syms[m], 1U), sizeof(crn_uint32))) != NULL;
+
+	for (crn_uint32 l = 0; ok && l < pParams->levels; l++)
+	{
+		const crn_uint32 start = syms.num_syms;
+		crn_comp_level_symbols(pCtx, pProbe, slice, l, &syms);
+		level_num_syms[l] = syms.num_syms - start;
+	}
+	for (crn_uint32 i = 0; ok && i < syms.num_syms; i++)
+		pFreq[syms.pSyms[i] >> 16][syms.pSyms[i] & 0xFFFF]++;
+
+	for (crn_uint32 m = 0; ok && m < cCRNCompNumModels; m++)
+		ok = crn_huff_encoder_init(&models[m], num_model_syms[m], pFreq[m], 16);
+
+	if (ok)
+	{
+		crn_uint32 pos = 0;
+		crn_bit_writer_send_model(&tables, &models[cCRNCompModelChunkEncoding]);
+		if (pCtx->has_color)
+		{
+			crn_bit_writer_send_model(&tables, &models[cCRNCompModelColorEndpoints]);
+			crn_bit_writer_send_model(&tables, &models[cCRNCompModelColorSelectors]);
+		}
+		if (pCtx->num_alpha_comps)
+		{
+			crn_bit_writer_send_model(&tables, &models[cCRNCompModelAlphaEndpoints]);
+			crn_bit_writer_send_model(&tables, &models[cCRNCompModelAlphaSelectors]);
+		}
+		for (crn_uint32 l = 0; l < pParams->levels; l++)
+		{
+			for (crn_uint32 i = 0; i < level_num_syms[l]; i++, pos++)
+				crn_bit_writer_encode(&levels[l], &models[syms.pSyms[pos] >> 16], syms.pSyms[pos] & 0xFFFF);
+		}
+	}
+
+	ok = crn_bit_writer_flush(&tables) && ok;
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+		ok = crn_bit_writer_flush(&levels[l]) && ok;
+
+	total_size = header_size + tables.size;
+	for (crn_uint32 i = 0; !slice && i < cCRNCompNumPalettes; i++)
+		total_size += pPalettes[i].size;
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+		total_size += levels[l].size;
+
+	pData = ok ? (crn_uint8*)crn_realloc(pProbe->pData, (size_t)pProbe->data_size + total_size) : NULL;
+	if (pData)
+	{
+		static const crn_uint32 s_palette_ofs[cCRNCompNumPalettes] =
+		{
+			cCRNHdrOfsColorEndpoints, cCRNHdrOfsColorSelectors, cCRNHdrOfsAlphaEndpoints, cCRNHdrOfsAlphaSelectors
+		};
+		crn_uint8* pFile = pData + pProbe->data_size;
+		memset(pFile, 0, total_size);
+		ofs = header_size;
+		for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+		{
+			if (!crn_comp_uses_palette(pCtx, i))
+				continue;
+			crn_write_packed(pFile + s_palette_ofs[i] + 6, pProbe->num_entries[i], 2);
+			if (slice)
+				continue;
+			crn_write_packed(pFile + s_palette_ofs[i], ofs, 3);
+			crn_write_packed(pFile + s_palette_ofs[i] + 3, pPalettes[i].size, 3);
+			memcpy(pFile + ofs, pPalettes[i].pBuf, pPalettes[i].size);
+			ofs += pPalettes[i].size;
+		}
+		if (slice)
+			crn_write_packed(pFile + cCRNHdrOfsFlags, cCRNHeaderFlagSharedPalettes, 2);
+
+		crn_write_packed(pFile + cCRNHdrOfsTablesSize, tables.size, 2);
+		crn_write_packed(pFile + cCRNHdrOfsTablesOfs, ofs, 3);
+		memcpy(pFile + ofs, tables.pBuf, tables.size);
+		ofs += tables.size;
+
+		for (crn_uint32 l = 0; l < pParams->levels; l++)
+		{
+			crn_write_packed(pFile + cCRNHdrOfsLevelOfs + l * 4, ofs, 4);
+			if (levels[l].size)
+				memcpy(pFile + ofs, levels[l].pBuf, levels[l].size);
+			ofs += levels[l].size;
+		}
+
+		crn_write_packed(pFile + cCRNHdrOfsSig, cCRNSigValue, 2);
+		crn_write_packed(pFile + cCRNHdrOfsHeaderSize, header_size, 2);
+		crn_write_packed(pFile + cCRNHdrOfsDataSize, total_size, 4);
+		crn_write_packed(pFile + cCRNHdrOfsWidth, pParams->width, 2);
+		crn_write_packed(pFile + cCRNHdrOfsHeight, pParams->height, 2);
+		pFile[cCRNHdrOfsLevels] = (crn_uint8)pParams->levels;
+		pFile[cCRNHdrOfsFaces] = (crn_uint8)pParams->faces;
+		pFile[cCRNHdrOfsFormat] = (crn_uint8)pParams->format;
+		crn_write_packed(pFile + cCRNHdrOfsUserdata0, pParams->userdata0, 4);
+		crn_write_packed(pFile + cCRNHdrOfsUserdata1, pParams->userdata1, 4);
+		crn_write_packed(pFile + cCRNHdrOfsDataCRC16, crn_crc16(pFile + header_size, total_size - header_size, 0), 2);
+		crn_write_packed(pFile + cCRNHdrOfsHeaderCRC16, crn_crc16(pFile + cCRNHdrOfsDataSize, header_size - cCRNHdrOfsDataSize, 0), 2);
+
+		pProbe->pData = pData;
+		pProbe->data_size += total_size;
+	}
+
+	for (crn_uint32 m = 0; m < cCRNCompNumModels; m++)
+	{
+		crn_huff_encoder_free(&models[m]);
+		crn_free(pFreq[m]);
+	}
+	crn_free(syms.pSyms);
+	crn_bit_writer_free(&tables);
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+		crn_bit_writer_free(&levels[l]);
+	return pData != NULL;
+}
+
+// Writes every slice's CRN file, back to back, the first one holding the palettes.
+static crn_bool crn_comp_write_file(const crn_comp_context* pCtx, crn_comp_probe* pProbe)
+{
+	crn_bit_writer palettes[cCRNCompNumPalettes];
+	crn_bool ok = crn_true;
+
+	for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+		crn_bit_writer_init(&palettes[i]);
+	if (pCtx->has_color)
+	{
+		ok = crn_comp_write_color_endpoints(&palettes[cCRNCompColorEndpoints], pProbe->pColor_endpoints, pProbe->num_entries[cCRNCompColorEndpoints]) && ok;
+		ok = crn_comp_write_selectors(&palettes[cCRNCompColorSelectors], pProbe->pColor_selectors, pProbe->num_entries[cCRNCompColorSelectors], 3) && ok;
+	}
+	if (pCtx->num_alpha_comps)
+	{
+		ok = crn_comp_write_alpha_endpoints(&palettes[cCRNCompAlphaEndpoints], pProbe->pAlpha_endpoints, pProbe->num_entries[cCRNCompAlphaEndpoints]) && ok;
+		ok = crn_comp_write_selectors(&palettes[cCRNCompAlphaSelectors], pProbe->pAlpha_selectors, pProbe->num_entries[cCRNCompAlphaSelectors], 7) && ok;
+	}
+	for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+		ok = crn_bit_writer_flush(&palettes[i]) && ok;
+
+	pProbe->pData = NULL;
+	pProbe->data_size = 0;
+	for (crn_uint32 s = 0; ok && s < pCtx->num_slices; s++)
+		ok = crn_comp_write_slice(pCtx, pProbe, s, palettes);
+	if (!ok)
+	{
+		crn_free(pProbe->pData);
+		pProbe->pData = NULL;
+		pProbe->data_size = 0;
+	}
+
+	for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+		crn_bit_writer_free(&palettes[i]);
+	return ok;
+}
+
+static void crn_comp_free_probe_state(crn_comp_probe* pProbe)
+{
+	for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+	{
+		crn_free(pProbe->pNode_entry[i]);
+		pProbe->pNode_entry[i] = NULL;
+	}
+	for (crn_uint32 i = 0; i < 3; i++)
+	{
+		crn_free(pProbe->pTile_endpoints[i]);
+		crn_free(pProbe->pBlock_selectors[i]);
+		pProbe->pTile_endpoints[i] = pProbe->pBlock_selectors[i] = NULL;
+	}
+	crn_free(pProbe->pColor_endpoints);
+	crn_free(pProbe->pAlpha_endpoints);
+	crn_free(pProbe->pColor_selectors);
+	crn_free(pProbe->pAlpha_selectors);
+	pProbe->pColor_endpoints = pProbe->pAlpha_endpoints = NULL;
+	pProbe->pColor_selectors = pProbe->pAlpha_selectors = NULL;
+}
+
+// Compresses the texture at a single quality level. Probes only read the shared context, so several
+// can run at once. The clustering itself is taken from prefixes of the shared VQ trees.
+static crn_bool crn_comp_run_probe(const crn_comp_context* pCtx, crn_comp_probe* pProbe)
+{
+	crn_comp_probe_job job = { pCtx, pProbe };
+	const crn_uint32 num_batches = (pCtx->num_chunks + cCRNCompChunkBatchSize - 1) / cCRNCompChunkBatchSize;
+	crn_uint32 nodes[cCRNMaxPaletteSize];
+	crn_bool ok = crn_true;
+
+	for (crn_uint32 pal = 0; ok && pal < cCRNCompNumPalettes; pal++)
+	{
+		const crn_vq_tree* pTree = &pCtx->trees[pal];
+		if (!crn_comp_uses_palette(pCtx, pal))
+			continue;
+
+		pProbe->num_entries[pal] = crn_vq_tree_get_codebook(pTree, crn_comp_palette_size(pCtx, pal, pProbe->quality_level), nodes);
+		pProbe->pNode_entry[pal] = (crn_uint32*)crn_malloc(pTree->num_nodes * sizeof(crn_uint32));
+		if (!pProbe->pNode_entry[pal])
+		{
+			ok = crn_false;
+			break;
+		}
+		for (crn_uint32 e = 0; e < pProbe->num_entries[pal]; e++)
+			pProbe->pNode_entry[pal][nodes[e]] = e;
+
+		switch (pal)
+		{
+		case cCRNCompColorEndpoints:
+		case cCRNCompAlphaEndpoints:
+		{
+			crn_uint32* pEntries = (crn_uint32*)crn_malloc(pProbe->num_entries[pal] * sizeof(crn_uint32));
+			const crn_uint32 num_comps = (pal == cCRNCompColorEndpoints) ? 1 : pCtx->num_alpha_comps;
+			const crn_uint32 first_comp = (pal == cCRNCompColorEndpoints) ? 0 : 1;
+			if (!pEntries)
+			{
+				ok = crn_false;
+				break;
+			}
+			for (crn_uint32 e = 0; e < pProbe->num_entries[pal]; e++)
+			{
+				const float* pCentroid = pTree->pCentroids + nodes[e] * pTree->dims;
+				pEntries[e] = (pal == cCRNCompColorEndpoints)
+					? crn_comp_pack_color_endpoints(crn_dxt_quantize565(pCentroid), crn_dxt_quantize565(pCentroid + 3))
+					: crn_comp_pack_alpha_endpoints((int)(pCentroid[0] + 0.5f), (int)(pCentroid[1] + 0.5f));
+			}
+			if (pal == cCRNCompColorEndpoints)
+				pProbe->pColor_endpoints = pEntries;
+			else
+				pProbe->pAlpha_endpoints = pEntries;
+
+			for (crn_uint32 comp = 0; ok && comp < num_comps; comp++)
+			{
+				crn_uint32* pTile_endpoints = (crn_uint32*)crn_malloc(CRN_MAX(pCtx->num_tiles, 1U) * sizeof(crn_uint32));
+				pProbe->pTile_endpoints[first_comp + comp] = pTile_endpoints;
+				if (!pTile_endpoints)
+				{
+					ok = crn_false;
+					break;
+				}
+				for (crn_uint32 t = 0; t < pCtx->num_tiles; t++)
+					pTile_endpoints[t] = pProbe->pNode_entry[pal][crn_vq_tree_vec_node(pTree, comp * pCtx->num_tiles + t, pProbe->num_entries[pal])];
+			}
+			break;
+		}
+		default:
+		{
+			const crn_uint32 num_comps = (pal == cCRNCompColorSelectors) ? 1 : pCtx->num_alpha_comps;
+			const crn_uint32 first_comp = (pal == cCRNCompColorSelectors) ? 0 : 1;
+			const float max_linear = (pal == cCRNCompColorSelectors) ? 3.0f : 7.0f;
+			crn_uint8* pEntries = (crn_uint8*)crn_malloc(pProbe->num_entries[pal] * 16);
+			if (!pEntries)
+			{
+				ok = crn_false;
+				break;
+			}
+			for (crn_uint32 e = 0; e < pProbe->num_entries[pal]; e++)
+			{
+				const float* pCentroid = pTree->pCentroids + nodes[e] * pTree->dims;
+				for (crn_uint32 i = 0; i < 16; i++)
+					pEntries[e * 16 + i] = (crn_uint8)(CRN_CLAMP(pCentroid[i], 0.0f, max_linear) + 0.5f);
+			}
+			if (pal == cCRNCompColorSelectors)
+				pProbe->pColor_selectors = pEntries;
+			else
+				pProbe->pAlpha_selectors = pEntries;
+
+			for (crn_uint32 comp = 0; ok && comp < num_comps; comp++)
+			{
+				pProbe->pBlock_selectors[first_comp + comp] = (crn_uint32*)crn_calloc(pCtx->num_chunks * 4, sizeof(crn_uint32));
+				ok = pProbe->pBlock_selectors[first_comp + comp] != NULL;
+			}
+			break;
+		}
+		}
+	}
+
+	// Selectors depend on the endpoints and vice versa: assign, refit the endpoints, reassign, then refit both palettes
+	// to the final assignment.
+	if (ok)
+	{
+		crn_parallel_for(pProbe->num_helper_threads, num_batches, crn_comp_assign_selectors, &job);
+		ok = crn_comp_refine_endpoints(pCtx, pProbe);
+	}
+	if (ok)
+	{
+		crn_parallel_for(pProbe->num_helper_threads, num_batches, crn_comp_assign_selectors, &job);
+		ok = crn_comp_refine_selectors(pCtx, pProbe) && crn_comp_refine_endpoints(pCtx, pProbe);
+		pProbe->error = ok ? crn_comp_probe_error(pCtx, pProbe) : 0;
+	}
+	if (ok)
+	{
+		if (!(pCtx->pParams->flags & cCRNCompFlagQuick))
+			ok = crn_comp_reorder_palettes(pCtx, pProbe);
+	}
+	ok = ok && crn_comp_write_file(pCtx, pProbe);
+
+	crn_comp_free_probe_state(pProbe);
+	pProbe->failed = !ok;
+	return ok;
+}
+
+typedef struct
+{
+	const crn_comp_context* pCtx;
+	crn_comp_probe* pProbes;
+} crn_comp_probe_batch;
+
+static void crn_comp_run_probe_task(crn_uint32 index, crn_uint32 thread_index, void* pData)
+{
+	crn_comp_probe_batch* pBatch = (crn_comp_probe_batch*)pData;
+	(void)thread_index;
+	crn_comp_run_probe(pBatch->pCtx, &pBatch->pProbes[index]);
+}
+
+// -------- Context
+
+static void crn_comp_free_context(crn_comp_context* pCtx)
+{
+	crn_free(pCtx->pChunks);
+	crn_free(pCtx->pChunk_encodings);
+	crn_free(pCtx->pChunk_first_tile);
+	for (crn_uint32 i = 0; i < cCRNCompNumPalettes; i++)
+	{
+		crn_free(pCtx->pVecs[i]);
+		crn_free(pCtx->pWeights[i]);
+		crn_vq_tree_free(&pCtx->trees[i]);
+	}
+}
+
+static crn_bool crn_comp_progress(const crn_comp_params* pParams, crn_uint32 phase, crn_uint32 subphase, crn_uint32 total_subphases)
+{
+	if (!pParams->pProgress_func)
+		return crn_true;
+	return pParams->pProgress_func(phase, cCRNCompNumPhases, subphase, total_subphases, pParams->pProgress_func_data);
+}
+
+static crn_bool crn_comp_init_context(crn_comp_context* pCtx, const crn_comp_params* pSlices, crn_uint32 num_slices, crn_bool hierarchical)
+{
+	const crn_comp_params* pParams = &pSlices[0];
+	crn_uint32 c = 0;
+
+	memset(pCtx, 0, sizeof(*pCtx));
+	pCtx->pParams = pParams;
+	pCtx->pSlices = pSlices;
+	pCtx->num_slices = num_slices;
+	pCtx->num_helper_threads = pParams->num_helper_threads;
+	pCtx->pColor_weights = crn_dxt1_get_weights(pParams->flags);
+
+	switch (pParams->format)
+	{
+	case cCRNFmtDXT1:
+		pCtx->has_color = crn_true;
+		break;
+	case cCRNFmtDXT5:
+		pCtx->has_color = crn_true;
+		pCtx->num_alpha_comps = 1;
+		pCtx->alpha_channels[0] = pParams->alpha_component;
+		break;
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+		// crn_comp_get_block() swizzles these to plain DXT5 pixels.
+		pCtx->has_color = crn_true;
+		pCtx->num_alpha_comps = 1;
+		pCtx->alpha_channels[0] = 3;
+		break;
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+		pCtx->num_alpha_comps = 2;
+		pCtx->alpha_channels[0] = (pParams->format == cCRNFmtDXN_XY) ? 0 : 1;
+		pCtx->alpha_channels[1] = (pParams->format == cCRNFmtDXN_XY) ? 1 : 0;
+		break;
+	case cCRNFmtDXT5A:
+		pCtx->num_alpha_comps = 1;
+		pCtx->alpha_channels[0] = pParams->alpha_component;
+		break;
+	default:
+		return crn_false;
+	}
+
+	for (crn_uint32 s = 0; s < num_slices; s++)
+	{
+		const crn_comp_params* pSlice = &pSlices[s];
+		if (pSlice->width != pParams->width || pSlice->height != pParams->height || pSlice->levels != pParams->levels || pSlice->faces != pParams->faces)
+			return crn_false;
+		for (crn_uint32 l = 0; l < pParams->levels; l++)
+			for (crn_uint32 f = 0; f < pParams->faces; f++)
+				if (!pSlice->pImages[f][l])
+					return crn_false;
+	}
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+	{
+		const crn_uint32 w = CRN_MAX(pParams->width >> l, 1U), h = CRN_MAX(pParams->height >> l, 1U);
+		const crn_uint32 chunks_x = (((w + 3) >> 2) + 1) >> 1, chunks_y = (((h + 3) >> 2) + 1) >> 1;
+		pCtx->chunks_per_slice += chunks_x * chunks_y * pParams->faces;
+		pCtx->total_texels += w * h * pParams->faces;
+	}
+	if ((crn_uint64)pCtx->total_texels * num_slices > cCRNCompMaxTexels)
+		return crn_false;
+	pCtx->num_chunks = pCtx->chunks_per_slice * num_slices;
+	pCtx->total_texels *= num_slices;
+
+	pCtx->pChunks = (crn_comp_chunk*)crn_malloc((size_t)pCtx->num_chunks * sizeof(crn_comp_chunk));
+	pCtx->pChunk_encodings = (crn_uint8*)crn_malloc(pCtx->num_chunks);
+	pCtx->pChunk_first_tile = (crn_uint32*)crn_malloc((pCtx->num_chunks + 1) * sizeof(crn_uint32));
+	if (!pCtx->pChunks || !pCtx->pChunk_encodings || !pCtx->pChunk_first_tile)
+		return crn_false;
+
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+	{
+		const crn_uint32 w = CRN_MAX(pParams->width >> l, 1U), h = CRN_MAX(pParams->height >> l, 1U);
+		const crn_uint32 chunks_x = (((w + 3) >> 2) + 1) >> 1, chunks_y = (((h + 3) >> 2) + 1) >> 1;
+		pCtx->level_first_chunk[l] = c;
+		for (crn_uint32 f = 0; f < pParams->faces; f++)
+		{
+			for (crn_uint32 y = 0; y < chunks_y; y++)
+			{
+				for (crn_uint32 i = 0; i < chunks_x; i++)
+				{
+					crn_comp_chunk* pChunk = &pCtx->pChunks[c++];
+					pChunk->level = (crn_uint8)l;
+					pChunk->face = (crn_uint8)f;
+					pChunk->slice = 0;
+					pChunk->x = (crn_uint16)((y & 1) ? chunks_x - 1 - i : i);
+					pChunk->y = (crn_uint16)y;
+				}
+			}
+		}
+	}
+	pCtx->level_first_chunk[pParams->levels] = c;
+	for (crn_uint32 s = 1; s < num_slices; s++)
+	{
+		crn_comp_chunk* pChunks = pCtx->pChunks + s * pCtx->chunks_per_slice;
+		memcpy(pChunks, pCtx->pChunks, pCtx->chunks_per_slice * sizeof(crn_comp_chunk));
+		for (c = 0; c < pCtx->chunks_per_slice; c++)
+			pChunks[c].slice = (crn_uint16)s;
+	}
+
+	// Without hierarchical tiling every block is its own tile.
+	memset(pCtx->pChunk_encodings, cCRNNumChunkEncodings - 1, pCtx->num_chunks);
+	if (hierarchical)
+		crn_parallel_for(pCtx->num_helper_threads, (pCtx->num_chunks + cCRNCompChunkBatchSize - 1) / cCRNCompChunkBatchSize, crn_comp_choose_tiles, pCtx);
+
+	for (c = 0; c < pCtx->num_chunks; c++)
+	{
+		pCtx->pChunk_first_tile[c] = pCtx->num_tiles;
+		pCtx->num_tiles += g_crnd_chunk_encoding_num_tiles[pCtx->pChunk_encodings[c]];
+	}
+	pCtx->pChunk_first_tile[pCtx->num_chunks] = pCtx->num_tiles;
+
+	pCtx->num_vecs[cCRNCompColorEndpoints] = pCtx->has_color ? pCtx->num_tiles : 0;
+	pCtx->num_vecs[cCRNCompColorSelectors] = pCtx->has_color ? pCtx->num_chunks * 4 : 0;
+	pCtx->num_vecs[cCRNCompAlphaEndpoints] = pCtx->num_alpha_comps * pCtx->num_tiles;
+	pCtx->num_vecs[cCRNCompAlphaSelectors] = pCtx->num_alpha_comps * pCtx->num_chunks * 4;
+	for (crn_uint32 pal = 0; pal < cCRNCompNumPalettes; pal++)
+	{
+		const crn_uint32 n = CRN_MAX(pCtx->num_vecs[pal], 1U);
+		pCtx->pVecs[pal] = (float*)crn_malloc((size_t)n * g_crn_comp_palette_dims[pal] * sizeof(float));
+		pCtx->pWeights[pal] = (float*)crn_malloc((size_t)n * sizeof(float));
+		if (!pCtx->pVecs[pal] || !pCtx->pWeights[pal])
+			return crn_false;
+	}
+	return crn_true;
+}
+
+// Counts the training vectors that actually carry weight, which bounds the useful palette size. Array slices store
+// their shared palettes once, so array palettes are sized from all the slices' vectors like a single texture's.
+static void crn_comp_init_max_entries(crn_comp_context* pCtx)
+{
+	for (crn_uint32 pal = 0; pal < cCRNCompNumPalettes; pal++)
+	{
+		crn_uint32 n = 0;
+		for (crn_uint32 i = 0; i < pCtx->num_vecs[pal]; i++)
+			n += pCtx->pWeights[pal][i] > 0.0f;
+		pCtx->max_entries[pal] = CRN_CLAMP(n, 1U, (crn_uint32)cCRNMaxPaletteSize);
+	}
+}
+
+// -------- Quality search
+
+typedef struct
+{
+	crn_uint8* pData;
+	crn_uint32 data_size;
+	crn_uint32 quality_level;
+	float      bitrate;
+	crn_uint64 error;
+	crn_bool   unshared;   // No data: the array slices have too little in common to share palettes
+} crn_comp_result;
+
+static void crn_comp_keep_result(crn_comp_result* pResult, crn_comp_probe* pProbe, float bitrate)
+{
+	crn_free(pResult->pData);
+	pResult->pData = pProbe->pData;
+	pResult->data_size = pProbe->data_size;
+	pResult->quality_level = pProbe->quality_level;
+	pResult->bitrate = bitrate;
+	pResult->error = pProbe->error;
+	pProbe->pData = NULL;
+}
+
+// Picks up to max_probes distinct quality levels strictly inside (lo, hi), centered on the interpolated guess.
+static crn_uint32 crn_comp_pick_probes(int lo, float lo_rate, int hi, float hi_rate, float target, crn_uint32 max_probes, crn_uint32* pQualities)
+{
+	const int span = hi - lo - 1;
+	crn_uint32 n = 0;
+	float guess, step;
+
+	if (span <= 0)
+		return 0;
+	max_probes = CRN_MIN(max_probes, (crn_uint32)span);
+
+	if (lo < 0 || hi > cCRNMaxQualityLevel || hi_rate <= lo_rate)
+	{
+		// Without a full bracket fall back to evenly subdividing the interval.
+		for (crn_uint32 i = 0; i < max_probes; i++)
+			pQualities[n++] = (crn_uint32)(lo + 1 + (int)((float)span * (i + 0.5f) / max_probes));
+		return n;
+	}
+
+	guess = lo + (target - lo_rate) / (hi_rate - lo_rate) * (hi - lo);
+	step = CRN_MAX((float)span / (max_probes * 2.0f), 1.0f);
+	for (crn_uint32 i = 0; n < max_probes && i < max_probes * 4; i++)
+	{
+		// Alternate around the guess: 0, +1, -1, +2, -2, ...
+		const int k = (int)((i + 1) / 2) * ((i & 1) ? 1 : -1);
+		const int q = CRN_CLAMP((int)(guess + k * step + 0.5f), lo + 1, hi - 1);
+		crn_uint32 j = 0;
+		while (j < n && pQualities[j] != (crn_uint32)q)
+			j++;
+		if (j == n)
+			pQualities[n++] = (crn_uint32)q;
+	}
+	return n;
+}
+
+static crn_bool crn_comp_search_bitrate(const crn_comp_context* pCtx, crn_comp_result* pResult)
+{
+	const crn_comp_params* pParams = pCtx->pParams;
+	const float target = pParams->target_bitrate;
+	const crn_uint32 max_probes = CRN_MIN(pParams->num_helper_threads + 1, (crn_uint32)cCRNMaxHelperThreads);
+	crn_comp_result fallback;
+	int lo = -1, hi = cCRNMaxQualityLevel + 1;
+	float lo_rate = 0.0f, hi_rate = 0.0f;
+
+	memset(&fallback, 0, sizeof(fallback));
+	for (crn_uint32 round = 0; round < cCRNCompMaxProbeRounds; round++)
+	{
+		crn_comp_probe probes[cCRNMaxHelperThreads];
+		crn_uint32 qualities[cCRNMaxHelperThreads];
+		crn_comp_probe_batch batch = { pCtx, probes };
+		crn_uint32 num_probes, threads_per_probe;
+
+		// The bracket is tight once adjacent quality levels straddle the target, or the best level is close enough.
+		if (hi - lo <= 1 || (lo >= 0 && lo_rate >= target * (1.0f - CRN_COMP_BITRATE_TOLERANCE)))
+			break;
+		if (!crn_comp_progress(pParams, 2, round, cCRNCompMaxProbeRounds))
+			break;
+
+		num_probes = crn_comp_pick_probes(lo, lo_rate, hi, hi_rate, target, max_probes, qualities);
+		threads_per_probe = (pParams->num_helper_threads + 1) / CRN_MAX(num_probes, 1U);
+		memset(probes, 0, sizeof(probes));
+		for (crn_uint32 i = 0; i < num_probes; i++)
+		{
+			probes[i].quality_level = qualities[i];
+			probes[i].num_helper_threads = threads_per_probe ? threads_per_probe - 1 : 0;
+		}
+		crn_parallel_for(num_probes - 1, num_probes, crn_comp_run_probe_task, &batch);
+
+		for (crn_uint32 i = 0; i < num_probes; i++)
+		{
+			crn_comp_probe* pProbe = &probes[i];
+			const int q = (int)pProbe->quality_level;
+			float rate;
+			if (pProbe->failed)
+				continue;
+
+			rate = pProbe->data_size * 8.0f / pCtx->total_texels;
+			if (rate <= target)
+			{
+				if (q > lo)
+				{
+					lo = q;
+					lo_rate = rate;
+					crn_comp_keep_result(pResult, pProbe, rate);
+				}
+			}
+			else
+			{
+				if (q < hi)
+				{
+					hi = q;
+					hi_rate = rate;
+				}
+				// If nothing fits the target, the smallest output is the best we can do.
+				if (!fallback.pData || rate < fallback.bitrate)
+					crn_comp_keep_result(&fallback, pProbe, rate);
+			}
+			crn_free(pProbe->pData);
+		}
+	}
+
+	if (!pResult->pData)
+	{
+		*pResult = fallback;
+		return pResult->pData != NULL;
+	}
+	crn_free(fallback.pData);
+	return crn_true;
+}
+
+static crn_bool crn_comp_compress_pass(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_bool hierarchical, crn_comp_result* pResult)
+{
+	const crn_comp_params* pParams = &pSlices[0];
+	crn_comp_context ctx;
+	crn_comp_tree_job tree_job;
+	crn_bool ok;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ok = crn_comp_progress(pParams, 0, 0, 1) && crn_comp_init_context(&ctx, pSlices, num_slices, hierarchical);
+	if (ok)
+	{
+		crn_parallel_for(ctx.num_helper_threads, (ctx.num_chunks + cCRNCompChunkBatchSize - 1) / cCRNCompChunkBatchSize, crn_comp_train_chunks, &ctx);
+		crn_comp_init_max_entries(&ctx);
+		ok = crn_comp_progress(pParams, 1, 0, 1);
+		pResult->unshared = ok && num_slices > 1 && !crn_comp_slices_share_endpoints(&ctx);
+	}
+
+	if (ok && !pResult->unshared)
+	{
+		// With a target bitrate every probe shares one set of trees, grown to the largest palette any quality level may need.
+		const crn_uint32 tree_quality = (pParams->target_bitrate > 0.0f) ? cCRNMaxQualityLevel : pParams->quality_level;
+		memset(&tree_job, 0, sizeof(tree_job));
+		tree_job.pCtx = &ctx;
+		for (crn_uint32 pal = 0; pal < cCRNCompNumPalettes; pal++)
+			tree_job.num_leaves[pal] = crn_comp_palette_size(&ctx, pal, tree_quality);
+		crn_parallel_for(ctx.num_helper_threads, cCRNCompNumPalettes, crn_comp_build_tree, &tree_job);
+		ok = !tree_job.failed;
+	}
+
+	if (ok && !pResult->unshared)
+	{
+		if (pParams->target_bitrate > 0.0f)
+			ok = crn_comp_search_bitrate(&ctx, pResult);
+		else
+		{
+			crn_comp_probe probe;
+			memset(&probe, 0, sizeof(probe));
+			probe.quality_level = pParams->quality_level;
+			probe.num_helper_threads = ctx.num_helper_threads;
+			ok = crn_comp_progress(pParams, 2, 0, 1) && crn_comp_run_probe(&ctx, &probe);
+			if (ok)
+				crn_comp_keep_result(pResult, &probe, probe.data_size * 8.0f / ctx.total_texels);
+		}
+	}
+
+	crn_comp_free_context(&ctx);
+	return ok;
+}
+
+// Compresses the slices together, retrying without adaptive tiles when large tiles can't reach the target bitrate.
+static crn_bool crn_comp_compress_slices(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_comp_result* pResult)
+{
+	const crn_comp_params* pParams = &pSlices[0];
+	const crn_bool hierarchical = (pParams->flags & cCRNCompFlagHierarchical) != 0;
+
+	if (!crn_comp_compress_pass(pSlices, num_slices, hierarchical, pResult))
+		return crn_false;
+	if (pResult->unshared)
+		return crn_true;
+
+	// Large tiles can make even the highest quality level undershoot the target, in which case 4x4 tiles buy back some quality.
+	if (hierarchical && pParams->target_bitrate > 0.0f && pResult->quality_level == cCRNMaxQualityLevel && pResult->bitrate < pParams->target_bitrate)
+	{
+		crn_comp_result flat;
+		memset(&flat, 0, sizeof(flat));
+		if (crn_comp_compress_pass(pSlices, num_slices, crn_false, &flat) && flat.bitrate <= pParams->target_bitrate && flat.bitrate > pResult->bitrate)
+		{
+			crn_free(pResult->pData);
+			*pResult = flat;
+		}
+		else
+			crn_free(flat.pData);
+	}
+	return crn_true;
+}
+
+typedef struct
+{
+	const crn_comp_params* pSlices;
+	crn_comp_result* pResults;
+	crn_uint32 num_helper_threads;   // Per slice
+	crn_bool failed;
+} crn_comp_separate_job;
+
+static void crn_comp_compress_slice_task(crn_uint32 slice, crn_uint32 thread_index, void* pData)
+{
+	crn_comp_separate_job* pJob = (crn_comp_separate_job*)pData;
+	crn_comp_params params = pJob->pSlices[slice];
+	(void)thread_index;
+
+	// Slices run concurrently, so none of them reports progress.
+	params.num_helper_threads = pJob->num_helper_threads;
+	params.pProgress_func = NULL;
+	if (!crn_comp_compress_slices(&params, 1, &pJob->pResults[slice]))
+		pJob->failed = crn_true;
+}
+
+// Compresses every slice on its own, as many at once as there are threads, and concatenates their standalone files.
+// The result reports the lowest quality level, and the average bitrate since all slices have the same size.
+static crn_bool crn_comp_compress_separately(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_comp_result* pResult)
+{
+	const crn_uint32 num_threads = pSlices[0].num_helper_threads + 1;
+	crn_comp_separate_job job;
+	crn_bool ok;
+
+	memset(&job, 0, sizeof(job));
+	job.pSlices = pSlices;
+	job.pResults = (crn_comp_result*)crn_calloc(num_slices, sizeof(crn_comp_result));
+	job.num_helper_threads = (num_threads > num_slices) ? num_threads / num_slices - 1 : 0;
+	if (!job.pResults)
+		return crn_false;
+	crn_parallel_for(CRN_MIN(num_threads, num_slices) - 1, num_slices, crn_comp_compress_slice_task, &job);
+
+	memset(pResult, 0, sizeof(*pResult));
+	pResult->quality_level = cCRNMaxQualityLevel;
+	for (crn_uint32 s = 0; s < num_slices; s++)
+		pResult->data_size += job.pResults[s].data_size;
+	ok = !job.failed && (pResult->pData = (crn_uint8*)crn_malloc(pResult->data_size)) != NULL;
+	for (crn_uint32 s = 0, ofs = 0; ok && s < num_slices; ofs += job.pResults[s++].data_size)
+	{
+		memcpy(pResult->pData + ofs, job.pResults[s].pData, job.pResults[s].data_size);
+		pResult->quality_level = CRN_MIN(pResult->quality_level, job.pResults[s].quality_level);
+		pResult->error += job.pResults[s].error;
+		pResult->bitrate += job.pResults[s].bitrate / num_slices;
+	}
+
+	for (crn_uint32 s = 0; s < num_slices; s++)
+		crn_free(job.pResults[s].pData);
+	crn_free(job.pResults);
+	return ok;
+}
+
+void* crn_comp_compress_crn_array(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_uint32* pCompressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate)
+{
+	crn_comp_result result;
+
+	// Slices without enough in common for shared palettes (see crn_comp_slices_share_endpoints()) are compressed
+	// one by one instead, as soon as their endpoints are known.
+	memset(&result, 0, sizeof(result));
+	if (!num_slices || num_slices > cCRNMaxArraySlices || !crn_comp_compress_slices(pSlices, num_slices, &result) ||
+		(result.unshared && !crn_comp_compress_separately(pSlices, num_slices, &result)))
+	{
+		crn_free(result.pData);
+		return NULL;
+	}
+
+	*pCompressed_size = result.data_size;
+	if (pActual_quality_level)
+		*pActual_quality_level = result.quality_level;
+	if (pActual_bitrate)
+		*pActual_bitrate = result.bitrate;
+	return result.pData;
+}
+
+void* crn_comp_compress_crn(const crn_comp_params* pParams, crn_uint32* pCompressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate)
+{
+	return crn_comp_compress_crn_array(pParams, 1, pCompressed_size, pActual_quality_level, pActual_bitrate);
+}
@@ -0,0 +1,17 @@
+// File: crn_comp.h - Clustered DXTn compressor producing .CRN files.
+#ifndef CRN_COMP_H
+#define CRN_COMP_H
+
+#include "crnlib.h"
+
+// Compresses comp_params' images to a CRN file in memory, see crn_compress().
+// Supports DXT1, DXT5, DXN_XY/YX and DXT5A. The returned block must be freed with crn_free_block().
+void* crn_comp_compress_crn(const crn_comp_params* pParams, crn_uint32* pCompressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate);
+
+// Compresses num_slices textures of the same size, levels and faces, whose shared settings are taken from pSlices[0],
+// with one set of palettes trained on all of them. Writes one CRN file per slice, back to back; each file's header
+// holds its size, and only the first file holds the palettes. The quality search targets the bitrate of all slices
+// together. Falls back to standalone files of separately compressed slices when sharing doesn't pay.
+void* crn_comp_compress_crn_array(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_uint32* pCompressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate);
+
+#endif // CRN_COMP_H
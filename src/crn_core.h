@@ -0,0 +1,95 @@
+// File: crn_core.h - Internal helpers shared by the μcrunch translation units.
+#ifndef CRN_CORE_H
+#define CRN_CORE_H
+
+#include "crnlib.h"
+#include <string.h>
+
+#define CRN_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define CRN_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define CRN_CLAMP(x, lo, hi) ((x) < (lo) ? (lo) : (x) > (hi) ? (hi) : (x))
+#define CRN_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Allocation helpers, these route through the callbacks given to crn_set_memory_callbacks().
+void* crn_malloc(size_t size);
+void* crn_calloc(size_t count, size_t size);
+void* crn_realloc(void* p, size_t size);
+void crn_free(void* p);
+
+// Big endian packed integer helpers, as used by the CRN file format.
+static inline crn_uint32 crn_read_packed(const crn_uint8* p, unsigned num_bytes)
+{
+	crn_uint32 v = 0;
+	for (unsigned i = 0; i < num_bytes; i++)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static inline void crn_write_packed(crn_uint8* p, crn_uint32 v, unsigned num_bytes)
+{
+	for (unsigned i = num_bytes; i--; v >>= 8)
+		p[i] = (crn_uint8)v;
+}
+
+// Little endian helpers, as used by DDS and DXTn blocks.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM64)
+#define CRN_LITTLE_ENDIAN 1
+#else
+#define CRN_LITTLE_ENDIAN 0
+#endif
+
+static inline void crn_write_le32(void* p, crn_uint32 v)
+{
+#if CRN_LITTLE_ENDIAN
+	memcpy(p, &v, 4);
+#else
+	crn_uint8* b = (crn_uint8*)p;
+	b[0] = (crn_uint8)v;
+	b[1] = (crn_uint8)(v >> 8);
+	b[2] = (crn_uint8)(v >> 16);
+	b[3] = (crn_uint8)(v >> 24);
+#endif
+}
+
+static inline void crn_write_le64(void* p, crn_uint64 v)
+{
+#if CRN_LITTLE_ENDIAN
+	memcpy(p, &v, 8);
+#else
+	crn_write_le32(p, (crn_uint32)v);
+	crn_write_le32((crn_uint8*)p + 4, (crn_uint32)(v >> 32));
+#endif
+}
+
+static inline crn_uint32 crn_read_le32(const void* p)
+{
+	const crn_uint8* b = (const crn_uint8*)p;
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((crn_uint32)b[3] << 24);
+}
+
+static inline crn_uint64 crn_read_le64(const void* p)
+{
+	return crn_read_le32(p) | ((crn_uint64)crn_read_le32((const crn_uint8*)p + 4) << 32);
+}
+
+// Rounds a 16-bit channel to 8 bits, the same as v * 255 / 65535 rounded to nearest. Widened 8-bit values (v * 257)
+// come back unchanged.
+static inline crn_uint8 crn_narrow16(crn_uint16 v)
+{
+	return (crn_uint8)(((crn_uint32)v * 255 + 32895) >> 16);
+}
+
+// SSE2 is part of the x86-64 baseline, 32-bit x86 builds only get it when explicitly targeted. Defining CRN_SSE2 to 0
+// beforehand builds the scalar fallbacks instead, which is how the tests cover them.
+#ifndef CRN_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRN_SSE2 1
+#else
+#define CRN_SSE2 0
+#endif
+#endif
+
+// CRC-16-CCITT, used for the CRN header and data checksums.
+crn_uint16 crn_crc16(const void* pBuf, size_t len, crn_uint16 crc);
+
+#endif // CRN_CORE_H
@@ -0,0 +1,712 @@
+#include "crn_dds_comp.h"
+#include "crn_core.h"
+#include "crn_analyze.h"
+#include "crn_bc6h.h"
+#include "crn_bc7.h"
+#include "crn_dxt.h"
+#include "crn_dxt_fast.h"
+#include "crn_etc.h"
+#include "crn_swizzle.h"
+#include "crn_threading.h"
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+enum
+{
+	cCRNBlockCacheLog2Entries       = 10,  // Per thread
+	cCRNBlockCacheLog2SharedEntries = 14,
+	cCRNBlockCacheNumLocks          = 64
+};
+
+// -------- Block hashing
+
+// Hashes the 64 bytes of a gathered block. The SSE2 path multiplies the four 16 byte rows into 64-bit
+// lanes, chaining each row through the previous state, and yields different (equally good) values than
+// the scalar path; hashes are only ever compared within one run.
+static crn_uint32 crn_dds_comp_hash_block(const crn_uint8 pixels[16][4])
+{
+#if CRN_SSE2
+	const __m128i k_even = _mm_set_epi32(0, (int)0x85EBCA6BU, 0, (int)0xC2B2AE35U);
+	const __m128i k_odd = _mm_set_epi32(0, (int)0x27D4EB2FU, 0, (int)0x165667B1U);
+	__m128i h = _mm_set_epi32((int)0x9E3779B9U, 0x7F4A7C15, (int)0xF39CC060U, 0x5CEDC834);
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		const __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)pixels[i * 4]), h);
+		const __m128i even = _mm_mul_epu32(v, k_even);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(v, 32), k_odd);
+		h = _mm_xor_si128(even, _mm_shuffle_epi32(odd, _MM_SHUFFLE(1, 0, 3, 2)));
+		h = _mm_xor_si128(h, _mm_srli_epi64(h, 29));
+	}
+	h = _mm_xor_si128(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+	h = _mm_xor_si128(h, _mm_srli_epi64(h, 32));
+	return (crn_uint32)_mm_cvtsi128_si32(h);
+#else
+	crn_uint64 h = 0x9E3779B97F4A7C15ULL;
+	for (crn_uint32 i = 0; i < 16; i += 2)
+	{
+		crn_uint64 w;
+		memcpy(&w, pixels[i], 8);
+		h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+	return (crn_uint32)(h ^ (h >> 29));
+#endif
+}
+
+// -------- Endpoint cache
+//
+// Maps the exact contents of a gathered block to its encoded DXTn block. Blocks are keyed by their
+// full 64 bytes (with the channels the format ignores cleared), so a hit always reproduces what the
+// encoder would have written and caching never changes the output.
+
+typedef struct
+{
+	crn_uint8  key[16][4];
+	crn_uint8  block[16];
+	crn_uint32 hash;
+	crn_uint32 used;
+} crn_block_cache_entry;
+
+typedef struct
+{
+	crn_block_cache_entry* pEntries;
+	crn_uint32 mask;
+	crn_bool shared;
+	crn_spinlock locks[cCRNBlockCacheNumLocks];
+} crn_block_cache;
+
+static crn_bool crn_block_cache_init(crn_block_cache* pCache, crn_uint32 log2_entries, crn_bool shared)
+{
+	memset(pCache, 0, sizeof(*pCache));
+	pCache->pEntries = (crn_block_cache_entry*)crn_calloc((size_t)1 << log2_entries, sizeof(crn_block_cache_entry));
+	pCache->mask = (1U << log2_entries) - 1;
+	pCache->shared = shared;
+	return pCache->pEntries != NULL;
+}
+
+static void crn_block_cache_free(crn_block_cache* pCache)
+{
+	crn_free(pCache->pEntries);
+	pCache->pEntries = NULL;
+}
+
+static crn_bool crn_block_cache_find(crn_block_cache* pCache, const crn_uint8 pixels[16][4], crn_uint32 hash, crn_uint8* pBlock, crn_uint32 block_size)
+{
+	const crn_block_cache_entry* pEntry = &pCache->pEntries[hash & pCache->mask];
+	crn_bool found;
+	if (pCache->shared)
+		crn_spinlock_lock(&pCache->locks[hash % cCRNBlockCacheNumLocks]);
+	found = pEntry->used && pEntry->hash == hash && !memcmp(pEntry->key, pixels, sizeof(pEntry->key));
+	if (found)
+		memcpy(pBlock, pEntry->block, block_size);
+	if (pCache->shared)
+		crn_spinlock_unlock(&pCache->locks[hash % cCRNBlockCacheNumLocks]);
+	return found;
+}
+
+static void crn_block_cache_insert(crn_block_cache* pCache, const crn_uint8 pixels[16][4], crn_uint32 hash, const crn_uint8* pBlock, crn_uint32 block_size)
+{
+	crn_block_cache_entry* pEntry = &pCache->pEntries[hash & pCache->mask];
+	if (pCache->shared)
+		crn_spinlock_lock(&pCache->locks[hash % cCRNBlockCacheNumLocks]);
+	memcpy(pEntry->key, pixels, sizeof(pEntry->key));
+	memcpy(pEntry->block, pBlock, block_size);
+	pEntry->hash = hash;
+	pEntry->used = 1;
+	if (pCache->shared)
+		crn_spinlock_unlock(&pCache->locks[hash % cCRNBlockCacheNumLocks]);
+}
+
+// -------- Block encoding
+
+typedef struct
+{
+	const crn_comp_params* pParams;
+	crn_uint8* const (*pDst_surfaces)[cCRNMaxLevels];
+	crn_uint32 bytes_per_block;
+
+	crn_uint32 level;
+	crn_uint32 blocks_x;
+	crn_uint32 blocks_y;
+	crn_uint32 classes;         // crn_texture_class bits of the level, see crn_dds_comp_analyze_level()
+
+	crn_block_cache* pCaches;   // One per thread, or a single shared one
+	crn_uint32 num_caches;
+
+	// Duplicate detection over all faces of the current level, indexed by (face * blocks_y + y) * blocks_x + x.
+	crn_bool dedupe;
+	crn_uint32* pHashes;
+	crn_uint32* pFirst;         // Index of the first block with identical contents, NULL if disabled
+} crn_dds_comp_job;
+
+// Moves the channels a format encodes to where its block encoder expects them, clearing the rest so they
+// don't split cache keys:
+//  DXT1: RGB, A=255, or transparent black (all 0) below dxt1a_alpha_threshold with cCRNCompFlagDXT1AForTransparency.
+//  ETC1: RGB. DXT3/DXT5/BC7: RGB, A=alpha_component. DXT5A: A=alpha_component. DXN: the two components in block order.
+//  Swizzled DXT5: see crn_swizzle.h, loaded a row at a time by crn_dds_comp_load_row().
+static inline void crn_dds_comp_load_pixel(const crn_comp_params* pParams, const crn_uint8* pSrc, crn_uint8* pDst)
+{
+	const crn_uint32 a = pParams->alpha_component;
+	switch (pParams->format)
+	{
+	case cCRNFmtDXT1:
+		if ((pParams->flags & cCRNCompFlagDXT1AForTransparency) && pSrc[a] < pParams->dxt1a_alpha_threshold)
+		{
+			memset(pDst, 0, 4);
+			break;
+		}
+		pDst[0] = pSrc[0];
+		pDst[1] = pSrc[1];
+		pDst[2] = pSrc[2];
+		pDst[3] = 255;
+		break;
+	case cCRNFmtETC1:
+		pDst[0] = pSrc[0];
+		pDst[1] = pSrc[1];
+		pDst[2] = pSrc[2];
+		pDst[3] = 0;
+		break;
+	case cCRNFmtDXT3:
+	case cCRNFmtDXT5:
+	case cCRNFmtBC7:
+		pDst[0] = pSrc[0];
+		pDst[1] = pSrc[1];
+		pDst[2] = pSrc[2];
+		pDst[3] = pSrc[a];
+		break;
+	case cCRNFmtDXT5A:
+		pDst[0] = pDst[1] = pDst[2] = 0;
+		pDst[3] = pSrc[a];
+		break;
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+	{
+		const crn_uint32 first = (pParams->format == cCRNFmtDXN_XY) ? 0 : 1;
+		pDst[0] = pSrc[first];
+		pDst[1] = pSrc[first ^ 1];
+		pDst[2] = pDst[3] = 0;
+		break;
+	}
+	default:
+		memset(pDst, 0, 4);
+		break;
+	}
+}
+
+// Loads a row of 4 pixels. The swizzles and the YCoCg transform of the swizzled DXT5 formats happen here, 4 pixels at
+// a time, so they never need a pass over the whole image.
+static inline void crn_dds_comp_load_row(const crn_comp_params* pParams, const crn_uint8* pSrc, crn_uint8 (*pDst)[4])
+{
+	if (crn_is_swizzled_dxt5(pParams->format))
+	{
+		crn_swizzle_row(pParams->format, pParams->alpha_component, pSrc, pDst[0]);
+		return;
+	}
+	for (crn_uint32 x = 0; x < 4; x++)
+		crn_dds_comp_load_pixel(pParams, pSrc + x * 4, pDst[x]);
+}
+
+// Gathers a 4x4 block with edge clamping, see crn_dds_comp_load_pixel(). 16-bit images are rounded to 8 bits here.
+static void crn_dds_comp_get_block(const crn_dds_comp_job* pJob, crn_uint32 face, crn_uint32 bx, crn_uint32 by, crn_uint8 pixels[16][4])
+{
+	const crn_comp_params* pParams = pJob->pParams;
+	const crn_uint32 width = CRN_MAX(pParams->width >> pJob->level, 1U);
+	const crn_uint32 height = CRN_MAX(pParams->height >> pJob->level, 1U);
+	const crn_uint8* pImage = (const crn_uint8*)pParams->pImages[face][pJob->level];
+
+	for (crn_uint32 y = 0; y < 4; y++)
+	{
+		const size_t row = (size_t)CRN_MIN(by * 4 + y, height - 1) * width * 4;
+		const crn_uint8* pRow = pImage + row;
+		crn_uint8 clamped[16];
+		if (pParams->flags & cCRNCompFlagSource16)
+		{
+			const crn_uint16* pWide = (const crn_uint16*)pImage + row;
+			for (crn_uint32 i = 0; i < 16; i++)
+				clamped[i] = crn_narrow16(pWide[CRN_MIN(bx * 4 + (i >> 2), width - 1) * 4 + (i & 3)]);
+			pRow = clamped;
+		}
+		else if (bx * 4 + 4 <= width)
+		{
+			pRow += bx * 16;
+		}
+		else
+		{
+			for (crn_uint32 x = 0; x < 4; x++)
+				memcpy(clamped + x * 4, pRow + CRN_MIN(bx * 4 + x, width - 1) * 4, 4);
+			pRow = clamped;
+		}
+		crn_dds_comp_load_row(pParams, pRow, &pixels[y * 4]);
+	}
+}
+
+// Encodes a DXT1 color block with the backend selected by dxt_compressor_type, or with the luma encoder for
+// cCRNCompFlagGrayscaleSampling. The swizzled DXT5 formats don't hold RGB and ignore the flag.
+static void crn_dds_comp_encode_color(const crn_comp_params* pParams, const crn_uint8 pixels[16][4], crn_uint8* pDst)
+{
+	if ((pParams->flags & cCRNCompFlagGrayscaleSampling) && !crn_is_swizzled_dxt5(pParams->format))
+	{
+		crn_dxt1_encode_luma_block(pixels, pDst, pParams->dxt_quality);
+		return;
+	}
+	switch (pParams->dxt_compressor_type)
+	{
+	case cCRNDXTCompressorCRNF:
+		crn_dxt1_fast_encode_block(pixels, pDst, pParams->dxt_quality, pParams->flags);
+		break;
+	case cCRNDXTCompressorRYG:
+		stb_compress_dxt_block_weighted(pDst, &pixels[0][0], 0, (pParams->dxt_quality >= cCRNDXTQualityBetter) ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL,
+			crn_dxt1_get_weights(pParams->flags));
+		break;
+	default:
+		crn_dxt1_encode_block(pixels, pDst, pParams->dxt_quality, pParams->flags);
+		break;
+	}
+}
+
+// Encodes a gathered block. classes are the crn_texture_class bits known to hold for the whole level (0 if unknown),
+// which only skip per block checks: the output for a given block never depends on them, so cached blocks stay valid
+// across levels.
+static void crn_dds_comp_encode_block(const crn_comp_params* pParams, crn_uint32 classes, const crn_uint8 pixels[16][4], crn_uint8* pDst)
+{
+	switch (pParams->format)
+	{
+	case cCRNFmtDXT1:
+	{
+		// Only 3 color mode can encode transparent pixels, so their blocks skip the 4 color encoders.
+		crn_bool transparent = crn_false;
+		for (crn_uint32 i = 0; i < 16; i++)
+			transparent = transparent || !pixels[i][3];
+		if (!transparent)
+			crn_dds_comp_encode_color(pParams, pixels, pDst);
+		// The CRNF and RYG backends are meant to stay fast, so they skip the Uber tier's neighborhood search. 3 color mode
+		// measures RGB error, which would undo the luma encoder's work on opaque blocks.
+		if (transparent || ((pParams->flags & cCRNCompFlagUseBothBlockTypes) && !(pParams->flags & cCRNCompFlagGrayscaleSampling)))
+		{
+			const crn_dxt_quality quality = (pParams->dxt_compressor_type == cCRNDXTCompressorCRNF || pParams->dxt_compressor_type == cCRNDXTCompressorRYG) ? CRN_MIN(pParams->dxt_quality, cCRNDXTQualityBetter) : pParams->dxt_quality;
+			crn_dxt1_encode_3color_block(pixels, pDst, quality, pParams->flags);
+		}
+		break;
+	}
+	case cCRNFmtDXT3:
+		// Opaque alpha rounds to all 15s with or without dithering.
+		if (classes & cCRNTextureOpaque)
+			memset(pDst, 0xFF, 8);
+		else
+			crn_dxt3_encode_alpha_block(pixels, pDst, (pParams->flags & cCRNCompFlagDXT3AlphaDithering) != 0);
+		crn_dds_comp_encode_color(pParams, pixels, pDst + 8);
+		break;
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+	case cCRNFmtDXT5A:
+		// Opaque and cutout alpha is encoded exactly without a search. The swizzled formats keep color in alpha.
+		if (!crn_is_swizzled_dxt5(pParams->format) && ((classes & cCRNTextureBinaryAlpha) || crn_dxt5_is_binary_alpha(pixels, 3)))
+			crn_dxt5_encode_binary_alpha_block(pixels, 3, pDst);
+		else
+			stb__CompressAlphaBlock(pDst, (unsigned char*)&pixels[0][3], 4);
+		if (pParams->format != cCRNFmtDXT5A)
+			crn_dds_comp_encode_color(pParams, pixels, pDst + 8);
+		break;
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+		stb__CompressAlphaBlock(pDst, (unsigned char*)&pixels[0][0], 4);
+		stb__CompressAlphaBlock(pDst + 8, (unsigned char*)&pixels[0][1], 4);
+		break;
+	case cCRNFmtETC1:
+		crn_etc1_encode_block(pixels, pDst, pParams->dxt_quality);
+		break;
+	case cCRNFmtBC7:
+		crn_bc7_encode_block(pixels, pDst, pParams->dxt_quality);
+		break;
+	default:
+		break;
+	}
+}
+
+static crn_uint8* crn_dds_comp_block_ptr(const crn_dds_comp_job* pJob, crn_uint32 block_index)
+{
+	const crn_uint32 blocks_per_face = pJob->blocks_x * pJob->blocks_y;
+	return pJob->pDst_surfaces[block_index / blocks_per_face][pJob->level] + (size_t)(block_index % blocks_per_face) * pJob->bytes_per_block;
+}
+
+static void crn_dds_comp_get_indexed_block(const crn_dds_comp_job* pJob, crn_uint32 block_index, crn_uint8 pixels[16][4])
+{
+	const crn_uint32 blocks_per_face = pJob->blocks_x * pJob->blocks_y, i = block_index % blocks_per_face;
+	crn_dds_comp_get_block(pJob, block_index / blocks_per_face, i % pJob->blocks_x, i / pJob->blocks_x, pixels);
+}
+
+static void crn_dds_comp_hash_row(crn_uint32 row, crn_uint32 thread_index, void* pData)
+{
+	const crn_dds_comp_job* pJob = (const crn_dds_comp_job*)pData;
+	const crn_uint32 first = row * pJob->blocks_x;
+	(void)thread_index;
+
+	for (crn_uint32 b = first; b < first + pJob->blocks_x; b++)
+	{
+		crn_uint8 pixels[16][4];
+		crn_dds_comp_get_indexed_block(pJob, b, pixels);
+		pJob->pHashes[b] = crn_dds_comp_hash_block((const crn_uint8 (*)[4])pixels);
+	}
+}
+
+// Links every block to the first block with the same hash, using an open addressed table of block indices.
+// The links are only candidates: crn_dds_comp_encode_row() confirms them by comparing the blocks, on the
+// helper threads, so hash collisions never merge different blocks.
+static crn_bool crn_dds_comp_find_duplicates(crn_dds_comp_job* pJob, crn_uint32 num_blocks)
+{
+	crn_uint32 table_size = 16;
+	crn_uint32* pTable;
+
+	while (table_size < num_blocks * 2)
+		table_size <<= 1;
+	pTable = (crn_uint32*)crn_malloc(table_size * sizeof(crn_uint32));
+	if (!pTable)
+		return crn_false;
+	memset(pTable, 0xFF, table_size * sizeof(crn_uint32));
+
+	for (crn_uint32 b = 0; b < num_blocks; b++)
+	{
+		const crn_uint32 hash = pJob->pHashes[b];
+		crn_uint32 slot = hash & (table_size - 1);
+		while (pTable[slot] != 0xFFFFFFFFU && pJob->pHashes[pTable[slot]] != hash)
+			slot = (slot + 1) & (table_size - 1);
+		if (pTable[slot] == 0xFFFFFFFFU)
+			pTable[slot] = b;
+		pJob->pFirst[b] = pTable[slot];
+	}
+
+	crn_free(pTable);
+	return crn_true;
+}
+
+static void crn_dds_comp_encode_row(crn_uint32 row, crn_uint32 thread_index, void* pData)
+{
+	const crn_dds_comp_job* pJob = (const crn_dds_comp_job*)pData;
+	crn_block_cache* pCache = pJob->num_caches ? &pJob->pCaches[CRN_MIN(thread_index, pJob->num_caches - 1)] : NULL;
+	const crn_uint32 first = row * pJob->blocks_x;
+
+	for (crn_uint32 b = first; b < first + pJob->blocks_x; b++)
+	{
+		crn_uint8* pDst = crn_dds_comp_block_ptr(pJob, b);
+		crn_uint8 pixels[16][4];
+		crn_uint32 hash;
+
+		crn_dds_comp_get_indexed_block(pJob, b, pixels);
+
+		// Duplicates are filled in by crn_dds_comp_scatter_row() once their first occurrence is encoded.
+		if (pJob->pFirst && pJob->pFirst[b] != b)
+		{
+			crn_uint8 first_pixels[16][4];
+			crn_dds_comp_get_indexed_block(pJob, pJob->pFirst[b], first_pixels);
+			if (!memcmp(pixels, first_pixels, sizeof(pixels)))
+				continue;
+			pJob->pFirst[b] = b;
+		}
+
+		// Repeated blocks in other levels or past the duplicate search skip the endpoint search.
+		if (pCache)
+		{
+			hash = pJob->pHashes ? pJob->pHashes[b] : crn_dds_comp_hash_block((const crn_uint8 (*)[4])pixels);
+			if (crn_block_cache_find(pCache, (const crn_uint8 (*)[4])pixels, hash, pDst, pJob->bytes_per_block))
+				continue;
+		}
+		crn_dds_comp_encode_block(pJob->pParams, pJob->classes, (const crn_uint8 (*)[4])pixels, pDst);
+		if (pCache)
+			crn_block_cache_insert(pCache, (const crn_uint8 (*)[4])pixels, hash, pDst, pJob->bytes_per_block);
+	}
+}
+
+static void crn_dds_comp_scatter_row(crn_uint32 row, crn_uint32 thread_index, void* pData)
+{
+	const crn_dds_comp_job* pJob = (const crn_dds_comp_job*)pData;
+	const crn_uint32 first = row * pJob->blocks_x;
+	(void)thread_index;
+
+	for (crn_uint32 b = first; b < first + pJob->blocks_x; b++)
+		if (pJob->pFirst[b] != b)
+			memcpy(crn_dds_comp_block_ptr(pJob, b), crn_dds_comp_block_ptr(pJob, pJob->pFirst[b]), pJob->bytes_per_block);
+}
+
+// -------- BC6H
+//
+// Float pixels skip the level analysis, duplicate search and endpoint cache, which all work on 8-bit RGBA.
+
+// Gathers a 4x4 block of float RGBA pixels with edge clamping.
+static void crn_dds_comp_get_hdr_block(const crn_dds_comp_job* pJob, crn_uint32 face, crn_uint32 bx, crn_uint32 by, float pixels[16][4])
+{
+	const crn_comp_params* pParams = pJob->pParams;
+	const crn_uint32 width = CRN_MAX(pParams->width >> pJob->level, 1U);
+	const crn_uint32 height = CRN_MAX(pParams->height >> pJob->level, 1U);
+	const float* pImage = (const float*)pParams->pImages[face][pJob->level];
+
+	for (crn_uint32 y = 0; y < 4; y++)
+	{
+		const float* pRow = pImage + (size_t)CRN_MIN(by * 4 + y, height - 1) * width * 4;
+		for (crn_uint32 x = 0; x < 4; x++)
+			memcpy(pixels[y * 4 + x], pRow + CRN_MIN(bx * 4 + x, width - 1) * 4, sizeof(pixels[0]));
+	}
+}
+
+static void crn_dds_comp_encode_hdr_row(crn_uint32 row, crn_uint32 thread_index, void* pData)
+{
+	const crn_dds_comp_job* pJob = (const crn_dds_comp_job*)pData;
+	const crn_uint32 blocks_per_face = pJob->blocks_x * pJob->blocks_y, first = row * pJob->blocks_x;
+	(void)thread_index;
+
+	for (crn_uint32 b = first; b < first + pJob->blocks_x; b++)
+	{
+		const crn_uint32 i = b % blocks_per_face;
+		float pixels[16][4];
+		crn_dds_comp_get_hdr_block(pJob, b / blocks_per_face, i % pJob->blocks_x, i / pJob->blocks_x, pixels);
+		crn_bc6h_encode_block((const float (*)[4])pixels, crn_dds_comp_block_ptr(pJob, b), pJob->pParams->dxt_quality);
+	}
+}
+
+static crn_bool crn_dds_comp_is_supported(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT1:
+	case cCRNFmtDXT3:
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+	case cCRNFmtDXT5A:
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+	case cCRNFmtETC1:
+	case cCRNFmtBC6H:
+	case cCRNFmtBC7:
+		return crn_true;
+	default:
+		return crn_false;
+	}
+}
+
+// Encodes every block of the current level, num_rows block rows of all faces, over num_threads threads.
+static void crn_dds_comp_encode_level(crn_dds_comp_job* pJob, crn_uint32 num_threads, crn_uint32 num_rows, crn_uint32 num_blocks)
+{
+	// Exact duplicates (padding, empty atlas space, repeated UI elements) are encoded once and copied, which
+	// also covers the uniform blocks stb_dxt special cases. Without the memory for it every block is encoded.
+	if (pJob->dedupe)
+	{
+		pJob->pHashes = (crn_uint32*)crn_malloc(num_blocks * sizeof(crn_uint32));
+		pJob->pFirst = (crn_uint32*)crn_malloc(num_blocks * sizeof(crn_uint32));
+	}
+	if (pJob->pHashes && pJob->pFirst)
+	{
+		crn_parallel_for(num_threads - 1, num_rows, crn_dds_comp_hash_row, pJob);
+		if (!crn_dds_comp_find_duplicates(pJob, num_blocks))
+		{
+			crn_free(pJob->pFirst);
+			pJob->pFirst = NULL;
+		}
+	}
+	else
+	{
+		crn_free(pJob->pHashes);
+		crn_free(pJob->pFirst);
+		pJob->pHashes = pJob->pFirst = NULL;
+	}
+
+	crn_parallel_for(num_threads - 1, num_rows, crn_dds_comp_encode_row, pJob);
+	if (pJob->pFirst)
+		crn_parallel_for(num_threads - 1, num_rows, crn_dds_comp_scatter_row, pJob);
+
+	crn_free(pJob->pHashes);
+	crn_free(pJob->pFirst);
+	pJob->pHashes = pJob->pFirst = NULL;
+}
+
+// Classifies every face of a level in one pass (see crn_analyze.h), looking only for what the level can use.
+static crn_uint32 crn_dds_comp_analyze_level(const crn_comp_params* pParams, crn_uint32 level)
+{
+	const crn_uint32 width = CRN_MAX(pParams->width >> level, 1U), height = CRN_MAX(pParams->height >> level, 1U);
+	crn_uint32 classes = cCRNTextureConstant;
+
+	switch (pParams->format)
+	{
+	case cCRNFmtDXT3:
+		classes |= cCRNTextureOpaque;
+		break;
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5A:
+		classes |= cCRNTextureBinaryAlpha;
+		break;
+	default:
+		break;
+	}
+	for (crn_uint32 f = 0; f < pParams->faces && classes; f++)
+	{
+		if (*pParams->pImages[f][level] != *pParams->pImages[0][level])
+			classes &= ~(crn_uint32)cCRNTextureConstant;
+		classes = crn_analyze_image((const crn_uint8*)pParams->pImages[f][level], width * height, pParams->alpha_component, classes);
+	}
+	return classes;
+}
+
+crn_bool crn_dds_comp_encode(const crn_comp_params* pParams, crn_uint8* const pDst_surfaces[cCRNMaxFaces][cCRNMaxLevels])
+{
+	const crn_uint32 num_threads = CRN_MIN(pParams->num_helper_threads, (crn_uint32)cCRNMaxHelperThreads) + 1;
+	crn_block_cache caches[cCRNMaxHelperThreads + 1];
+	const crn_bool hdr = pParams->format == cCRNFmtBC6H;
+	crn_dds_comp_job job;
+	crn_bool ok = crn_true;
+
+	if (!crn_dds_comp_is_supported(pParams->format))
+		return crn_false;
+
+	memset(&job, 0, sizeof(job));
+	job.pParams = pParams;
+	job.pDst_surfaces = pDst_surfaces;
+	job.bytes_per_block = crn_get_bytes_per_dxt_block(pParams->format);
+	job.pCaches = caches;
+	// Alpha only blocks are cheaper to encode than to look up, while a BC7 block costs far more than the lookup.
+	job.dedupe = crn_get_fundamental_dxt_format(pParams->format) == cCRNFmtDXT5 || pParams->format == cCRNFmtDXT1 || pParams->format == cCRNFmtDXT3 ||
+		pParams->format == cCRNFmtETC1 || pParams->format == cCRNFmtBC7;
+
+	if (!(pParams->flags & cCRNCompFlagDisableEndpointCaching) && !hdr)
+	{
+		if (pParams->flags & cCRNCompFlagShareEndpointCache)
+		{
+			ok = crn_block_cache_init(&caches[0], cCRNBlockCacheLog2SharedEntries, num_threads > 1);
+			job.num_caches = ok ? 1 : 0;
+		}
+		else
+		{
+			for (; ok && job.num_caches < num_threads; job.num_caches++)
+				ok = crn_block_cache_init(&caches[job.num_caches], cCRNBlockCacheLog2Entries, crn_false);
+			job.num_caches -= !ok;
+		}
+	}
+
+	for (crn_uint32 l = 0; ok && l < pParams->levels; l++)
+	{
+		crn_uint32 num_rows, num_blocks;
+		job.level = l;
+		job.blocks_x = (CRN_MAX(pParams->width >> l, 1U) + 3) >> 2;
+		job.blocks_y = (CRN_MAX(pParams->height >> l, 1U) + 3) >> 2;
+		for (crn_uint32 f = 0; f < pParams->faces; f++)
+			ok = ok && pParams->pImages[f][l] && pDst_surfaces[f][l];
+		if (!ok)
+			break;
+		// The analysis reads 8-bit pixels, 16-bit levels go without its shortcuts.
+		job.classes = (hdr || (pParams->flags & cCRNCompFlagSource16)) ? 0 : crn_dds_comp_analyze_level(pParams, l);
+
+		num_rows = job.blocks_y * pParams->faces;
+		num_blocks = num_rows * job.blocks_x;
+		if (hdr)
+		{
+			crn_parallel_for(num_threads - 1, num_rows, crn_dds_comp_encode_hdr_row, &job);
+		}
+		else if (job.classes & cCRNTextureConstant)
+		{
+			// Every block of a constant level is the same one.
+			crn_uint8 pixels[16][4];
+			crn_dds_comp_get_indexed_block(&job, 0, pixels);
+			crn_dds_comp_encode_block(pParams, job.classes, (const crn_uint8 (*)[4])pixels, crn_dds_comp_block_ptr(&job, 0));
+			for (crn_uint32 b = 1; b < num_blocks; b++)
+				memcpy(crn_dds_comp_block_ptr(&job, b), crn_dds_comp_block_ptr(&job, 0), job.bytes_per_block);
+		}
+		else
+		{
+			crn_dds_comp_encode_level(&job, num_threads, num_rows, num_blocks);
+		}
+
+		if (pParams->pProgress_func && !pParams->pProgress_func(0, 1, l + 1, pParams->levels, pParams->pProgress_func_data))
+			ok = crn_false;
+	}
+
+	for (crn_uint32 i = 0; i < job.num_caches; i++)
+		crn_block_cache_free(&caches[i]);
+	return ok;
+}
+
+// -------- Block compressor
+
+struct crn_dds_block_comp
+{
+	crn_comp_params params;
+	crn_uint32 bytes_per_block;
+	crn_bool use_cache;
+	crn_block_cache cache;
+};
+
+crn_dds_block_comp* crn_dds_block_comp_create(const crn_comp_params* pParams)
+{
+	crn_dds_block_comp* pComp;
+
+	// BC6H's pixels are floats, which the block API doesn't take.
+	if (!crn_dds_comp_is_supported(pParams->format) || pParams->format == cCRNFmtBC6H)
+		return NULL;
+	pComp = (crn_dds_block_comp*)crn_calloc(1, sizeof(crn_dds_block_comp));
+	if (!pComp)
+		return NULL;
+
+	// Only the encoding settings are used, the image pointers may dangle after this returns.
+	pComp->params = *pParams;
+	memset(pComp->params.pImages, 0, sizeof(pComp->params.pImages));
+	pComp->bytes_per_block = crn_get_bytes_per_dxt_block(pParams->format);
+	pComp->use_cache = !(pParams->flags & cCRNCompFlagDisableEndpointCaching);
+	if (pComp->use_cache && !crn_block_cache_init(&pComp->cache, cCRNBlockCacheLog2Entries, crn_false))
+	{
+		crn_free(pComp);
+		return NULL;
+	}
+	return pComp;
+}
+
+void crn_dds_block_comp_encode(crn_dds_block_comp* pComp, const crn_uint8* pPixels, crn_uint32 num_blocks, crn_uint8* pDst)
+{
+	crn_uint8 pixels[16][4], prev_pixels[16][4];
+	crn_uint8* pPrev = NULL;
+
+	for (crn_uint32 b = 0; b < num_blocks; b++, pPixels += 64, pDst += pComp->bytes_per_block)
+	{
+		crn_uint32 hash;
+
+		for (crn_uint32 y = 0; y < 4; y++)
+			crn_dds_comp_load_row(&pComp->params, pPixels + y * 16, &pixels[y * 4]);
+
+		// Runs of identical blocks (flat lightmap texels, padding) just repeat the previous output.
+		if (pPrev && !memcmp(pixels, prev_pixels, sizeof(pixels)))
+		{
+			memcpy(pDst, pPrev, pComp->bytes_per_block);
+			continue;
+		}
+
+		if (pComp->use_cache)
+		{
+			hash = crn_dds_comp_hash_block((const crn_uint8 (*)[4])pixels);
+			if (!crn_block_cache_find(&pComp->cache, (const crn_uint8 (*)[4])pixels, hash, pDst, pComp->bytes_per_block))
+			{
+				crn_dds_comp_encode_block(&pComp->params, 0, (const crn_uint8 (*)[4])pixels, pDst);
+				crn_block_cache_insert(&pComp->cache, (const crn_uint8 (*)[4])pixels, hash, pDst, pComp->bytes_per_block);
+			}
+		}
+		else
+			crn_dds_comp_encode_block(&pComp->params, 0, (const crn_uint8 (*)[4])pixels, pDst);
+
+		memcpy(prev_pixels, pixels, sizeof(pixels));
+		pPrev = pDst;
+	}
+}
+
+void crn_dds_block_comp_free(crn_dds_block_comp* pComp)
+{
+	if (!pComp)
+		return;
+	if (pComp->use_cache)
+		crn_block_cache_free(&pComp->cache);
+	crn_free(pComp);
+}
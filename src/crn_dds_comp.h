@@ -0,0 +1,25 @@
+// File: crn_dds_comp.h - Plain (non-clustered) DXTn encoding of whole textures, as written to .DDS files.
+#ifndef CRN_DDS_COMP_H
+#define CRN_DDS_COMP_H
+
+#include "crnlib.h"
+
+// Encodes every level of every face of pParams' images to pDst_surfaces[face][level], which must have room for
+// the level's blocks in raster order. Levels are split into block rows spread over the helper threads.
+// Returns false if the format isn't supported, memory runs out or the progress callback cancels.
+crn_bool crn_dds_comp_encode(const crn_comp_params* pParams, crn_uint8* const pDst_surfaces[cCRNMaxFaces][cCRNMaxLevels]);
+
+// Standalone block encoder behind crn_create_block_compressor(), with its own endpoint cache. Not thread safe,
+// give each thread its own.
+typedef struct crn_dds_block_comp crn_dds_block_comp;
+
+// Returns NULL if pParams' format isn't supported (BC6H never is here) or memory runs out. Keeps a copy of the
+// encoding settings.
+crn_dds_block_comp* crn_dds_block_comp_create(const crn_comp_params* pParams);
+
+// Encodes num_blocks consecutive blocks of 16 RGBA pixels (64 bytes each) to consecutive blocks at pDst.
+void crn_dds_block_comp_encode(crn_dds_block_comp* pComp, const crn_uint8* pPixels, crn_uint32 num_blocks, crn_uint8* pDst);
+
+void crn_dds_block_comp_free(crn_dds_block_comp* pComp);
+
+#endif // CRN_DDS_COMP_H
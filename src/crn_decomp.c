@@ -0,0 +1,497 @@
+#include "crn_decomp.h"
+#include "crn_core.h"
+#include "crn_huffman.h"
+
+const crn_uint8 g_crnd_chunk_encoding_num_tiles[cCRNNumChunkEncodings] = { 1, 2, 2, 3, 3, 3, 3, 4 };
+const crn_uint8 g_crnd_chunk_encoding_tiles[cCRNNumChunkEncodings][4] =
+{
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 1, 1 }, { 0, 1, 0, 1 },
+	{ 0, 0, 1, 2 }, { 1, 2, 0, 0 },
+	{ 0, 1, 0, 2 }, { 1, 0, 2, 0 },
+	{ 0, 1, 2, 3 }
+};
+
+const crn_uint8 g_crnd_dxt1_to_linear[4]   = { 0, 3, 1, 2 };
+const crn_uint8 g_crnd_dxt1_from_linear[4] = { 0, 2, 3, 1 };
+const crn_uint8 g_crnd_dxt5_to_linear[8]   = { 0, 7, 1, 2, 3, 4, 5, 6 };
+const crn_uint8 g_crnd_dxt5_from_linear[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+typedef enum
+{
+	cCRNDBlockDXT1,
+	cCRNDBlockDXT5,
+	cCRNDBlockDXN,
+	cCRNDBlockDXT5A
+} crnd_block_kind;
+
+struct crnd_unpack_context_s
+{
+	const crn_uint8*  pData;
+	crn_uint32        data_size;
+	const crn_uint8*  pPalette_data;     // The file holding the palettes, pData unless they're shared
+	crn_uint32        palette_data_size;
+	crnd_texture_info info;
+	crnd_block_kind   kind;
+
+	// Palettes, pre-packed in the exact layout of the DXTn block halves they end up in.
+	crn_uint32*       pColor_endpoints;  // color0 | color1 << 16
+	crn_uint32*       pColor_selectors;  // 2 bits per texel, DXT1 order
+	crn_uint16*       pAlpha_endpoints;  // alpha0 | alpha1 << 8
+	crn_uint64*       pAlpha_selectors;  // 3 bits per texel, DXT5 order, pre-shifted up by 16 bits
+	crn_uint32        num_color_endpoints;
+	crn_uint32        num_color_selectors;
+	crn_uint32        num_alpha_endpoints;
+	crn_uint32        num_alpha_selectors;
+
+	crn_huff_decoder  chunk_encoding_dm;
+	crn_huff_decoder  endpoint_delta_dm[2];
+	crn_huff_decoder  selector_delta_dm[2];
+};
+
+static crn_uint32 crnd_palette_ofs(const crn_uint8* pHdr, crn_uint32 pal) { return crn_read_packed(pHdr + pal, 3); }
+static crn_uint32 crnd_palette_size(const crn_uint8* pHdr, crn_uint32 pal) { return crn_read_packed(pHdr + pal + 3, 3); }
+static crn_uint32 crnd_palette_num(const crn_uint8* pHdr, crn_uint32 pal) { return crn_read_packed(pHdr + pal + 6, 2); }
+
+crn_bool crnd_get_texture_info(const void* pData, crn_uint32 data_size, crnd_texture_info* pInfo)
+{
+	const crn_uint8* pHdr = (const crn_uint8*)pData;
+	crn_uint32 header_size, levels;
+
+	if (!pData || data_size < cCRNHeaderMinSize || !pInfo)
+		return crn_false;
+	if (crn_read_packed(pHdr + cCRNHdrOfsSig, 2) != cCRNSigValue)
+		return crn_false;
+
+	header_size = crn_read_packed(pHdr + cCRNHdrOfsHeaderSize, 2);
+	levels = pHdr[cCRNHdrOfsLevels];
+	if (header_size < cCRNHeaderMinSize + levels * 4 || header_size > data_size)
+		return crn_false;
+	if (crn_crc16(pHdr + cCRNHdrOfsDataSize, header_size - cCRNHdrOfsDataSize, 0) != crn_read_packed(pHdr + cCRNHdrOfsHeaderCRC16, 2))
+		return crn_false;
+	if (crn_read_packed(pHdr + cCRNHdrOfsDataSize, 4) > data_size)
+		return crn_false;
+
+	pInfo->width = crn_read_packed(pHdr + cCRNHdrOfsWidth, 2);
+	pInfo->height = crn_read_packed(pHdr + cCRNHdrOfsHeight, 2);
+	pInfo->levels = levels;
+	pInfo->faces = pHdr[cCRNHdrOfsFaces];
+	pInfo->format = (crn_format)pHdr[cCRNHdrOfsFormat];
+	pInfo->userdata0 = crn_read_packed(pHdr + cCRNHdrOfsUserdata0, 4);
+	pInfo->userdata1 = crn_read_packed(pHdr + cCRNHdrOfsUserdata1, 4);
+
+	if (!pInfo->width || !pInfo->height || pInfo->width > cCRNMaxLevelResolution || pInfo->height > cCRNMaxLevelResolution ||
+		!levels || levels > cCRNMaxLevels || (pInfo->faces != 1 && pInfo->faces != 6) ||
+		pInfo->format < cCRNFmtFirstValid || pInfo->format >= cCRNFmtTotal)
+		return crn_false;
+
+	pInfo->bytes_per_block = crn_get_bytes_per_dxt_block(pInfo->format);
+	return crn_true;
+}
+
+static crn_bool crnd_begin_palette(const crnd_unpack_context ctx, crn_uint32 pal, crn_bit_reader* pReader)
+{
+	const crn_uint32 ofs = crnd_palette_ofs(ctx->pPalette_data, pal);
+	const crn_uint32 size = crnd_palette_size(ctx->pPalette_data, pal);
+	if (ofs + size < ofs || ofs + size > ctx->palette_data_size)
+		return crn_false;
+	crn_bit_reader_init(pReader, ctx->pPalette_data + ofs, size);
+	return crn_true;
+}
+
+static crn_bool crnd_decode_color_endpoints(crnd_unpack_context ctx)
+{
+	crn_huff_decoder dm[2] = { { 0 } };
+	crn_bit_reader reader;
+	crn_uint32 a = 0, b = 0, c = 0, d = 0, e = 0, f = 0;
+	crn_bool ok;
+
+	if (!crnd_begin_palette(ctx, cCRNHdrOfsColorEndpoints, &reader))
+		return crn_false;
+	ctx->pColor_endpoints = (crn_uint32*)crn_malloc(ctx->num_color_endpoints * sizeof(crn_uint32));
+	ok = ctx->pColor_endpoints &&
+		crn_bit_reader_receive_model(&reader, &dm[0]) &&
+		crn_bit_reader_receive_model(&reader, &dm[1]);
+
+	for (crn_uint32 i = 0; ok && i < ctx->num_color_endpoints; i++)
+	{
+		a = (a + crn_bit_reader_decode(&reader, &dm[0])) & 31;
+		b = (b + crn_bit_reader_decode(&reader, &dm[1])) & 63;
+		c = (c + crn_bit_reader_decode(&reader, &dm[0])) & 31;
+		d = (d + crn_bit_reader_decode(&reader, &dm[0])) & 31;
+		e = (e + crn_bit_reader_decode(&reader, &dm[1])) & 63;
+		f = (f + crn_bit_reader_decode(&reader, &dm[0])) & 31;
+		ctx->pColor_endpoints[i] = c | (b << 5) | (a << 11) | (f << 16) | (e << 21) | (d << 27);
+	}
+
+	crn_huff_decoder_free(&dm[0]);
+	crn_huff_decoder_free(&dm[1]);
+	return ok;
+}
+
+static crn_bool crnd_decode_color_selectors(crnd_unpack_context ctx)
+{
+	crn_huff_decoder dm = { 0 };
+	crn_bit_reader reader;
+	crn_uint32 cur[16] = { 0 };
+	crn_bool ok;
+
+	if (!crnd_begin_palette(ctx, cCRNHdrOfsColorSelectors, &reader))
+		return crn_false;
+	ctx->pColor_selectors = (crn_uint32*)crn_malloc(ctx->num_color_selectors * sizeof(crn_uint32));
+	ok = ctx->pColor_selectors && crn_bit_reader_receive_model(&reader, &dm);
+
+	for (crn_uint32 i = 0; ok && i < ctx->num_color_selectors; i++)
+	{
+		crn_uint32 s = 0;
+		for (crn_uint32 j = 0; j < 8; j++)
+		{
+			const crn_uint32 sym = crn_bit_reader_decode(&reader, &dm);
+			cur[j * 2 + 0] = (cur[j * 2 + 0] + (sym % 7) - 3) & 3;
+			cur[j * 2 + 1] = (cur[j * 2 + 1] + (sym / 7) - 3) & 3;
+		}
+		for (crn_uint32 j = 0; j < 16; j++)
+			s |= (crn_uint32)g_crnd_dxt1_from_linear[cur[j]] << (j * 2);
+		ctx->pColor_selectors[i] = s;
+	}
+
+	crn_huff_decoder_free(&dm);
+	return ok;
+}
+
+static crn_bool crnd_decode_alpha_endpoints(crnd_unpack_context ctx)
+{
+	crn_huff_decoder dm = { 0 };
+	crn_bit_reader reader;
+	crn_uint32 a = 0, b = 0;
+	crn_bool ok;
+
+	if (!crnd_begin_palette(ctx, cCRNHdrOfsAlphaEndpoints, &reader))
+		return crn_false;
+	ctx->pAlpha_endpoints = (crn_uint16*)crn_malloc(ctx->num_alpha_endpoints * sizeof(crn_uint16));
+	ok = ctx->pAlpha_endpoints && crn_bit_reader_receive_model(&reader, &dm);
+
+	for (crn_uint32 i = 0; ok && i < ctx->num_alpha_endpoints; i++)
+	{
+		a = (a + crn_bit_reader_decode(&reader, &dm)) & 255;
+		b = (b + crn_bit_reader_decode(&reader, &dm)) & 255;
+		ctx->pAlpha_endpoints[i] = (crn_uint16)(a | (b << 8));
+	}
+
+	crn_huff_decoder_free(&dm);
+	return ok;
+}
+
+static crn_bool crnd_decode_alpha_selectors(crnd_unpack_context ctx)
+{
+	crn_huff_decoder dm = { 0 };
+	crn_bit_reader reader;
+	crn_uint32 cur[16] = { 0 };
+	crn_bool ok;
+
+	if (!crnd_begin_palette(ctx, cCRNHdrOfsAlphaSelectors, &reader))
+		return crn_false;
+	ctx->pAlpha_selectors = (crn_uint64*)crn_malloc(ctx->num_alpha_selectors * sizeof(crn_uint64));
+	ok = ctx->pAlpha_selectors && crn_bit_reader_receive_model(&reader, &dm);
+
+	for (crn_uint32 i = 0; ok && i < ctx->num_alpha_selectors; i++)
+	{
+		crn_uint64 s = 0;
+		for (crn_uint32 j = 0; j < 8; j++)
+		{
+			const crn_uint32 sym = crn_bit_reader_decode(&reader, &dm);
+			cur[j * 2 + 0] = (cur[j * 2 + 0] + (sym % 15) - 7) & 7;
+			cur[j * 2 + 1] = (cur[j * 2 + 1] + (sym / 15) - 7) & 7;
+		}
+		for (crn_uint32 j = 0; j < 16; j++)
+			s |= (crn_uint64)g_crnd_dxt5_from_linear[cur[j]] << (16 + j * 3);
+		ctx->pAlpha_selectors[i] = s;
+	}
+
+	crn_huff_decoder_free(&dm);
+	return ok;
+}
+
+static crn_bool crnd_decode_tables(crnd_unpack_context ctx)
+{
+	const crn_uint32 ofs = crn_read_packed(ctx->pData + cCRNHdrOfsTablesOfs, 3);
+	const crn_uint32 size = crn_read_packed(ctx->pData + cCRNHdrOfsTablesSize, 2);
+	crn_bit_reader reader;
+
+	if (ofs + size > ctx->data_size)
+		return crn_false;
+	crn_bit_reader_init(&reader, ctx->pData + ofs, size);
+
+	if (!crn_bit_reader_receive_model(&reader, &ctx->chunk_encoding_dm))
+		return crn_false;
+	if (ctx->num_color_endpoints &&
+		(!crn_bit_reader_receive_model(&reader, &ctx->endpoint_delta_dm[0]) ||
+		 !crn_bit_reader_receive_model(&reader, &ctx->selector_delta_dm[0])))
+		return crn_false;
+	if (ctx->num_alpha_endpoints &&
+		(!crn_bit_reader_receive_model(&reader, &ctx->endpoint_delta_dm[1]) ||
+		 !crn_bit_reader_receive_model(&reader, &ctx->selector_delta_dm[1])))
+		return crn_false;
+	return crn_true;
+}
+
+crnd_unpack_context crnd_unpack_begin(const void* pData, crn_uint32 data_size)
+{
+	return crnd_unpack_begin_slice(pData, data_size, NULL, 0);
+}
+
+crnd_unpack_context crnd_unpack_begin_slice(const void* pData, crn_uint32 data_size, const void* pPalette_data, crn_uint32 palette_data_size)
+{
+	crnd_unpack_context ctx;
+	crnd_texture_info info, palette_info;
+	crn_bool ok, needs_color, needs_alpha;
+
+	if (!crnd_get_texture_info(pData, data_size, &info))
+		return NULL;
+
+	// The first slice's file must itself hold the palettes, of the same format and sizes.
+	if (crn_read_packed((const crn_uint8*)pData + cCRNHdrOfsFlags, 2) & cCRNHeaderFlagSharedPalettes)
+	{
+		if (!crnd_get_texture_info(pPalette_data, palette_data_size, &palette_info) || palette_info.format != info.format ||
+			(crn_read_packed((const crn_uint8*)pPalette_data + cCRNHdrOfsFlags, 2) & cCRNHeaderFlagSharedPalettes))
+			return NULL;
+		for (crn_uint32 pal = cCRNHdrOfsColorEndpoints; pal <= cCRNHdrOfsAlphaSelectors; pal += 8)
+		{
+			if (crnd_palette_num((const crn_uint8*)pData, pal) != crnd_palette_num((const crn_uint8*)pPalette_data, pal))
+				return NULL;
+		}
+	}
+	else
+	{
+		pPalette_data = pData;
+		palette_data_size = data_size;
+	}
+
+	ctx = (crnd_unpack_context)crn_calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+	ctx->pData = (const crn_uint8*)pData;
+	ctx->data_size = data_size;
+	ctx->pPalette_data = (const crn_uint8*)pPalette_data;
+	ctx->palette_data_size = palette_data_size;
+	ctx->info = info;
+
+	switch (info.format)
+	{
+	case cCRNFmtDXT1:
+		ctx->kind = cCRNDBlockDXT1;
+		break;
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+		ctx->kind = cCRNDBlockDXT5;
+		break;
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+		ctx->kind = cCRNDBlockDXN;
+		break;
+	case cCRNFmtDXT5A:
+		ctx->kind = cCRNDBlockDXT5A;
+		break;
+	default:
+		// DXT3, ETC1, BC6H and BC7 have no CRN representation.
+		crn_free(ctx);
+		return NULL;
+	}
+
+	ctx->num_color_endpoints = crnd_palette_num(ctx->pData, cCRNHdrOfsColorEndpoints);
+	ctx->num_color_selectors = crnd_palette_num(ctx->pData, cCRNHdrOfsColorSelectors);
+	ctx->num_alpha_endpoints = crnd_palette_num(ctx->pData, cCRNHdrOfsAlphaEndpoints);
+	ctx->num_alpha_selectors = crnd_palette_num(ctx->pData, cCRNHdrOfsAlphaSelectors);
+
+	needs_color = ctx->kind == cCRNDBlockDXT1 || ctx->kind == cCRNDBlockDXT5;
+	needs_alpha = ctx->kind != cCRNDBlockDXT1;
+	ok = (!needs_color || (ctx->num_color_endpoints && ctx->num_color_selectors)) &&
+		(!needs_alpha || (ctx->num_alpha_endpoints && ctx->num_alpha_selectors));
+
+	ok = ok && (!ctx->num_color_endpoints || crnd_decode_color_endpoints(ctx));
+	ok = ok && (!ctx->num_color_selectors || crnd_decode_color_selectors(ctx));
+	ok = ok && (!ctx->num_alpha_endpoints || crnd_decode_alpha_endpoints(ctx));
+	ok = ok && (!ctx->num_alpha_selectors || crnd_decode_alpha_selectors(ctx));
+	ok = ok && crnd_decode_tables(ctx);
+
+	if (!ok)
+	{
+		crnd_unpack_end(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+void crnd_unpack_end(crnd_unpack_context ctx)
+{
+	if (!ctx)
+		return;
+	crn_free(ctx->pColor_endpoints);
+	crn_free(ctx->pColor_selectors);
+	crn_free(ctx->pAlpha_endpoints);
+	crn_free(ctx->pAlpha_selectors);
+	crn_huff_decoder_free(&ctx->chunk_encoding_dm);
+	for (crn_uint32 i = 0; i < 2; i++)
+	{
+		crn_huff_decoder_free(&ctx->endpoint_delta_dm[i]);
+		crn_huff_decoder_free(&ctx->selector_delta_dm[i]);
+	}
+	crn_free(ctx);
+}
+
+// Per-level decoding state. Indices are delta coded against the previous index of the same palette.
+typedef struct
+{
+	crn_bit_reader reader;
+	crn_uint32     chunk_encoding_bits;
+	crn_uint32     prev_endpoint[2];
+	crn_uint32     prev_selector[2];
+} crnd_level_state;
+
+static inline crn_uint32 crnd_next_index(crn_bit_reader* pReader, const crn_huff_decoder* pDm, crn_uint32* pPrev, crn_uint32 num)
+{
+	crn_uint32 i = *pPrev + crn_bit_reader_decode(pReader, pDm);
+	if (i >= num)
+		i -= num;
+	// Only reachable with corrupted data, keeps palette lookups in bounds.
+	if (i >= num)
+		i = 0;
+	*pPrev = i;
+	return i;
+}
+
+static inline crn_uint32 crnd_next_chunk_encoding(crnd_level_state* pState, const crn_huff_decoder* pDm)
+{
+	crn_uint32 index;
+	if (pState->chunk_encoding_bits == 1)
+		pState->chunk_encoding_bits = crn_bit_reader_decode(&pState->reader, pDm) | 512;
+	index = pState->chunk_encoding_bits & 7;
+	pState->chunk_encoding_bits >>= 3;
+	return index;
+}
+
+crn_bool crnd_unpack_level(crnd_unpack_context ctx, void** ppDst, crn_uint32 dst_size_in_bytes, crn_uint32 row_pitch_in_bytes, crn_uint32 level_index)
+{
+	const crn_uint8* pHdr;
+	crn_uint32 width, height, blocks_x, blocks_y, chunks_x, chunks_y, level_ofs, level_end, bpb;
+	crnd_level_state state;
+
+	if (!ctx || !ppDst || level_index >= ctx->info.levels)
+		return crn_false;
+
+	pHdr = ctx->pData;
+	width = CRN_MAX(ctx->info.width >> level_index, 1U);
+	height = CRN_MAX(ctx->info.height >> level_index, 1U);
+	blocks_x = (width + 3) >> 2;
+	blocks_y = (height + 3) >> 2;
+	chunks_x = (blocks_x + 1) >> 1;
+	chunks_y = (blocks_y + 1) >> 1;
+	bpb = ctx->info.bytes_per_block;
+
+	if (row_pitch_in_bytes < blocks_x * bpb || (crn_uint64)row_pitch_in_bytes * blocks_y > dst_size_in_bytes)
+		return crn_false;
+
+	level_ofs = crn_read_packed(pHdr + cCRNHdrOfsLevelOfs + level_index * 4, 4);
+	level_end = (level_index + 1 < ctx->info.levels)
+		? crn_read_packed(pHdr + cCRNHdrOfsLevelOfs + (level_index + 1) * 4, 4)
+		: crn_read_packed(pHdr + cCRNHdrOfsDataSize, 4);
+	if (level_ofs > level_end || level_end > ctx->data_size)
+		return crn_false;
+
+	memset(&state, 0, sizeof(state));
+	state.chunk_encoding_bits = 1;
+	crn_bit_reader_init(&state.reader, pHdr + level_ofs, level_end - level_ofs);
+
+	for (crn_uint32 f = 0; f < ctx->info.faces; f++)
+	{
+		crn_uint8* pFace = (crn_uint8*)ppDst[f];
+		for (crn_uint32 y = 0; y < chunks_y; y++)
+		{
+			// Chunk rows are traversed in serpentine order, so consecutive chunks are always neighbours.
+			const int dir_x = (y & 1) ? -1 : 1;
+			const int start_x = (y & 1) ? (int)chunks_x - 1 : 0;
+			const int end_x = (y & 1) ? -1 : (int)chunks_x;
+			const crn_bool has_bottom = (y * 2 + 1) < blocks_y;
+			crn_uint8* pRow = pFace + (size_t)y * 2 * row_pitch_in_bytes;
+
+			for (int x = start_x; x != end_x; x += dir_x)
+			{
+				const crn_uint32 encoding = crnd_next_chunk_encoding(&state, &ctx->chunk_encoding_dm);
+				const crn_uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[encoding];
+				const crn_uint8* pTiles = g_crnd_chunk_encoding_tiles[encoding];
+				const crn_bool has_right = ((crn_uint32)x * 2 + 1) < blocks_x;
+				crn_uint8* pBlocks[4];
+				crn_uint32 tiles[2][4];
+
+				pBlocks[0] = pRow + (size_t)x * 2 * bpb;
+				pBlocks[1] = has_right ? pBlocks[0] + bpb : NULL;
+				pBlocks[2] = has_bottom ? pBlocks[0] + row_pitch_in_bytes : NULL;
+				pBlocks[3] = (has_right && has_bottom) ? pBlocks[2] + bpb : NULL;
+
+				switch (ctx->kind)
+				{
+				case cCRNDBlockDXT1:
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[0][t] = ctx->pColor_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[0], &state.prev_endpoint[0], ctx->num_color_endpoints)];
+					for (crn_uint32 b = 0; b < 4; b++)
+					{
+						const crn_uint32 sel = ctx->pColor_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[0], &state.prev_selector[0], ctx->num_color_selectors)];
+						if (pBlocks[b])
+							crn_write_le64(pBlocks[b], tiles[0][pTiles[b]] | ((crn_uint64)sel << 32));
+					}
+					break;
+
+				case cCRNDBlockDXT5:
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[0][t] = ctx->pColor_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[0], &state.prev_endpoint[0], ctx->num_color_endpoints)];
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[1][t] = ctx->pAlpha_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[1], &state.prev_endpoint[1], ctx->num_alpha_endpoints)];
+					for (crn_uint32 b = 0; b < 4; b++)
+					{
+						const crn_uint64 asel = ctx->pAlpha_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[1], &state.prev_selector[1], ctx->num_alpha_selectors)];
+						const crn_uint32 csel = ctx->pColor_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[0], &state.prev_selector[0], ctx->num_color_selectors)];
+						if (pBlocks[b])
+						{
+							crn_write_le64(pBlocks[b], tiles[1][pTiles[b]] | asel);
+							crn_write_le64(pBlocks[b] + 8, tiles[0][pTiles[b]] | ((crn_uint64)csel << 32));
+						}
+					}
+					break;
+
+				case cCRNDBlockDXN:
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[0][t] = ctx->pAlpha_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[1], &state.prev_endpoint[1], ctx->num_alpha_endpoints)];
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[1][t] = ctx->pAlpha_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[1], &state.prev_endpoint[1], ctx->num_alpha_endpoints)];
+					for (crn_uint32 b = 0; b < 4; b++)
+					{
+						const crn_uint64 sel0 = ctx->pAlpha_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[1], &state.prev_selector[1], ctx->num_alpha_selectors)];
+						const crn_uint64 sel1 = ctx->pAlpha_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[1], &state.prev_selector[1], ctx->num_alpha_selectors)];
+						if (pBlocks[b])
+						{
+							crn_write_le64(pBlocks[b], tiles[0][pTiles[b]] | sel0);
+							crn_write_le64(pBlocks[b] + 8, tiles[1][pTiles[b]] | sel1);
+						}
+					}
+					break;
+
+				case cCRNDBlockDXT5A:
+					for (crn_uint32 t = 0; t < num_tiles; t++)
+						tiles[0][t] = ctx->pAlpha_endpoints[crnd_next_index(&state.reader, &ctx->endpoint_delta_dm[1], &state.prev_endpoint[1], ctx->num_alpha_endpoints)];
+					for (crn_uint32 b = 0; b < 4; b++)
+					{
+						const crn_uint64 sel = ctx->pAlpha_selectors[crnd_next_index(&state.reader, &ctx->selector_delta_dm[1], &state.prev_selector[1], ctx->num_alpha_selectors)];
+						if (pBlocks[b])
+							crn_write_le64(pBlocks[b], tiles[0][pTiles[b]] | sel);
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	return crn_true;
+}
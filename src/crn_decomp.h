@@ -0,0 +1,95 @@
+// File: crn_decomp.h - CRN file parsing and transcoding to raw DXTn blocks.
+//
+// A CRN file stores shared endpoint/selector palettes followed by one Huffman coded bitstream per
+// mipmap level. Once crnd_unpack_begin() has decoded the palettes and models the context is
+// read-only, so separate levels may be unpacked concurrently from different threads.
+#ifndef CRN_DECOMP_H
+#define CRN_DECOMP_H
+
+#include "crnlib.h"
+
+enum
+{
+	cCRNSigValue      = ('H' << 8) | 'x',
+	cCRNHeaderMinSize = 70,   // Header size excluding the per-level offsets
+	cCRNMaxFileSize   = 0x7FFFFFFF
+};
+
+// Byte offsets of the big endian fields of the CRN header.
+enum
+{
+	cCRNHdrOfsSig            = 0,
+	cCRNHdrOfsHeaderSize     = 2,
+	cCRNHdrOfsHeaderCRC16    = 4,
+	cCRNHdrOfsDataSize       = 6,
+	cCRNHdrOfsDataCRC16      = 10,
+	cCRNHdrOfsWidth          = 12,
+	cCRNHdrOfsHeight         = 14,
+	cCRNHdrOfsLevels         = 16,
+	cCRNHdrOfsFaces          = 17,
+	cCRNHdrOfsFormat         = 18,
+	cCRNHdrOfsFlags          = 19,
+	cCRNHdrOfsReserved       = 21,
+	cCRNHdrOfsUserdata0      = 25,
+	cCRNHdrOfsUserdata1      = 29,
+	cCRNHdrOfsColorEndpoints = 33, // Each palette is { ofs:3, size:3, num:2 }
+	cCRNHdrOfsColorSelectors = 41,
+	cCRNHdrOfsAlphaEndpoints = 49,
+	cCRNHdrOfsAlphaSelectors = 57,
+	cCRNHdrOfsTablesSize     = 65,
+	cCRNHdrOfsTablesOfs      = 67,
+	cCRNHdrOfsLevelOfs       = 70
+};
+
+// Bits of the 2 byte header flags field.
+enum
+{
+	// The file is a texture array slice after the first, whose palettes are only stored in the first slice's file.
+	// Its palette entries keep their counts, with zero offsets and sizes.
+	cCRNHeaderFlagSharedPalettes = 1
+};
+
+// Tile layouts of a 2x2 block chunk, blocks are ordered top-left, top-right, bottom-left, bottom-right.
+enum { cCRNNumChunkEncodings = 8 };
+extern const crn_uint8 g_crnd_chunk_encoding_num_tiles[cCRNNumChunkEncodings];
+extern const crn_uint8 g_crnd_chunk_encoding_tiles[cCRNNumChunkEncodings][4];
+
+// Mapping between DXTn selector values and their linear (ordered by interpolation weight) equivalents.
+extern const crn_uint8 g_crnd_dxt1_to_linear[4];
+extern const crn_uint8 g_crnd_dxt1_from_linear[4];
+extern const crn_uint8 g_crnd_dxt5_to_linear[8];
+extern const crn_uint8 g_crnd_dxt5_from_linear[8];
+
+typedef struct
+{
+	crn_uint32 width;
+	crn_uint32 height;
+	crn_uint32 levels;
+	crn_uint32 faces;
+	crn_uint32 bytes_per_block;
+	crn_uint32 userdata0;
+	crn_uint32 userdata1;
+	crn_format format;
+} crnd_texture_info;
+
+// Retrieves basic information from a CRN file's header, without decoding anything. Checks the header CRC.
+crn_bool crnd_get_texture_info(const void* pData, crn_uint32 data_size, crnd_texture_info* pInfo);
+
+typedef struct crnd_unpack_context_s* crnd_unpack_context;
+
+// Decodes the palettes and Huffman tables, returns NULL on failure.
+// pData must stay valid until crnd_unpack_end() is called.
+crnd_unpack_context crnd_unpack_begin(const void* pData, crn_uint32 data_size);
+
+// Like crnd_unpack_begin(), for any slice of a texture array written by crn_compress_array(). The palettes of slices
+// with cCRNHeaderFlagSharedPalettes are decoded from pPalette_data, the array's first file, which must stay valid until
+// crnd_unpack_end() too. Files holding their own palettes ignore it, so every slice can be opened the same way.
+crnd_unpack_context crnd_unpack_begin_slice(const void* pData, crn_uint32 data_size, const void* pPalette_data, crn_uint32 palette_data_size);
+
+// Transcodes a single mip level. ppDst holds one pointer per face, each receiving
+// blocks_y rows of row_pitch_in_bytes bytes (row_pitch_in_bytes >= blocks_x * bytes_per_block).
+crn_bool crnd_unpack_level(crnd_unpack_context context, void** ppDst, crn_uint32 dst_size_in_bytes, crn_uint32 row_pitch_in_bytes, crn_uint32 level_index);
+
+void crnd_unpack_end(crnd_unpack_context context);
+
+#endif // CRN_DECOMP_H
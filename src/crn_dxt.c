@@ -0,0 +1,1512 @@
+#include "crn_dxt.h"
+#include "crn_core.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+void crn_dxt_unpack565(crn_uint16 c, crn_uint8* pRGBA)
+{
+	pRGBA[0] = (crn_uint8)crn_dxt_expand5((c >> 11) & 31);
+	pRGBA[1] = (crn_uint8)crn_dxt_expand6((c >> 5) & 63);
+	pRGBA[2] = (crn_uint8)crn_dxt_expand5(c & 31);
+	pRGBA[3] = 255;
+}
+
+crn_uint16 crn_dxt_quantize565(const float* pRGB)
+{
+	const int r = (int)(CRN_CLAMP(pRGB[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+	const int g = (int)(CRN_CLAMP(pRGB[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+	const int b = (int)(CRN_CLAMP(pRGB[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+	return crn_dxt_pack565((crn_uint32)r, (crn_uint32)g, (crn_uint32)b);
+}
+
+void crn_dxt1_get_block_colors(crn_uint16 c0, crn_uint16 c1, crn_uint8 colors[4][4])
+{
+	crn_dxt_unpack565(c0, colors[0]);
+	crn_dxt_unpack565(c1, colors[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		if (c0 > c1)
+		{
+			colors[2][c] = (crn_uint8)((colors[0][c] * 2 + colors[1][c]) / 3);
+			colors[3][c] = (crn_uint8)((colors[0][c] + colors[1][c] * 2) / 3);
+		}
+		else
+		{
+			colors[2][c] = (crn_uint8)((colors[0][c] + colors[1][c]) / 2);
+			colors[3][c] = 0;
+		}
+	}
+	colors[2][3] = 255;
+	colors[3][3] = (c0 > c1) ? 255 : 0;
+}
+
+void crn_dxt5_get_block_values(crn_uint32 a0, crn_uint32 a1, crn_uint8 values[8])
+{
+	values[0] = (crn_uint8)a0;
+	values[1] = (crn_uint8)a1;
+	if (a0 > a1)
+	{
+		for (crn_uint32 i = 1; i < 7; i++)
+			values[i + 1] = (crn_uint8)((a0 * (7 - i) + a1 * i) / 7);
+	}
+	else
+	{
+		for (crn_uint32 i = 1; i < 5; i++)
+			values[i + 1] = (crn_uint8)((a0 * (5 - i) + a1 * i) / 5);
+		values[6] = 0;
+		values[7] = 255;
+	}
+}
+
+// Weighted squared RGB distance, in sixteenths (see crn_dxt1_get_weights()).
+static inline crn_uint32 crn_dxt1_distance(const crn_uint8* pA, const crn_uint8* pB, const crn_uint8* pWeights)
+{
+	const int dr = pA[0] - pB[0], dg = pA[1] - pB[1], db = pA[2] - pB[2];
+	return (crn_uint32)(dr * dr * pWeights[0] + dg * dg * pWeights[1] + db * db * pWeights[2]);
+}
+
+#if CRN_SSE2
+// An RGB triple in both halves of a vector of 16-bit lanes, to line up with two pixels widened by unpacking.
+static inline __m128i crn_dxt1_splat_rgb(const crn_uint8* pRGB)
+{
+	return _mm_set_epi16(0, pRGB[2], pRGB[1], pRGB[0], 0, pRGB[2], pRGB[1], pRGB[0]);
+}
+
+// Weighted squared RGB distances of 4 pixels (widened to 16 bits in lo and hi) to a palette color. The weights are
+// applied to one factor of each square before madd pairs up the channels, so everything stays in integers.
+static inline __m128i crn_dxt1_distances(__m128i lo, __m128i hi, __m128i color, __m128i weights)
+{
+	const __m128i dl = _mm_sub_epi16(lo, color), dh = _mm_sub_epi16(hi, color);
+	const __m128 el = _mm_castsi128_ps(_mm_madd_epi16(dl, _mm_mullo_epi16(dl, weights)));
+	const __m128 eh = _mm_castsi128_ps(_mm_madd_epi16(dh, _mm_mullo_epi16(dh, weights)));
+	return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(el, eh, _MM_SHUFFLE(2, 0, 2, 0))),
+		_mm_castps_si128(_mm_shuffle_ps(el, eh, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+
+static inline __m128i crn_dxt1_min_epi32(__m128i a, __m128i b)
+{
+	const __m128i lt = _mm_cmplt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+}
+#endif
+
+// crn_dxt1_color_error() in sixteenths.
+static crn_uint32 crn_dxt1_palette_error(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8 colors[4][4], const crn_uint8* pWeights)
+{
+	crn_uint32 total = 0, i = 0;
+#if CRN_SSE2
+	// 4 pixels per iteration: widen to 16 bits, then keep each pixel's smallest distance.
+	const __m128i zero = _mm_setzero_si128(), rgb_mask = _mm_set1_epi32(0x00FFFFFF), weights = crn_dxt1_splat_rgb(pWeights);
+	__m128i pal[4], sum = zero;
+	crn_uint32 lanes[4];
+	for (int c = 0; c < 4; c++)
+		pal[c] = crn_dxt1_splat_rgb(colors[c]);
+	for (; i + 4 <= num_pixels; i += 4)
+	{
+		const __m128i px = _mm_and_si128(_mm_loadu_si128((const __m128i*)(pPixels + i * 4)), rgb_mask);
+		const __m128i lo = _mm_unpacklo_epi8(px, zero), hi = _mm_unpackhi_epi8(px, zero);
+		const __m128i best = crn_dxt1_min_epi32(crn_dxt1_min_epi32(crn_dxt1_distances(lo, hi, pal[0], weights), crn_dxt1_distances(lo, hi, pal[1], weights)),
+			crn_dxt1_min_epi32(crn_dxt1_distances(lo, hi, pal[2], weights), crn_dxt1_distances(lo, hi, pal[3], weights)));
+		sum = _mm_add_epi32(sum, best);
+	}
+	_mm_storeu_si128((__m128i*)lanes, sum);
+	total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (; i < num_pixels; i++)
+	{
+		crn_uint32 best = 0xFFFFFFFF;
+		for (int c = 0; c < 4; c++)
+			best = CRN_MIN(best, crn_dxt1_distance(pPixels + i * 4, colors[c], pWeights));
+		total += best;
+	}
+	return total;
+}
+
+crn_uint32 crn_dxt1_color_error(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8 colors[4][4], const crn_uint8* pWeights)
+{
+	return (crn_dxt1_palette_error(pPixels, num_pixels, colors, pWeights) + 8) >> 4;
+}
+
+crn_uint32 crn_dxt5_alpha_error(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint32 channel, const crn_uint8 values[8])
+{
+	crn_uint32 total = 0, i = 0;
+#if CRN_SSE2
+	// 8 pixels per iteration: extract the channel into 16-bit lanes and keep the smallest absolute difference.
+	const __m128i zero = _mm_setzero_si128(), byte_mask = _mm_set1_epi32(0xFF), shift = _mm_cvtsi32_si128((int)channel * 8);
+	__m128i vals[8], sum = zero;
+	crn_uint32 lanes[4];
+	for (int v = 0; v < 8; v++)
+		vals[v] = _mm_set1_epi16(values[v]);
+	for (; i + 8 <= num_pixels; i += 8)
+	{
+		const __m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(pPixels + i * 4)), shift), byte_mask);
+		const __m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(pPixels + i * 4 + 16)), shift), byte_mask);
+		const __m128i x = _mm_packs_epi32(a, b);
+		__m128i best = _mm_set1_epi16(255);
+		for (int v = 0; v < 8; v++)
+		{
+			const __m128i d = _mm_sub_epi16(x, vals[v]);
+			best = _mm_min_epi16(best, _mm_max_epi16(d, _mm_sub_epi16(zero, d)));
+		}
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(best, best));
+	}
+	_mm_storeu_si128((__m128i*)lanes, sum);
+	total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (; i < num_pixels; i++)
+	{
+		crn_uint32 best = 0xFFFFFFFF;
+		for (int v = 0; v < 8; v++)
+		{
+			const int d = pPixels[i * 4 + channel] - values[v];
+			best = CRN_MIN(best, (crn_uint32)(d * d));
+		}
+		total += best;
+	}
+	return total;
+}
+
+crn_bool crn_dxt1_ls_solve(const crn_dxt1_ls* pLS, float* pEndpoints)
+{
+	const float det = pLS->aa * pLS->bb - pLS->ab * pLS->ab;
+	float inv;
+	if (fabsf(det) < 1e-6f)
+		return crn_false;
+
+	inv = 1.0f / det;
+	for (int c = 0; c < 3; c++)
+	{
+		const float e0 = (pLS->bb * pLS->ax[c] - pLS->ab * pLS->bx[c]) * inv;
+		const float e1 = (pLS->aa * pLS->bx[c] - pLS->ab * pLS->ax[c]) * inv;
+		pEndpoints[c] = CRN_CLAMP(e0, 0.0f, 255.0f);
+		pEndpoints[3 + c] = CRN_CLAMP(e1, 0.0f, 255.0f);
+	}
+	return crn_true;
+}
+
+// Mean and principal axis (unit length) of the pixels' colors, with each channel scaled by the square root of its
+// weight so the axis follows the weighted error. The axis falls back to luma for flat pixel sets.
+static void crn_dxt1_principal_axis(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8* pWeights, float* pMean, float* pAxis)
+{
+	// Integer moments are exact; the covariance is derived from them once.
+	crn_uint32 sum[3] = { 0, 0, 0 };
+	crn_uint64 prod[6] = { 0, 0, 0, 0, 0, 0 };
+	float cov[6];
+	int mn[3] = { 255, 255, 255 }, mx[3] = { 0, 0, 0 };
+	const double inv_n = 1.0 / CRN_MAX(num_pixels, 1U);
+	const float scale[3] = { sqrtf((float)pWeights[0]), sqrtf((float)pWeights[1]), sqrtf((float)pWeights[2]) };
+
+	for (crn_uint32 i = 0; i < num_pixels; i++)
+	{
+		const int r = pPixels[i * 4 + 0], g = pPixels[i * 4 + 1], b = pPixels[i * 4 + 2];
+		sum[0] += (crn_uint32)r;
+		sum[1] += (crn_uint32)g;
+		sum[2] += (crn_uint32)b;
+		prod[0] += (crn_uint32)(r * r);
+		prod[1] += (crn_uint32)(r * g);
+		prod[2] += (crn_uint32)(r * b);
+		prod[3] += (crn_uint32)(g * g);
+		prod[4] += (crn_uint32)(g * b);
+		prod[5] += (crn_uint32)(b * b);
+		mn[0] = CRN_MIN(mn[0], r);
+		mn[1] = CRN_MIN(mn[1], g);
+		mn[2] = CRN_MIN(mn[2], b);
+		mx[0] = CRN_MAX(mx[0], r);
+		mx[1] = CRN_MAX(mx[1], g);
+		mx[2] = CRN_MAX(mx[2], b);
+	}
+	for (int c = 0; c < 3; c++)
+		pMean[c] = (float)(sum[c] * inv_n);
+	cov[0] = (float)((double)prod[0] - (double)sum[0] * sum[0] * inv_n) * scale[0] * scale[0];
+	cov[1] = (float)((double)prod[1] - (double)sum[0] * sum[1] * inv_n) * scale[0] * scale[1];
+	cov[2] = (float)((double)prod[2] - (double)sum[0] * sum[2] * inv_n) * scale[0] * scale[2];
+	cov[3] = (float)((double)prod[3] - (double)sum[1] * sum[1] * inv_n) * scale[1] * scale[1];
+	cov[4] = (float)((double)prod[4] - (double)sum[1] * sum[2] * inv_n) * scale[1] * scale[2];
+	cov[5] = (float)((double)prod[5] - (double)sum[2] * sum[2] * inv_n) * scale[2] * scale[2];
+
+	// Power iteration in the weighted space, seeded with the bounding box diagonal.
+	pAxis[0] = (float)(mx[0] - mn[0]) * scale[0];
+	pAxis[1] = (float)(mx[1] - mn[1]) * scale[1];
+	pAxis[2] = (float)(mx[2] - mn[2]) * scale[2];
+	for (int iter = 0; iter < 4; iter++)
+	{
+		const float r = pAxis[0] * cov[0] + pAxis[1] * cov[1] + pAxis[2] * cov[2];
+		const float g = pAxis[0] * cov[1] + pAxis[1] * cov[3] + pAxis[2] * cov[4];
+		const float b = pAxis[0] * cov[2] + pAxis[1] * cov[4] + pAxis[2] * cov[5];
+		const float m = CRN_MAX(fabsf(r), CRN_MAX(fabsf(g), fabsf(b)));
+		if (m < 1e-8f)
+			break;
+		pAxis[0] = r / m;
+		pAxis[1] = g / m;
+		pAxis[2] = b / m;
+	}
+	for (int c = 0; c < 3; c++)
+		pAxis[c] /= scale[c];
+	{
+		const float len = sqrtf(pAxis[0] * pAxis[0] + pAxis[1] * pAxis[1] + pAxis[2] * pAxis[2]);
+		if (len < 1e-8f)
+		{
+			pAxis[0] = 0.2990f;
+			pAxis[1] = 0.5870f;
+			pAxis[2] = 0.1140f;
+		}
+		else
+		{
+			pAxis[0] /= len;
+			pAxis[1] /= len;
+			pAxis[2] /= len;
+		}
+	}
+}
+
+// Endpoints spanning the pixels' projections onto an axis through the mean, the larger projection first.
+static void crn_dxt1_project_endpoints(const crn_uint8* pPixels, crn_uint32 num_pixels, const float* pMean, const float* pAxis, float* pEndpoints)
+{
+	float lo = 1e30f, hi = -1e30f;
+	for (crn_uint32 i = 0; i < num_pixels; i++)
+	{
+		const float t = (pPixels[i * 4 + 0] - pMean[0]) * pAxis[0] + (pPixels[i * 4 + 1] - pMean[1]) * pAxis[1] + (pPixels[i * 4 + 2] - pMean[2]) * pAxis[2];
+		lo = CRN_MIN(lo, t);
+		hi = CRN_MAX(hi, t);
+	}
+	if (!num_pixels)
+		lo = hi = 0.0f;
+	for (int c = 0; c < 3; c++)
+	{
+		pEndpoints[c] = CRN_CLAMP(pMean[c] + pAxis[c] * hi, 0.0f, 255.0f);
+		pEndpoints[3 + c] = CRN_CLAMP(pMean[c] + pAxis[c] * lo, 0.0f, 255.0f);
+	}
+}
+
+// Least squares passes over the linear selectors of unquantized endpoints. The selectors come from the pixels' weighted
+// projections; the least squares solution itself doesn't depend on the weights, as the channels are solved separately.
+static void crn_dxt1_refine_endpoints(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint32 num_passes, const crn_uint8* pWeights, float* pEndpoints)
+{
+	for (crn_uint32 pass = 0; pass < num_passes; pass++)
+	{
+		const float e[3] = { pEndpoints[0], pEndpoints[1], pEndpoints[2] };
+		const float dir[3] = { (pEndpoints[3] - e[0]) * pWeights[0], (pEndpoints[4] - e[1]) * pWeights[1], (pEndpoints[5] - e[2]) * pWeights[2] };
+		const float len2 = (pEndpoints[3] - e[0]) * dir[0] + (pEndpoints[4] - e[1]) * dir[1] + (pEndpoints[5] - e[2]) * dir[2];
+		crn_uint32 counts[4] = { 0, 0, 0, 0 }, sums[4][3];
+		crn_dxt1_ls ls;
+		if (len2 < 16.0f)
+			break;
+
+		// Pixels sharing a selector contribute identically apart from their color, so sum them per selector first.
+		memset(sums, 0, sizeof(sums));
+		for (crn_uint32 i = 0; i < num_pixels; i++)
+		{
+			const crn_uint8* p = pPixels + i * 4;
+			const float t = ((p[0] - e[0]) * dir[0] + (p[1] - e[1]) * dir[1] + (p[2] - e[2]) * dir[2]) * (3.0f / len2);
+			const int s = CRN_CLAMP((int)(t + 0.5f), 0, 3);
+			counts[s]++;
+			sums[s][0] += p[0];
+			sums[s][1] += p[1];
+			sums[s][2] += p[2];
+		}
+
+		memset(&ls, 0, sizeof(ls));
+		for (crn_uint32 s = 0; s < 4; s++)
+		{
+			const float bw = s * (1.0f / 3.0f), aw = 1.0f - bw, n = (float)counts[s];
+			ls.aa += aw * aw * n;
+			ls.ab += aw * bw * n;
+			ls.bb += bw * bw * n;
+			for (int c = 0; c < 3; c++)
+			{
+				ls.ax[c] += aw * (float)sums[s][c];
+				ls.bx[c] += bw * (float)sums[s][c];
+			}
+		}
+		if (!crn_dxt1_ls_solve(&ls, pEndpoints))
+			break;
+	}
+}
+
+void crn_dxt1_fit_endpoints(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8* pWeights, float* pEndpoints)
+{
+	float mean[3], axis[3];
+	crn_dxt1_principal_axis(pPixels, num_pixels, pWeights, mean, axis);
+	crn_dxt1_project_endpoints(pPixels, num_pixels, mean, axis, pEndpoints);
+	crn_dxt1_refine_endpoints(pPixels, num_pixels, 2, pWeights, pEndpoints);
+
+	if (crn_dxt_quantize565(pEndpoints) < crn_dxt_quantize565(pEndpoints + 3))
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const float t = pEndpoints[c];
+			pEndpoints[c] = pEndpoints[3 + c];
+			pEndpoints[3 + c] = t;
+		}
+	}
+}
+
+// -------- Block encoding
+
+// Colors of an endpoint pair in 4 color mode, which stores the larger 565 value first. Equal endpoints can only be
+// stored in 3 color mode; they're evaluated as 4 copies of the one color, as every selector is set to 0 for them.
+static void crn_dxt1_get_opaque_colors(crn_uint16 c0, crn_uint16 c1, crn_uint8 colors[4][4])
+{
+	if (c0 == c1)
+	{
+		crn_dxt_unpack565(c0, colors[0]);
+		memcpy(colors[1], colors[0], 4);
+		memcpy(colors[2], colors[0], 4);
+		memcpy(colors[3], colors[0], 4);
+	}
+	else
+	{
+		crn_dxt1_get_block_colors(CRN_MAX(c0, c1), CRN_MIN(c0, c1), colors);
+	}
+}
+
+static crn_uint32 crn_dxt1_eval_endpoints(const crn_uint8 pixels[16][4], crn_uint16 c0, crn_uint16 c1, const crn_uint8* pWeights)
+{
+	crn_uint8 colors[4][4];
+	crn_dxt1_get_opaque_colors(c0, c1, colors);
+	return crn_dxt1_palette_error(&pixels[0][0], 16, (const crn_uint8 (*)[4])colors, pWeights);
+}
+
+// Nearest block color of each pixel, as 2-bit selectors packed in pixel order.
+static crn_uint32 crn_dxt1_find_selectors(const crn_uint8 pixels[16][4], const crn_uint8 colors[4][4], const crn_uint8* pWeights)
+{
+	crn_uint32 selectors = 0;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_uint32 best = 0, best_error = 0xFFFFFFFF;
+		for (crn_uint32 s = 0; s < 4; s++)
+		{
+			const crn_uint32 error = crn_dxt1_distance(pixels[i], colors[s], pWeights);
+			if (error < best_error)
+			{
+				best_error = error;
+				best = s;
+			}
+		}
+		selectors |= best << (i * 2);
+	}
+	return selectors;
+}
+
+// Selectors from each pixel's weighted position along the endpoint line, close to the nearest colors' at a fraction
+// of the cost.
+static crn_uint32 crn_dxt1_project_selectors(const crn_uint8 pixels[16][4], const crn_uint8 colors[4][4], const crn_uint8* pWeights)
+{
+	// Linear selectors (from the larger endpoint) to block order.
+	static const crn_uint32 s_block_selectors[4] = { 0, 2, 3, 1 };
+	const int dir[3] = { (colors[1][0] - colors[0][0]) * pWeights[0], (colors[1][1] - colors[0][1]) * pWeights[1], (colors[1][2] - colors[0][2]) * pWeights[2] };
+	const int len2 = (colors[1][0] - colors[0][0]) * dir[0] + (colors[1][1] - colors[0][1]) * dir[1] + (colors[1][2] - colors[0][2]) * dir[2];
+	crn_uint32 selectors = 0;
+
+	if (!len2)
+		return 0;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const int t = (pixels[i][0] - colors[0][0]) * dir[0] + (pixels[i][1] - colors[0][1]) * dir[1] + (pixels[i][2] - colors[0][2]) * dir[2];
+		const int s = (t * 6 + len2) / (len2 * 2);
+		selectors |= s_block_selectors[CRN_CLAMP(s, 0, 3)] << (i * 2);
+	}
+	return selectors;
+}
+
+// Errors of an endpoint pair in 4 color mode (pError4, meaningless if a pixel is transparent) and in 3 color mode
+// (pError3), in one pass: both palettes share the endpoints, so the pair costs 6 distances per pixel instead of 8.
+// Transparent (A=0) pixels cost nothing in 3 color mode, and black is only offered to opaque pixels if black_ok.
+static void crn_dxt1_dual_error(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint16 c0, crn_uint16 c1, crn_bool black_ok, const crn_uint8* pWeights, crn_uint32* pError4, crn_uint32* pError3)
+{
+	static const crn_uint8 s_black[3] = { 0, 0, 0 };
+	crn_uint8 colors[4][4], mid[3];
+	crn_uint32 total4 = 0, total3 = 0, i = 0;
+
+	crn_dxt1_get_opaque_colors(c0, c1, colors);
+	for (int c = 0; c < 3; c++)
+		mid[c] = (crn_uint8)((colors[0][c] + colors[1][c]) / 2);
+
+#if CRN_SSE2
+	{
+		const __m128i zero = _mm_setzero_si128(), rgb_mask = _mm_set1_epi32(0x00FFFFFF), weights = crn_dxt1_splat_rgb(pWeights);
+		const __m128i no_black = black_ok ? zero : _mm_set1_epi32(0x7FFFFFFF);
+		const __m128i mid_color = crn_dxt1_splat_rgb(mid);
+		__m128i pal[4], sum4 = zero, sum3 = zero;
+		crn_uint32 lanes[8];
+		for (int c = 0; c < 4; c++)
+			pal[c] = crn_dxt1_splat_rgb(colors[c]);
+		for (; i + 4 <= num_pixels; i += 4)
+		{
+			const __m128i raw = _mm_loadu_si128((const __m128i*)(pPixels + i * 4));
+			const __m128i px = _mm_and_si128(raw, rgb_mask);
+			const __m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(raw, 24), zero);
+			const __m128i lo = _mm_unpacklo_epi8(px, zero), hi = _mm_unpackhi_epi8(px, zero);
+			const __m128i ends = crn_dxt1_min_epi32(crn_dxt1_distances(lo, hi, pal[0], weights), crn_dxt1_distances(lo, hi, pal[1], weights));
+			const __m128i best4 = crn_dxt1_min_epi32(ends, crn_dxt1_min_epi32(crn_dxt1_distances(lo, hi, pal[2], weights), crn_dxt1_distances(lo, hi, pal[3], weights)));
+			__m128i best3 = crn_dxt1_min_epi32(ends, crn_dxt1_distances(lo, hi, mid_color, weights));
+			best3 = crn_dxt1_min_epi32(best3, _mm_or_si128(crn_dxt1_distances(lo, hi, zero, weights), no_black));
+			sum4 = _mm_add_epi32(sum4, best4);
+			sum3 = _mm_add_epi32(sum3, _mm_andnot_si128(transparent, best3));
+		}
+		_mm_storeu_si128((__m128i*)lanes, sum4);
+		_mm_storeu_si128((__m128i*)(lanes + 4), sum3);
+		total4 = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		total3 = lanes[4] + lanes[5] + lanes[6] + lanes[7];
+	}
+#endif
+	for (; i < num_pixels; i++)
+	{
+		const crn_uint8* p = pPixels + i * 4;
+		crn_uint32 d[5], ends;
+		for (int c = 0; c < 4; c++)
+			d[c] = crn_dxt1_distance(p, colors[c], pWeights);
+		d[4] = crn_dxt1_distance(p, mid, pWeights);
+		ends = CRN_MIN(d[0], d[1]);
+		total4 += CRN_MIN(ends, CRN_MIN(d[2], d[3]));
+		if (p[3])
+		{
+			crn_uint32 best3 = CRN_MIN(ends, d[4]);
+			if (black_ok)
+				best3 = CRN_MIN(best3, crn_dxt1_distance(p, s_black, pWeights));
+			total3 += best3;
+		}
+	}
+	*pError4 = total4;
+	*pError3 = total3;
+}
+
+typedef struct
+{
+	crn_uint16 c0, c1;
+	crn_uint32 error;
+} crn_dxt1_solution;
+
+// Best endpoints for a block of one color: per channel, the pair of quantized values whose 2/3 interpolant (or
+// midpoint, in 3 color mode) lands closest to the color, searched in a small neighborhood of the nearest quantized value.
+static void crn_dxt1_fit_single_color(const crn_uint8* pColor, crn_bool three_color, crn_dxt1_solution* pSolution)
+{
+	crn_uint32 q0[3], q1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		const int max_val = (c == 1) ? 63 : 31;
+		const int q = (pColor[c] * max_val + 127) / 255;
+		int best_error = 0x7FFFFFFF;
+		for (int a = CRN_MAX(q - 3, 0); a <= CRN_MIN(q + 3, max_val); a++)
+		{
+			for (int b = CRN_MAX(q - 3, 0); b <= CRN_MIN(q + 3, max_val); b++)
+			{
+				const int ea = (int)((c == 1) ? crn_dxt_expand6((crn_uint32)a) : crn_dxt_expand5((crn_uint32)a));
+				const int eb = (int)((c == 1) ? crn_dxt_expand6((crn_uint32)b) : crn_dxt_expand5((crn_uint32)b));
+				const int error = abs((three_color ? (ea + eb) / 2 : (ea * 2 + eb) / 3) - pColor[c]);
+				if (error < best_error)
+				{
+					best_error = error;
+					q0[c] = (crn_uint32)a;
+					q1[c] = (crn_uint32)b;
+				}
+			}
+		}
+	}
+	pSolution->c0 = crn_dxt_pack565(q0[0], q0[1], q0[2]);
+	pSolution->c1 = crn_dxt_pack565(q1[0], q1[1], q1[2]);
+}
+
+// Bounding box corners inset by 1/16 of the extent. The diagonal is flipped on green and blue where they fall as
+// red (or green, when red is flat) rises.
+static void crn_dxt1_bbox_endpoints(const crn_uint8 pixels[16][4], float* pEndpoints)
+{
+	float mn[3] = { 255.0f, 255.0f, 255.0f }, mx[3] = { 0.0f, 0.0f, 0.0f }, center[3], cov[3] = { 0.0f, 0.0f, 0.0f };
+	crn_bool flip[3];
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mn[c] = CRN_MIN(mn[c], (float)pixels[i][c]);
+			mx[c] = CRN_MAX(mx[c], (float)pixels[i][c]);
+		}
+	}
+	for (int c = 0; c < 3; c++)
+		center[c] = (mn[c] + mx[c]) * 0.5f;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const float r = pixels[i][0] - center[0], g = pixels[i][1] - center[1], b = pixels[i][2] - center[2];
+		cov[0] += r * g;
+		cov[1] += r * b;
+		cov[2] += g * b;
+	}
+	flip[0] = crn_false;
+	flip[1] = cov[0] < 0.0f;
+	flip[2] = (mx[0] > mn[0]) ? (cov[1] < 0.0f) : (cov[2] < 0.0f);
+
+	for (int c = 0; c < 3; c++)
+	{
+		const float inset = (mx[c] - mn[c]) * (1.0f / 16.0f);
+		pEndpoints[c] = flip[c] ? mn[c] + inset : mx[c] - inset;
+		pEndpoints[3 + c] = flip[c] ? mx[c] - inset : mn[c] + inset;
+	}
+}
+
+// Alternates between quantizing the endpoints and refitting them by least squares to the selectors of the quantized
+// colors, for as long as the error keeps falling.
+static void crn_dxt1_iterate_endpoints(const crn_uint8 pixels[16][4], const crn_uint8* pWeights, float* pEndpoints, crn_dxt1_solution* pBest)
+{
+	// Selectors in block order (larger endpoint, smaller endpoint, 2/3, 1/3) to linear selectors from the larger one.
+	static const crn_uint32 s_linear_selectors[4] = { 0, 3, 1, 2 };
+	crn_uint32 prev_error = 0xFFFFFFFF;
+
+	for (int iter = 0; iter < 4; iter++)
+	{
+		const crn_uint16 c0 = crn_dxt_quantize565(pEndpoints), c1 = crn_dxt_quantize565(pEndpoints + 3);
+		const crn_uint32 error = crn_dxt1_eval_endpoints(pixels, c0, c1, pWeights);
+		crn_uint8 colors[4][4];
+		crn_uint32 selectors;
+		crn_dxt1_ls ls;
+
+		if (error >= prev_error)
+			break;
+		prev_error = error;
+		if (error < pBest->error)
+		{
+			pBest->c0 = c0;
+			pBest->c1 = c1;
+			pBest->error = error;
+		}
+		if (c0 == c1 || !error)
+			break;
+
+		crn_dxt1_get_opaque_colors(c0, c1, colors);
+		selectors = crn_dxt1_find_selectors(pixels, (const crn_uint8 (*)[4])colors, pWeights);
+		memset(&ls, 0, sizeof(ls));
+		for (crn_uint32 i = 0; i < 16; i++)
+			crn_dxt1_ls_add(&ls, pixels[i], s_linear_selectors[(selectors >> (i * 2)) & 3], 1.0f);
+		if (!crn_dxt1_ls_solve(&ls, pEndpoints))
+			break;
+	}
+}
+
+// Iterated least squares starting from the principal axis, the bounding box diagonal and the luma axis.
+static void crn_dxt1_search_axes(const crn_uint8 pixels[16][4], const crn_uint8* pWeights, crn_dxt1_solution* pBest)
+{
+	float mean[3], axes[3][3], endpoints[6];
+
+	crn_dxt1_principal_axis(&pixels[0][0], 16, pWeights, mean, axes[0]);
+	crn_dxt1_bbox_endpoints(pixels, endpoints);
+	{
+		const float d[3] = { endpoints[0] - endpoints[3], endpoints[1] - endpoints[4], endpoints[2] - endpoints[5] };
+		const float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		for (int c = 0; c < 3; c++)
+			axes[1][c] = (len > 1e-8f) ? d[c] / len : axes[0][c];
+	}
+	axes[2][0] = 0.2990f / 0.6686f;
+	axes[2][1] = 0.5870f / 0.6686f;
+	axes[2][2] = 0.1140f / 0.6686f;
+
+	for (crn_uint32 a = 0; a < 3; a++)
+	{
+		crn_dxt1_project_endpoints(&pixels[0][0], 16, mean, axes[a], endpoints);
+		crn_dxt1_iterate_endpoints(pixels, pWeights, endpoints, pBest);
+	}
+}
+
+enum
+{
+	cCRNDXT1MaxNeighborhoodPasses = 8
+};
+
+// Hill climbs from the best solution in single 565 steps: each of the six endpoint components alone, and each channel
+// of both endpoints together, in the same or in opposite directions. Every pass moves to the best of those 24
+// neighbors, until none helps or cCRNDXT1MaxNeighborhoodPasses passes have run. In 3 color mode the solution's error
+// is the 3 color error.
+static void crn_dxt1_search_neighborhood(const crn_uint8 pixels[16][4], crn_bool three_color, crn_bool black_ok, const crn_uint8* pWeights, crn_dxt1_solution* pBest)
+{
+	static const int s_max_values[6] = { 31, 63, 31, 31, 63, 31 };
+
+	for (int pass = 0; pass < cCRNDXT1MaxNeighborhoodPasses && pBest->error; pass++)
+	{
+		const crn_dxt1_solution base = *pBest;
+		const int comps[6] = { base.c0 >> 11, (base.c0 >> 5) & 63, base.c0 & 31, base.c1 >> 11, (base.c1 >> 5) & 63, base.c1 & 31 };
+
+		for (int k = 0; k < 24; k++)
+		{
+			// Moves 0-11 step one component, 12-23 step channel k % 3 of both endpoints by the signs in bits 0-1 of k / 3.
+			int v[6];
+			crn_bool valid = crn_true;
+			memcpy(v, comps, sizeof(v));
+			if (k < 12)
+			{
+				v[k >> 1] += (k & 1) ? 1 : -1;
+			}
+			else
+			{
+				const int c = k % 3, signs = k / 3 - 4;
+				v[c] += (signs & 1) ? 1 : -1;
+				v[c + 3] += (signs & 2) ? 1 : -1;
+			}
+			for (int j = 0; j < 6; j++)
+				valid = valid && v[j] >= 0 && v[j] <= s_max_values[j];
+			if (valid)
+			{
+				// Most steps are rejected on the first half of the block alone.
+				const crn_uint16 c0 = crn_dxt_pack565((crn_uint32)v[0], (crn_uint32)v[1], (crn_uint32)v[2]);
+				const crn_uint16 c1 = crn_dxt_pack565((crn_uint32)v[3], (crn_uint32)v[4], (crn_uint32)v[5]);
+				crn_uint8 colors[4][4];
+				crn_uint32 error, rest, error4;
+				if (three_color)
+				{
+					crn_dxt1_dual_error(&pixels[0][0], 8, c0, c1, black_ok, pWeights, &error4, &error);
+				}
+				else
+				{
+					crn_dxt1_get_opaque_colors(c0, c1, colors);
+					error = crn_dxt1_palette_error(&pixels[0][0], 8, (const crn_uint8 (*)[4])colors, pWeights);
+				}
+				if (error < pBest->error)
+				{
+					if (three_color)
+						crn_dxt1_dual_error(&pixels[8][0], 8, c0, c1, black_ok, pWeights, &error4, &rest);
+					else
+						rest = crn_dxt1_palette_error(&pixels[8][0], 8, (const crn_uint8 (*)[4])colors, pWeights);
+					error += rest;
+					if (error < pBest->error)
+					{
+						pBest->c0 = c0;
+						pBest->c1 = c1;
+						pBest->error = error;
+					}
+				}
+			}
+		}
+		if (pBest->error == base.error)
+			break;
+	}
+}
+
+// -------- Cluster fit
+
+// Orders the pixels by their projection onto an axis.
+static void crn_dxt1_sort_pixels(const crn_uint8 pixels[16][4], const float* pAxis, crn_uint8 order[16])
+{
+	float keys[16];
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const float key = pixels[i][0] * pAxis[0] + pixels[i][1] * pAxis[1] + pixels[i][2] * pAxis[2];
+		crn_uint32 j = i;
+		for (; j && keys[j - 1] > key; j--)
+		{
+			keys[j] = keys[j - 1];
+			order[j] = order[j - 1];
+		}
+		keys[j] = key;
+		order[j] = (crn_uint8)i;
+	}
+}
+
+// Prefix sums of the ordered pixels' channels, padded so 4 consecutive sums can be loaded from any split point.
+typedef struct
+{
+	float sums[3][20];
+} crn_dxt1_cluster_sums;
+
+static const float g_crn_dxt1_grid[3] = { 31.0f, 63.0f, 31.0f };
+
+// Least squares endpoints for the split of the ordered pixels into [0, a), [a, b), [b, c) and [c, 16), with
+// interpolation weights 1, 2/3, 1/3 and 0 on the first endpoint. The endpoints are optionally snapped to the 565 grid.
+// Returns the fit's weighted error less the constant weighted sum of squared pixels, or FLT_MAX if the system is singular.
+static float crn_dxt1_cluster_solve(const crn_dxt1_cluster_sums* pSums, int a, int b, int c, crn_bool snap, const crn_uint8* pWeights, float* pEndpoints)
+{
+	const float n1 = (float)(b - a), n2 = (float)(c - b), n3 = (float)(16 - c);
+	const float a2 = (float)a + n1 * (4.0f / 9.0f) + n2 * (1.0f / 9.0f);
+	const float b2 = n3 + n1 * (1.0f / 9.0f) + n2 * (4.0f / 9.0f);
+	const float ab = (n1 + n2) * (2.0f / 9.0f);
+	const float det = a2 * b2 - ab * ab;
+	float error = 0.0f;
+
+	if (det <= 1e-3f)
+		return FLT_MAX;
+	for (int ch = 0; ch < 3; ch++)
+	{
+		const float* s = pSums->sums[ch];
+		const float ax = s[a] + (s[b] - s[a]) * (2.0f / 3.0f) + (s[c] - s[b]) * (1.0f / 3.0f);
+		const float bx = s[16] - ax;
+		float e0 = CRN_CLAMP((ax * b2 - bx * ab) / det, 0.0f, 255.0f);
+		float e1 = CRN_CLAMP((bx * a2 - ax * ab) / det, 0.0f, 255.0f);
+		if (snap)
+		{
+			e0 = (float)(int)(e0 * (g_crn_dxt1_grid[ch] / 255.0f) + 0.5f) * (255.0f / g_crn_dxt1_grid[ch]);
+			e1 = (float)(int)(e1 * (g_crn_dxt1_grid[ch] / 255.0f) + 0.5f) * (255.0f / g_crn_dxt1_grid[ch]);
+		}
+		error += e0 * pWeights[ch] * (e0 * a2 - 2.0f * ax) + e1 * pWeights[ch] * (e1 * b2 - 2.0f * bx) + 2.0f * e0 * pWeights[ch] * e1 * ab;
+		pEndpoints[ch] = e0;
+		pEndpoints[3 + ch] = e1;
+	}
+	return error;
+}
+
+// Tries every ordered split of the pixels into 4 clusters, as squish's cluster fit does, and returns the least squares
+// endpoints of the split with the lowest error on the 565 grid. The SSE2 path solves 4 values of c at once.
+static crn_bool crn_dxt1_cluster_fit(const crn_uint8 pixels[16][4], const crn_uint8 order[16], const crn_uint8* pWeights, float* pEndpoints)
+{
+	crn_dxt1_cluster_sums sums;
+	float best_error = FLT_MAX;
+	int best_a = -1, best_b = 0, best_c = 0;
+
+	for (int ch = 0; ch < 3; ch++)
+	{
+		float* s = sums.sums[ch];
+		s[0] = 0.0f;
+		for (int k = 0; k < 16; k++)
+			s[k + 1] = s[k] + pixels[order[k]][ch];
+		s[17] = s[18] = s[19] = s[16];
+	}
+
+	for (int a = 0; a <= 16; a++)
+	{
+		for (int b = a; b <= 16; b++)
+		{
+#if CRN_SSE2
+			const float n1 = (float)(b - a);
+			const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), sixteen = _mm_set1_ps(16.0f), zero = _mm_setzero_ps();
+			const __m128 max_val = _mm_set1_ps(255.0f), third = _mm_set1_ps(1.0f / 3.0f), two = _mm_set1_ps(2.0f);
+			__m128 ax_base[3];
+			for (int ch = 0; ch < 3; ch++)
+			{
+				const float* s = sums.sums[ch];
+				ax_base[ch] = _mm_set1_ps(s[a] + (s[b] - s[a]) * (2.0f / 3.0f) - s[b] * (1.0f / 3.0f));
+			}
+			for (int c = b; c <= 16; c += 4)
+			{
+				const __m128 cv = _mm_add_ps(_mm_set1_ps((float)c), lane);
+				const __m128 n2 = _mm_sub_ps(cv, _mm_set1_ps((float)b));
+				const __m128 a2 = _mm_add_ps(_mm_set1_ps((float)a + n1 * (4.0f / 9.0f)), _mm_mul_ps(n2, _mm_set1_ps(1.0f / 9.0f)));
+				const __m128 b2 = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(16.0f + n1 * (1.0f / 9.0f)), cv), _mm_mul_ps(n2, _mm_set1_ps(4.0f / 9.0f)));
+				const __m128 ab = _mm_mul_ps(_mm_add_ps(n2, _mm_set1_ps(n1)), _mm_set1_ps(2.0f / 9.0f));
+				const __m128 det = _mm_sub_ps(_mm_mul_ps(a2, b2), _mm_mul_ps(ab, ab));
+				const __m128 valid = _mm_and_ps(_mm_cmple_ps(cv, sixteen), _mm_cmpgt_ps(det, _mm_set1_ps(1e-3f)));
+				const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(valid, det), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+				__m128 error = zero;
+				float errors[4];
+
+				for (int ch = 0; ch < 3; ch++)
+				{
+					const __m128 grid = _mm_set1_ps(g_crn_dxt1_grid[ch] / 255.0f), inv_grid = _mm_set1_ps(255.0f / g_crn_dxt1_grid[ch]);
+					const __m128 weight = _mm_set1_ps((float)pWeights[ch]);
+					const __m128 ax = _mm_add_ps(ax_base[ch], _mm_mul_ps(_mm_loadu_ps(&sums.sums[ch][c]), third));
+					const __m128 bx = _mm_sub_ps(_mm_set1_ps(sums.sums[ch][16]), ax);
+					__m128 e0 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ax, b2), _mm_mul_ps(bx, ab)), inv_det);
+					__m128 e1 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(bx, a2), _mm_mul_ps(ax, ab)), inv_det);
+					__m128 we0, we1;
+					e0 = _mm_min_ps(_mm_max_ps(e0, zero), max_val);
+					e1 = _mm_min_ps(_mm_max_ps(e1, zero), max_val);
+					e0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(e0, grid), _mm_set1_ps(0.5f)))), inv_grid);
+					e1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(e1, grid), _mm_set1_ps(0.5f)))), inv_grid);
+					we0 = _mm_mul_ps(e0, weight);
+					we1 = _mm_mul_ps(e1, weight);
+					error = _mm_add_ps(error, _mm_mul_ps(we0, _mm_sub_ps(_mm_mul_ps(e0, a2), _mm_mul_ps(two, ax))));
+					error = _mm_add_ps(error, _mm_mul_ps(we1, _mm_sub_ps(_mm_mul_ps(e1, b2), _mm_mul_ps(two, bx))));
+					error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(two, we0), _mm_mul_ps(e1, ab)));
+				}
+				error = _mm_or_ps(_mm_and_ps(valid, error), _mm_andnot_ps(valid, _mm_set1_ps(FLT_MAX)));
+				_mm_storeu_ps(errors, error);
+				for (int i = 0; i < 4; i++)
+				{
+					if (errors[i] < best_error)
+					{
+						best_error = errors[i];
+						best_a = a;
+						best_b = b;
+						best_c = c + i;
+					}
+				}
+			}
+#else
+			for (int c = b; c <= 16; c++)
+			{
+				float endpoints[6];
+				const float error = crn_dxt1_cluster_solve(&sums, a, b, c, crn_true, pWeights, endpoints);
+				if (error < best_error)
+				{
+					best_error = error;
+					best_a = a;
+					best_b = b;
+					best_c = c;
+				}
+			}
+#endif
+		}
+	}
+
+	if (best_a < 0)
+		return crn_false;
+	crn_dxt1_cluster_solve(&sums, best_a, best_b, best_c, crn_false, pWeights, pEndpoints);
+	return crn_true;
+}
+
+// Cluster fit starting from the principal axis. Up to num_iters times, the pixels are re-sorted along the fitted
+// endpoints and fitted again, stopping early once the order settles.
+static void crn_dxt1_search_clusters(const crn_uint8 pixels[16][4], crn_uint32 num_iters, const crn_uint8* pWeights, crn_dxt1_solution* pBest)
+{
+	float mean[3], axis[3], endpoints[6];
+	crn_uint8 order[16], prev_order[16];
+
+	crn_dxt1_principal_axis(&pixels[0][0], 16, pWeights, mean, axis);
+	for (crn_uint32 iter = 0; iter < num_iters; iter++)
+	{
+		crn_dxt1_sort_pixels(pixels, axis, order);
+		if (iter && !memcmp(order, prev_order, sizeof(order)))
+			break;
+		if (!crn_dxt1_cluster_fit(pixels, order, pWeights, endpoints))
+			break;
+		memcpy(prev_order, order, sizeof(order));
+		axis[0] = endpoints[3] - endpoints[0];
+		axis[1] = endpoints[4] - endpoints[1];
+		axis[2] = endpoints[5] - endpoints[2];
+		crn_dxt1_iterate_endpoints(pixels, pWeights, endpoints, pBest);
+	}
+}
+
+// Writes a 4 color mode block, with nearest or (much cheaper) projected selectors.
+static void crn_dxt1_write_opaque_block(const crn_uint8 pixels[16][4], crn_uint16 c0, crn_uint16 c1, crn_bool project, const crn_uint8* pWeights, crn_uint8* pDst)
+{
+	const crn_uint16 hi = CRN_MAX(c0, c1), lo = CRN_MIN(c0, c1);
+	crn_uint8 colors[4][4];
+	crn_uint32 selectors;
+
+	crn_dxt1_get_opaque_colors(hi, lo, colors);
+	pDst[0] = (crn_uint8)hi;
+	pDst[1] = (crn_uint8)(hi >> 8);
+	pDst[2] = (crn_uint8)lo;
+	pDst[3] = (crn_uint8)(lo >> 8);
+	if (hi == lo)
+		selectors = 0;
+	else if (project)
+		selectors = crn_dxt1_project_selectors(pixels, (const crn_uint8 (*)[4])colors, pWeights);
+	else
+		selectors = crn_dxt1_find_selectors(pixels, (const crn_uint8 (*)[4])colors, pWeights);
+	crn_write_le32(pDst + 4, selectors);
+}
+
+void crn_dxt1_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags)
+{
+	const crn_uint8* pWeights = crn_dxt1_get_weights(flags);
+	crn_dxt1_solution best;
+	crn_bool single_color = crn_true;
+	float mean[3], axis[3], endpoints[6];
+
+	for (crn_uint32 i = 1; i < 16 && single_color; i++)
+		single_color = pixels[i][0] == pixels[0][0] && pixels[i][1] == pixels[0][1] && pixels[i][2] == pixels[0][2];
+
+	best.c0 = best.c1 = 0;
+	best.error = 0xFFFFFFFF;
+	if (single_color)
+	{
+		crn_dxt1_fit_single_color(pixels[0], crn_false, &best);
+	}
+	else if (quality == cCRNDXTQualitySuperFast)
+	{
+		crn_dxt1_bbox_endpoints(pixels, endpoints);
+		best.c0 = crn_dxt_quantize565(endpoints);
+		best.c1 = crn_dxt_quantize565(endpoints + 3);
+	}
+	else if (quality <= cCRNDXTQualityNormal)
+	{
+		crn_dxt1_principal_axis(&pixels[0][0], 16, pWeights, mean, axis);
+		crn_dxt1_project_endpoints(&pixels[0][0], 16, mean, axis, endpoints);
+		crn_dxt1_refine_endpoints(&pixels[0][0], 16, 1, pWeights, endpoints);
+		best.c0 = crn_dxt_quantize565(endpoints);
+		best.c1 = crn_dxt_quantize565(endpoints + 3);
+		// Normal carries on from Fast's endpoints with the loop stb_dxt runs after its principal axis, on the weighted
+		// error: least squares on the nearest selectors of the quantized colors. Fast's endpoints are scored first, so
+		// Normal never does worse.
+		if (quality == cCRNDXTQualityNormal)
+			crn_dxt1_iterate_endpoints(pixels, pWeights, endpoints, &best);
+	}
+	else if (quality == cCRNDXTQualityBetter)
+	{
+		crn_dxt1_search_axes(pixels, pWeights, &best);
+	}
+	else
+	{
+		crn_dxt1_search_clusters(pixels, 4, pWeights, &best);
+		crn_dxt1_search_neighborhood(pixels, crn_false, crn_false, pWeights, &best);
+	}
+
+	crn_dxt1_write_opaque_block(pixels, best.c0, best.c1, quality <= cCRNDXTQualityFast && !single_color, pWeights, pDst);
+}
+
+// -------- 3 color mode
+
+// 3 color mode selectors for endpoints lo <= hi: the nearest of lo, hi and their midpoint, or 3 for transparent pixels
+// and, if black_ok, pixels nearest to black.
+static crn_uint32 crn_dxt1_find_3color_selectors(const crn_uint8 pixels[16][4], crn_uint16 lo, crn_uint16 hi, crn_bool black_ok, const crn_uint8* pWeights)
+{
+	const crn_uint32 num_colors = black_ok ? 4 : 3;
+	crn_uint8 colors[4][4];
+	crn_uint32 selectors = 0;
+
+	crn_dxt1_get_block_colors(lo, hi, colors);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_uint32 best = 3, best_error = 0xFFFFFFFF;
+		for (crn_uint32 s = 0; s < num_colors && pixels[i][3]; s++)
+		{
+			const crn_uint32 error = crn_dxt1_distance(pixels[i], colors[s], pWeights);
+			if (error < best_error)
+			{
+				best_error = error;
+				best = s;
+			}
+		}
+		selectors |= best << (i * 2);
+	}
+	return selectors;
+}
+
+// One least squares pass for 3 color endpoints lo <= hi. Opaque pixels are assigned by their weighted projection onto
+// the line between the endpoints, rounded to lo, the midpoint or hi, and summed per selector as in crn_dxt1_refine_endpoints().
+// Transparent pixels and (if black_ok) black ones are left out, as in crn_dxt1_encode_3color_block().
+static crn_bool crn_dxt1_refine_3color(const crn_uint8 pixels[16][4], crn_uint16 lo, crn_uint16 hi, crn_bool black_ok, const crn_uint8* pWeights, float* pEndpoints)
+{
+	crn_uint8 colors[4][4];
+	int dir[3], len2;
+	float scale;
+	crn_uint32 counts[3] = { 0, 0, 0 }, sums[3][3];
+	crn_dxt1_ls ls;
+
+	crn_dxt1_get_block_colors(lo, hi, colors);
+	dir[0] = (colors[1][0] - colors[0][0]) * pWeights[0];
+	dir[1] = (colors[1][1] - colors[0][1]) * pWeights[1];
+	dir[2] = (colors[1][2] - colors[0][2]) * pWeights[2];
+	len2 = (colors[1][0] - colors[0][0]) * dir[0] + (colors[1][1] - colors[0][1]) * dir[1] + (colors[1][2] - colors[0][2]) * dir[2];
+	scale = len2 ? 2.0f / (float)len2 : 0.0f;
+
+	memset(sums, 0, sizeof(sums));
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const crn_uint8* p = pixels[i];
+		const int t = (p[0] - colors[0][0]) * dir[0] + (p[1] - colors[0][1]) * dir[1] + (p[2] - colors[0][2]) * dir[2];
+		const float f = (float)t * scale + 0.5f;
+		const int s = (f <= 0.0f) ? 0 : CRN_MIN((int)f, 2);
+		if (!p[3] || (black_ok && !p[0] && !p[1] && !p[2]))
+			continue;
+		counts[s]++;
+		sums[s][0] += p[0];
+		sums[s][1] += p[1];
+		sums[s][2] += p[2];
+	}
+
+	memset(&ls, 0, sizeof(ls));
+	for (crn_uint32 s = 0; s < 3; s++)
+	{
+		const float bw = s * 0.5f, aw = 1.0f - bw, n = (float)counts[s];
+		ls.aa += aw * aw * n;
+		ls.ab += aw * bw * n;
+		ls.bb += bw * bw * n;
+		for (int c = 0; c < 3; c++)
+		{
+			ls.ax[c] += aw * (float)sums[s][c];
+			ls.bx[c] += bw * (float)sums[s][c];
+		}
+	}
+	return crn_dxt1_ls_solve(&ls, pEndpoints);
+}
+
+static void crn_dxt1_update_solutions(const crn_uint8 pixels[16][4], crn_uint16 c0, crn_uint16 c1, crn_bool opaque, crn_bool black_ok, const crn_uint8* pWeights, crn_dxt1_solution* pBest4, crn_dxt1_solution* pBest3)
+{
+	crn_uint32 error4, error3;
+	crn_dxt1_dual_error(&pixels[0][0], 16, c0, c1, black_ok, pWeights, &error4, &error3);
+	if (opaque && error4 < pBest4->error)
+	{
+		pBest4->c0 = c0;
+		pBest4->c1 = c1;
+		pBest4->error = error4;
+	}
+	if (error3 < pBest3->error)
+	{
+		pBest3->c0 = c0;
+		pBest3->c1 = c1;
+		pBest3->error = error3;
+	}
+}
+
+void crn_dxt1_encode_3color_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags)
+{
+	static const crn_uint32 s_num_passes[cCRNDXTQualityTotal] = { 0, 1, 1, 1, 2 };
+	const crn_bool black_ok = (flags & cCRNCompFlagUseTransparentIndicesForBlack) != 0;
+	const crn_uint8* pWeights = crn_dxt1_get_weights(flags);
+	crn_dxt1_solution best4, best3, seed;
+	crn_uint8 fit[16][4];
+	crn_uint32 num_fit = 0, num_transparent = 0;
+	crn_bool single_color = crn_true;
+	float endpoints[6];
+
+	// Transparent pixels and, when they can use selector 3, black ones don't pull on the endpoints.
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		if (!pixels[i][3])
+			num_transparent++;
+		else if (!black_ok || pixels[i][0] || pixels[i][1] || pixels[i][2])
+			memcpy(fit[num_fit++], pixels[i], 4);
+	}
+	for (crn_uint32 i = 1; i < num_fit && single_color; i++)
+		single_color = fit[i][0] == fit[0][0] && fit[i][1] == fit[0][1] && fit[i][2] == fit[0][2];
+
+	best4.c0 = best4.c1 = best3.c0 = best3.c1 = 0;
+	best4.error = best3.error = 0xFFFFFFFF;
+	seed = best4;
+	if (!num_transparent)
+	{
+		// Seed with the opaque block's endpoints. They're usually also a fair start for 3 color mode.
+		const crn_uint16 c0 = (crn_uint16)(pDst[0] | (pDst[1] << 8)), c1 = (crn_uint16)(pDst[2] | (pDst[3] << 8));
+		crn_dxt1_update_solutions(pixels, c0, c1, crn_true, black_ok, pWeights, &best4, &best3);
+		seed = best4;
+	}
+
+	if (!num_fit)
+	{
+		// Transparent or black throughout.
+		best3.c0 = best3.c1 = 0;
+		best3.error = 0;
+	}
+	else if (single_color)
+	{
+		crn_dxt1_solution single;
+		crn_dxt1_fit_single_color(fit[0], crn_true, &single);
+		crn_dxt1_update_solutions(pixels, single.c0, single.c1, !num_transparent, black_ok, pWeights, &best4, &best3);
+	}
+	else
+	{
+		crn_uint16 c0 = seed.c0, c1 = seed.c1;
+		if (num_transparent)
+		{
+			float mean[3], axis[3];
+			crn_dxt1_principal_axis(&fit[0][0], num_fit, pWeights, mean, axis);
+			crn_dxt1_project_endpoints(&fit[0][0], num_fit, mean, axis, endpoints);
+			c0 = crn_dxt_quantize565(endpoints);
+			c1 = crn_dxt_quantize565(endpoints + 3);
+			crn_dxt1_update_solutions(pixels, c0, c1, crn_false, black_ok, pWeights, &best4, &best3);
+		}
+
+		// Least squares over the 3 color selectors, which put the midpoint halfway between the endpoints. One pass from the
+		// opaque endpoints is enough below Uber, and Fast only spends it when 3 color mode already wins at the seed.
+		crn_uint32 num_passes = s_num_passes[quality];
+		if (quality <= cCRNDXTQualityFast && !num_transparent && best3.error >= best4.error)
+			num_passes = 0;
+		for (crn_uint32 pass = 0; pass < num_passes && best3.error; pass++)
+		{
+			const crn_uint32 prev_error = best3.error;
+			if (!crn_dxt1_refine_3color(pixels, CRN_MIN(c0, c1), CRN_MAX(c0, c1), black_ok, pWeights, endpoints))
+				break;
+			c0 = crn_dxt_quantize565(endpoints);
+			c1 = crn_dxt_quantize565(endpoints + 3);
+			crn_dxt1_update_solutions(pixels, c0, c1, !num_transparent, black_ok, pWeights, &best4, &best3);
+			if (best3.error == prev_error)
+				break;
+		}
+
+		// The neighborhood search is only worth its cost when 3 color mode is close.
+		if (quality == cCRNDXTQualityUber && (num_transparent || best3.error < best4.error + best4.error / 4))
+			crn_dxt1_search_neighborhood(pixels, crn_true, black_ok, pWeights, &best3);
+	}
+
+	if (!num_transparent && best4.error <= best3.error)
+	{
+		if (best4.error < seed.error)
+			crn_dxt1_write_opaque_block(pixels, best4.c0, best4.c1, crn_false, pWeights, pDst);
+		return;
+	}
+
+	{
+		const crn_uint16 lo = CRN_MIN(best3.c0, best3.c1), hi = CRN_MAX(best3.c0, best3.c1);
+		pDst[0] = (crn_uint8)lo;
+		pDst[1] = (crn_uint8)(lo >> 8);
+		pDst[2] = (crn_uint8)hi;
+		pDst[3] = (crn_uint8)(hi >> 8);
+		crn_write_le32(pDst + 4, crn_dxt1_find_3color_selectors(pixels, lo, hi, black_ok, pWeights));
+	}
+}
+
+// -------- Luma mode
+//
+// With cCRNCompFlagGrayscaleSampling only the luma of the decoded colors matters, so the endpoint search runs on the
+// pixels' luma alone. Endpoints are then quantized to whichever nearly gray 565 color comes closest in luma: the
+// chroma the 565 grid adds around each gray is what lands the luma between the grid's gray levels. Lumas are Rec. 601
+// in 8.8 fixed point.
+
+static inline int crn_dxt1_luma(const crn_uint8* pColor)
+{
+	return pColor[0] * 77 + pColor[1] * 150 + pColor[2] * 29;
+}
+
+// Lumas of the block's pixels. Gray blocks, the common case for this mode, are detected with one compare per row of
+// pixels and skip the multiplies.
+static void crn_dxt1_get_lumas(const crn_uint8 pixels[16][4], int lumas[16])
+{
+	crn_bool gray = crn_true;
+#if CRN_SSE2
+	// Each pixel's R == G and G == B bytes land in the low 2 bits of its 4 movemask bits.
+	int mask = 0xFFFF;
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)pixels[i * 4]);
+		mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_srli_epi32(v, 8)));
+	}
+	gray = (mask & 0x3333) == 0x3333;
+#else
+	for (crn_uint32 i = 0; i < 16 && gray; i++)
+		gray = pixels[i][0] == pixels[i][1] && pixels[i][1] == pixels[i][2];
+#endif
+	for (crn_uint32 i = 0; i < 16; i++)
+		lumas[i] = gray ? pixels[i][0] << 8 : crn_dxt1_luma(pixels[i]);
+}
+
+// The 565 color with every component within a step of the gray nearest to luma y whose own luma is closest to y.
+static crn_uint16 crn_dxt1_quantize_luma(float y)
+{
+	const float v = CRN_CLAMP(y, 0.0f, 65280.0f) * (1.0f / 256.0f);
+	const int target = (int)(CRN_CLAMP(y, 0.0f, 65280.0f) + 0.5f);
+	const int q5 = (int)(v * (31.0f / 255.0f) + 0.5f), q6 = (int)(v * (63.0f / 255.0f) + 0.5f);
+	crn_uint16 best = 0;
+	int best_error = 0x7FFFFFFF;
+
+	for (int g = CRN_MAX(q6 - 1, 0); g <= CRN_MIN(q6 + 1, 63); g++)
+	{
+		for (int r = CRN_MAX(q5 - 1, 0); r <= CRN_MIN(q5 + 1, 31); r++)
+		{
+			const int rg = (int)crn_dxt_expand5((crn_uint32)r) * 77 + (int)crn_dxt_expand6((crn_uint32)g) * 150;
+			for (int b = CRN_MAX(q5 - 1, 0); b <= CRN_MIN(q5 + 1, 31); b++)
+			{
+				const int error = abs(rg + (int)crn_dxt_expand5((crn_uint32)b) * 29 - target);
+				if (error < best_error)
+				{
+					best_error = error;
+					best = crn_dxt_pack565((crn_uint32)r, (crn_uint32)g, (crn_uint32)b);
+				}
+			}
+		}
+	}
+	return best;
+}
+
+// Squared luma error of the 4 color block of endpoints c0 and c1 (in either order), with each pixel's nearest
+// selector packed into *pSelectors for the block's endpoint order.
+static crn_uint64 crn_dxt1_luma_error(const int lumas[16], crn_uint16 c0, crn_uint16 c1, crn_uint32* pSelectors)
+{
+	crn_uint8 colors[4][4];
+	int palette[4];
+	crn_uint64 total = 0;
+	crn_uint32 selectors = 0;
+
+	crn_dxt1_get_opaque_colors(c0, c1, colors);
+	for (int c = 0; c < 4; c++)
+		palette[c] = crn_dxt1_luma(colors[c]);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		crn_uint32 best = 0, best_error = 0xFFFFFFFF;
+		for (crn_uint32 s = 0; s < 4; s++)
+		{
+			const crn_uint32 error = (crn_uint32)abs(lumas[i] - palette[s]);
+			if (error < best_error)
+			{
+				best_error = error;
+				best = s;
+			}
+		}
+		total += (crn_uint64)best_error * best_error;
+		selectors |= best << (i * 2);
+	}
+	if (pSelectors)
+		*pSelectors = (c0 == c1) ? 0 : selectors;
+	return total;
+}
+
+// Least squares passes on the endpoint lumas pE[0] <= pE[1], each assigning the pixels to the nearest of the 4
+// evenly spaced points between them.
+static void crn_dxt1_refine_luma(const int lumas[16], crn_uint32 num_passes, float* pE)
+{
+	for (crn_uint32 pass = 0; pass < num_passes && pE[1] - pE[0] >= 1.0f; pass++)
+	{
+		const float scale = 3.0f / (pE[1] - pE[0]);
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax = 0.0f, bx = 0.0f, det;
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const float t = CRN_CLAMP(((float)lumas[i] - pE[0]) * scale, 0.0f, 3.0f);
+			const float wb = (float)(int)(t + 0.5f) * (1.0f / 3.0f), wa = 1.0f - wb;
+			aa += wa * wa;
+			ab += wa * wb;
+			bb += wb * wb;
+			ax += wa * (float)lumas[i];
+			bx += wb * (float)lumas[i];
+		}
+		det = aa * bb - ab * ab;
+		if (det < 1e-6f)
+			break;
+		pE[0] = (bb * ax - ab * bx) / det;
+		pE[1] = (aa * bx - ab * ax) / det;
+	}
+}
+
+// Least squares endpoint lumas for the split of the sorted lumas into [0, a), [a, b), [b, c) and [c, 16), which take
+// the points at 0, 1/3, 2/3 and 1, clamped to the luma range. Sums are prefix sums in 8-bit units, where float still
+// resolves the differences between splits. Returns the error less the constant sum of squared lumas, or FLT_MAX if the
+// split puts every pixel on one point.
+static float crn_dxt1_cluster_solve_luma(const float* pSums, int a, int b, int c, float* pE)
+{
+	const float n1 = (float)(b - a), n2 = (float)(c - b), n3 = (float)(16 - c);
+	const float aa = (float)a + n1 * (4.0f / 9.0f) + n2 * (1.0f / 9.0f);
+	const float bb = n3 + n1 * (1.0f / 9.0f) + n2 * (4.0f / 9.0f);
+	const float ab = (n1 + n2) * (2.0f / 9.0f);
+	const float det = aa * bb - ab * ab;
+	const float ax = pSums[a] + (pSums[b] - pSums[a]) * (2.0f / 3.0f) + (pSums[c] - pSums[b]) * (1.0f / 3.0f);
+	const float bx = pSums[16] - ax;
+	float e0, e1;
+
+	if (det <= 1e-3f)
+		return FLT_MAX;
+	e0 = CRN_CLAMP((ax * bb - bx * ab) / det, 0.0f, 255.0f);
+	e1 = CRN_CLAMP((bx * aa - ax * ab) / det, 0.0f, 255.0f);
+	pE[0] = e0 * 256.0f;
+	pE[1] = e1 * 256.0f;
+	return e0 * (e0 * aa - 2.0f * ax) + e1 * (e1 * bb - 2.0f * bx) + 2.0f * e0 * e1 * ab;
+}
+
+// Exact least squares over every split of the sorted lumas into 4 runs, the 1D counterpart of
+// crn_dxt1_cluster_fit(). The SSE2 path solves 4 values of c at once.
+static void crn_dxt1_cluster_fit_luma(const int lumas[16], float* pE)
+{
+	float sorted[16], sums[20];
+	float best_error = FLT_MAX;
+	int best_a = 0, best_b = 0, best_c = 16;
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const float x = (float)lumas[i] * (1.0f / 256.0f);
+		crn_uint32 j = i;
+		for (; j && sorted[j - 1] > x; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = x;
+	}
+	sums[0] = 0.0f;
+	for (crn_uint32 i = 0; i < 16; i++)
+		sums[i + 1] = sums[i] + sorted[i];
+	sums[17] = sums[18] = sums[19] = sums[16];
+
+	for (int a = 0; a <= 16; a++)
+	{
+		for (int b = a; b <= 16; b++)
+		{
+#if CRN_SSE2
+			const float n1 = (float)(b - a);
+			const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), zero = _mm_setzero_ps(), max_val = _mm_set1_ps(255.0f);
+			const __m128 two = _mm_set1_ps(2.0f), total = _mm_set1_ps(sums[16]);
+			const __m128 ax_base = _mm_set1_ps(sums[a] + (sums[b] - sums[a]) * (2.0f / 3.0f) - sums[b] * (1.0f / 3.0f));
+			for (int c = b; c <= 16; c += 4)
+			{
+				const __m128 cv = _mm_add_ps(_mm_set1_ps((float)c), lane);
+				const __m128 n2 = _mm_sub_ps(cv, _mm_set1_ps((float)b));
+				const __m128 aa = _mm_add_ps(_mm_set1_ps((float)a + n1 * (4.0f / 9.0f)), _mm_mul_ps(n2, _mm_set1_ps(1.0f / 9.0f)));
+				const __m128 bb = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(16.0f + n1 * (1.0f / 9.0f)), cv), _mm_mul_ps(n2, _mm_set1_ps(4.0f / 9.0f)));
+				const __m128 ab = _mm_mul_ps(_mm_add_ps(n2, _mm_set1_ps(n1)), _mm_set1_ps(2.0f / 9.0f));
+				const __m128 det = _mm_sub_ps(_mm_mul_ps(aa, bb), _mm_mul_ps(ab, ab));
+				const __m128 valid = _mm_and_ps(_mm_cmple_ps(cv, _mm_set1_ps(16.0f)), _mm_cmpgt_ps(det, _mm_set1_ps(1e-3f)));
+				const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(_mm_and_ps(valid, det), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+				const __m128 ax = _mm_add_ps(ax_base, _mm_mul_ps(_mm_loadu_ps(&sums[c]), _mm_set1_ps(1.0f / 3.0f)));
+				const __m128 bx = _mm_sub_ps(total, ax);
+				const __m128 e0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ax, bb), _mm_mul_ps(bx, ab)), inv_det), zero), max_val);
+				const __m128 e1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(bx, aa), _mm_mul_ps(ax, ab)), inv_det), zero), max_val);
+				__m128 error = _mm_mul_ps(e0, _mm_sub_ps(_mm_mul_ps(e0, aa), _mm_mul_ps(two, ax)));
+				float errors[4];
+				error = _mm_add_ps(error, _mm_mul_ps(e1, _mm_sub_ps(_mm_mul_ps(e1, bb), _mm_mul_ps(two, bx))));
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(two, e0), _mm_mul_ps(e1, ab)));
+				error = _mm_or_ps(_mm_and_ps(valid, error), _mm_andnot_ps(valid, _mm_set1_ps(FLT_MAX)));
+				_mm_storeu_ps(errors, error);
+				for (int i = 0; i < 4; i++)
+				{
+					if (errors[i] < best_error)
+					{
+						best_error = errors[i];
+						best_a = a;
+						best_b = b;
+						best_c = c + i;
+					}
+				}
+			}
+#else
+			for (int c = b; c <= 16; c++)
+			{
+				float e[2];
+				const float error = crn_dxt1_cluster_solve_luma(sums, a, b, c, e);
+				if (error < best_error)
+				{
+					best_error = error;
+					best_a = a;
+					best_b = b;
+					best_c = c;
+				}
+			}
+#endif
+		}
+	}
+
+	// The caller handles blocks of one luma, so some split is always solvable.
+	crn_dxt1_cluster_solve_luma(sums, best_a, best_b, best_c, pE);
+}
+
+// Searches the 565 colors within a step of c0 in each component with c1 fixed, then those around c1 with c0 fixed, and
+// repeats from the result until neither moves or cCRNDXT1MaxNeighborhoodPasses passes have run.
+static void crn_dxt1_search_luma_neighborhood(const int lumas[16], crn_uint16* pC0, crn_uint16* pC1, crn_uint64* pError)
+{
+	static const int s_max_values[3] = { 31, 63, 31 };
+
+	for (int pass = 0; pass < cCRNDXT1MaxNeighborhoodPasses && *pError; pass++)
+	{
+		const crn_uint64 base_error = *pError;
+		for (crn_uint32 e = 0; e < 2 && *pError; e++)
+		{
+			crn_uint16* pC = e ? pC1 : pC0;
+			const crn_uint16 base = *pC, other = e ? *pC0 : *pC1;
+			const int q[3] = { base >> 11, (base >> 5) & 63, base & 31 };
+			for (int d = 0; d < 27; d++)
+			{
+				const int v[3] = { q[0] + d % 3 - 1, q[1] + (d / 3) % 3 - 1, q[2] + d / 9 - 1 };
+				if (d != 13 && v[0] >= 0 && v[0] <= s_max_values[0] && v[1] >= 0 && v[1] <= s_max_values[1] && v[2] >= 0 && v[2] <= s_max_values[2])
+				{
+					const crn_uint16 c = crn_dxt_pack565((crn_uint32)v[0], (crn_uint32)v[1], (crn_uint32)v[2]);
+					const crn_uint64 error = crn_dxt1_luma_error(lumas, c, other, NULL);
+					if (error < *pError)
+					{
+						*pError = error;
+						*pC = c;
+					}
+				}
+			}
+		}
+		if (*pError == base_error)
+			break;
+	}
+}
+
+void crn_dxt1_encode_luma_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality)
+{
+	static const crn_uint32 s_num_passes[cCRNDXTQualityTotal] = { 0, 1, 2, 0, 0 };
+	int lumas[16], mn = 0x7FFFFFFF, mx = 0;
+	crn_uint16 c0, c1;
+	crn_uint32 selectors;
+
+	crn_dxt1_get_lumas(pixels, lumas);
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		mn = CRN_MIN(mn, lumas[i]);
+		mx = CRN_MAX(mx, lumas[i]);
+	}
+
+	if (mn == mx)
+	{
+		crn_dxt1_solution single;
+		crn_dxt1_fit_single_color(pixels[0], crn_false, &single);
+		c0 = single.c0;
+		c1 = single.c1;
+	}
+	else
+	{
+		const float inset = (float)(mx - mn) * (1.0f / 16.0f);
+		float e[2] = { (float)mn + inset, (float)mx - inset };
+		if (quality >= cCRNDXTQualityBetter)
+			crn_dxt1_cluster_fit_luma(lumas, e);
+		else
+			crn_dxt1_refine_luma(lumas, s_num_passes[quality], e);
+		c0 = crn_dxt1_quantize_luma(e[0]);
+		c1 = crn_dxt1_quantize_luma(e[1]);
+	}
+
+	if (quality == cCRNDXTQualityUber)
+	{
+		crn_uint64 error = crn_dxt1_luma_error(lumas, c0, c1, NULL);
+		crn_dxt1_search_luma_neighborhood(lumas, &c0, &c1, &error);
+	}
+
+	{
+		const crn_uint16 hi = CRN_MAX(c0, c1), lo = CRN_MIN(c0, c1);
+		crn_dxt1_luma_error(lumas, hi, lo, &selectors);
+		pDst[0] = (crn_uint8)hi;
+		pDst[1] = (crn_uint8)(hi >> 8);
+		pDst[2] = (crn_uint8)lo;
+		pDst[3] = (crn_uint8)(lo >> 8);
+		crn_write_le32(pDst + 4, selectors);
+	}
+}
+
+// -------- DXT3 alpha
+
+void crn_dxt3_encode_alpha_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_bool dither)
+{
+	if (dither)
+	{
+		// Floyd-Steinberg within the block; error leaving the block is dropped.
+		float error[16] = { 0 };
+		memset(pDst, 0, 8);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const crn_uint32 x = i & 3, y = i >> 2;
+			const float v = CRN_CLAMP((float)pixels[i][3] + error[i], 0.0f, 255.0f);
+			const crn_uint32 q = CRN_MIN((crn_uint32)(v * (1.0f / 17.0f) + 0.5f), 15U);
+			const float e = v - (float)(q * 17);
+			pDst[i >> 1] |= (crn_uint8)(q << ((i & 1) * 4));
+			if (x < 3)
+				error[i + 1] += e * (7.0f / 16.0f);
+			if (y < 3)
+			{
+				if (x > 0)
+					error[i + 3] += e * (3.0f / 16.0f);
+				error[i + 4] += e * (5.0f / 16.0f);
+				if (x < 3)
+					error[i + 5] += e * (1.0f / 16.0f);
+			}
+		}
+		return;
+	}
+
+#if CRN_SSE2
+	{
+		// round(a * 15 / 255) = (a + 8) / 17, and x / 17 = (x * 3856) >> 16 for x < 264.
+		const __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)pixels[0]), 24);
+		const __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)pixels[4]), 24);
+		const __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)pixels[8]), 24);
+		const __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)pixels[12]), 24);
+		const __m128i bias = _mm_set1_epi16(8), recip = _mm_set1_epi16(3856);
+		const __m128i q_lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_packs_epi32(a0, a1), bias), recip);
+		const __m128i q_hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_packs_epi32(a2, a3), bias), recip);
+
+		// Each 16-bit lane of the packed bytes holds an even and an odd pixel: fold them into one byte.
+		const __m128i pairs = _mm_packus_epi16(q_lo, q_hi);
+		const __m128i nibbles = _mm_or_si128(_mm_and_si128(pairs, _mm_set1_epi16(0x0F)), _mm_and_si128(_mm_srli_epi16(pairs, 4), _mm_set1_epi16(0xF0)));
+		_mm_storel_epi64((__m128i*)pDst, _mm_packus_epi16(nibbles, nibbles));
+	}
+#else
+	for (crn_uint32 i = 0; i < 8; i++)
+		pDst[i] = (crn_uint8)(((pixels[i * 2][3] + 8) / 17) | (((pixels[i * 2 + 1][3] + 8) / 17) << 4));
+#endif
+}
+
+// -------- DXT5 alpha
+
+crn_bool crn_dxt5_is_binary_alpha(const crn_uint8 pixels[16][4], crn_uint32 channel)
+{
+	for (crn_uint32 i = 0; i < 16; i++)
+		if (pixels[i][channel] && pixels[i][channel] != 255)
+			return crn_false;
+	return crn_true;
+}
+
+void crn_dxt5_encode_binary_alpha_block(const crn_uint8 pixels[16][4], crn_uint32 channel, crn_uint8* pDst)
+{
+	// Endpoints 255 > 0 select 8 value mode, where selector 0 is 255 and selector 1 is 0.
+	crn_uint64 selectors = 0;
+	for (crn_uint32 i = 0; i < 16; i++)
+		selectors |= (crn_uint64)(pixels[i][channel] == 0) << (i * 3);
+	pDst[0] = 255;
+	pDst[1] = 0;
+	for (crn_uint32 i = 0; i < 6; i++)
+		pDst[2 + i] = (crn_uint8)(selectors >> (i * 8));
+}
@@ -0,0 +1,111 @@
+// File: crn_dxt.h - DXTn block helpers: endpoint packing, palette evaluation and endpoint fitting.
+#ifndef CRN_DXT_H
+#define CRN_DXT_H
+
+#include "crnlib.h"
+
+static inline crn_uint32 crn_dxt_expand5(crn_uint32 v) { return (v << 3) | (v >> 2); }
+static inline crn_uint32 crn_dxt_expand6(crn_uint32 v) { return (v << 2) | (v >> 4); }
+
+static inline crn_uint16 crn_dxt_pack565(crn_uint32 r, crn_uint32 g, crn_uint32 b)
+{
+	return (crn_uint16)((r << 11) | (g << 5) | b);
+}
+
+// Weights of the R, G and B squared errors the DXT1 encoders minimize, in sixteenths. With cCRNCompFlagPerceptual
+// they follow the channels' Rec. 601 luma contributions, otherwise every channel counts the same. Either way they sum
+// to 48, so weighted errors scaled back by 16 stay comparable with plain RGB errors.
+static inline const crn_uint8* crn_dxt1_get_weights(crn_uint32 flags)
+{
+	static const crn_uint8 s_weights[2][3] = { { 16, 16, 16 }, { 14, 28, 6 } };
+	return s_weights[(flags & cCRNCompFlagPerceptual) != 0];
+}
+
+// Unpacks a 565 color to 8-bit RGB(A=255) using bit replication.
+void crn_dxt_unpack565(crn_uint16 c, crn_uint8* pRGBA);
+
+// Quantizes an 8-bit scaled float RGB color to the nearest 565 color.
+crn_uint16 crn_dxt_quantize565(const float* pRGB);
+
+// Evaluates the 4 colors of a DXT1 block in DXT selector order, including 3 color (c0 <= c1) mode.
+void crn_dxt1_get_block_colors(crn_uint16 c0, crn_uint16 c1, crn_uint8 colors[4][4]);
+
+// Evaluates the 8 values of a DXT5 alpha block in DXT selector order.
+void crn_dxt5_get_block_values(crn_uint32 a0, crn_uint32 a1, crn_uint8 values[8]);
+
+// Sum of weighted squared RGB errors of RGBA pixels against the nearest of 4 block colors, scaled back by 16.
+crn_uint32 crn_dxt1_color_error(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8 colors[4][4], const crn_uint8* pWeights);
+
+// Sum of squared errors of one channel of RGBA pixels against the nearest of 8 block values.
+crn_uint32 crn_dxt5_alpha_error(const crn_uint8* pPixels, crn_uint32 num_pixels, crn_uint32 channel, const crn_uint8 values[8]);
+
+// Fits 4 color mode DXT1 endpoints to an arbitrary number of RGBA pixels (principal axis of the weighted colors followed
+// by least squares). pEndpoints receives two unquantized RGB colors, ordered so the first one quantizes to the larger
+// 565 value.
+void crn_dxt1_fit_endpoints(const crn_uint8* pPixels, crn_uint32 num_pixels, const crn_uint8* pWeights, float* pEndpoints);
+
+// Least squares fit of color endpoints to pixels with fixed linear selectors (0=first endpoint, 3=second endpoint).
+// Accumulate with crn_dxt1_ls_add() and solve with crn_dxt1_ls_solve(), which fails if the system is singular.
+typedef struct
+{
+	float aa, ab, bb;
+	float ax[3], bx[3];
+} crn_dxt1_ls;
+
+static inline void crn_dxt1_ls_add(crn_dxt1_ls* pLS, const crn_uint8* pPixel, crn_uint32 linear_selector, float weight)
+{
+	const float b = linear_selector * (1.0f / 3.0f), a = 1.0f - b;
+	pLS->aa += a * a * weight;
+	pLS->ab += a * b * weight;
+	pLS->bb += b * b * weight;
+	for (int c = 0; c < 3; c++)
+	{
+		pLS->ax[c] += a * pPixel[c] * weight;
+		pLS->bx[c] += b * pPixel[c] * weight;
+	}
+}
+
+crn_bool crn_dxt1_ls_solve(const crn_dxt1_ls* pLS, float* pEndpoints);
+
+// Encodes the RGB of 16 RGBA pixels to an 8 byte 4 color mode DXT1 block, minimizing the error weighted by
+// crn_dxt1_get_weights(flags). Blocks of a single color get the closest interpolated color; otherwise the quality tier
+// selects the endpoint search:
+//  SuperFast: inset bounding box corners.
+//  Fast:      principal axis extents and one least squares pass.
+//  Normal:    Fast's endpoints, then least squares iterated on quantized selectors for as long as the error falls.
+//  Better:    least squares iterated on quantized selectors, from the principal, bounding box and luma axes.
+//  Uber:      iterated cluster fit (every ordered 4 cluster split of the pixels), followed by a bounded hill climb
+//             over +-1 steps of the 565 endpoint components.
+void crn_dxt1_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags);
+
+// 3 color (DXT1A) mode search: the two endpoints, their midpoint and selector 3 for transparent black. Pixels with A=0
+// are transparent and always get selector 3; with cCRNCompFlagUseTransparentIndicesForBlack in flags, opaque pixels
+// may use it for black too. Blocks with transparent pixels are encoded from scratch. Otherwise pDst must hold an
+// opaque block of the same pixels (from any encoder), which seeds the search and is only replaced by a block of
+// lower error, weighted by crn_dxt1_get_weights(flags). Every candidate is evaluated in both modes at once, so better
+// 4 color endpoints found on the way are kept as well. Below Uber the search is one least squares pass from the
+// opaque endpoints (none at SuperFast, and at Fast only if 3 color mode already wins with them); Uber runs two and also
+// searches the 565 neighborhood when 3 color mode comes close.
+void crn_dxt1_encode_3color_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags);
+
+// Encodes the RGB of 16 RGBA pixels to an 8 byte 4 color mode DXT1 block for cCRNCompFlagGrayscaleSampling, minimizing
+// only the error in Rec. 601 luma. The endpoint search is one dimensional, over the pixels' luma:
+//  SuperFast: inset luma extents.
+//  Fast:      inset extents and one least squares pass.
+//  Normal:    inset extents and 2 least squares passes.
+//  Better:    exact least squares over every split of the sorted lumas into 4 runs.
+//  Uber:      as Better, followed by bounded alternating searches of the +-1 steps around each endpoint.
+// Endpoints are quantized to the nearly gray 565 color closest in luma, so blocks may carry some chroma.
+void crn_dxt1_encode_luma_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality);
+
+// Encodes the A of 16 RGBA pixels to the 8 byte explicit 4-bit alpha half of a DXT3 block, rounding each pixel to the
+// nearest level. With dither, the rounding error is diffused to the pixels right of and below each one instead.
+void crn_dxt3_encode_alpha_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_bool dither);
+
+// True if channel of every pixel is 0 or 255.
+crn_bool crn_dxt5_is_binary_alpha(const crn_uint8 pixels[16][4], crn_uint32 channel);
+
+// Encodes a channel that is only ever 0 or 255 to an 8 byte DXT5 alpha block, exactly and without an endpoint search.
+void crn_dxt5_encode_binary_alpha_block(const crn_uint8 pixels[16][4], crn_uint32 channel, crn_uint8* pDst);
+
+#endif // CRN_DXT_H
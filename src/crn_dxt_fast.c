@@ -0,0 +1,311 @@
+#include "crn_dxt_fast.h"
+#include "crn_core.h"
+#include "crn_dxt.h"
+
+// Endpoint pairs whose 2/3 interpolant exactly (or most closely) reproduces each 8-bit value, preferring the pair
+// with the smallest spread so other decoders' rounding stays close.
+static const crn_uint8 g_crn_dxt_fast_match5[256][2] =
+{
+	{ 0, 0 }, { 0, 0 }, { 0, 1 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 1, 0 }, { 1, 1 },
+	{ 1, 1 }, { 1, 1 }, { 1, 2 }, { 0, 4 }, { 2, 1 }, { 2, 1 }, { 2, 1 }, { 2, 2 },
+	{ 2, 2 }, { 2, 2 }, { 2, 3 }, { 1, 5 }, { 3, 2 }, { 3, 2 }, { 4, 0 }, { 3, 3 },
+	{ 3, 3 }, { 3, 3 }, { 3, 4 }, { 3, 4 }, { 3, 4 }, { 3, 5 }, { 4, 3 }, { 4, 3 },
+	{ 3, 6 }, { 4, 4 }, { 4, 4 }, { 4, 5 }, { 4, 5 }, { 5, 4 }, { 5, 4 }, { 5, 4 },
+	{ 6, 3 }, { 5, 5 }, { 5, 5 }, { 5, 6 }, { 4, 8 }, { 6, 5 }, { 6, 5 }, { 6, 5 },
+	{ 6, 6 }, { 6, 6 }, { 6, 6 }, { 6, 7 }, { 5, 9 }, { 7, 6 }, { 7, 6 }, { 8, 4 },
+	{ 7, 7 }, { 7, 7 }, { 7, 7 }, { 7, 8 }, { 7, 8 }, { 7, 8 }, { 7, 9 }, { 8, 7 },
+	{ 8, 7 }, { 7, 10 }, { 8, 8 }, { 8, 8 }, { 8, 9 }, { 8, 9 }, { 9, 8 }, { 9, 8 },
+	{ 9, 8 }, { 10, 7 }, { 9, 9 }, { 9, 9 }, { 9, 10 }, { 8, 12 }, { 10, 9 }, { 10, 9 },
+	{ 10, 9 }, { 10, 10 }, { 10, 10 }, { 10, 10 }, { 10, 11 }, { 9, 13 }, { 11, 10 }, { 11, 10 },
+	{ 12, 8 }, { 11, 11 }, { 11, 11 }, { 11, 11 }, { 11, 12 }, { 11, 12 }, { 11, 12 }, { 11, 13 },
+	{ 12, 11 }, { 12, 11 }, { 11, 14 }, { 12, 12 }, { 12, 12 }, { 12, 13 }, { 12, 13 }, { 13, 12 },
+	{ 13, 12 }, { 13, 12 }, { 14, 11 }, { 13, 13 }, { 13, 13 }, { 13, 14 }, { 12, 16 }, { 14, 13 },
+	{ 14, 13 }, { 14, 13 }, { 14, 14 }, { 14, 14 }, { 14, 14 }, { 14, 15 }, { 13, 17 }, { 15, 14 },
+	{ 15, 14 }, { 16, 12 }, { 15, 15 }, { 15, 15 }, { 15, 15 }, { 15, 16 }, { 15, 16 }, { 15, 16 },
+	{ 15, 17 }, { 16, 15 }, { 16, 15 }, { 15, 18 }, { 16, 16 }, { 16, 16 }, { 16, 17 }, { 16, 17 },
+	{ 17, 16 }, { 17, 16 }, { 17, 16 }, { 18, 15 }, { 17, 17 }, { 17, 17 }, { 17, 18 }, { 16, 20 },
+	{ 18, 17 }, { 18, 17 }, { 18, 17 }, { 18, 18 }, { 18, 18 }, { 18, 18 }, { 18, 19 }, { 17, 21 },
+	{ 19, 18 }, { 19, 18 }, { 20, 16 }, { 19, 19 }, { 19, 19 }, { 19, 19 }, { 19, 20 }, { 19, 20 },
+	{ 19, 20 }, { 19, 21 }, { 20, 19 }, { 20, 19 }, { 19, 22 }, { 20, 20 }, { 20, 20 }, { 20, 21 },
+	{ 20, 21 }, { 21, 20 }, { 21, 20 }, { 21, 20 }, { 22, 19 }, { 21, 21 }, { 21, 21 }, { 21, 22 },
+	{ 20, 24 }, { 22, 21 }, { 22, 21 }, { 22, 21 }, { 22, 22 }, { 22, 22 }, { 22, 22 }, { 22, 23 },
+	{ 21, 25 }, { 23, 22 }, { 23, 22 }, { 24, 20 }, { 23, 23 }, { 23, 23 }, { 23, 23 }, { 23, 24 },
+	{ 23, 24 }, { 23, 24 }, { 23, 25 }, { 24, 23 }, { 24, 23 }, { 23, 26 }, { 24, 24 }, { 24, 24 },
+	{ 24, 25 }, { 24, 25 }, { 25, 24 }, { 25, 24 }, { 25, 24 }, { 26, 23 }, { 25, 25 }, { 25, 25 },
+	{ 25, 26 }, { 24, 28 }, { 26, 25 }, { 26, 25 }, { 26, 25 }, { 26, 26 }, { 26, 26 }, { 26, 26 },
+	{ 26, 27 }, { 25, 29 }, { 27, 26 }, { 27, 26 }, { 28, 24 }, { 27, 27 }, { 27, 27 }, { 27, 27 },
+	{ 27, 28 }, { 27, 28 }, { 27, 28 }, { 27, 29 }, { 28, 27 }, { 28, 27 }, { 27, 30 }, { 28, 28 },
+	{ 28, 28 }, { 28, 29 }, { 28, 29 }, { 29, 28 }, { 29, 28 }, { 29, 28 }, { 30, 27 }, { 29, 29 },
+	{ 29, 29 }, { 29, 30 }, { 29, 30 }, { 30, 29 }, { 30, 29 }, { 30, 29 }, { 30, 30 }, { 30, 30 },
+	{ 30, 30 }, { 30, 31 }, { 30, 31 }, { 31, 30 }, { 31, 30 }, { 31, 30 }, { 31, 31 }, { 31, 31 }
+};
+
+static const crn_uint8 g_crn_dxt_fast_match6[256][2] =
+{
+	{ 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 1, 2 }, { 2, 1 }, { 2, 2 },
+	{ 2, 2 }, { 2, 3 }, { 3, 2 }, { 3, 3 }, { 3, 3 }, { 3, 4 }, { 4, 3 }, { 4, 4 },
+	{ 4, 4 }, { 4, 5 }, { 5, 4 }, { 5, 5 }, { 5, 5 }, { 5, 6 }, { 6, 5 }, { 0, 17 },
+	{ 6, 6 }, { 6, 7 }, { 7, 6 }, { 2, 16 }, { 7, 7 }, { 7, 8 }, { 8, 7 }, { 3, 17 },
+	{ 8, 8 }, { 8, 9 }, { 9, 8 }, { 5, 16 }, { 9, 9 }, { 9, 10 }, { 10, 9 }, { 6, 17 },
+	{ 10, 10 }, { 10, 11 }, { 11, 10 }, { 8, 16 }, { 11, 11 }, { 11, 12 }, { 12, 11 }, { 9, 17 },
+	{ 12, 12 }, { 12, 13 }, { 13, 12 }, { 11, 16 }, { 13, 13 }, { 13, 14 }, { 14, 13 }, { 12, 17 },
+	{ 14, 14 }, { 14, 15 }, { 15, 14 }, { 14, 16 }, { 15, 15 }, { 15, 16 }, { 16, 14 }, { 16, 15 },
+	{ 15, 18 }, { 16, 16 }, { 16, 17 }, { 17, 16 }, { 18, 15 }, { 17, 17 }, { 17, 18 }, { 18, 17 },
+	{ 20, 14 }, { 18, 18 }, { 18, 19 }, { 19, 18 }, { 21, 15 }, { 19, 19 }, { 19, 20 }, { 20, 19 },
+	{ 23, 14 }, { 20, 20 }, { 20, 21 }, { 21, 20 }, { 24, 15 }, { 21, 21 }, { 21, 22 }, { 22, 21 },
+	{ 26, 14 }, { 22, 22 }, { 22, 23 }, { 23, 22 }, { 27, 15 }, { 23, 23 }, { 23, 24 }, { 24, 23 },
+	{ 19, 33 }, { 24, 24 }, { 24, 25 }, { 25, 24 }, { 21, 32 }, { 25, 25 }, { 25, 26 }, { 26, 25 },
+	{ 22, 33 }, { 26, 26 }, { 26, 27 }, { 27, 26 }, { 24, 32 }, { 27, 27 }, { 27, 28 }, { 28, 27 },
+	{ 25, 33 }, { 28, 28 }, { 28, 29 }, { 29, 28 }, { 27, 32 }, { 29, 29 }, { 29, 30 }, { 30, 29 },
+	{ 28, 33 }, { 30, 30 }, { 30, 31 }, { 31, 30 }, { 30, 32 }, { 31, 31 }, { 31, 32 }, { 32, 30 },
+	{ 32, 31 }, { 31, 34 }, { 32, 32 }, { 32, 33 }, { 33, 32 }, { 34, 31 }, { 33, 33 }, { 33, 34 },
+	{ 34, 33 }, { 36, 30 }, { 34, 34 }, { 34, 35 }, { 35, 34 }, { 37, 31 }, { 35, 35 }, { 35, 36 },
+	{ 36, 35 }, { 39, 30 }, { 36, 36 }, { 36, 37 }, { 37, 36 }, { 40, 31 }, { 37, 37 }, { 37, 38 },
+	{ 38, 37 }, { 42, 30 }, { 38, 38 }, { 38, 39 }, { 39, 38 }, { 43, 31 }, { 39, 39 }, { 39, 40 },
+	{ 40, 39 }, { 35, 49 }, { 40, 40 }, { 40, 41 }, { 41, 40 }, { 37, 48 }, { 41, 41 }, { 41, 42 },
+	{ 42, 41 }, { 38, 49 }, { 42, 42 }, { 42, 43 }, { 43, 42 }, { 40, 48 }, { 43, 43 }, { 43, 44 },
+	{ 44, 43 }, { 41, 49 }, { 44, 44 }, { 44, 45 }, { 45, 44 }, { 43, 48 }, { 45, 45 }, { 45, 46 },
+	{ 46, 45 }, { 44, 49 }, { 46, 46 }, { 46, 47 }, { 47, 46 }, { 46, 48 }, { 47, 47 }, { 47, 48 },
+	{ 48, 46 }, { 48, 47 }, { 47, 50 }, { 48, 48 }, { 48, 49 }, { 49, 48 }, { 50, 47 }, { 49, 49 },
+	{ 49, 50 }, { 50, 49 }, { 52, 46 }, { 50, 50 }, { 50, 51 }, { 51, 50 }, { 53, 47 }, { 51, 51 },
+	{ 51, 52 }, { 52, 51 }, { 55, 46 }, { 52, 52 }, { 52, 53 }, { 53, 52 }, { 56, 47 }, { 53, 53 },
+	{ 53, 54 }, { 54, 53 }, { 58, 46 }, { 54, 54 }, { 54, 55 }, { 55, 54 }, { 59, 47 }, { 55, 55 },
+	{ 55, 56 }, { 56, 55 }, { 61, 46 }, { 56, 56 }, { 56, 57 }, { 57, 56 }, { 62, 47 }, { 57, 57 },
+	{ 57, 58 }, { 58, 57 }, { 58, 58 }, { 58, 58 }, { 58, 59 }, { 59, 58 }, { 59, 59 }, { 59, 59 },
+	{ 59, 60 }, { 60, 59 }, { 60, 60 }, { 60, 60 }, { 60, 61 }, { 61, 60 }, { 61, 61 }, { 61, 61 },
+	{ 61, 62 }, { 62, 61 }, { 62, 62 }, { 62, 62 }, { 62, 63 }, { 63, 62 }, { 63, 63 }, { 63, 63 }
+};
+
+// Linear selectors (0 = first endpoint, 3 = second) to block selectors when the first endpoint is stored first.
+static const crn_uint32 g_crn_dxt_fast_block_selectors[4] = { 0, 2, 3, 1 };
+
+// Least squares weights of each linear selector s, (3 - s)^2, (3 - s) * s and s^2, packed 8 bits apart so all
+// 16 pixels' contributions sum in one integer.
+static const crn_uint32 g_crn_dxt_fast_ls_weights[4] = { 9, 4 | (2 << 8) | (1 << 16), 1 | (2 << 8) | (4 << 16), 9 << 16 };
+
+// Power iterations for the principal axis and the most least squares passes of each crn_dxt_quality tier.
+static const crn_uint32 g_crn_dxt_fast_iterations[cCRNDXTQualityTotal] = { 2, 4, 6, 8, 12 };
+static const crn_uint32 g_crn_dxt_fast_passes[cCRNDXTQualityTotal] = { 1, 1, 2, 3, 4 };
+
+static int crn_dxt_fast_quantize(int v, int max_val)
+{
+	return (v * max_val + 127) / 255;
+}
+
+static crn_uint16 crn_dxt_fast_quantize565(const int* pColor)
+{
+	return crn_dxt_pack565((crn_uint32)crn_dxt_fast_quantize(pColor[0], 31), (crn_uint32)crn_dxt_fast_quantize(pColor[1], 63),
+		(crn_uint32)crn_dxt_fast_quantize(pColor[2], 31));
+}
+
+static void crn_dxt_fast_write_block(crn_uint16 c0, crn_uint16 c1, crn_uint32 selectors, crn_uint8* pDst)
+{
+	pDst[0] = (crn_uint8)c0;
+	pDst[1] = (crn_uint8)(c0 >> 8);
+	pDst[2] = (crn_uint8)c1;
+	pDst[3] = (crn_uint8)(c1 >> 8);
+	crn_write_le32(pDst + 4, selectors);
+}
+
+// Encodes one color with every pixel on the match tables' 2/3 interpolant.
+static void crn_dxt_fast_write_single_color(const crn_uint8* pColor, crn_uint8* pDst)
+{
+	const crn_uint16 c0 = crn_dxt_pack565(g_crn_dxt_fast_match5[pColor[0]][0], g_crn_dxt_fast_match6[pColor[1]][0], g_crn_dxt_fast_match5[pColor[2]][0]);
+	const crn_uint16 c1 = crn_dxt_pack565(g_crn_dxt_fast_match5[pColor[0]][1], g_crn_dxt_fast_match6[pColor[1]][1], g_crn_dxt_fast_match5[pColor[2]][1]);
+	if (c0 >= c1)
+		crn_dxt_fast_write_block(c0, c1, (c0 == c1) ? 0 : 0xAAAAAAAAU, pDst);
+	else
+		crn_dxt_fast_write_block(c1, c0, 0xFFFFFFFFU, pDst);
+}
+
+// Linear selectors of the pixels along the line from e0 to e1, from comparisons of their weighted projections against
+// the midpoints of the projections of the four colors the decoder interpolates. Returns them packed 2 bits apart, the
+// first pixel lowest.
+static crn_uint32 crn_dxt_fast_selectors(const crn_uint8 pixels[16][4], const int* e0, const int* e1, const crn_uint8* pWeights, crn_uint8 selectors[16])
+{
+	const int dir[3] = { (e1[0] - e0[0]) * pWeights[0], (e1[1] - e0[1]) * pWeights[1], (e1[2] - e0[2]) * pWeights[2] };
+	const int origin = e0[0] * dir[0] + e0[1] * dir[1] + e0[2] * dir[2];
+	const int t1 = ((2 * e0[0] + e1[0]) / 3) * dir[0] + ((2 * e0[1] + e1[1]) / 3) * dir[1] + ((2 * e0[2] + e1[2]) / 3) * dir[2] - origin;
+	const int t2 = ((e0[0] + 2 * e1[0]) / 3) * dir[0] + ((e0[1] + 2 * e1[1]) / 3) * dir[1] + ((e0[2] + 2 * e1[2]) / 3) * dir[2] - origin;
+	const int t3 = e1[0] * dir[0] + e1[1] * dir[1] + e1[2] * dir[2] - origin;
+	crn_uint32 linear = 0;
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const int t = (pixels[i][0] * dir[0] + pixels[i][1] * dir[1] + pixels[i][2] * dir[2] - origin) * 2;
+		const crn_uint32 s = (crn_uint32)(t >= t1) + (t >= t1 + t2) + (t >= t2 + t3);
+		selectors[i] = (crn_uint8)s;
+		linear |= s << (i * 2);
+	}
+	return linear;
+}
+
+// Rounds one channel of least squares endpoints down or up on the 5 or 6 bit grid, picking the combination with the
+// least error over the pixels given their per-selector counts and sums. Returns the expanded 8-bit values.
+static void crn_dxt_fast_round_endpoints(float e0, float e1, int max_val, const int counts[4], const int sums[4], int* pE0, int* pE1)
+{
+	const int b0 = (int)(CRN_CLAMP(e0, 0.0f, 255.0f) * max_val * (1.0f / 255.0f));
+	const int b1 = (int)(CRN_CLAMP(e1, 0.0f, 255.0f) * max_val * (1.0f / 255.0f));
+	int best_error = 0x7FFFFFFF;
+	for (int k = 0; k < 4; k++)
+	{
+		const int q0 = CRN_MIN(b0 + (k & 1), max_val), q1 = CRN_MIN(b1 + (k >> 1), max_val);
+		const int x0 = (max_val == 63) ? ((q0 << 2) | (q0 >> 4)) : ((q0 << 3) | (q0 >> 2));
+		const int x1 = (max_val == 63) ? ((q1 << 2) | (q1 >> 4)) : ((q1 << 3) | (q1 >> 2));
+		const int p1 = (2 * x0 + x1) / 3, p2 = (x0 + 2 * x1) / 3;
+		const int error = x0 * (counts[0] * x0 - 2 * sums[0]) + p1 * (counts[1] * p1 - 2 * sums[1]) + p2 * (counts[2] * p2 - 2 * sums[2]) +
+			x1 * (counts[3] * x1 - 2 * sums[3]);
+		*pE0 = (error < best_error) ? x0 : *pE0;
+		*pE1 = (error < best_error) ? x1 : *pE1;
+		best_error = CRN_MIN(best_error, error);
+	}
+}
+
+void crn_dxt1_fast_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags)
+{
+	const crn_uint32 num_passes = g_crn_dxt_fast_passes[quality];
+	const crn_uint32 num_iterations = g_crn_dxt_fast_iterations[quality];
+	const crn_uint8* pWeights = crn_dxt1_get_weights(flags);
+	int sum[3] = { 0, 0, 0 }, prod[6] = { 0, 0, 0, 0, 0, 0 }, lo = 0x7FFFFFFF, hi = -0x7FFFFFFF, lo_index = 0, hi_index = 0;
+	int e0[3], e1[3];
+	float cov[6], axis[3];
+	crn_uint8 selectors[16], q0[4], q1[4];
+	crn_uint16 c0, c1;
+	crn_uint32 packed = 0, prev_linear = 0;
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		const int r = pixels[i][0], g = pixels[i][1], b = pixels[i][2];
+		sum[0] += r;
+		sum[1] += g;
+		sum[2] += b;
+		prod[0] += r * r;
+		prod[1] += r * g;
+		prod[2] += r * b;
+		prod[3] += g * g;
+		prod[4] += g * b;
+		prod[5] += b * b;
+	}
+
+	// A block of one color has no covariance at all.
+	if (prod[0] * 16 == sum[0] * sum[0] && prod[3] * 16 == sum[1] * sum[1] && prod[5] * 16 == sum[2] * sum[2])
+	{
+		crn_dxt_fast_write_single_color(pixels[0], pDst);
+		return;
+	}
+
+	// The principal axis under the weighted metric, scaled back to unweighted pixel space, is the dominant eigenvector
+	// of the covariance matrix times the weights. It is found by power iteration from the covariance matrix's row
+	// sums, with the matrix divided by its trace first: the dominant eigenvalue is then between 1/3 and 1, so the
+	// iterations need no rescaling in between. The luma bias only matters if the row sums vanish.
+	cov[0] = (float)(prod[0] * 16 - sum[0] * sum[0]);
+	cov[1] = (float)(prod[1] * 16 - sum[0] * sum[1]);
+	cov[2] = (float)(prod[2] * 16 - sum[0] * sum[2]);
+	cov[3] = (float)(prod[3] * 16 - sum[1] * sum[1]);
+	cov[4] = (float)(prod[4] * 16 - sum[1] * sum[2]);
+	cov[5] = (float)(prod[5] * 16 - sum[2] * sum[2]);
+	{
+		const float k = 1.0f / (cov[0] * pWeights[0] + cov[3] * pWeights[1] + cov[5] * pWeights[2]);
+		for (int i = 0; i < 6; i++)
+			cov[i] *= k;
+	}
+	axis[0] = cov[0] + cov[1] + cov[2] + 0.2990e-6f;
+	axis[1] = cov[1] + cov[3] + cov[4] + 0.5870e-6f;
+	axis[2] = cov[2] + cov[4] + cov[5] + 0.1140e-6f;
+	for (crn_uint32 iter = 0; iter < num_iterations; iter++)
+	{
+		const float wr = axis[0] * pWeights[0], wg = axis[1] * pWeights[1], wb = axis[2] * pWeights[2];
+		axis[0] = wr * cov[0] + wg * cov[1] + wb * cov[2];
+		axis[1] = wr * cov[1] + wg * cov[3] + wb * cov[4];
+		axis[2] = wr * cov[2] + wg * cov[4] + wb * cov[5];
+	}
+
+	// Start from the pixels at either end of the axis.
+	{
+		const float m = 1024.0f / (CRN_MAX(CRN_MAX(axis[0], -axis[0]), CRN_MAX(CRN_MAX(axis[1], -axis[1]), CRN_MAX(axis[2], -axis[2]))) + 1e-30f);
+		const int ia[3] = { (int)(axis[0] * m), (int)(axis[1] * m), (int)(axis[2] * m) };
+		for (int i = 0; i < 16; i++)
+		{
+			const int d = pixels[i][0] * ia[0] + pixels[i][1] * ia[1] + pixels[i][2] * ia[2];
+			lo_index = (d < lo) ? i : lo_index;
+			lo = CRN_MIN(lo, d);
+			hi_index = (d > hi) ? i : hi_index;
+			hi = CRN_MAX(hi, d);
+		}
+	}
+	// Selectors are found against the endpoints the decoder sees, so the starting ones are snapped to the 565 grid.
+	for (int c = 0; c < 3; c++)
+	{
+		e0[c] = pixels[hi_index][c];
+		e1[c] = pixels[lo_index][c];
+	}
+	crn_dxt_unpack565(crn_dxt_fast_quantize565(e0), q0);
+	crn_dxt_unpack565(crn_dxt_fast_quantize565(e1), q1);
+	for (int c = 0; c < 3; c++)
+	{
+		e0[c] = q0[c];
+		e1[c] = q1[c];
+	}
+
+	// Least squares passes. The system is accumulated in integers scaled by 3 (the selectors' weights are thirds),
+	// and its solution is rounded to whichever neighboring grid values fit the pixels best. Once the selectors stop
+	// changing, so would the solution. Either way the loop ends with the selectors of the final endpoints.
+	for (crn_uint32 pass = 0; ; pass++)
+	{
+		int counts[4] = { 0, 0, 0, 0 }, sums[3][4], ax[3], bx[3], aa, ab, bb, det;
+		float inv_det;
+		crn_uint32 weights = 0;
+		const crn_uint32 linear = crn_dxt_fast_selectors(pixels, e0, e1, pWeights, selectors);
+
+		if (pass == num_passes || (pass && linear == prev_linear))
+			break;
+		prev_linear = linear;
+
+		memset(sums, 0, sizeof(sums));
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const int s = selectors[i];
+			weights += g_crn_dxt_fast_ls_weights[s];
+			counts[s]++;
+			sums[0][s] += pixels[i][0];
+			sums[1][s] += pixels[i][1];
+			sums[2][s] += pixels[i][2];
+		}
+		aa = (int)(weights & 255);
+		ab = (int)((weights >> 8) & 255);
+		bb = (int)(weights >> 16);
+		det = aa * bb - ab * ab;
+		if (!det)
+			break;
+		inv_det = 3.0f / (float)det;
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] = sums[c][0] * 3 + sums[c][1] * 2 + sums[c][2];
+			bx[c] = sums[c][1] + sums[c][2] * 2 + sums[c][3] * 3;
+			crn_dxt_fast_round_endpoints((float)(ax[c] * bb - bx[c] * ab) * inv_det, (float)(bx[c] * aa - ax[c] * ab) * inv_det,
+				(c == 1) ? 63 : 31, counts, sums[c], &e0[c], &e1[c]);
+		}
+	}
+
+	c0 = crn_dxt_fast_quantize565(e0);
+	c1 = crn_dxt_fast_quantize565(e1);
+	for (crn_uint32 i = 0; i < 16; i++)
+		packed |= g_crn_dxt_fast_block_selectors[selectors[i]] << (i * 2);
+
+	// Swapping the endpoints flips the low bit of every selector.
+	if (c0 < c1)
+	{
+		const crn_uint16 t = c0;
+		c0 = c1;
+		c1 = t;
+		packed ^= 0x55555555U;
+	}
+	else if (c0 == c1)
+	{
+		// Endpoints too close to separate after quantization: the average color matched exactly serves better.
+		const crn_uint8 avg[3] = { (crn_uint8)((sum[0] + 8) >> 4), (crn_uint8)((sum[1] + 8) >> 4), (crn_uint8)((sum[2] + 8) >> 4) };
+		crn_dxt_fast_write_single_color(avg, pDst);
+		return;
+	}
+
+	crn_dxt_fast_write_block(c0, c1, packed, pDst);
+}
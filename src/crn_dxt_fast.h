@@ -0,0 +1,15 @@
+// File: crn_dxt_fast.h - Fast (CRNF) DXT1 color block encoding.
+#ifndef CRN_DXT_FAST_H
+#define CRN_DXT_FAST_H
+
+#include "crnlib.h"
+
+// Encodes the RGB of 16 RGBA pixels to an 8 byte 4 color mode DXT1 block, trading some quality for throughput: a
+// principal axis by power iteration on integer moments, then least squares passes over projected selectors whose
+// solutions are rounded to the 565 grid per channel by error, without per-pixel branches or palette searches. Single
+// color blocks are looked up in exact match tables. The quality tier sets the number of power iterations (2, 4, 6, 8
+// and 12 from SuperFast to Uber) and the most least squares passes (1 for SuperFast and Fast, then 2, 3 and 4), which
+// stop early once the selectors settle. The axis and projections follow crn_dxt1_get_weights(flags).
+void crn_dxt1_fast_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality, crn_uint32 flags);
+
+#endif // CRN_DXT_FAST_H
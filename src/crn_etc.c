@@ -0,0 +1,334 @@
+#include "crn_etc.h"
+#include "crn_core.h"
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+enum
+{
+	cCRNETC1NumTables     = 8,
+	cCRNETC1MaxCandidates = 125  // (2 * 2 + 1)^3 base colors at cCRNDXTQualityUber
+};
+
+// Intensity modifiers of each table, in selector order (selector = msb << 1 | lsb).
+static const int g_crn_etc1_modifiers[cCRNETC1NumTables][4] =
+{
+	{ 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+	{ 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 }
+};
+
+// Pixels (y * 4 + x) of each subblock, indexed by [flip][subblock]. Unflipped subblocks are 2x4, flipped ones 4x2.
+static const crn_uint8 g_crn_etc1_subblock_pixels[2][2][8] =
+{
+	{ { 0, 4, 8, 12, 1, 5, 9, 13 }, { 2, 6, 10, 14, 3, 7, 11, 15 } },
+	{ { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } }
+};
+
+// A subblock's 8 pixels in planar form, so they load straight into 16-bit SIMD lanes.
+typedef struct
+{
+	crn_uint8 r[8], g[8], b[8];
+} crn_etc1_subblock;
+
+typedef struct
+{
+	crn_uint8  color[3];  // 4 or 5 bits per channel
+	crn_uint8  table;
+	crn_uint32 error;
+} crn_etc1_candidate;
+
+static int crn_etc1_expand(int c, crn_uint32 bits)
+{
+	return (bits == 4) ? ((c << 4) | c) : ((c << 3) | (c >> 2));
+}
+
+// Returns the error of the best intensity table for a base color (8 bits per channel), and the table.
+static crn_uint32 crn_etc1_eval_base(const crn_etc1_subblock* pSub, const int base[3], crn_uint32* pTable)
+{
+	crn_uint32 best_error = 0xFFFFFFFF, best_table = 0;
+#if CRN_SSE2
+	// 8 pixels in 16-bit lanes; squared distances are summed into 32 bits with madd, 4 pixels per half.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pSub->r), zero);
+	const __m128i g = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pSub->g), zero);
+	const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pSub->b), zero);
+	for (crn_uint32 t = 0; t < cCRNETC1NumTables; t++)
+	{
+		__m128i best_lo = _mm_set1_epi32(0x7FFFFFFF), best_hi = best_lo, sum;
+		for (crn_uint32 m = 0; m < 4; m++)
+		{
+			const int mod = g_crn_etc1_modifiers[t][m];
+			const __m128i dr = _mm_sub_epi16(r, _mm_set1_epi16((short)CRN_CLAMP(base[0] + mod, 0, 255)));
+			const __m128i dg = _mm_sub_epi16(g, _mm_set1_epi16((short)CRN_CLAMP(base[1] + mod, 0, 255)));
+			const __m128i db = _mm_sub_epi16(b, _mm_set1_epi16((short)CRN_CLAMP(base[2] + mod, 0, 255)));
+			const __m128i rg_lo = _mm_unpacklo_epi16(dr, dg), rg_hi = _mm_unpackhi_epi16(dr, dg);
+			const __m128i b_lo = _mm_unpacklo_epi16(db, zero), b_hi = _mm_unpackhi_epi16(db, zero);
+			const __m128i err_lo = _mm_add_epi32(_mm_madd_epi16(rg_lo, rg_lo), _mm_madd_epi16(b_lo, b_lo));
+			const __m128i err_hi = _mm_add_epi32(_mm_madd_epi16(rg_hi, rg_hi), _mm_madd_epi16(b_hi, b_hi));
+			const __m128i lt_lo = _mm_cmplt_epi32(err_lo, best_lo), lt_hi = _mm_cmplt_epi32(err_hi, best_hi);
+			best_lo = _mm_or_si128(_mm_and_si128(lt_lo, err_lo), _mm_andnot_si128(lt_lo, best_lo));
+			best_hi = _mm_or_si128(_mm_and_si128(lt_hi, err_hi), _mm_andnot_si128(lt_hi, best_hi));
+		}
+		sum = _mm_add_epi32(best_lo, best_hi);
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		if ((crn_uint32)_mm_cvtsi128_si32(sum) < best_error)
+		{
+			best_error = (crn_uint32)_mm_cvtsi128_si32(sum);
+			best_table = t;
+		}
+	}
+#else
+	for (crn_uint32 t = 0; t < cCRNETC1NumTables; t++)
+	{
+		crn_uint32 error = 0;
+		for (crn_uint32 i = 0; i < 8 && error < best_error; i++)
+		{
+			crn_uint32 best = 0xFFFFFFFF;
+			for (crn_uint32 m = 0; m < 4; m++)
+			{
+				const int mod = g_crn_etc1_modifiers[t][m];
+				const int dr = pSub->r[i] - CRN_CLAMP(base[0] + mod, 0, 255);
+				const int dg = pSub->g[i] - CRN_CLAMP(base[1] + mod, 0, 255);
+				const int db = pSub->b[i] - CRN_CLAMP(base[2] + mod, 0, 255);
+				best = CRN_MIN(best, (crn_uint32)(dr * dr + dg * dg + db * db));
+			}
+			error += best;
+		}
+		if (error < best_error)
+		{
+			best_error = error;
+			best_table = t;
+		}
+	}
+#endif
+	*pTable = best_table;
+	return best_error;
+}
+
+// Lists the base colors the quality tier tries around a subblock's average color.
+static crn_uint32 crn_etc1_get_candidates(const float avg[3], crn_uint32 bits, crn_dxt_quality quality, crn_etc1_candidate* pCands)
+{
+	const int max_val = (1 << bits) - 1;
+	const int radius = (quality == cCRNDXTQualitySuperFast) ? 0 : (quality == cCRNDXTQualityFast || quality == cCRNDXTQualityBetter) ? 1 : 2;
+	const crn_bool cube = quality >= cCRNDXTQualityBetter;
+	int q[3];
+	crn_uint32 n = 0;
+
+	for (int c = 0; c < 3; c++)
+		q[c] = CRN_CLAMP((int)(avg[c] * max_val / 255.0f + 0.5f), 0, max_val);
+
+	for (int dr = -radius; dr <= radius; dr++)
+	{
+		for (int dg = cube ? -radius : dr; dg <= (cube ? radius : dr); dg++)
+		{
+			for (int db = cube ? -radius : dr; db <= (cube ? radius : dr); db++)
+			{
+				crn_etc1_candidate* pCand = &pCands[n++];
+				pCand->color[0] = (crn_uint8)CRN_CLAMP(q[0] + dr, 0, max_val);
+				pCand->color[1] = (crn_uint8)CRN_CLAMP(q[1] + dg, 0, max_val);
+				pCand->color[2] = (crn_uint8)CRN_CLAMP(q[2] + db, 0, max_val);
+			}
+		}
+	}
+	return n;
+}
+
+// Evaluates the candidate base colors of a subblock, returning the number of candidates and the index of the best.
+static crn_uint32 crn_etc1_eval_subblock(const crn_etc1_subblock* pSub, const float avg[3], crn_uint32 bits, crn_dxt_quality quality,
+	crn_etc1_candidate* pCands, crn_uint32* pBest)
+{
+	const crn_uint32 n = crn_etc1_get_candidates(avg, bits, quality, pCands);
+	*pBest = 0;
+	for (crn_uint32 i = 0; i < n; i++)
+	{
+		const int base[3] = { crn_etc1_expand(pCands[i].color[0], bits), crn_etc1_expand(pCands[i].color[1], bits), crn_etc1_expand(pCands[i].color[2], bits) };
+		crn_uint32 table;
+		pCands[i].error = crn_etc1_eval_base(pSub, base, &table);
+		pCands[i].table = (crn_uint8)table;
+		if (pCands[i].error < pCands[*pBest].error)
+			*pBest = i;
+	}
+	return n;
+}
+
+static crn_bool crn_etc1_delta_ok(const crn_etc1_candidate* pA, const crn_etc1_candidate* pB)
+{
+	for (int c = 0; c < 3; c++)
+	{
+		const int d = pB->color[c] - pA->color[c];
+		if (d < -4 || d > 3)
+			return crn_false;
+	}
+	return crn_true;
+}
+
+typedef struct
+{
+	crn_uint32 error;
+	crn_uint32 flip;
+	crn_uint32 diff;
+	crn_etc1_candidate subblocks[2];
+} crn_etc1_solution;
+
+static void crn_etc1_write_block(const crn_uint8 pixels[16][4], const crn_etc1_solution* pSol, crn_uint8* pDst)
+{
+	const crn_etc1_candidate* pA = &pSol->subblocks[0];
+	const crn_etc1_candidate* pB = &pSol->subblocks[1];
+	const crn_uint32 bits = pSol->diff ? 5 : 4;
+	crn_uint32 hi, lo = 0;
+
+	if (pSol->diff)
+	{
+		hi = ((crn_uint32)pA->color[0] << 27) | ((crn_uint32)((pB->color[0] - pA->color[0]) & 7) << 24) |
+			((crn_uint32)pA->color[1] << 19) | ((crn_uint32)((pB->color[1] - pA->color[1]) & 7) << 16) |
+			((crn_uint32)pA->color[2] << 11) | ((crn_uint32)((pB->color[2] - pA->color[2]) & 7) << 8);
+	}
+	else
+	{
+		hi = ((crn_uint32)pA->color[0] << 28) | ((crn_uint32)pB->color[0] << 24) | ((crn_uint32)pA->color[1] << 20) |
+			((crn_uint32)pB->color[1] << 16) | ((crn_uint32)pA->color[2] << 12) | ((crn_uint32)pB->color[2] << 8);
+	}
+	hi |= ((crn_uint32)pA->table << 5) | ((crn_uint32)pB->table << 2) | (pSol->diff << 1) | pSol->flip;
+
+	for (crn_uint32 s = 0; s < 2; s++)
+	{
+		const crn_etc1_candidate* pCand = &pSol->subblocks[s];
+		const int* pMods = g_crn_etc1_modifiers[pCand->table];
+		const int base[3] = { crn_etc1_expand(pCand->color[0], bits), crn_etc1_expand(pCand->color[1], bits), crn_etc1_expand(pCand->color[2], bits) };
+		for (crn_uint32 i = 0; i < 8; i++)
+		{
+			const crn_uint32 p = g_crn_etc1_subblock_pixels[pSol->flip][s][i], bit = (p & 3) * 4 + (p >> 2);
+			crn_uint32 best = 0, best_error = 0xFFFFFFFF;
+			for (crn_uint32 m = 0; m < 4; m++)
+			{
+				const int dr = pixels[p][0] - CRN_CLAMP(base[0] + pMods[m], 0, 255);
+				const int dg = pixels[p][1] - CRN_CLAMP(base[1] + pMods[m], 0, 255);
+				const int db = pixels[p][2] - CRN_CLAMP(base[2] + pMods[m], 0, 255);
+				const crn_uint32 error = (crn_uint32)(dr * dr + dg * dg + db * db);
+				if (error < best_error)
+				{
+					best_error = error;
+					best = m;
+				}
+			}
+			lo |= ((best >> 1) << (16 + bit)) | ((best & 1) << bit);
+		}
+	}
+
+	crn_write_packed(pDst, hi, 4);
+	crn_write_packed(pDst + 4, lo, 4);
+}
+
+void crn_etc1_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality)
+{
+	crn_etc1_candidate cands[2][cCRNETC1MaxCandidates];
+	crn_etc1_solution best;
+
+	best.error = 0xFFFFFFFF;
+	for (crn_uint32 flip = 0; flip < 2; flip++)
+	{
+		crn_etc1_subblock subs[2];
+		float avg[2][3];
+		crn_uint32 num[2], first[2];
+
+		for (crn_uint32 s = 0; s < 2; s++)
+		{
+			float sum[3] = { 0.0f, 0.0f, 0.0f };
+			for (crn_uint32 i = 0; i < 8; i++)
+			{
+				const crn_uint8* p = pixels[g_crn_etc1_subblock_pixels[flip][s][i]];
+				subs[s].r[i] = p[0];
+				subs[s].g[i] = p[1];
+				subs[s].b[i] = p[2];
+				sum[0] += p[0];
+				sum[1] += p[1];
+				sum[2] += p[2];
+			}
+			for (int c = 0; c < 3; c++)
+				avg[s][c] = sum[c] * (1.0f / 8.0f);
+		}
+
+		// Individual mode: each subblock independently picks a 444 base color.
+		for (crn_uint32 s = 0; s < 2; s++)
+			num[s] = crn_etc1_eval_subblock(&subs[s], avg[s], 4, quality, cands[s], &first[s]);
+		if ((crn_uint64)cands[0][first[0]].error + cands[1][first[1]].error < best.error)
+		{
+			best.error = cands[0][first[0]].error + cands[1][first[1]].error;
+			best.flip = flip;
+			best.diff = 0;
+			best.subblocks[0] = cands[0][first[0]];
+			best.subblocks[1] = cands[1][first[1]];
+		}
+
+		// Differential mode: 555 base colors whose difference fits in 3 signed bits per channel. If the two
+		// best candidates don't fit, search the best compatible pair.
+		for (crn_uint32 s = 0; s < 2; s++)
+			num[s] = crn_etc1_eval_subblock(&subs[s], avg[s], 5, quality, cands[s], &first[s]);
+		if (!crn_etc1_delta_ok(&cands[0][first[0]], &cands[1][first[1]]))
+		{
+			crn_uint64 pair_error = 0xFFFFFFFFFFFFFFFFULL;
+			for (crn_uint32 i = 0; i < num[0]; i++)
+			{
+				for (crn_uint32 j = 0; j < num[1]; j++)
+				{
+					if ((crn_uint64)cands[0][i].error + cands[1][j].error < pair_error && crn_etc1_delta_ok(&cands[0][i], &cands[1][j]))
+					{
+						pair_error = (crn_uint64)cands[0][i].error + cands[1][j].error;
+						first[0] = i;
+						first[1] = j;
+					}
+				}
+			}
+			if (pair_error == 0xFFFFFFFFFFFFFFFFULL)
+				continue;
+		}
+		if ((crn_uint64)cands[0][first[0]].error + cands[1][first[1]].error < best.error)
+		{
+			best.error = cands[0][first[0]].error + cands[1][first[1]].error;
+			best.flip = flip;
+			best.diff = 1;
+			best.subblocks[0] = cands[0][first[0]];
+			best.subblocks[1] = cands[1][first[1]];
+		}
+	}
+
+	crn_etc1_write_block(pixels, &best, pDst);
+}
+
+void crn_etc1_decode_block(const crn_uint8* pSrc, crn_uint8 pixels[16][4])
+{
+	const crn_uint32 hi = crn_read_packed(pSrc, 4), lo = crn_read_packed(pSrc + 4, 4);
+	const crn_uint32 flip = hi & 1, diff = (hi >> 1) & 1;
+	const crn_uint32 tables[2] = { (hi >> 5) & 7, (hi >> 2) & 7 };
+	int base[2][3];
+
+	for (int c = 0; c < 3; c++)
+	{
+		const crn_uint32 shift = 27 - c * 8;
+		if (diff)
+		{
+			const int c0 = (int)((hi >> shift) & 31);
+			const int d = (int)((hi >> (shift - 3)) & 7);
+			base[0][c] = crn_etc1_expand(c0, 5);
+			base[1][c] = crn_etc1_expand((c0 + ((d ^ 4) - 4)) & 31, 5);
+		}
+		else
+		{
+			base[0][c] = crn_etc1_expand((int)((hi >> (shift + 1)) & 15), 4);
+			base[1][c] = crn_etc1_expand((int)((hi >> (shift - 3)) & 15), 4);
+		}
+	}
+
+	for (crn_uint32 p = 0; p < 16; p++)
+	{
+		const crn_uint32 x = p & 3, y = p >> 2, bit = x * 4 + y;
+		const crn_uint32 s = flip ? (y >= 2) : (x >= 2);
+		const crn_uint32 sel = (((lo >> (16 + bit)) & 1) << 1) | ((lo >> bit) & 1);
+		const int mod = g_crn_etc1_modifiers[tables[s]][sel];
+		for (int c = 0; c < 3; c++)
+			pixels[p][c] = (crn_uint8)CRN_CLAMP(base[s][c] + mod, 0, 255);
+		pixels[p][3] = 255;
+	}
+}
@@ -0,0 +1,20 @@
+// File: crn_etc.h - ETC1 block encoding and decoding.
+#ifndef CRN_ETC_H
+#define CRN_ETC_H
+
+#include "crnlib.h"
+
+// Encodes 16 RGBA pixels (alpha ignored) to an 8 byte ETC1 block. Both flip orientations, individual and
+// differential modes and all 8 intensity tables are always evaluated; the quality tier controls how many base
+// colors are tried around each subblock's average:
+//  SuperFast: the quantized average only.
+//  Fast:      +-1 step along the intensity (gray) axis.
+//  Normal:    +-2 steps along the intensity axis.
+//  Better:    every color within +-1 step of the average on each channel.
+//  Uber:      every color within +-2 steps of the average on each channel.
+void crn_etc1_encode_block(const crn_uint8 pixels[16][4], crn_uint8* pDst, crn_dxt_quality quality);
+
+// Decodes an 8 byte ETC1 block to 16 RGBA pixels (alpha=255).
+void crn_etc1_decode_block(const crn_uint8* pSrc, crn_uint8 pixels[16][4]);
+
+#endif // CRN_ETC_H
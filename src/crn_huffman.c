@@ -0,0 +1,479 @@
+#include "crn_huffman.h"
+#include "crn_core.h"
+
+#include <stdlib.h>
+
+const crn_uint8 g_crn_most_probable_codelength_codes[cCRNHuffMaxCodelengthCodes] =
+{
+	cCRNHuffSmallZeroRunCode, cCRNHuffLargeZeroRunCode,
+	cCRNHuffSmallRepeatCode, cCRNHuffLargeRepeatCode,
+	0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15, 16
+};
+
+crn_bool crn_huff_decoder_init(crn_huff_decoder* pModel, crn_uint32 num_syms, const crn_uint8* pCode_sizes, crn_uint32 table_bits)
+{
+	crn_uint32 num_codes[cCRNHuffMaxCodeSize + 1] = { 0 };
+	crn_uint32 next_code[cCRNHuffMaxCodeSize + 1];
+	crn_uint32 sorted_pos[cCRNHuffMaxCodeSize + 1];
+	crn_uint32 code = 0, total = 0;
+
+	memset(pModel, 0, sizeof(*pModel));
+	if (num_syms > cCRNHuffMaxSupportedSyms)
+		return crn_false;
+
+	for (crn_uint32 i = 0; i < num_syms; i++)
+	{
+		if (pCode_sizes[i] > cCRNHuffMaxCodeSize)
+			return crn_false;
+		num_codes[pCode_sizes[i]]++;
+		if (pCode_sizes[i] > pModel->max_code_size)
+			pModel->max_code_size = pCode_sizes[i];
+	}
+
+	pModel->num_syms = num_syms;
+	pModel->max_code_size = CRN_MAX(pModel->max_code_size, 1U);
+	pModel->table_bits = CRN_CLAMP(table_bits, 1U, CRN_MIN(pModel->max_code_size, (crn_uint32)cCRNHuffMaxTableBits));
+
+	for (crn_uint32 len = 1; len <= cCRNHuffMaxCodeSize; len++)
+	{
+		next_code[len] = code;
+		sorted_pos[len] = total;
+		pModel->val_ptrs[len] = (crn_int32)total - (crn_int32)code;
+		code += num_codes[len];
+		total += num_codes[len];
+		pModel->max_codes[len] = num_codes[len] ? (code << (16 - len)) : 0;
+		// Over-subscribed code sizes can't be canonically assigned.
+		if (code > (1U << len))
+			return crn_false;
+		code <<= 1;
+	}
+
+	pModel->num_sorted_syms = total;
+	pModel->pSorted_syms = (crn_uint16*)crn_malloc(CRN_MAX(total, 1U) * sizeof(crn_uint16));
+	pModel->pLookup = (crn_uint32*)crn_calloc((size_t)1 << pModel->table_bits, sizeof(crn_uint32));
+	if (!pModel->pSorted_syms || !pModel->pLookup)
+	{
+		crn_huff_decoder_free(pModel);
+		return crn_false;
+	}
+	pModel->pSorted_syms[0] = 0;
+
+	for (crn_uint32 sym = 0; sym < num_syms; sym++)
+	{
+		const crn_uint32 len = pCode_sizes[sym];
+		crn_uint32 c;
+		if (!len)
+			continue;
+
+		c = next_code[len]++;
+		pModel->pSorted_syms[sorted_pos[len]++] = (crn_uint16)sym;
+		if (len <= pModel->table_bits)
+		{
+			const crn_uint32 shift = pModel->table_bits - len;
+			const crn_uint32 entry = (len << 16) | sym;
+			for (crn_uint32 j = 0; j < (1U << shift); j++)
+				pModel->pLookup[(c << shift) + j] = entry;
+		}
+	}
+
+	// Without a slow path every prefix must resolve, invalid codes just decode to the first symbol.
+	if (pModel->table_bits >= pModel->max_code_size)
+	{
+		for (crn_uint32 i = 0; i < (1U << pModel->table_bits); i++)
+			if (!pModel->pLookup[i])
+				pModel->pLookup[i] = (pModel->max_code_size << 16) | pModel->pSorted_syms[0];
+	}
+
+	return crn_true;
+}
+
+void crn_huff_decoder_free(crn_huff_decoder* pModel)
+{
+	crn_free(pModel->pLookup);
+	crn_free(pModel->pSorted_syms);
+	memset(pModel, 0, sizeof(*pModel));
+}
+
+crn_bool crn_bit_reader_receive_model(crn_bit_reader* pReader, crn_huff_decoder* pModel)
+{
+	crn_uint8 code_sizes[cCRNHuffMaxSupportedSyms];
+	crn_uint8 dm_code_sizes[cCRNHuffMaxCodelengthCodes] = { 0 };
+	crn_huff_decoder dm;
+	crn_uint32 total_used_syms, num_codelength_codes, ofs;
+	crn_bool ok = crn_true;
+
+	total_used_syms = crn_bit_reader_get_bits(pReader, 14);
+	if (!total_used_syms)
+		return crn_huff_decoder_init(pModel, 0, NULL, 0);
+	if (total_used_syms > cCRNHuffMaxSupportedSyms)
+		return crn_false;
+
+	num_codelength_codes = crn_bit_reader_get_bits(pReader, 5);
+	if (num_codelength_codes < 1 || num_codelength_codes > cCRNHuffMaxCodelengthCodes)
+		return crn_false;
+	for (crn_uint32 i = 0; i < num_codelength_codes; i++)
+		dm_code_sizes[g_crn_most_probable_codelength_codes[i]] = (crn_uint8)crn_bit_reader_get_bits(pReader, 3);
+	if (!crn_huff_decoder_init(&dm, cCRNHuffMaxCodelengthCodes, dm_code_sizes, 7))
+		return crn_false;
+
+	memset(code_sizes, 0, total_used_syms);
+	for (ofs = 0; ok && ofs < total_used_syms;)
+	{
+		const crn_uint32 num_remaining = total_used_syms - ofs;
+		const crn_uint32 code = crn_bit_reader_decode(pReader, &dm);
+		crn_uint32 len;
+
+		if (code <= cCRNHuffMaxCodeSize)
+		{
+			code_sizes[ofs++] = (crn_uint8)code;
+		}
+		else if (code == cCRNHuffSmallZeroRunCode || code == cCRNHuffLargeZeroRunCode)
+		{
+			len = (code == cCRNHuffSmallZeroRunCode)
+				? crn_bit_reader_get_bits(pReader, cCRNHuffSmallZeroRunExtraBits) + cCRNHuffMinSmallZeroRunSize
+				: crn_bit_reader_get_bits(pReader, cCRNHuffLargeZeroRunExtraBits) + cCRNHuffMinLargeZeroRunSize;
+			ok = len <= num_remaining;
+			ofs += len;
+		}
+		else
+		{
+			len = (code == cCRNHuffSmallRepeatCode)
+				? crn_bit_reader_get_bits(pReader, cCRNHuffSmallNonZeroRunExtraBits) + cCRNHuffSmallMinNonZeroRunSize
+				: crn_bit_reader_get_bits(pReader, cCRNHuffLargeNonZeroRunExtraBits) + cCRNHuffLargeMinNonZeroRunSize;
+			ok = ofs && len <= num_remaining && code_sizes[ofs - 1];
+			if (ok)
+			{
+				memset(code_sizes + ofs, code_sizes[ofs - 1], len);
+				ofs += len;
+			}
+		}
+	}
+
+	crn_huff_decoder_free(&dm);
+	return ok && crn_huff_decoder_init(pModel, total_used_syms, code_sizes, cCRNHuffMaxTableBits);
+}
+
+typedef struct
+{
+	crn_uint32 key;
+	crn_uint32 sym;
+} crn_huff_sym_freq;
+
+static int crn_huff_sym_freq_compare(const void* a, const void* b)
+{
+	const crn_huff_sym_freq* pA = (const crn_huff_sym_freq*)a;
+	const crn_huff_sym_freq* pB = (const crn_huff_sym_freq*)b;
+	if (pA->key != pB->key)
+		return pA->key < pB->key ? -1 : 1;
+	return pA->sym < pB->sym ? -1 : (pA->sym > pB->sym);
+}
+
+// In-place minimum redundancy code lengths (Moffat & Katajainen), A must be sorted by ascending frequency.
+static void crn_huff_calculate_minimum_redundancy(crn_huff_sym_freq* A, int n)
+{
+	int root, leaf, next, avbl, used, dpth;
+	if (n == 1)
+	{
+		A[0].key = 1;
+		return;
+	}
+
+	A[0].key += A[1].key;
+	root = 0;
+	leaf = 2;
+	for (next = 1; next < n - 1; next++)
+	{
+		if (leaf >= n || A[root].key < A[leaf].key)
+		{
+			A[next].key = A[root].key;
+			A[root++].key = (crn_uint32)next;
+		}
+		else
+			A[next].key = A[leaf++].key;
+
+		if (leaf >= n || (root < next && A[root].key < A[leaf].key))
+		{
+			A[next].key += A[root].key;
+			A[root++].key = (crn_uint32)next;
+		}
+		else
+			A[next].key += A[leaf++].key;
+	}
+
+	A[n - 2].key = 0;
+	for (next = n - 3; next >= 0; next--)
+		A[next].key = A[A[next].key].key + 1;
+
+	avbl = 1;
+	used = dpth = 0;
+	root = n - 2;
+	next = n - 1;
+	while (avbl > 0)
+	{
+		while (root >= 0 && (int)A[root].key == dpth)
+		{
+			used++;
+			root--;
+		}
+		while (avbl > used)
+		{
+			A[next--].key = (crn_uint32)dpth;
+			avbl--;
+		}
+		avbl = 2 * used;
+		dpth++;
+		used = 0;
+	}
+}
+
+enum { cCRNHuffMaxUnlimitedCodeSize = 64 };
+
+static void crn_huff_enforce_max_code_size(crn_uint32* pNum_codes, crn_uint32 max_code_size)
+{
+	crn_uint64 total = 0;
+	for (crn_uint32 i = max_code_size + 1; i < cCRNHuffMaxUnlimitedCodeSize; i++)
+	{
+		pNum_codes[max_code_size] += pNum_codes[i];
+		pNum_codes[i] = 0;
+	}
+	for (crn_uint32 i = max_code_size; i > 0; i--)
+		total += (crn_uint64)pNum_codes[i] << (max_code_size - i);
+	while (total != (1ULL << max_code_size))
+	{
+		pNum_codes[max_code_size]--;
+		for (crn_uint32 i = max_code_size - 1; i > 0; i--)
+		{
+			if (pNum_codes[i])
+			{
+				pNum_codes[i]--;
+				pNum_codes[i + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
+}
+
+crn_bool crn_huff_encoder_init(crn_huff_encoder* pModel, crn_uint32 num_syms, const crn_uint32* pFreq, crn_uint32 max_code_size)
+{
+	crn_uint32 num_codes[cCRNHuffMaxUnlimitedCodeSize] = { 0 };
+	crn_uint32 next_code[cCRNHuffMaxCodeSize + 1];
+	crn_huff_sym_freq* pSyms;
+	crn_uint32 num_used = 0, code = 0;
+
+	memset(pModel, 0, sizeof(*pModel));
+	if (num_syms > cCRNHuffMaxSupportedSyms || max_code_size < 1 || max_code_size > cCRNHuffMaxCodeSize)
+		return crn_false;
+
+	pModel->num_syms = num_syms;
+	pModel->pCode_sizes = (crn_uint8*)crn_calloc(CRN_MAX(num_syms, 1U), 1);
+	pModel->pCodes = (crn_uint16*)crn_calloc(CRN_MAX(num_syms, 1U), sizeof(crn_uint16));
+	pSyms = (crn_huff_sym_freq*)crn_malloc(CRN_MAX(num_syms, 1U) * sizeof(crn_huff_sym_freq));
+	if (!pModel->pCode_sizes || !pModel->pCodes || !pSyms)
+	{
+		crn_free(pSyms);
+		crn_huff_encoder_free(pModel);
+		return crn_false;
+	}
+
+	for (crn_uint32 i = 0; i < num_syms; i++)
+	{
+		if (pFreq[i])
+		{
+			pSyms[num_used].key = pFreq[i];
+			pSyms[num_used++].sym = i;
+		}
+	}
+
+	if (num_used)
+	{
+		qsort(pSyms, num_used, sizeof(crn_huff_sym_freq), crn_huff_sym_freq_compare);
+		crn_huff_calculate_minimum_redundancy(pSyms, (int)num_used);
+		for (crn_uint32 i = 0; i < num_used; i++)
+			num_codes[CRN_MIN(pSyms[i].key, (crn_uint32)cCRNHuffMaxUnlimitedCodeSize - 1)]++;
+		if (num_used > 1)
+			crn_huff_enforce_max_code_size(num_codes, max_code_size);
+
+		// The most frequent symbols (at the end of the sorted list) get the shortest codes.
+		for (crn_uint32 len = 1, j = num_used; len <= max_code_size; len++)
+			for (crn_uint32 k = num_codes[len]; k > 0; k--)
+				pModel->pCode_sizes[pSyms[--j].sym] = (crn_uint8)len;
+	}
+	crn_free(pSyms);
+
+	memset(num_codes, 0, sizeof(num_codes));
+	for (crn_uint32 i = 0; i < num_syms; i++)
+		num_codes[pModel->pCode_sizes[i]]++;
+	for (crn_uint32 len = 1; len <= cCRNHuffMaxCodeSize; len++)
+	{
+		next_code[len] = code;
+		code = (code + num_codes[len]) << 1;
+	}
+	for (crn_uint32 i = 0; i < num_syms; i++)
+		if (pModel->pCode_sizes[i])
+			pModel->pCodes[i] = (crn_uint16)next_code[pModel->pCode_sizes[i]]++;
+
+	return crn_true;
+}
+
+void crn_huff_encoder_free(crn_huff_encoder* pModel)
+{
+	crn_free(pModel->pCode_sizes);
+	crn_free(pModel->pCodes);
+	memset(pModel, 0, sizeof(*pModel));
+}
+
+crn_uint64 crn_huff_encoder_cost(const crn_huff_encoder* pModel, const crn_uint32* pFreq)
+{
+	crn_uint64 bits = 0;
+	for (crn_uint32 i = 0; i < pModel->num_syms; i++)
+		bits += (crn_uint64)pFreq[i] * pModel->pCode_sizes[i];
+	return bits;
+}
+
+void crn_bit_writer_init(crn_bit_writer* pWriter)
+{
+	memset(pWriter, 0, sizeof(*pWriter));
+}
+
+void crn_bit_writer_free(crn_bit_writer* pWriter)
+{
+	crn_free(pWriter->pBuf);
+	memset(pWriter, 0, sizeof(*pWriter));
+}
+
+static void crn_bit_writer_put_byte(crn_bit_writer* pWriter, crn_uint8 c)
+{
+	if (pWriter->size == pWriter->capacity)
+	{
+		const crn_uint32 new_capacity = CRN_MAX(pWriter->capacity * 2, 256U);
+		crn_uint8* pNew = (crn_uint8*)crn_realloc(pWriter->pBuf, new_capacity);
+		if (!pNew)
+		{
+			pWriter->failed = crn_true;
+			return;
+		}
+		pWriter->pBuf = pNew;
+		pWriter->capacity = new_capacity;
+	}
+	pWriter->pBuf[pWriter->size++] = c;
+}
+
+void crn_bit_writer_put_bits(crn_bit_writer* pWriter, crn_uint32 bits, crn_uint32 num_bits)
+{
+	if (!num_bits)
+		return;
+	pWriter->bit_buf = (pWriter->bit_buf << num_bits) | (bits & (crn_uint32)((1ULL << num_bits) - 1));
+	pWriter->bit_count += num_bits;
+	while (pWriter->bit_count >= 8)
+	{
+		pWriter->bit_count -= 8;
+		crn_bit_writer_put_byte(pWriter, (crn_uint8)(pWriter->bit_buf >> pWriter->bit_count));
+	}
+}
+
+crn_bool crn_bit_writer_flush(crn_bit_writer* pWriter)
+{
+	if (pWriter->bit_count)
+		crn_bit_writer_put_bits(pWriter, 0, 8 - pWriter->bit_count);
+	return !pWriter->failed;
+}
+
+void crn_bit_writer_send_model(crn_bit_writer* pWriter, const crn_huff_encoder* pModel)
+{
+	crn_uint16* pCodes;
+	crn_uint32 freq[cCRNHuffMaxCodelengthCodes] = { 0 };
+	crn_uint32 total_used_syms = pModel->num_syms, num_codes = 0, num_codelength_codes;
+	crn_huff_encoder dm;
+
+	while (total_used_syms && !pModel->pCode_sizes[total_used_syms - 1])
+		total_used_syms--;
+	crn_bit_writer_put_bits(pWriter, total_used_syms, 14);
+	if (!total_used_syms)
+		return;
+
+	// Run-length code the code sizes, each entry is (extra bits << 5) | code length code.
+	pCodes = (crn_uint16*)crn_malloc(total_used_syms * sizeof(crn_uint16));
+	if (!pCodes)
+	{
+		pWriter->failed = crn_true;
+		return;
+	}
+	for (crn_uint32 i = 0; i < total_used_syms;)
+	{
+		const crn_uint32 size = pModel->pCode_sizes[i];
+		crn_uint32 run = 1, remaining;
+		while (i + run < total_used_syms && pModel->pCode_sizes[i + run] == size)
+			run++;
+		i += run;
+
+		remaining = run;
+		if (size)
+		{
+			pCodes[num_codes++] = (crn_uint16)size;
+			remaining--;
+		}
+		while (remaining)
+		{
+			crn_uint32 len;
+			if (!size && remaining >= cCRNHuffMinLargeZeroRunSize)
+			{
+				len = CRN_MIN(remaining, (crn_uint32)cCRNHuffMaxLargeZeroRunSize);
+				pCodes[num_codes++] = (crn_uint16)(((len - cCRNHuffMinLargeZeroRunSize) << 5) | cCRNHuffLargeZeroRunCode);
+			}
+			else if (!size && remaining >= cCRNHuffMinSmallZeroRunSize)
+			{
+				len = remaining;
+				pCodes[num_codes++] = (crn_uint16)(((len - cCRNHuffMinSmallZeroRunSize) << 5) | cCRNHuffSmallZeroRunCode);
+			}
+			else if (size && remaining >= cCRNHuffLargeMinNonZeroRunSize)
+			{
+				len = CRN_MIN(remaining, (crn_uint32)cCRNHuffLargeMaxNonZeroRunSize);
+				pCodes[num_codes++] = (crn_uint16)(((len - cCRNHuffLargeMinNonZeroRunSize) << 5) | cCRNHuffLargeRepeatCode);
+			}
+			else if (size && remaining >= cCRNHuffSmallMinNonZeroRunSize)
+			{
+				len = remaining;
+				pCodes[num_codes++] = (crn_uint16)(((len - cCRNHuffSmallMinNonZeroRunSize) << 5) | cCRNHuffSmallRepeatCode);
+			}
+			else
+			{
+				len = 1;
+				pCodes[num_codes++] = (crn_uint16)size;
+			}
+			remaining -= len;
+		}
+	}
+
+	for (crn_uint32 i = 0; i < num_codes; i++)
+		freq[pCodes[i] & 31]++;
+	if (!crn_huff_encoder_init(&dm, cCRNHuffMaxCodelengthCodes, freq, 7))
+	{
+		crn_free(pCodes);
+		pWriter->failed = crn_true;
+		return;
+	}
+
+	num_codelength_codes = cCRNHuffMaxCodelengthCodes;
+	while (num_codelength_codes > 1 && !dm.pCode_sizes[g_crn_most_probable_codelength_codes[num_codelength_codes - 1]])
+		num_codelength_codes--;
+	crn_bit_writer_put_bits(pWriter, num_codelength_codes, 5);
+	for (crn_uint32 i = 0; i < num_codelength_codes; i++)
+		crn_bit_writer_put_bits(pWriter, dm.pCode_sizes[g_crn_most_probable_codelength_codes[i]], 3);
+
+	for (crn_uint32 i = 0; i < num_codes; i++)
+	{
+		const crn_uint32 code = pCodes[i] & 31, extra = pCodes[i] >> 5;
+		crn_bit_writer_encode(pWriter, &dm, code);
+		switch (code)
+		{
+		case cCRNHuffSmallZeroRunCode: crn_bit_writer_put_bits(pWriter, extra, cCRNHuffSmallZeroRunExtraBits); break;
+		case cCRNHuffLargeZeroRunCode: crn_bit_writer_put_bits(pWriter, extra, cCRNHuffLargeZeroRunExtraBits); break;
+		case cCRNHuffSmallRepeatCode:  crn_bit_writer_put_bits(pWriter, extra, cCRNHuffSmallNonZeroRunExtraBits); break;
+		case cCRNHuffLargeRepeatCode:  crn_bit_writer_put_bits(pWriter, extra, cCRNHuffLargeNonZeroRunExtraBits); break;
+		}
+	}
+
+	crn_huff_encoder_free(&dm);
+	crn_free(pCodes);
+}
@@ -0,0 +1,162 @@
+// File: crn_huffman.h - Static Huffman models and the MSB-first bit reader used by the CRN format.
+#ifndef CRN_HUFFMAN_H
+#define CRN_HUFFMAN_H
+
+#include "crnlib.h"
+
+enum
+{
+	cCRNHuffMaxSupportedSyms   = 8192,
+	cCRNHuffMaxCodeSize        = 16,
+	cCRNHuffMaxTableBits       = 11,
+
+	// Code length alphabet used to transmit a model's code sizes.
+	cCRNHuffMaxCodelengthCodes = 21,
+	cCRNHuffSmallZeroRunCode   = 17,
+	cCRNHuffLargeZeroRunCode   = 18,
+	cCRNHuffSmallRepeatCode    = 19,
+	cCRNHuffLargeRepeatCode    = 20,
+
+	cCRNHuffMinSmallZeroRunSize    = 3,
+	cCRNHuffMaxSmallZeroRunSize    = 10,
+	cCRNHuffSmallZeroRunExtraBits  = 3,
+	cCRNHuffMinLargeZeroRunSize    = 11,
+	cCRNHuffMaxLargeZeroRunSize    = 138,
+	cCRNHuffLargeZeroRunExtraBits  = 7,
+	cCRNHuffSmallMinNonZeroRunSize = 3,
+	cCRNHuffSmallMaxNonZeroRunSize = 6,
+	cCRNHuffSmallNonZeroRunExtraBits = 2,
+	cCRNHuffLargeMinNonZeroRunSize = 7,
+	cCRNHuffLargeMaxNonZeroRunSize = 70,
+	cCRNHuffLargeNonZeroRunExtraBits = 6
+};
+
+// Order in which code length code sizes are transmitted, most probable first.
+extern const crn_uint8 g_crn_most_probable_codelength_codes[cCRNHuffMaxCodelengthCodes];
+
+// Table driven canonical Huffman decoder.
+// Codes up to table_bits long resolve with a single lookup, longer codes fall back to a per-length canonical search.
+typedef struct
+{
+	crn_uint32  num_syms;
+	crn_uint32  table_bits;
+	crn_uint32  max_code_size;
+	crn_uint32* pLookup;     // (code_size << 16) | symbol, or 0 when the prefix needs the slow path
+	crn_uint16* pSorted_syms;
+	crn_uint32  num_sorted_syms;
+	crn_uint32  max_codes[cCRNHuffMaxCodeSize + 1]; // one past the last left justified 16-bit code of each size
+	crn_int32   val_ptrs[cCRNHuffMaxCodeSize + 1];
+} crn_huff_decoder;
+
+crn_bool crn_huff_decoder_init(crn_huff_decoder* pModel, crn_uint32 num_syms, const crn_uint8* pCode_sizes, crn_uint32 table_bits);
+void crn_huff_decoder_free(crn_huff_decoder* pModel);
+
+typedef struct
+{
+	const crn_uint8* pBuf;
+	const crn_uint8* pBuf_end;
+	crn_uint64       bit_buf;  // next bit is the MSB
+	crn_int32        bit_count;
+} crn_bit_reader;
+
+static inline void crn_bit_reader_init(crn_bit_reader* pReader, const void* pBuf, crn_uint32 buf_size)
+{
+	pReader->pBuf = (const crn_uint8*)pBuf;
+	pReader->pBuf_end = pReader->pBuf + buf_size;
+	pReader->bit_buf = 0;
+	pReader->bit_count = 0;
+}
+
+static inline void crn_bit_reader_refill(crn_bit_reader* pReader)
+{
+	while (pReader->bit_count <= 56)
+	{
+		crn_uint64 c = (pReader->pBuf < pReader->pBuf_end) ? *pReader->pBuf++ : 0;
+		pReader->bit_buf |= c << (56 - pReader->bit_count);
+		pReader->bit_count += 8;
+	}
+}
+
+static inline crn_uint32 crn_bit_reader_get_bits(crn_bit_reader* pReader, crn_uint32 num_bits)
+{
+	crn_uint32 v;
+	if (!num_bits)
+		return 0;
+	if (pReader->bit_count < (crn_int32)num_bits)
+		crn_bit_reader_refill(pReader);
+	v = (crn_uint32)(pReader->bit_buf >> (64 - num_bits));
+	pReader->bit_buf <<= num_bits;
+	pReader->bit_count -= num_bits;
+	return v;
+}
+
+static inline crn_uint32 crn_bit_reader_decode(crn_bit_reader* pReader, const crn_huff_decoder* pModel)
+{
+	crn_uint32 k, t, len, sym;
+	if (pReader->bit_count < cCRNHuffMaxCodeSize)
+		crn_bit_reader_refill(pReader);
+
+	k = (crn_uint32)(pReader->bit_buf >> 48);
+	t = pModel->pLookup[k >> (16 - pModel->table_bits)];
+	if (t)
+	{
+		len = t >> 16;
+		sym = t & 0xFFFF;
+	}
+	else
+	{
+		len = pModel->table_bits + 1;
+		while (len < pModel->max_code_size && k >= pModel->max_codes[len])
+			len++;
+		sym = (crn_uint32)(pModel->val_ptrs[len] + (crn_int32)(k >> (16 - len)));
+		sym = pModel->pSorted_syms[sym < pModel->num_sorted_syms ? sym : 0];
+	}
+
+	pReader->bit_buf <<= len;
+	pReader->bit_count -= len;
+	return sym;
+}
+
+// Reads a model's run-length coded code sizes from the stream and initializes pModel from them.
+crn_bool crn_bit_reader_receive_model(crn_bit_reader* pReader, crn_huff_decoder* pModel);
+
+// Length limited canonical Huffman encoder, built from symbol frequencies.
+typedef struct
+{
+	crn_uint32  num_syms;
+	crn_uint8*  pCode_sizes;
+	crn_uint16* pCodes;
+} crn_huff_encoder;
+
+crn_bool crn_huff_encoder_init(crn_huff_encoder* pModel, crn_uint32 num_syms, const crn_uint32* pFreq, crn_uint32 max_code_size);
+void crn_huff_encoder_free(crn_huff_encoder* pModel);
+
+// Total number of bits needed to code the given frequencies with pModel, not including the model itself.
+crn_uint64 crn_huff_encoder_cost(const crn_huff_encoder* pModel, const crn_uint32* pFreq);
+
+// Growable MSB-first bit writer.
+typedef struct
+{
+	crn_uint8* pBuf;
+	crn_uint32 size;
+	crn_uint32 capacity;
+	crn_uint64 bit_buf;
+	crn_uint32 bit_count;
+	crn_bool   failed;
+} crn_bit_writer;
+
+void crn_bit_writer_init(crn_bit_writer* pWriter);
+void crn_bit_writer_free(crn_bit_writer* pWriter);
+void crn_bit_writer_put_bits(crn_bit_writer* pWriter, crn_uint32 bits, crn_uint32 num_bits);
+// Pads the stream to a byte boundary, returns false if any allocation failed while writing.
+crn_bool crn_bit_writer_flush(crn_bit_writer* pWriter);
+
+static inline void crn_bit_writer_encode(crn_bit_writer* pWriter, const crn_huff_encoder* pModel, crn_uint32 sym)
+{
+	crn_bit_writer_put_bits(pWriter, pModel->pCodes[sym], pModel->pCode_sizes[sym]);
+}
+
+// Writes a model's code sizes in the form read by crn_bit_reader_receive_model().
+void crn_bit_writer_send_model(crn_bit_writer* pWriter, const crn_huff_encoder* pModel);
+
+#endif // CRN_HUFFMAN_H
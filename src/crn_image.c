@@ -0,0 +1,80 @@
+#include "crn_image.h"
+#include "crn_core.h"
+
+#define STBI_NO_STDIO
+#define STBI_MALLOC(size)     crn_malloc(size)
+#define STBI_REALLOC(p, size) crn_realloc(p, size)
+#define STBI_FREE(p)          crn_free(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+crn_uint32* crn_image_load(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight, crn_uint32* pNum_images, int** ppDelays)
+{
+	const stbi_uc* pFile = (const stbi_uc*)pData;
+	stbi_uc* pPixels;
+	int* pDelays = NULL;
+	int w = 0, h = 0, n = 1, comps;
+
+	if (!pData || !size || size > 0x7FFFFFFF)
+		return NULL;
+
+	if (size >= 4 && !memcmp(pFile, "GIF8", 4))
+		pPixels = stbi_load_gif_from_memory(pFile, (int)size, &pDelays, &w, &h, &n, &comps, 4);
+	else
+		pPixels = stbi_load_from_memory(pFile, (int)size, &w, &h, &comps, 4);
+	if (!pPixels || w <= 0 || h <= 0 || n <= 0)
+	{
+		crn_free(pPixels);
+		crn_free(pDelays);
+		return NULL;
+	}
+
+	*pWidth = (crn_uint32)w;
+	*pHeight = (crn_uint32)h;
+	*pNum_images = (crn_uint32)n;
+	if (ppDelays)
+		*ppDelays = pDelays;
+	else
+		crn_free(pDelays);
+	return (crn_uint32*)pPixels;
+}
+
+float* crn_image_load_hdr(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight)
+{
+	float* pPixels;
+	int w = 0, h = 0, comps;
+
+	if (!pData || !size || size > 0x7FFFFFFF)
+		return NULL;
+
+	pPixels = stbi_loadf_from_memory((const stbi_uc*)pData, (int)size, &w, &h, &comps, 4);
+	if (!pPixels || w <= 0 || h <= 0)
+	{
+		crn_free(pPixels);
+		return NULL;
+	}
+
+	*pWidth = (crn_uint32)w;
+	*pHeight = (crn_uint32)h;
+	return pPixels;
+}
+
+crn_uint16* crn_image_load_16(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight)
+{
+	crn_uint16* pPixels;
+	int w = 0, h = 0, comps;
+
+	if (!pData || !size || size > 0x7FFFFFFF)
+		return NULL;
+
+	pPixels = stbi_load_16_from_memory((const stbi_uc*)pData, (int)size, &w, &h, &comps, 4);
+	if (!pPixels || w <= 0 || h <= 0)
+	{
+		crn_free(pPixels);
+		return NULL;
+	}
+
+	*pWidth = (crn_uint32)w;
+	*pHeight = (crn_uint32)h;
+	return pPixels;
+}
@@ -0,0 +1,21 @@
+// File: crn_image.h - Image file decoding (through stb_image) for crn_load_image(), crn_load_image_hdr() and
+// crn_load_image_16().
+#ifndef CRN_IMAGE_H
+#define CRN_IMAGE_H
+
+#include "crnlib.h"
+
+// Decodes a file in memory to RGBA pixels, see crn_load_image(). GIFs are recognized by their signature and decoded
+// frame by frame, composited onto the full canvas; stb_image's delays are already in milliseconds. The pixels and
+// delays are allocated with crn_malloc().
+crn_uint32* crn_image_load(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight, crn_uint32* pNum_images, int** ppDelays);
+
+// Decodes a file in memory to RGBA float pixels, see crn_load_image_hdr(). stb_image converts LDR files itself, with
+// its default 2.2 gamma. The pixels are allocated with crn_malloc().
+float* crn_image_load_hdr(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight);
+
+// Decodes a file in memory to 16-bit RGBA pixels, see crn_load_image_16(). stb_image widens 8-bit files itself. The
+// pixels are allocated with crn_malloc().
+crn_uint16* crn_image_load_16(const void* pData, crn_uint32 size, crn_uint32* pWidth, crn_uint32* pHeight);
+
+#endif // CRN_IMAGE_H
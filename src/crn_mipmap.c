@@ -0,0 +1,785 @@
+#include "crn_mipmap.h"
+#include "crn_core.h"
+#include "crn_threading.h"
+
+#include <math.h>
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+// -------- Filter kernels
+
+// Kernels take a distance in (scaled) source texels and are zero beyond their support.
+
+static float crn_mip_sinc(float x)
+{
+	x *= 3.14159265f;
+	return (fabsf(x) < 1e-5f) ? 1.0f : sinf(x) / x;
+}
+
+static float crn_mip_box(float x)
+{
+	return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+}
+
+static float crn_mip_tent(float x)
+{
+	x = fabsf(x);
+	return (x < 1.0f) ? 1.0f - x : 0.0f;
+}
+
+static float crn_mip_lanczos4(float x)
+{
+	return (fabsf(x) < 4.0f) ? crn_mip_sinc(x) * crn_mip_sinc(x * 0.25f) : 0.0f;
+}
+
+// Mitchell-Netravali with B = C = 1/3.
+static float crn_mip_mitchell(float x)
+{
+	const float b = 1.0f / 3.0f, c = 1.0f / 3.0f;
+	x = fabsf(x);
+	if (x < 1.0f)
+		return ((12.0f - 9.0f * b - 6.0f * c) * x * x * x + (-18.0f + 12.0f * b + 6.0f * c) * x * x + (6.0f - 2.0f * b)) * (1.0f / 6.0f);
+	if (x < 2.0f)
+		return ((-b - 6.0f * c) * x * x * x + (6.0f * b + 30.0f * c) * x * x + (-12.0f * b - 48.0f * c) * x + (8.0f * b + 24.0f * c)) * (1.0f / 6.0f);
+	return 0.0f;
+}
+
+// Zeroth order modified Bessel function of the first kind.
+static double crn_mip_bessel0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32 && term > sum * 1e-12; k++)
+	{
+		term *= (x * 0.5 / k) * (x * 0.5 / k);
+		sum += term;
+	}
+	return sum;
+}
+
+// Sinc with a Kaiser window over a support of 3, shaped for 40 dB of stopband attenuation.
+static float crn_mip_kaiser(float x)
+{
+	const double alpha = 0.5842 * pow(40.0 - 21.0, 0.4) + 0.07886 * (40.0 - 21.0);
+	const double ratio = x / 3.0;
+	if (fabs(ratio) >= 1.0)
+		return 0.0f;
+	return crn_mip_sinc(x) * (float)(crn_mip_bessel0(alpha * sqrt(1.0 - ratio * ratio)) / crn_mip_bessel0(alpha));
+}
+
+typedef struct
+{
+	float (*pFunc)(float x);
+	float support;
+} crn_mip_kernel;
+
+static const crn_mip_kernel g_crn_mip_kernels[cCRNMipFilterTotal] =
+{
+	{ crn_mip_box, 0.5f },
+	{ crn_mip_tent, 1.0f },
+	{ crn_mip_lanczos4, 4.0f },
+	{ crn_mip_mitchell, 2.0f },
+	{ crn_mip_kaiser, 3.0f }
+};
+
+// -------- Resampling
+
+// Source texels and normalized weights contributing to each destination texel along one axis. Edges are resolved here,
+// clamped or wrapped, so the filter loops just follow the indices. Destination texel i uses taps pOfs[i] to
+// pOfs[i + 1] - 1.
+typedef struct
+{
+	crn_uint32* pOfs;
+	crn_uint32* pIndex;
+	float* pWeight;
+} crn_mip_axis;
+
+static void crn_mip_axis_free(crn_mip_axis* pAxis)
+{
+	crn_free(pAxis->pOfs);
+	crn_free(pAxis->pIndex);
+	crn_free(pAxis->pWeight);
+	memset(pAxis, 0, sizeof(*pAxis));
+}
+
+// A source with borders has border extra texels on either side, which shifts every index by border.
+static crn_uint32 crn_mip_address(int i, crn_uint32 size, crn_bool wrap, crn_uint32 border)
+{
+	if (wrap)
+		return (crn_uint32)(((i % (int)size) + (int)size) % (int)size);
+	return (crn_uint32)(CRN_CLAMP(i, -(int)border, (int)(size + border) - 1) + (int)border);
+}
+
+// Source texels the kernel reaches on either side of a destination texel's center. The kernel is stretched by the
+// reduction factor when minifying, and by blurriness in either direction.
+static float crn_mip_half_width(crn_uint32 src_size, crn_uint32 dst_size, const crn_mip_kernel* pKernel, float blurriness)
+{
+	const float scale = (float)dst_size / (float)src_size;
+	return pKernel->support / (CRN_MIN(scale, 1.0f) / CRN_MAX(blurriness, 1e-3f));
+}
+
+static crn_bool crn_mip_axis_init(crn_mip_axis* pAxis, crn_uint32 src_size, crn_uint32 dst_size, const crn_mip_kernel* pKernel, float blurriness, crn_bool wrap, crn_uint32 border)
+{
+	const float scale = (float)dst_size / (float)src_size;
+	const float filter_scale = CRN_MIN(scale, 1.0f) / CRN_MAX(blurriness, 1e-3f);
+	const float half_width = crn_mip_half_width(src_size, dst_size, pKernel, blurriness);
+	const crn_uint32 max_taps = (crn_uint32)ceilf(half_width * 2.0f) + 1;
+	crn_uint32 n = 0;
+
+	memset(pAxis, 0, sizeof(*pAxis));
+	pAxis->pOfs = (crn_uint32*)crn_malloc((dst_size + 1) * sizeof(crn_uint32));
+	pAxis->pIndex = (crn_uint32*)crn_malloc((size_t)dst_size * max_taps * sizeof(crn_uint32));
+	pAxis->pWeight = (float*)crn_malloc((size_t)dst_size * max_taps * sizeof(float));
+	if (!pAxis->pOfs || !pAxis->pIndex || !pAxis->pWeight)
+	{
+		crn_mip_axis_free(pAxis);
+		return crn_false;
+	}
+
+	for (crn_uint32 i = 0; i < dst_size; i++)
+	{
+		const float center = ((float)i + 0.5f) / scale - 0.5f;
+		const int lo = (int)ceilf(center - half_width), hi = (int)floorf(center + half_width);
+		const crn_uint32 first = n;
+		float total = 0.0f;
+
+		pAxis->pOfs[i] = n;
+		for (int j = lo; j <= hi && n - first < max_taps; j++)
+		{
+			const float w = pKernel->pFunc(((float)j - center) * filter_scale);
+			if (w == 0.0f)
+				continue;
+			pAxis->pIndex[n] = crn_mip_address(j, src_size, wrap, border);
+			pAxis->pWeight[n++] = w;
+			total += w;
+		}
+
+		if (fabsf(total) < 1e-6f)
+		{
+			// Kernels this narrow fall between texel centers: take the nearest texel.
+			n = first;
+			pAxis->pIndex[n] = crn_mip_address((int)floorf(center + 0.5f), src_size, wrap, border);
+			pAxis->pWeight[n++] = 1.0f;
+		}
+		else
+		{
+			for (crn_uint32 t = first; t < n; t++)
+				pAxis->pWeight[t] /= total;
+		}
+	}
+	pAxis->pOfs[dst_size] = n;
+	return crn_true;
+}
+
+// -------- Gamma
+
+enum
+{
+	cCRNMipGammaSteps     = 4096,
+	cCRNMipWideGammaSteps = 16384
+};
+
+// Tables for filtering gamma encoded channels in linear light, with the alpha channel left as is. Linear values stay on
+// the 0-255 scale. The encoding table is indexed by the square root of linear / 255, which spreads its 12 bits evenly
+// enough over the curve that every step stays well under one 8-bit level, even in the darks. 16-bit images decode
+// through a table of every value, and encode by interpolating a finer table indexed the same way, which stays within
+// half a 16-bit level of the exact curve.
+typedef struct
+{
+	float to_linear[256][4];
+	crn_uint8 to_gamma[cCRNMipGammaSteps];
+	crn_uint32 alpha_component;
+	float gamma;
+	float* pWide_to_linear;   // Color channels of 16-bit images, 65536 entries; NULL for 8-bit images
+	float* pWide_to_gamma;    // 0-65535 encoded values, cCRNMipWideGammaSteps + 1 entries; NULL for 8-bit images
+} crn_mip_gamma;
+
+// Returns false if a 16-bit image's table can't be allocated.
+static crn_bool crn_mip_gamma_init(crn_mip_gamma* pGamma, float gamma, crn_uint32 alpha_component, crn_bool wide)
+{
+	for (crn_uint32 v = 0; v < 256; v++)
+	{
+		for (crn_uint32 c = 0; c < 4; c++)
+			pGamma->to_linear[v][c] = (c == alpha_component) ? (float)v : 255.0f * powf((float)v / 255.0f, gamma);
+	}
+	for (crn_uint32 i = 0; i < cCRNMipGammaSteps; i++)
+		pGamma->to_gamma[i] = (crn_uint8)(255.0f * powf((float)i / (cCRNMipGammaSteps - 1), 2.0f / gamma) + 0.5f);
+	pGamma->alpha_component = alpha_component;
+	pGamma->gamma = gamma;
+	pGamma->pWide_to_linear = pGamma->pWide_to_gamma = NULL;
+	if (!wide)
+		return crn_true;
+	pGamma->pWide_to_linear = (float*)crn_malloc(65536 * sizeof(float));
+	pGamma->pWide_to_gamma = (float*)crn_malloc((cCRNMipWideGammaSteps + 1) * sizeof(float));
+	if (!pGamma->pWide_to_linear || !pGamma->pWide_to_gamma)
+		return crn_false;
+	for (crn_uint32 v = 0; v < 65536; v++)
+		pGamma->pWide_to_linear[v] = 255.0f * powf((float)v / 65535.0f, gamma);
+	for (crn_uint32 i = 0; i <= cCRNMipWideGammaSteps; i++)
+		pGamma->pWide_to_gamma[i] = 65535.0f * powf((float)i / cCRNMipWideGammaSteps, 2.0f / gamma);
+	return crn_true;
+}
+
+// Rounds 4 filtered linear pixels to 8-bit gamma encoded ones.
+static void crn_mip_store_gamma(const crn_mip_gamma* pGamma, const float pixels[4][4], crn_uint8* pDst)
+{
+	crn_uint32 steps[16], values[16];
+#if CRN_SSE2
+	const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(255.0f), to_unit = _mm_set1_ps(1.0f / 255.0f);
+	const __m128 to_steps = _mm_set1_ps((float)(cCRNMipGammaSteps - 1)), half = _mm_set1_ps(0.5f);
+	for (int i = 0; i < 4; i++)
+	{
+		const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pixels[i]), lo), hi);
+		_mm_storeu_si128((__m128i*)(steps + i * 4), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_mul_ps(v, to_unit)), to_steps), half)));
+		_mm_storeu_si128((__m128i*)(values + i * 4), _mm_cvttps_epi32(_mm_add_ps(v, half)));
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		const float v = CRN_CLAMP(pixels[i >> 2][i & 3], 0.0f, 255.0f);
+		steps[i] = (crn_uint32)(sqrtf(v * (1.0f / 255.0f)) * (cCRNMipGammaSteps - 1) + 0.5f);
+		values[i] = (crn_uint32)(v + 0.5f);
+	}
+#endif
+	for (crn_uint32 i = 0; i < 16; i++)
+		pDst[i] = ((i & 3) == pGamma->alpha_component) ? (crn_uint8)values[i] : pGamma->to_gamma[steps[i]];
+}
+
+// -------- Filtering
+
+// All faces of a level are filtered by one parallel_for, whose row y is row y % dst_height of face y / dst_height.
+typedef struct
+{
+	const crn_uint8* pSrc[cCRNMaxFaces];   // First texel of each face's source window
+	crn_uint32 src_pitch;                  // Bytes between source rows
+	crn_uint32 src_width;                  // Source window texels per row
+	crn_uint32 src_height;
+	crn_uint32 border;                     // Texels around each source face in pBorders, 0 for none
+	const crn_uint8* pBorders;             // Per face: top and bottom strips of padded rows, then left and right strips
+	crn_uint8* pDst[cCRNMaxFaces];
+	crn_uint32 channel_size;               // Bytes per channel: 1, 2 for 16-bit images, or 4 for float images (BC6H)
+	crn_uint32 dst_width;
+	crn_uint32 dst_height;
+	const crn_mip_axis* pX;
+	const crn_mip_axis* pY;
+	crn_bool renormalize;
+	const crn_mip_gamma* pGamma;   // NULL to filter the stored values directly
+	float* pRows;   // One row of src_width + 2 * border RGBA floats per thread
+} crn_mip_job;
+
+static size_t crn_mip_border_size(crn_uint32 width, crn_uint32 height, crn_uint32 border, crn_uint32 channel_size)
+{
+	return ((size_t)(width + border * 2) * border * 2 + (size_t)height * border * 2) * 4 * channel_size;
+}
+
+// Rescales the RGB of 4 filtered pixels (0-255 floats, mapped to [-1,1]) back to unit vectors. Vectors that filtered
+// down to (nearly) nothing are left alone.
+static void crn_mip_renormalize(float pixels[4][4])
+{
+#if CRN_SSE2
+	const __m128 to_signed = _mm_set1_ps(2.0f / 255.0f), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(127.5f);
+	__m128 r = _mm_loadu_ps(pixels[0]), g = _mm_loadu_ps(pixels[1]), b = _mm_loadu_ps(pixels[2]), a = _mm_loadu_ps(pixels[3]);
+	__m128 len2, inv, valid;
+
+	_MM_TRANSPOSE4_PS(r, g, b, a);
+	r = _mm_sub_ps(_mm_mul_ps(r, to_signed), one);
+	g = _mm_sub_ps(_mm_mul_ps(g, to_signed), one);
+	b = _mm_sub_ps(_mm_mul_ps(b, to_signed), one);
+	len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(g, g)), _mm_mul_ps(b, b));
+	valid = _mm_cmpgt_ps(len2, _mm_set1_ps(1e-8f));
+
+	// Estimate plus one Newton-Raphson step, about 22 bits.
+	inv = _mm_rsqrt_ps(_mm_max_ps(len2, _mm_set1_ps(1e-8f)));
+	inv = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), inv), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(len2, inv), inv)));
+	inv = _mm_or_ps(_mm_and_ps(valid, inv), _mm_andnot_ps(valid, one));
+
+	r = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(r, inv), one), half);
+	g = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(g, inv), one), half);
+	b = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(b, inv), one), half);
+	_MM_TRANSPOSE4_PS(r, g, b, a);
+	_mm_storeu_ps(pixels[0], r);
+	_mm_storeu_ps(pixels[1], g);
+	_mm_storeu_ps(pixels[2], b);
+	_mm_storeu_ps(pixels[3], a);
+#else
+	for (crn_uint32 i = 0; i < 4; i++)
+	{
+		float v[3], len2 = 0.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			v[c] = pixels[i][c] * (2.0f / 255.0f) - 1.0f;
+			len2 += v[c] * v[c];
+		}
+		if (len2 > 1e-8f)
+		{
+			const float inv = 1.0f / sqrtf(len2);
+			for (int c = 0; c < 3; c++)
+				pixels[i][c] = (v[c] * inv + 1.0f) * 127.5f;
+		}
+	}
+#endif
+}
+
+// Rounds 4 filtered pixels to 8 bits.
+static void crn_mip_store(const float pixels[4][4], crn_uint8* pDst)
+{
+#if CRN_SSE2
+	const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(255.0f);
+	__m128i v[4];
+	for (int i = 0; i < 4; i++)
+		v[i] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(pixels[i]), lo), hi));
+	_mm_storeu_si128((__m128i*)pDst, _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		const float v = pixels[i >> 2][i & 3];
+		pDst[i] = (crn_uint8)(CRN_CLAMP(v, 0.0f, 255.0f) + 0.5f);
+	}
+#endif
+}
+
+// Rounds n filtered pixels (0-255 floats, like 8-bit ones) to 16 bits, re-encoding color channels with pGamma's
+// gamma unless it's NULL.
+static void crn_mip_store16(const crn_mip_gamma* pGamma, const float pixels[4][4], crn_uint16* pDst, crn_uint32 n)
+{
+	for (crn_uint32 i = 0; i < n * 4; i++)
+	{
+		const float v = CRN_CLAMP(pixels[i >> 2][i & 3], 0.0f, 255.0f) * (1.0f / 255.0f);
+		if (pGamma && (i & 3) != pGamma->alpha_component)
+		{
+			const float x = sqrtf(v) * cCRNMipWideGammaSteps;
+			const crn_uint32 step = CRN_MIN((crn_uint32)x, (crn_uint32)cCRNMipWideGammaSteps - 1);
+			const float* pTable = pGamma->pWide_to_gamma + step;
+			pDst[i] = (crn_uint16)(pTable[0] + (pTable[1] - pTable[0]) * (x - (float)step) + 0.5f);
+		}
+		else
+			pDst[i] = (crn_uint16)(v * 65535.0f + 0.5f);
+	}
+}
+
+// Stores n filtered float pixels. Negative lobes of the sharper kernels can ring below black, which is clamped off.
+static void crn_mip_store_hdr(const float pixels[4][4], float* pDst, crn_uint32 n)
+{
+#if CRN_SSE2
+	for (crn_uint32 i = 0; i < n; i++)
+		_mm_storeu_ps(pDst + i * 4, _mm_max_ps(_mm_loadu_ps(pixels[i]), _mm_setzero_ps()));
+#else
+	for (crn_uint32 i = 0; i < n * 4; i++)
+		pDst[i] = CRN_MAX(pixels[i >> 2][i & 3], 0.0f);
+#endif
+}
+
+// Adds size channels of source texels, times w, to pRow. Float sources (channel_size 4) are taken as is, 16-bit ones
+// are scaled to the 0-255 range of 8-bit ones.
+static void crn_mip_accumulate(float* pRow, const crn_uint8* pSrc, crn_uint32 size, float w, const crn_mip_gamma* pGamma, crn_uint32 channel_size)
+{
+	crn_uint32 i = 0;
+	if (channel_size == 4)
+	{
+		const float* pFloats = (const float*)pSrc;
+#if CRN_SSE2
+		const __m128 wv = _mm_set1_ps(w);
+		for (; i < size; i += 4)
+			_mm_storeu_ps(pRow + i, _mm_add_ps(_mm_loadu_ps(pRow + i), _mm_mul_ps(_mm_loadu_ps(pFloats + i), wv)));
+#else
+		for (; i < size; i++)
+			pRow[i] += w * pFloats[i];
+#endif
+		return;
+	}
+	if (channel_size == 2)
+	{
+		const crn_uint16* pWide = (const crn_uint16*)pSrc;
+		const float ws = w * (255.0f / 65535.0f);
+		if (pGamma)
+		{
+			for (; i < size; i++)
+				pRow[i] += ((i & 3) == pGamma->alpha_component) ? ws * (float)pWide[i] : w * pGamma->pWide_to_linear[pWide[i]];
+			return;
+		}
+#if CRN_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 wv = _mm_set1_ps(ws);
+		for (; i + 8 <= size; i += 8)
+		{
+			const __m128i words = _mm_loadu_si128((const __m128i*)(pWide + i));
+			_mm_storeu_ps(pRow + i, _mm_add_ps(_mm_loadu_ps(pRow + i), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)), wv)));
+			_mm_storeu_ps(pRow + i + 4, _mm_add_ps(_mm_loadu_ps(pRow + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)), wv)));
+		}
+#endif
+		for (; i < size; i++)
+			pRow[i] += ws * (float)pWide[i];
+		return;
+	}
+	if (pGamma)
+	{
+		// Decoded to linear on the way in, a pixel per table lookup of each channel.
+		const float (*pTable)[4] = pGamma->to_linear;
+#if CRN_SSE2
+		const __m128 wv = _mm_set1_ps(w);
+		for (; i < size; i += 4)
+		{
+			const __m128 v = _mm_set_ps(pTable[pSrc[i + 3]][3], pTable[pSrc[i + 2]][2], pTable[pSrc[i + 1]][1], pTable[pSrc[i]][0]);
+			_mm_storeu_ps(pRow + i, _mm_add_ps(_mm_loadu_ps(pRow + i), _mm_mul_ps(v, wv)));
+		}
+#else
+		for (; i < size; i++)
+			pRow[i] += w * pTable[pSrc[i]][i & 3];
+#endif
+		return;
+	}
+#if CRN_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 wv = _mm_set1_ps(w);
+	for (; i + 16 <= size; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128((const __m128i*)(pSrc + i));
+		const __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+		_mm_storeu_ps(pRow + i, _mm_add_ps(_mm_loadu_ps(pRow + i), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), wv)));
+		_mm_storeu_ps(pRow + i + 4, _mm_add_ps(_mm_loadu_ps(pRow + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), wv)));
+		_mm_storeu_ps(pRow + i + 8, _mm_add_ps(_mm_loadu_ps(pRow + i + 8), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), wv)));
+		_mm_storeu_ps(pRow + i + 12, _mm_add_ps(_mm_loadu_ps(pRow + i + 12), _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), wv)));
+	}
+#endif
+	for (; i < size; i++)
+		pRow[i] += w * (float)pSrc[i];
+}
+
+static void crn_mip_filter_row(crn_uint32 y, crn_uint32 thread_index, void* pData)
+{
+	const crn_mip_job* pJob = (const crn_mip_job*)pData;
+	const crn_uint32 face = y / pJob->dst_height, border = pJob->border, src_h = pJob->src_height, cs = pJob->channel_size;
+	const crn_uint32 face_row_size = pJob->src_width * 4, border_size = border * 4, row_size = face_row_size + border_size * 2;
+	const crn_bool hdr = cs == 4;
+	float* pRow = pJob->pRows + (size_t)thread_index * row_size;
+	crn_uint8* pDst = pJob->pDst[face] + (size_t)(y % pJob->dst_height) * pJob->dst_width * 4 * cs;
+
+	// Vertical pass into a float row of source texels. Rows and columns past the face's edges come from its borders.
+	memset(pRow, 0, row_size * sizeof(float));
+	for (crn_uint32 t = pJob->pY->pOfs[y % pJob->dst_height]; t < pJob->pY->pOfs[y % pJob->dst_height + 1]; t++)
+	{
+		const int r = (int)pJob->pY->pIndex[t] - (int)border;
+		const float w = pJob->pY->pWeight[t];
+		if (border)
+		{
+			const crn_uint8* pTop = pJob->pBorders + crn_mip_border_size(pJob->src_width, src_h, border, cs) * face;
+			const crn_uint8* pLeft = pTop + (size_t)row_size * border * 2 * cs;
+			if (r < 0 || r >= (int)src_h)
+			{
+				const crn_uint32 strip_row = (r < 0) ? (crn_uint32)(r + (int)border) : border + (crn_uint32)r - src_h;
+				crn_mip_accumulate(pRow, pTop + (size_t)strip_row * row_size * cs, row_size, w, pJob->pGamma, cs);
+				continue;
+			}
+			crn_mip_accumulate(pRow, pLeft + (size_t)r * border_size * cs, border_size, w, pJob->pGamma, cs);
+			crn_mip_accumulate(pRow + border_size + face_row_size, pLeft + ((size_t)src_h + r) * border_size * cs, border_size, w, pJob->pGamma, cs);
+		}
+		crn_mip_accumulate(pRow + border_size, pJob->pSrc[face] + (size_t)r * pJob->src_pitch, face_row_size, w, pJob->pGamma, cs);
+	}
+
+	// Horizontal pass, 4 destination pixels at a time.
+	for (crn_uint32 x = 0; x < pJob->dst_width; x += 4)
+	{
+		const crn_uint32 n = CRN_MIN(pJob->dst_width - x, 4U);
+		float pixels[4][4];
+		crn_uint8 out[16];
+
+		memset(pixels, 0, sizeof(pixels));
+		for (crn_uint32 i = 0; i < n; i++)
+		{
+#if CRN_SSE2
+			__m128 acc = _mm_setzero_ps();
+			for (crn_uint32 t = pJob->pX->pOfs[x + i]; t < pJob->pX->pOfs[x + i + 1]; t++)
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(pRow + pJob->pX->pIndex[t] * 4), _mm_set1_ps(pJob->pX->pWeight[t])));
+			_mm_storeu_ps(pixels[i], acc);
+#else
+			for (crn_uint32 t = pJob->pX->pOfs[x + i]; t < pJob->pX->pOfs[x + i + 1]; t++)
+				for (int c = 0; c < 4; c++)
+					pixels[i][c] += pRow[pJob->pX->pIndex[t] * 4 + c] * pJob->pX->pWeight[t];
+#endif
+		}
+
+		if (hdr)
+		{
+			crn_mip_store_hdr((const float (*)[4])pixels, (float*)pDst + x * 4, n);
+			continue;
+		}
+		if (pJob->renormalize)
+			crn_mip_renormalize(pixels);
+		if (cs == 2)
+		{
+			crn_mip_store16(pJob->pGamma, (const float (*)[4])pixels, (crn_uint16*)pDst + x * 4, n);
+			continue;
+		}
+		if (pJob->pGamma)
+			crn_mip_store_gamma(pJob->pGamma, (const float (*)[4])pixels, (n == 4) ? pDst + x * 4 : out);
+		else
+			crn_mip_store((const float (*)[4])pixels, (n == 4) ? pDst + x * 4 : out);
+		if (n < 4)
+			memcpy(pDst + x * 4, out, n * 4);
+	}
+}
+
+// -------- Cubemap seams
+
+// Texel (u, v) of a face, up to a face width outside it, folded over the cube's edges onto the face that holds it. A
+// texel n rows past an edge is the neighbor's texel n rows in from the shared edge. Corners fold over two edges.
+static const crn_uint8* crn_mip_cube_texel(const crn_uint8* const pFaces[cCRNMaxFaces], crn_uint32 size, crn_uint32 texel_size, crn_uint32 face, int u, int v)
+{
+	// Axis and sign of s and t on each face, in the D3D and GL order +X, -X, +Y, -Y, +Z, -Z.
+	static const signed char s_axes[6][4] =
+	{
+		{ 2, -1, 1, -1 }, { 2, 1, 1, -1 }, { 0, 1, 2, 1 }, { 0, 1, 2, -1 }, { 0, 1, 1, -1 }, { 0, -1, 1, -1 }
+	};
+
+	if (u < 0 || v < 0 || u >= (int)size || v >= (int)size)
+	{
+		int major = (int)face >> 1;
+		float d[3];
+
+		d[major] = (face & 1) ? -1.0f : 1.0f;
+		d[s_axes[face][0]] = s_axes[face][1] * ((2.0f * (float)u + 1.0f) / (float)size - 1.0f);
+		d[s_axes[face][2]] = s_axes[face][3] * ((2.0f * (float)v + 1.0f) / (float)size - 1.0f);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				const float over = fabsf(d[a]) - 1.0f;
+				if (a == major || over <= 0.0f)
+					continue;
+				d[major] = (d[major] < 0.0f) ? over - 1.0f : 1.0f - over;
+				d[a] = (d[a] < 0.0f) ? -1.0f : 1.0f;
+				major = a;
+			}
+		}
+
+		face = (crn_uint32)major * 2 + (d[major] < 0.0f);
+		u = (int)floorf((d[s_axes[face][0]] * s_axes[face][1] + 1.0f) * 0.5f * (float)size);
+		v = (int)floorf((d[s_axes[face][2]] * s_axes[face][3] + 1.0f) * 0.5f * (float)size);
+		u = CRN_CLAMP(u, 0, (int)size - 1);
+		v = CRN_CLAMP(v, 0, (int)size - 1);
+	}
+	return pFaces[face] + ((size_t)v * size + (crn_uint32)u) * texel_size;
+}
+
+// Fills each face's borders, laid out as crn_mip_job.pBorders, from the faces around it.
+static void crn_mip_cube_borders(crn_uint8* pBorders, const crn_uint8* const pFaces[cCRNMaxFaces], crn_uint32 size, crn_uint32 border, crn_uint32 channel_size)
+{
+	const int b = (int)border, n = (int)size;
+	const crn_uint32 ts = channel_size * 4;
+	for (crn_uint32 f = 0; f < 6; f++)
+	{
+		crn_uint8* pDst = pBorders + crn_mip_border_size(size, size, border, channel_size) * f;
+		for (int v = -b; v < 0; v++)
+			for (int u = -b; u < n + b; u++, pDst += ts)
+				memcpy(pDst, crn_mip_cube_texel(pFaces, size, ts, f, u, v), ts);
+		for (int v = n; v < n + b; v++)
+			for (int u = -b; u < n + b; u++, pDst += ts)
+				memcpy(pDst, crn_mip_cube_texel(pFaces, size, ts, f, u, v), ts);
+		for (int v = 0; v < n; v++)
+			for (int u = -b; u < 0; u++, pDst += ts)
+				memcpy(pDst, crn_mip_cube_texel(pFaces, size, ts, f, u, v), ts);
+		for (int v = 0; v < n; v++)
+			for (int u = n; u < n + b; u++, pDst += ts)
+				memcpy(pDst, crn_mip_cube_texel(pFaces, size, ts, f, u, v), ts);
+	}
+}
+
+// -------- Mip chain
+
+static crn_uint32 crn_mip_scale_pow2(crn_uint32 size, crn_scale_mode mode)
+{
+	crn_uint32 lower = 1;
+	while (lower * 2 <= size)
+		lower *= 2;
+	if (lower == size || mode == cCRNSMLowerPow2)
+		return lower;
+	if (mode == cCRNSMNextPow2)
+		return lower * 2;
+	return (size - lower < lower * 2 - size) ? lower : lower * 2;
+}
+
+static crn_uint32 crn_mip_scale_size(crn_uint32 size, float scale, crn_scale_mode mode, crn_uint32 clamp_size)
+{
+	switch (mode)
+	{
+	case cCRNSMAbsolute:
+		size = (crn_uint32)CRN_CLAMP(scale + 0.5f, 1.0f, (float)cCRNMaxSourceResolution);
+		break;
+	case cCRNSMRelative:
+		size = (crn_uint32)CRN_CLAMP((float)size * scale + 0.5f, 1.0f, (float)cCRNMaxSourceResolution);
+		break;
+	case cCRNSMLowerPow2:
+	case cCRNSMNearestPow2:
+	case cCRNSMNextPow2:
+		size = crn_mip_scale_pow2(size, mode);
+		break;
+	default:
+		break;
+	}
+	if (clamp_size)
+		size = CRN_MIN(size, clamp_size);
+	return CRN_MAX(size, 1U);
+}
+
+// Source window (left, top, right, bottom, exclusive) and top level size pMip_params asks for. Sizes past
+// cCRNMaxLevelResolution are scaled down to it, keeping the aspect ratio.
+static void crn_mip_get_size(const crn_comp_params* pParams, const crn_mipmap_params* pMip_params, crn_uint32 window[4], crn_uint32* pWidth, crn_uint32* pHeight)
+{
+	window[0] = 0;
+	window[1] = 0;
+	window[2] = pParams->width;
+	window[3] = pParams->height;
+	if (pMip_params->window_right > pMip_params->window_left && pMip_params->window_bottom > pMip_params->window_top)
+	{
+		window[0] = CRN_MIN(pMip_params->window_left, pParams->width - 1);
+		window[1] = CRN_MIN(pMip_params->window_top, pParams->height - 1);
+		window[2] = CRN_MIN(pMip_params->window_right + 1, pParams->width);
+		window[3] = CRN_MIN(pMip_params->window_bottom + 1, pParams->height);
+	}
+	*pWidth = crn_mip_scale_size(window[2] - window[0], pMip_params->scale_x, pMip_params->scale_mode, pMip_params->clamp_scale ? pMip_params->clamp_width : 0);
+	*pHeight = crn_mip_scale_size(window[3] - window[1], pMip_params->scale_y, pMip_params->scale_mode, pMip_params->clamp_scale ? pMip_params->clamp_height : 0);
+	if (*pWidth > cCRNMaxLevelResolution || *pHeight > cCRNMaxLevelResolution)
+	{
+		const float fit = (float)cCRNMaxLevelResolution / (float)CRN_MAX(*pWidth, *pHeight);
+		*pWidth = CRN_CLAMP((crn_uint32)((float)*pWidth * fit + 0.5f), 1U, (crn_uint32)cCRNMaxLevelResolution);
+		*pHeight = CRN_CLAMP((crn_uint32)((float)*pHeight * fit + 0.5f), 1U, (crn_uint32)cCRNMaxLevelResolution);
+	}
+}
+
+crn_bool crn_mipmap_build(const crn_comp_params* pParams, const crn_mipmap_params* pMip_params, crn_comp_params* pDst_params, void** ppLevels)
+{
+	const crn_uint32 num_threads = CRN_MIN(pParams->num_helper_threads, (crn_uint32)cCRNMaxHelperThreads) + 1;
+	const crn_uint32 max_levels = CRN_CLAMP(pMip_params->max_levels, 1U, (crn_uint32)cCRNMaxLevels);
+	const crn_uint32 min_size = CRN_MAX(pMip_params->min_mip_size, 1U);
+	const crn_mip_kernel* pKernel = &g_crn_mip_kernels[(pMip_params->filter < cCRNMipFilterTotal) ? pMip_params->filter : cCRNMipFilterKaiser];
+	const crn_uint32 cs = (pParams->format == cCRNFmtBC6H) ? sizeof(float) : (pParams->flags & cCRNCompFlagSource16) ? sizeof(crn_uint16) : 1;
+	crn_uint32 window[4], width, height, first_level, levels = 1, level_ofs[cCRNMaxLevels], face_size = 0;
+	crn_bool resample, seamless, generate = crn_true, ok = crn_true;
+	crn_uint8* pLevels;
+	crn_mip_job job;
+	crn_mip_gamma gamma;
+
+	*pDst_params = *pParams;
+	*ppLevels = NULL;
+	crn_mip_get_size(pParams, pMip_params, window, &width, &height);
+	resample = window[0] || window[1] || window[2] != pParams->width || window[3] != pParams->height || width != pParams->width || height != pParams->height;
+
+	// A resampled top level makes the source's own mips useless.
+	switch (pMip_params->mode)
+	{
+	case cCRNMipModeUseSourceMips:
+	case cCRNMipModeNoMips:
+		if (pMip_params->mode == cCRNMipModeNoMips)
+			pDst_params->levels = 1;
+		if (!resample)
+			return crn_true;
+		generate = crn_false;
+		break;
+	case cCRNMipModeUseSourceOrGenerateMips:
+		if (pParams->levels > 1 && !resample)
+			return crn_true;
+		break;
+	default:
+		break;
+	}
+
+	// Halve until the largest side is down to min_mip_size.
+	while (generate && levels < max_levels && CRN_MAX(CRN_MAX(width >> (levels - 1), 1U), CRN_MAX(height >> (levels - 1), 1U)) > min_size)
+		levels++;
+	pDst_params->width = width;
+	pDst_params->height = height;
+	pDst_params->levels = levels;
+	first_level = resample ? 0 : 1;
+	if (levels == first_level)
+		return crn_true;
+	// Cube faces are filtered across their edges, which needs square faces and the whole source.
+	seamless = pMip_params->seamless_cube && pParams->faces == 6 && width == height && window[2] - window[0] == window[3] - window[1] &&
+		!window[0] && !window[1] && window[2] == pParams->width && window[3] == pParams->height;
+
+	for (crn_uint32 l = first_level; l < levels; l++)
+	{
+		level_ofs[l] = face_size;
+		face_size += CRN_MAX(width >> l, 1U) * CRN_MAX(height >> l, 1U) * 4 * cs;
+	}
+	pLevels = (crn_uint8*)crn_malloc((size_t)face_size * pParams->faces);
+	memset(&job, 0, sizeof(job));
+	// Borders are at most a face wide on either side.
+	job.pRows = (float*)crn_malloc((size_t)num_threads * CRN_MAX(window[2] - window[0], width) * (seamless ? 3 : 1) * 4 * sizeof(float));
+	if (!pLevels || !job.pRows)
+	{
+		crn_free(pLevels);
+		crn_free(job.pRows);
+		return crn_false;
+	}
+	job.channel_size = cs;
+	job.renormalize = pMip_params->renormalize || pParams->format == cCRNFmtDXN_XY || pParams->format == cCRNFmtDXN_YX;
+	// Normal maps hold vectors, not light: they are filtered linearly whatever gamma_filtering says. Float images are
+	// linear already.
+	if (pMip_params->gamma_filtering && !job.renormalize && cs != sizeof(float) && pMip_params->gamma > 0.0f && pMip_params->gamma != 1.0f)
+	{
+		ok = crn_mip_gamma_init(&gamma, pMip_params->gamma, pParams->alpha_component, cs == sizeof(crn_uint16));
+		job.pGamma = &gamma;
+	}
+
+	// Level 0, when resampled, reads the source window directly: cropping and scaling are the same filter pass.
+	for (crn_uint32 l = first_level; ok && l < levels; l++)
+	{
+		const crn_uint32 src_w = l ? CRN_MAX(width >> (l - 1), 1U) : window[2] - window[0];
+		const crn_uint32 src_h = l ? CRN_MAX(height >> (l - 1), 1U) : window[3] - window[1];
+		const crn_uint32 dst_w = CRN_MAX(width >> l, 1U), dst_h = CRN_MAX(height >> l, 1U);
+		const crn_uint32 border = seamless ? CRN_MIN((crn_uint32)ceilf(crn_mip_half_width(src_w, dst_w, pKernel, pMip_params->blurriness)), src_w) : 0;
+		const crn_bool wrap = pMip_params->tiled && !seamless;
+		crn_uint8* pBorders = NULL;
+		crn_mip_axis x_axis, y_axis;
+
+		memset(&x_axis, 0, sizeof(x_axis));
+		memset(&y_axis, 0, sizeof(y_axis));
+		ok = crn_mip_axis_init(&x_axis, src_w, dst_w, pKernel, pMip_params->blurriness, wrap, border) &&
+			crn_mip_axis_init(&y_axis, src_h, dst_h, pKernel, pMip_params->blurriness, wrap, border);
+		if (ok && border)
+			ok = (pBorders = (crn_uint8*)crn_malloc(crn_mip_border_size(src_w, src_h, border, cs) * 6)) != NULL;
+
+		if (ok)
+		{
+			job.pX = &x_axis;
+			job.pY = &y_axis;
+			job.src_pitch = (l ? src_w : pParams->width) * 4 * cs;
+			job.src_width = src_w;
+			job.src_height = src_h;
+			job.dst_width = dst_w;
+			job.dst_height = dst_h;
+			for (crn_uint32 f = 0; f < pParams->faces; f++)
+			{
+				if (l)
+					job.pSrc[f] = (const crn_uint8*)pDst_params->pImages[f][l - 1];
+				else
+					job.pSrc[f] = (const crn_uint8*)pParams->pImages[f][0] + ((size_t)window[1] * pParams->width + window[0]) * 4 * cs;
+				job.pDst[f] = pLevels + (size_t)f * face_size + level_ofs[l];
+				pDst_params->pImages[f][l] = (const crn_uint32*)job.pDst[f];
+			}
+			if (border)
+				crn_mip_cube_borders(pBorders, job.pSrc, src_w, border, cs);
+			job.border = border;
+			job.pBorders = pBorders;
+			crn_parallel_for(num_threads - 1, dst_h * pParams->faces, crn_mip_filter_row, &job);
+		}
+
+		crn_free(pBorders);
+		crn_mip_axis_free(&x_axis);
+		crn_mip_axis_free(&y_axis);
+	}
+
+	crn_free(job.pRows);
+	if (job.pGamma)
+	{
+		crn_free(gamma.pWide_to_linear);
+		crn_free(gamma.pWide_to_gamma);
+	}
+	if (!ok)
+	{
+		crn_free(pLevels);
+		return crn_false;
+	}
+	*ppLevels = pLevels;
+	return crn_true;
+}
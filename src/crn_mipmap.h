@@ -0,0 +1,20 @@
+// File: crn_mipmap.h - Mipmap generation for crn_compress_ext().
+#ifndef CRN_MIPMAP_H
+#define CRN_MIPMAP_H
+
+#include "crnlib.h"
+
+// Builds the mip chain pMip_params asks for. *pDst_params receives a copy of pParams whose width, height, levels and
+// pImages describe the chain. Generated levels live in *ppLevels (NULL if nothing was generated), which must be freed
+// with crn_free() once the texture is compressed. Each level is filtered from the one above it, one output row per
+// parallel_for task over pParams' helper threads. Returns false if memory runs out.
+// A cropped or scaled top level is filtered straight from the source window, and replaces the source's mips; only
+// then may pParams' size exceed cCRNMaxLevelResolution.
+// With gamma_filtering, color channels are decoded with gamma before filtering and re-encoded after; alpha_component
+// stays linear. DXN textures are treated as normal maps: their levels are filtered linearly and renormalized like
+// renormalize asks.
+// BC6H textures' images are RGBA floats, and so are their levels. Those are filtered linearly, with negatives clamped.
+// With cCRNCompFlagSource16 images and levels are 16-bit RGBA, filtered on the same 0-255 float scale as 8-bit ones.
+crn_bool crn_mipmap_build(const crn_comp_params* pParams, const crn_mipmap_params* pMip_params, crn_comp_params* pDst_params, void** ppLevels);
+
+#endif // CRN_MIPMAP_H
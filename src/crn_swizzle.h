@@ -0,0 +1,98 @@
+// File: crn_swizzle.h - Channel swizzles of the swizzled DXT5 formats, applied while gathering blocks.
+#ifndef CRN_SWIZZLE_H
+#define CRN_SWIZZLE_H
+
+#include "crn_core.h"
+
+#if CRN_SSE2
+#include <emmintrin.h>
+#endif
+
+// The swizzled DXT5 formats are encoded as plain DXT5 (color from RGB, alpha from A) of the swizzled pixels:
+//  CCxY: R=Co, G=Cg, B=0, A=Y, with Y=(R+2G+B)/4, Co=(R-B)/2+128 and Cg=(2G-R-B)/4+128.
+//  xGxR: R=0, G, B=0, A=R.
+//  xGBR: R=0, G, B, A=R.
+//  AGBR: R=alpha_component, G, B, A=R.
+static inline crn_bool crn_is_swizzled_dxt5(crn_format fmt)
+{
+	return fmt == cCRNFmtDXT5_CCxY || fmt == cCRNFmtDXT5_xGxR || fmt == cCRNFmtDXT5_xGBR || fmt == cCRNFmtDXT5_AGBR;
+}
+
+static inline void crn_swizzle_pixel(crn_format fmt, crn_uint32 alpha_component, const crn_uint8* pSrc, crn_uint8* pDst)
+{
+	const int r = pSrc[0], g = pSrc[1], b = pSrc[2], a = pSrc[alpha_component];
+	switch (fmt)
+	{
+	case cCRNFmtDXT5_CCxY:
+		pDst[0] = (crn_uint8)(((r - b) >> 1) + 128);
+		pDst[1] = (crn_uint8)(((g * 2 - r - b) >> 2) + 128);
+		pDst[2] = 0;
+		pDst[3] = (crn_uint8)((r + g * 2 + b + 2) >> 2);
+		break;
+	case cCRNFmtDXT5_xGxR:
+		pDst[0] = 0;
+		pDst[1] = (crn_uint8)g;
+		pDst[2] = 0;
+		pDst[3] = (crn_uint8)r;
+		break;
+	case cCRNFmtDXT5_xGBR:
+		pDst[0] = 0;
+		pDst[1] = (crn_uint8)g;
+		pDst[2] = (crn_uint8)b;
+		pDst[3] = (crn_uint8)r;
+		break;
+	case cCRNFmtDXT5_AGBR:
+		pDst[0] = (crn_uint8)a;
+		pDst[1] = (crn_uint8)g;
+		pDst[2] = (crn_uint8)b;
+		pDst[3] = (crn_uint8)r;
+		break;
+	default:
+		memcpy(pDst, pSrc, 4);
+		break;
+	}
+}
+
+// Swizzles a row of 4 pixels (16 bytes) for a swizzled DXT5 format. pSrc and pDst may be the same.
+// The SSE2 path works on the pixels as 32-bit lanes and gives the same results as crn_swizzle_pixel().
+static inline void crn_swizzle_row(crn_format fmt, crn_uint32 alpha_component, const crn_uint8* pSrc, crn_uint8* pDst)
+{
+#if CRN_SSE2
+	const __m128i px = _mm_loadu_si128((const __m128i*)pSrc), byte_mask = _mm_set1_epi32(0xFF);
+	const __m128i gb = _mm_and_si128(px, _mm_set1_epi32(0x00FFFF00)), r_to_a = _mm_slli_epi32(px, 24);
+	__m128i out;
+	switch (fmt)
+	{
+	case cCRNFmtDXT5_CCxY:
+	{
+		const __m128i r = _mm_and_si128(px, byte_mask), b = _mm_and_si128(_mm_srli_epi32(px, 16), byte_mask);
+		const __m128i g2 = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(px, 8), byte_mask), 1), bias = _mm_set1_epi32(128);
+		const __m128i y = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(r, b), _mm_add_epi32(g2, _mm_set1_epi32(2))), 2);
+		const __m128i co = _mm_add_epi32(_mm_srai_epi32(_mm_sub_epi32(r, b), 1), bias);
+		const __m128i cg = _mm_add_epi32(_mm_srai_epi32(_mm_sub_epi32(g2, _mm_add_epi32(r, b)), 2), bias);
+		out = _mm_or_si128(_mm_or_si128(co, _mm_slli_epi32(cg, 8)), _mm_slli_epi32(y, 24));
+		break;
+	}
+	case cCRNFmtDXT5_xGxR:
+		out = _mm_or_si128(_mm_and_si128(px, _mm_set1_epi32(0x0000FF00)), r_to_a);
+		break;
+	case cCRNFmtDXT5_xGBR:
+		out = _mm_or_si128(gb, r_to_a);
+		break;
+	case cCRNFmtDXT5_AGBR:
+		out = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srl_epi32(px, _mm_cvtsi32_si128((int)alpha_component * 8)), byte_mask), gb), r_to_a);
+		break;
+	default:
+		out = px;
+		break;
+	}
+	_mm_storeu_si128((__m128i*)pDst, out);
+#else
+	crn_uint8 src[16];
+	memcpy(src, pSrc, sizeof(src));
+	for (crn_uint32 x = 0; x < 4; x++)
+		crn_swizzle_pixel(fmt, alpha_component, src + x * 4, pDst + x * 4);
+#endif
+}
+
+#endif // CRN_SWIZZLE_H
@@ -0,0 +1,118 @@
+#include "crn_threading.h"
+#include "crn_core.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+typedef struct
+{
+	volatile long next;
+	crn_uint32 count;
+	crn_task_func pFunc;
+	void* pData;
+} crn_parallel_job;
+
+typedef struct
+{
+	crn_parallel_job* pJob;
+	crn_uint32 thread_index;
+} crn_parallel_worker;
+
+static crn_uint32 crn_job_claim(crn_parallel_job* pJob)
+{
+#if defined(_MSC_VER)
+	return (crn_uint32)(InterlockedIncrement(&pJob->next) - 1);
+#else
+	return (crn_uint32)__atomic_fetch_add(&pJob->next, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void crn_job_run(crn_parallel_job* pJob, crn_uint32 thread_index)
+{
+	for (crn_uint32 i; (i = crn_job_claim(pJob)) < pJob->count;)
+		pJob->pFunc(i, thread_index, pJob->pData);
+}
+
+void crn_spinlock_lock(crn_spinlock* pLock)
+{
+#if defined(_MSC_VER)
+	while (InterlockedExchange(pLock, 1))
+		while (*pLock)
+			YieldProcessor();
+#else
+	while (__atomic_exchange_n(pLock, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(pLock, __ATOMIC_RELAXED))
+			;
+#endif
+}
+
+void crn_spinlock_unlock(crn_spinlock* pLock)
+{
+#if defined(_MSC_VER)
+	InterlockedExchange(pLock, 0);
+#else
+	__atomic_store_n(pLock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+#ifdef _WIN32
+static unsigned __stdcall crn_worker_entry(void* p)
+{
+	crn_parallel_worker* pWorker = (crn_parallel_worker*)p;
+	crn_job_run(pWorker->pJob, pWorker->thread_index);
+	return 0;
+}
+#else
+static void* crn_worker_entry(void* p)
+{
+	crn_parallel_worker* pWorker = (crn_parallel_worker*)p;
+	crn_job_run(pWorker->pJob, pWorker->thread_index);
+	return NULL;
+}
+#endif
+
+void crn_parallel_for(crn_uint32 num_helper_threads, crn_uint32 count, crn_task_func pFunc, void* pData)
+{
+	crn_parallel_job job = { 0, count, pFunc, pData };
+	crn_parallel_worker workers[cCRNMaxHelperThreads];
+#ifdef _WIN32
+	HANDLE threads[cCRNMaxHelperThreads];
+#else
+	pthread_t threads[cCRNMaxHelperThreads];
+#endif
+	crn_uint32 num_threads = 0;
+
+	num_helper_threads = CRN_MIN(num_helper_threads, (crn_uint32)cCRNMaxHelperThreads);
+	if (count)
+		num_helper_threads = CRN_MIN(num_helper_threads, count - 1);
+	for (; num_threads < num_helper_threads; num_threads++)
+	{
+		workers[num_threads].pJob = &job;
+		workers[num_threads].thread_index = num_threads + 1;
+#ifdef _WIN32
+		threads[num_threads] = (HANDLE)_beginthreadex(NULL, 0, crn_worker_entry, &workers[num_threads], 0, NULL);
+		if (!threads[num_threads])
+			break;
+#else
+		if (pthread_create(&threads[num_threads], NULL, crn_worker_entry, &workers[num_threads]) != 0)
+			break;
+#endif
+	}
+
+	crn_job_run(&job, 0);
+
+	for (crn_uint32 i = 0; i < num_threads; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+	}
+}
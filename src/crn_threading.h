@@ -0,0 +1,21 @@
+// File: crn_threading.h - Minimal fork/join helpers for spreading independent work over helper threads.
+#ifndef CRN_THREADING_H
+#define CRN_THREADING_H
+
+#include "crnlib.h"
+
+// Task callback, index is in [0, count) and thread_index is in [0, num_helper_threads] (0 is the calling thread).
+typedef void (*crn_task_func)(crn_uint32 index, crn_uint32 thread_index, void* pData);
+
+// Runs pFunc for every index in [0, count), distributing the indices over the calling thread and
+// up to num_helper_threads additional threads. Returns once every index has been processed.
+// Falls back to running everything on the calling thread if threads can't be created.
+void crn_parallel_for(crn_uint32 num_helper_threads, crn_uint32 count, crn_task_func pFunc, void* pData);
+
+// Spin lock for very short critical sections shared between parallel_for tasks, initialize to 0.
+typedef volatile long crn_spinlock;
+
+void crn_spinlock_lock(crn_spinlock* pLock);
+void crn_spinlock_unlock(crn_spinlock* pLock);
+
+#endif // CRN_THREADING_H
@@ -0,0 +1,730 @@
+#include "crnlib.h"
+#include "crn_core.h"
+#include "crn_analyze.h"
+#include "crn_comp.h"
+#include "crn_dds_comp.h"
+#include "crn_decomp.h"
+#include "crn_image.h"
+#include "crn_mipmap.h"
+#include "crn_threading.h"
+
+#include <stdlib.h>
+
+#define CRN_FOURCC(a, b, c, d) ((crn_uint32)(a) | ((crn_uint32)(b) << 8) | ((crn_uint32)(c) << 16) | ((crn_uint32)(d) << 24))
+
+// -------- Memory
+
+static void* crn_default_realloc(void* p, size_t size, size_t* pActual_size, crn_bool movable, void* pUser_data)
+{
+	void* pNew;
+	(void)pUser_data;
+
+	if (!size)
+	{
+		free(p);
+		if (pActual_size)
+			*pActual_size = 0;
+		return NULL;
+	}
+	if (p && !movable)
+		return NULL;
+
+	pNew = realloc(p, size);
+	if (pActual_size)
+		*pActual_size = pNew ? size : 0;
+	return pNew;
+}
+
+static size_t crn_default_msize(void* p, void* pUser_data)
+{
+	(void)p;
+	(void)pUser_data;
+	return 0;
+}
+
+static crn_realloc_func g_pRealloc = crn_default_realloc;
+static crn_msize_func g_pMSize = crn_default_msize;
+static void* g_pUser_data = NULL;
+
+void crn_set_memory_callbacks(crn_realloc_func pRealloc, crn_msize_func pMSize, void* pUser_data)
+{
+	if (!pRealloc || !pMSize)
+	{
+		g_pRealloc = crn_default_realloc;
+		g_pMSize = crn_default_msize;
+		g_pUser_data = NULL;
+	}
+	else
+	{
+		g_pRealloc = pRealloc;
+		g_pMSize = pMSize;
+		g_pUser_data = pUser_data;
+	}
+}
+
+void* crn_malloc(size_t size)
+{
+	return g_pRealloc(NULL, size ? size : 1, NULL, crn_true, g_pUser_data);
+}
+
+void* crn_calloc(size_t count, size_t size)
+{
+	void* p;
+	if (size && count > (size_t)-1 / size)
+		return NULL;
+	p = crn_malloc(count * size);
+	if (p)
+		memset(p, 0, count * size);
+	return p;
+}
+
+void* crn_realloc(void* p, size_t size)
+{
+	return g_pRealloc(p, size, NULL, crn_true, g_pUser_data);
+}
+
+void crn_free(void* p)
+{
+	if (p)
+		g_pRealloc(p, 0, NULL, crn_true, g_pUser_data);
+}
+
+void crn_free_block(void* pBlock)
+{
+	crn_free(pBlock);
+}
+
+crn_uint16 crn_crc16(const void* pBuf, size_t len, crn_uint16 crc)
+{
+	const crn_uint8* p = (const crn_uint8*)pBuf;
+	crc = (crn_uint16)~crc;
+	while (len--)
+	{
+		const crn_uint16 q = (crn_uint16)(*p++ ^ (crc >> 8));
+		crn_uint16 r = (crn_uint16)((q >> 4) ^ q);
+		crc = (crn_uint16)(crc << 8);
+		crc ^= r;
+		r = (crn_uint16)(r << 5);
+		crc ^= r;
+		r = (crn_uint16)(r << 7);
+		crc ^= r;
+	}
+	return (crn_uint16)~crc;
+}
+
+// -------- crn_format related helpers
+
+crn_uint32 crn_get_format_fourcc(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT1:      return CRN_FOURCC('D', 'X', 'T', '1');
+	case cCRNFmtDXT3:      return CRN_FOURCC('D', 'X', 'T', '3');
+	case cCRNFmtDXT5:      return CRN_FOURCC('D', 'X', 'T', '5');
+	case cCRNFmtDXT5_CCxY: return CRN_FOURCC('C', 'C', 'x', 'Y');
+	case cCRNFmtDXT5_xGxR: return CRN_FOURCC('x', 'G', 'x', 'R');
+	case cCRNFmtDXT5_xGBR: return CRN_FOURCC('x', 'G', 'B', 'R');
+	case cCRNFmtDXT5_AGBR: return CRN_FOURCC('A', 'G', 'B', 'R');
+	case cCRNFmtDXN_XY:    return CRN_FOURCC('A', '2', 'X', 'Y');
+	case cCRNFmtDXN_YX:    return CRN_FOURCC('A', 'T', 'I', '2');
+	case cCRNFmtDXT5A:     return CRN_FOURCC('A', 'T', 'I', '1');
+	case cCRNFmtETC1:      return CRN_FOURCC('E', 'T', 'C', '1');
+	default:               return 0;
+	}
+}
+
+crn_uint32 crn_get_format_bits_per_texel(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT1:
+	case cCRNFmtDXT5A:
+	case cCRNFmtETC1:
+		return 4;
+	case cCRNFmtDXT3:
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+	case cCRNFmtBC6H:
+	case cCRNFmtBC7:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+crn_uint32 crn_get_bytes_per_dxt_block(crn_format fmt)
+{
+	return (crn_get_format_bits_per_texel(fmt) << 4) >> 3;
+}
+
+crn_format crn_get_fundamental_dxt_format(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT5_CCxY:
+	case cCRNFmtDXT5_xGxR:
+	case cCRNFmtDXT5_xGBR:
+	case cCRNFmtDXT5_AGBR:
+		return cCRNFmtDXT5;
+	default:
+		return fmt;
+	}
+}
+
+// -------- String helpers
+
+const char* crn_get_file_type_ext(crn_file_type file_type)
+{
+	switch (file_type)
+	{
+	case cCRNFileTypeCRN: return "crn";
+	case cCRNFileTypeDDS: return "dds";
+	default:              return "?";
+	}
+}
+
+const char* crn_get_format_string(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT1:      return "DXT1";
+	case cCRNFmtDXT3:      return "DXT3";
+	case cCRNFmtDXT5:      return "DXT5";
+	case cCRNFmtDXT5_CCxY: return "DXT5_CCxY";
+	case cCRNFmtDXT5_xGxR: return "DXT5_xGxR";
+	case cCRNFmtDXT5_xGBR: return "DXT5_xGBR";
+	case cCRNFmtDXT5_AGBR: return "DXT5_AGBR";
+	case cCRNFmtDXN_XY:    return "DXN_XY";
+	case cCRNFmtDXN_YX:    return "DXN_YX";
+	case cCRNFmtDXT5A:     return "DXT5A";
+	case cCRNFmtETC1:      return "ETC1";
+	case cCRNFmtBC6H:      return "BC6H";
+	case cCRNFmtBC7:       return "BC7";
+	default:               return "?";
+	}
+}
+
+const char* crn_get_dxt_quality_string(crn_dxt_quality q)
+{
+	switch (q)
+	{
+	case cCRNDXTQualitySuperFast: return "SuperFast";
+	case cCRNDXTQualityFast:      return "Fast";
+	case cCRNDXTQualityNormal:    return "Normal";
+	case cCRNDXTQualityBetter:    return "Better";
+	case cCRNDXTQualityUber:      return "Uber";
+	default:                      return "?";
+	}
+}
+
+const char* crn_get_mip_mode_desc(crn_mip_mode m)
+{
+	switch (m)
+	{
+	case cCRNMipModeUseSourceOrGenerateMips: return "Use source/generate if none";
+	case cCRNMipModeUseSourceMips:           return "Only use source MIP maps (if any)";
+	case cCRNMipModeGenerateMips:            return "Always generate new MIP maps";
+	case cCRNMipModeNoMips:                  return "No MIP maps";
+	default:                                 return "?";
+	}
+}
+
+const char* crn_get_mip_mode_name(crn_mip_mode m)
+{
+	switch (m)
+	{
+	case cCRNMipModeUseSourceOrGenerateMips: return "UseSourceOrGenerate";
+	case cCRNMipModeUseSourceMips:           return "UseSource";
+	case cCRNMipModeGenerateMips:            return "Generate";
+	case cCRNMipModeNoMips:                  return "None";
+	default:                                 return "?";
+	}
+}
+
+const char* crn_get_scale_mode_desc(crn_scale_mode sm)
+{
+	switch (sm)
+	{
+	case cCRNSMDisabled:     return "disabled";
+	case cCRNSMAbsolute:     return "absolute";
+	case cCRNSMRelative:     return "relative";
+	case cCRNSMLowerPow2:    return "lowerpow2";
+	case cCRNSMNearestPow2:  return "nearestpow2";
+	case cCRNSMNextPow2:     return "nextpow2";
+	default:                 return "?";
+	}
+}
+
+const char* crn_get_mip_filter_name(crn_mip_filter f)
+{
+	switch (f)
+	{
+	case cCRNMipFilterBox:      return "box";
+	case cCRNMipFilterTent:     return "tent";
+	case cCRNMipFilterLanczos4: return "lanczos4";
+	case cCRNMipFilterMitchell: return "mitchell";
+	case cCRNMipFilterKaiser:   return "kaiser";
+	default:                    return "?";
+	}
+}
+
+// -------- DDS
+
+enum
+{
+	cDDSHeaderSize          = 128, // Including the 'DDS ' magic
+	cDDSHeaderDX10Size      = 20,  // Follows the header if the FOURCC is 'DX10'
+	cDDSDCaps               = 0x00000001,
+	cDDSDHeight             = 0x00000002,
+	cDDSDWidth              = 0x00000004,
+	cDDSDPixelFormat        = 0x00001000,
+	cDDSDMipMapCount        = 0x00020000,
+	cDDSDLinearSize         = 0x00080000,
+	cDDPFFourCC             = 0x00000004,
+	cDDSCapsComplex         = 0x00000008,
+	cDDSCapsTexture         = 0x00001000,
+	cDDSCapsMipMap          = 0x00400000,
+	cDDSCaps2Cubemap        = 0x00000200,
+	cDDSCaps2CubemapAllFaces = 0x0000FC00,
+	cDDSDimensionTexture2D  = 3,
+	cDDSMiscTextureCube     = 0x00000004,
+	cDXGIFormatBC1          = 71,
+	cDXGIFormatBC2          = 74,
+	cDXGIFormatBC3          = 77,
+	cDXGIFormatBC4          = 80,
+	cDXGIFormatBC5          = 83,
+	cDXGIFormatBC6HUF16     = 95,
+	cDXGIFormatBC7          = 98
+};
+
+static crn_uint32 crn_get_level_size(crn_uint32 width, crn_uint32 height, crn_uint32 level, crn_uint32 bytes_per_block)
+{
+	const crn_uint32 w = CRN_MAX(width >> level, 1U);
+	const crn_uint32 h = CRN_MAX(height >> level, 1U);
+	return ((w + 3) >> 2) * ((h + 3) >> 2) * bytes_per_block;
+}
+
+// Writes the 'DDS ' magic and header. Swizzled DXT5 variants are written with the DXT5 FOURCC,
+// storing their actual FOURCC in the RGB bit count field.
+static void crn_write_dds_header(crn_uint8* pDst, crn_uint32 width, crn_uint32 height, crn_uint32 levels, crn_uint32 faces, crn_format fmt)
+{
+	const crn_format fundamental_fmt = crn_get_fundamental_dxt_format(fmt);
+	crn_uint32 flags = cDDSDCaps | cDDSDHeight | cDDSDWidth | cDDSDPixelFormat | cDDSDLinearSize;
+	crn_uint32 caps = cDDSCapsTexture;
+
+	if (levels > 1)
+	{
+		flags |= cDDSDMipMapCount;
+		caps |= cDDSCapsMipMap | cDDSCapsComplex;
+	}
+	if (faces == 6)
+		caps |= cDDSCapsComplex;
+
+	memset(pDst, 0, cDDSHeaderSize);
+	crn_write_le32(pDst + 0, CRN_FOURCC('D', 'D', 'S', ' '));
+	crn_write_le32(pDst + 4, 124);
+	crn_write_le32(pDst + 8, flags);
+	crn_write_le32(pDst + 12, height);
+	crn_write_le32(pDst + 16, width);
+	crn_write_le32(pDst + 20, crn_get_level_size(width, height, 0, crn_get_bytes_per_dxt_block(fmt)));
+	crn_write_le32(pDst + 28, levels);
+	crn_write_le32(pDst + 76, 32);
+	crn_write_le32(pDst + 80, cDDPFFourCC);
+	crn_write_le32(pDst + 84, crn_get_format_fourcc(fundamental_fmt));
+	if (fundamental_fmt != fmt)
+		crn_write_le32(pDst + 88, crn_get_format_fourcc(fmt));
+	crn_write_le32(pDst + 108, caps);
+	crn_write_le32(pDst + 112, (faces == 6) ? (cDDSCaps2Cubemap | cDDSCaps2CubemapAllFaces) : 0);
+}
+
+// DXGI format of the DX10 header, 0 if fmt has none. DXN_YX stores Y in its first block, which BC5 reads as red.
+static crn_uint32 crn_get_dxgi_format(crn_format fmt)
+{
+	switch (crn_get_fundamental_dxt_format(fmt))
+	{
+	case cCRNFmtDXT1:   return cDXGIFormatBC1;
+	case cCRNFmtDXT3:   return cDXGIFormatBC2;
+	case cCRNFmtDXT5:   return cDXGIFormatBC3;
+	case cCRNFmtDXT5A:  return cDXGIFormatBC4;
+	case cCRNFmtDXN_XY: return cDXGIFormatBC5;
+	case cCRNFmtBC6H:   return cDXGIFormatBC6HUF16;
+	case cCRNFmtBC7:    return cDXGIFormatBC7;
+	default:            return 0;
+	}
+}
+
+// Writes the 'DDS ' magic and header followed by the DX10 header, for texture arrays and formats without a FOURCC.
+// A cubemap's array size counts whole cubes.
+static void crn_write_dds_dx10_header(crn_uint8* pDst, crn_uint32 width, crn_uint32 height, crn_uint32 levels, crn_uint32 faces, crn_uint32 slices, crn_format fmt)
+{
+	crn_write_dds_header(pDst, width, height, levels, faces, fmt);
+	crn_write_le32(pDst + 84, CRN_FOURCC('D', 'X', '1', '0'));
+	crn_write_le32(pDst + 88, 0);
+	crn_write_le32(pDst + cDDSHeaderSize + 0, crn_get_dxgi_format(fmt));
+	crn_write_le32(pDst + cDDSHeaderSize + 4, cDDSDimensionTexture2D);
+	crn_write_le32(pDst + cDDSHeaderSize + 8, (faces == 6) ? cDDSMiscTextureCube : 0);
+	crn_write_le32(pDst + cDDSHeaderSize + 12, slices);
+	crn_write_le32(pDst + cDDSHeaderSize + 16, 0);
+}
+
+// -------- CRN to DDS transcoding
+
+typedef struct
+{
+	crnd_unpack_context context;
+	const crnd_texture_info* pInfo;
+	crn_uint8* pDDS;
+	crn_uint32 level_ofs[cCRNMaxLevels];  // Offset of each level within a face
+	crn_uint32 face_size;
+	volatile crn_uint32 failed;
+} crn_transcode_job;
+
+static void crn_transcode_level(crn_uint32 level, crn_uint32 thread_index, void* pData)
+{
+	crn_transcode_job* pJob = (crn_transcode_job*)pData;
+	const crnd_texture_info* pInfo = pJob->pInfo;
+	const crn_uint32 w = CRN_MAX(pInfo->width >> level, 1U);
+	const crn_uint32 row_pitch = ((w + 3) >> 2) * pInfo->bytes_per_block;
+	const crn_uint32 level_size = crn_get_level_size(pInfo->width, pInfo->height, level, pInfo->bytes_per_block);
+	void* pFaces[cCRNMaxFaces];
+	(void)thread_index;
+
+	for (crn_uint32 f = 0; f < pInfo->faces; f++)
+		pFaces[f] = pJob->pDDS + cDDSHeaderSize + f * pJob->face_size + pJob->level_ofs[level];
+
+	if (!crnd_unpack_level(pJob->context, pFaces, level_size, row_pitch, level))
+		pJob->failed = 1;
+}
+
+void* crn_decompress_crn_to_dds_ext(const void* pCRN_file_data, crn_uint32* file_size, crn_uint32 num_helper_threads)
+{
+	crnd_texture_info info;
+	crn_transcode_job job;
+	crn_uint32 total_size;
+
+	if (!pCRN_file_data || !file_size || !crnd_get_texture_info(pCRN_file_data, *file_size, &info))
+		return NULL;
+
+	memset(&job, 0, sizeof(job));
+	job.pInfo = &info;
+	for (crn_uint32 l = 0; l < info.levels; l++)
+	{
+		job.level_ofs[l] = job.face_size;
+		job.face_size += crn_get_level_size(info.width, info.height, l, info.bytes_per_block);
+	}
+	total_size = cDDSHeaderSize + job.face_size * info.faces;
+
+	job.context = crnd_unpack_begin(pCRN_file_data, *file_size);
+	if (!job.context)
+		return NULL;
+	job.pDDS = (crn_uint8*)crn_malloc(total_size);
+	if (!job.pDDS)
+	{
+		crnd_unpack_end(job.context);
+		return NULL;
+	}
+
+	crn_write_dds_header(job.pDDS, info.width, info.height, info.levels, info.faces, info.format);
+
+	// Each level is an independent bitstream, the largest level is queued first so the smaller ones fill in around it.
+	crn_parallel_for(num_helper_threads, info.levels, crn_transcode_level, &job);
+
+	crnd_unpack_end(job.context);
+	if (job.failed)
+	{
+		crn_free(job.pDDS);
+		return NULL;
+	}
+
+	*file_size = total_size;
+	return job.pDDS;
+}
+
+void* crn_decompress_crn_to_dds(const void* pCRN_file_data, crn_uint32* file_size)
+{
+	return crn_decompress_crn_to_dds_ext(pCRN_file_data, file_size, 0);
+}
+
+// -------- Compression
+
+// Compresses pSlices' textures to one DDS file: a texture array if array is set, otherwise the only slice. Arrays and
+// formats without a FOURCC get a DX10 header. Up to cCRNMaxFaces single face array slices are encoded at once, as one
+// texture's faces.
+static void* crn_compress_dds(const crn_comp_params* pSlices, crn_uint32 num_slices, crn_bool array, crn_uint32* pCompressed_size)
+{
+	const crn_comp_params* pParams = &pSlices[0];
+	const crn_uint32 bytes_per_block = crn_get_bytes_per_dxt_block(pParams->format);
+	const crn_bool dx10 = array || !crn_get_format_fourcc(pParams->format);
+	const crn_uint32 header_size = dx10 ? cDDSHeaderSize + cDDSHeaderDX10Size : cDDSHeaderSize;
+	crn_uint32 level_ofs[cCRNMaxLevels], face_size = 0;
+	size_t total_size;
+	crn_uint8* pDDS;
+
+	for (crn_uint32 l = 0; l < pParams->levels; l++)
+	{
+		level_ofs[l] = face_size;
+		face_size += crn_get_level_size(pParams->width, pParams->height, l, bytes_per_block);
+	}
+	total_size = header_size + (size_t)face_size * pParams->faces * num_slices;
+	if (total_size > 0xFFFFFFFFU)
+		return NULL;
+
+	pDDS = (crn_uint8*)crn_malloc(total_size);
+	if (!pDDS)
+		return NULL;
+	if (dx10)
+		crn_write_dds_dx10_header(pDDS, pParams->width, pParams->height, pParams->levels, pParams->faces, num_slices, pParams->format);
+	else
+		crn_write_dds_header(pDDS, pParams->width, pParams->height, pParams->levels, pParams->faces, pParams->format);
+
+	for (crn_uint32 first = 0; first < num_slices; first += cCRNMaxFaces)
+	{
+		crn_comp_params params = pSlices[first];
+		crn_uint8* pSurfaces[cCRNMaxFaces][cCRNMaxLevels];
+
+		if (array)
+		{
+			params.faces = CRN_MIN(num_slices - first, (crn_uint32)cCRNMaxFaces);
+			for (crn_uint32 f = 0; f < params.faces; f++)
+				memcpy(params.pImages[f], pSlices[first + f].pImages[0], sizeof(params.pImages[f]));
+		}
+
+		memset(pSurfaces, 0, sizeof(pSurfaces));
+		for (crn_uint32 f = 0; f < params.faces; f++)
+			for (crn_uint32 l = 0; l < params.levels; l++)
+				pSurfaces[f][l] = pDDS + header_size + (size_t)(first + f) * face_size + level_ofs[l];
+
+		if (!crn_dds_comp_encode(&params, (crn_uint8* const (*)[cCRNMaxLevels])pSurfaces))
+		{
+			crn_free(pDDS);
+			return NULL;
+		}
+	}
+
+	*pCompressed_size = (crn_uint32)total_size;
+	return pDDS;
+}
+
+void* crn_compress(const crn_comp_params* comp_params, crn_uint32* compressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate)
+{
+	void* pDDS;
+
+	if (!comp_params || !compressed_size || !crn_comp_params_check(comp_params))
+		return NULL;
+
+	*compressed_size = 0;
+	if (pActual_quality_level)
+		*pActual_quality_level = 0;
+	if (pActual_bitrate)
+		*pActual_bitrate = 0.0f;
+
+	if (comp_params->file_type == cCRNFileTypeCRN)
+		return crn_comp_compress_crn(comp_params, compressed_size, pActual_quality_level, pActual_bitrate);
+
+	pDDS = crn_compress_dds(comp_params, 1, crn_false, compressed_size);
+	if (pDDS)
+	{
+		if (pActual_quality_level)
+			*pActual_quality_level = comp_params->quality_level;
+		if (pActual_bitrate)
+			*pActual_bitrate = (float)crn_get_format_bits_per_texel(comp_params->format);
+	}
+	return pDDS;
+}
+
+void* crn_compress_ext(const crn_comp_params* comp_params, const crn_mipmap_params* mip_params, crn_uint32* compressed_size, crn_uint32* pActual_quality_level, float* pActual_bitrate)
+{
+	crn_comp_params params;
+	void* pLevels;
+	void* pOutput;
+
+	if (!comp_params || !mip_params || !compressed_size || !crn_mipmap_params_check(mip_params))
+		return NULL;
+	// The source may be larger than any level: crn_mipmap_build() scales it down, and crn_compress() checks the result.
+	params = *comp_params;
+	params.width = CRN_MIN(params.width, (crn_uint32)cCRNMaxLevelResolution);
+	params.height = CRN_MIN(params.height, (crn_uint32)cCRNMaxLevelResolution);
+	if (comp_params->width > cCRNMaxSourceResolution || comp_params->height > cCRNMaxSourceResolution || !crn_comp_params_check(&params))
+		return NULL;
+
+	if (!crn_mipmap_build(comp_params, mip_params, &params, &pLevels))
+		return NULL;
+	pOutput = crn_compress(&params, compressed_size, pActual_quality_level, pActual_bitrate);
+	crn_free(pLevels);
+	return pOutput;
+}
+
+// -------- Texture arrays
+
+crn_uint32* crn_load_image(const void* pSrc_file_data, crn_uint32 src_file_size, crn_uint32* pWidth, crn_uint32* pHeight, crn_uint32* pNum_images, int** ppDelays)
+{
+	if (ppDelays)
+		*ppDelays = NULL;
+	if (!pSrc_file_data || !pWidth || !pHeight || !pNum_images)
+		return NULL;
+	return crn_image_load(pSrc_file_data, src_file_size, pWidth, pHeight, pNum_images, ppDelays);
+}
+
+float* crn_load_image_hdr(const void* pSrc_file_data, crn_uint32 src_file_size, crn_uint32* pWidth, crn_uint32* pHeight)
+{
+	if (!pSrc_file_data || !pWidth || !pHeight)
+		return NULL;
+	return crn_image_load_hdr(pSrc_file_data, src_file_size, pWidth, pHeight);
+}
+
+crn_uint16* crn_load_image_16(const void* pSrc_file_data, crn_uint32 src_file_size, crn_uint32* pWidth, crn_uint32* pHeight)
+{
+	if (!pSrc_file_data || !pWidth || !pHeight)
+		return NULL;
+	return crn_image_load_16(pSrc_file_data, src_file_size, pWidth, pHeight);
+}
+
+void* crn_compress_array(const crn_comp_params* comp_params, const crn_mipmap_params* mip_params, const crn_uint32* const* ppSlices, crn_uint32 num_slices, crn_uint32* compressed_size, crn_uint32* pSlice_sizes)
+{
+	crn_comp_params params;
+	crn_comp_params* pSlices;
+	void** ppLevels;
+	crn_uint8* pOutput = NULL;
+	crn_bool ok;
+
+	if (!comp_params || !ppSlices || !compressed_size || !num_slices || num_slices > cCRNMaxArraySlices || comp_params->faces != 1)
+		return NULL;
+	if (mip_params && !crn_mipmap_params_check(mip_params))
+		return NULL;
+	*compressed_size = 0;
+
+	// Only the top levels are given: crn_mipmap_build() generates the rest, and may scale the source down like crn_compress_ext().
+	params = *comp_params;
+	memset(params.pImages, 0, sizeof(params.pImages));
+	params.levels = 1;
+	if (mip_params)
+	{
+		params.width = CRN_MIN(params.width, (crn_uint32)cCRNMaxLevelResolution);
+		params.height = CRN_MIN(params.height, (crn_uint32)cCRNMaxLevelResolution);
+		if (comp_params->width > cCRNMaxSourceResolution || comp_params->height > cCRNMaxSourceResolution)
+			return NULL;
+	}
+	if (!crn_comp_params_check(&params) || (params.file_type == cCRNFileTypeDDS && !crn_get_dxgi_format(params.format)))
+		return NULL;
+
+	pSlices = (crn_comp_params*)crn_malloc(num_slices * sizeof(crn_comp_params));
+	ppLevels = (void**)crn_calloc(num_slices, sizeof(void*));
+	ok = pSlices && ppLevels;
+	for (crn_uint32 s = 0; ok && s < num_slices; s++)
+	{
+		ok = ppSlices[s] != NULL;
+		if (ok && mip_params)
+		{
+			crn_comp_params src = *comp_params;
+			memset(src.pImages, 0, sizeof(src.pImages));
+			src.levels = 1;
+			src.pImages[0][0] = ppSlices[s];
+			ok = crn_mipmap_build(&src, mip_params, &pSlices[s], &ppLevels[s]);
+		}
+		else if (ok)
+		{
+			pSlices[s] = params;
+			pSlices[s].pImages[0][0] = ppSlices[s];
+		}
+	}
+
+	ok = ok && crn_comp_params_check(&pSlices[0]);
+	if (ok && params.file_type == cCRNFileTypeCRN)
+	{
+		pOutput = (crn_uint8*)crn_comp_compress_crn_array(pSlices, num_slices, compressed_size, NULL, NULL);
+		// Each slice's file starts with a header holding its size.
+		for (crn_uint32 s = 0, ofs = 0; pOutput && pSlice_sizes && s < num_slices; s++)
+		{
+			pSlice_sizes[s] = crn_read_packed(pOutput + ofs + cCRNHdrOfsDataSize, 4);
+			ofs += pSlice_sizes[s];
+		}
+	}
+	else if (ok)
+		pOutput = (crn_uint8*)crn_compress_dds(pSlices, num_slices, crn_true, compressed_size);
+
+	for (crn_uint32 s = 0; ppLevels && s < num_slices; s++)
+		crn_free(ppLevels[s]);
+	crn_free(ppLevels);
+	crn_free(pSlices);
+	return pOutput;
+}
+
+// -------- Source analysis
+
+crn_uint32 crn_analyze_texture(const crn_comp_params* comp_params)
+{
+	crn_uint32 classes = cCRNTextureAllClasses;
+
+	if (!comp_params || !crn_comp_params_check(comp_params) || comp_params->format == cCRNFmtBC6H || (comp_params->flags & cCRNCompFlagSource16))
+		return 0;
+	for (crn_uint32 f = 0; f < comp_params->faces && classes; f++)
+	{
+		const crn_uint32* pImage = comp_params->pImages[f][0];
+		if (!pImage)
+			return 0;
+		if (*pImage != *comp_params->pImages[0][0])
+			classes &= ~(crn_uint32)cCRNTextureConstant;
+		classes = crn_analyze_image((const crn_uint8*)pImage, comp_params->width * comp_params->height, comp_params->alpha_component, classes);
+	}
+	return classes;
+}
+
+crn_format crn_get_recommended_format(crn_uint32 texture_classes, crn_uint32* pFlags)
+{
+	crn_uint32 flags = pFlags ? *pFlags : 0;
+	crn_format fmt = cCRNFmtDXT5;
+
+	if ((texture_classes & cCRNTextureNormalMap) && (texture_classes & cCRNTextureOpaque))
+	{
+		fmt = cCRNFmtDXN_XY;
+		flags &= ~(crn_uint32)cCRNCompFlagPerceptual;
+	}
+	else if (texture_classes & cCRNTextureOpaque)
+	{
+		fmt = cCRNFmtDXT1;
+	}
+	else if (texture_classes & cCRNTextureBinaryAlpha)
+	{
+		fmt = cCRNFmtDXT1;
+		flags |= cCRNCompFlagDXT1AForTransparency;
+	}
+
+	// Gray sources lose nothing to luma sampling, and gain the chroma the 565 grid adds between its gray levels. A
+	// constant texture doesn't need it: its one color is matched directly, and RGB sampling keeps working.
+	if ((texture_classes & cCRNTextureGrayscale) && !(texture_classes & cCRNTextureConstant))
+		flags |= cCRNCompFlagGrayscaleSampling;
+
+	if (pFlags)
+		*pFlags = flags;
+	return fmt;
+}
+
+// -------- Block compressor
+
+crn_block_compressor_context_t crn_create_block_compressor(const crn_comp_params* params)
+{
+	if (!params)
+		return NULL;
+	return crn_dds_block_comp_create(params);
+}
+
+void crn_compress_block(crn_block_compressor_context_t pContext, const crn_uint32* pPixels, void* pDst_block)
+{
+	crn_compress_blocks(pContext, pPixels, 1, pDst_block);
+}
+
+void crn_compress_blocks(crn_block_compressor_context_t pContext, const crn_uint32* pPixels, crn_uint32 num_blocks, void* pDst_blocks)
+{
+	if (pContext && pPixels && pDst_blocks)
+		crn_dds_block_comp_encode((crn_dds_block_comp*)pContext, (const crn_uint8*)pPixels, num_blocks, (crn_uint8*)pDst_blocks);
+}
+
+void crn_free_block_compressor(crn_block_compressor_context_t pContext)
+{
+	crn_dds_block_comp_free((crn_dds_block_comp*)pContext);
+}
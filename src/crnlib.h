@@ -27,6 +27,7 @@
 typedef unsigned char   crn_uint8;
 typedef unsigned short  crn_uint16;
 typedef unsigned int    crn_uint32;
+typedef unsigned long long crn_uint64;
 typedef signed char     crn_int8;
 typedef signed short    crn_int16;
 typedef signed int      crn_int32;
@@ -79,6 +80,12 @@ typedef enum
 
    cCRNFmtETC1,
 
+   // BC6H unsigned half float, from float RGBA images (see pImages below). DDS only, always written with a DX10 header.
+   cCRNFmtBC6H,
+
+   // BC7 RGBA. DDS only, always written with a DX10 header. dxt_quality picks how many modes and partitions are searched.
+   cCRNFmtBC7,
+
    cCRNFmtTotal,
 
    cCRNFmtForceDWORD = 0xFFFFFFFF
@@ -91,12 +98,18 @@ typedef enum
    // Max. mipmap level resolution on any axis.
    cCRNMaxLevelResolution     = 4096,
 
+   // Max. source resolution on any axis accepted by crn_compress_ext(), which scales larger images down to cCRNMaxLevelResolution.
+   cCRNMaxSourceResolution    = 16384,
+
    cCRNMinPaletteSize         = 8,
    cCRNMaxPaletteSize         = 8192,
 
    cCRNMaxFaces               = 6,
    cCRNMaxLevels              = 16,
 
+   // Max. number of slices of a texture array, see crn_compress_array().
+   cCRNMaxArraySlices         = 2048,
+
    cCRNMaxHelperThreads       = 16,
 
    cCRNMinQualityLevel        = 0,
@@ -150,10 +163,28 @@ typedef enum
    // If enabled, the DXT1 compressor's color distance metric assumes the pixel shader will be converting the fetched RGB results to luma (Y part of YCbCr).
    // This increases quality when compressing grayscale images, because the compressor can spread the luma error amoung all three channels (i.e. it can generate blocks
    // with some chroma present if doing so will ultimately lead to lower luma error).
-   // Only enable on grayscale source images.
+   // Only enable on grayscale source images. crn_get_recommended_format() sets it when crn_analyze_texture() finds one.
+   // Currently only used when writing to .DDS files, for the DXT1 and (unswizzled) DXT3/DXT5 color blocks.
    // Default: Not set.
    cCRNCompFlagGrayscaleSampling = 256,
 
+   // If enabled, all compression threads share a single endpoint cache instead of one cache per thread.
+   // Finds more repeated blocks in images with distant duplicates (texture atlases, tiled UI), at the cost of some lock contention.
+   // Currently only used when writing to .DDS files.
+   // Default: Not set.
+   cCRNCompFlagShareEndpointCache = 512,
+
+   // If enabled, the DXT3 compressor diffuses the error of quantizing alpha to 4 bits between neighboring pixels of each block.
+   // Trades banding in smooth alpha gradients for noise. Only used when writing to .DDS files.
+   // Default: Not set.
+   cCRNCompFlagDXT3AlphaDithering = 1024,
+
+   // If enabled, pImages hold 16 bits per channel RGBA (4 crn_uint16's per pixel) instead of 8, such as crn_load_image_16() returns.
+   // crn_compress_ext() filters mipmaps (and renormalizes them) at that precision, and pixels are only rounded to 8 bits as blocks are encoded.
+   // Keeps height maps and 16-bit normal maps from losing precision to 8-bit intermediate levels. Not valid with cCRNFmtBC6H.
+   // Default: Not set.
+   cCRNCompFlagSource16 = 2048,
+
    // If enabled, debug information will be output during compression.
    // Default: Not set.
    cCRNCompFlagDebugging = 0x80000000,
@@ -162,7 +193,9 @@ typedef enum
 
 } crn_comp_flags;
 
-// Controls DXTn quality vs. speed control - only used when compressing to .DDS.
+// Controls DXTn quality vs. speed control - only used when compressing to .DDS. Uber runs an exhaustive cluster fit,
+// then a hill climb over +-1 steps of the 565 endpoints capped at a few passes, rather than crunch's exhaustive
+// neighborhood search: the full search costs about 6x as much for a few hundredths of a dB.
 typedef enum
 {
    cCRNDXTQualitySuperFast,
@@ -198,6 +231,19 @@ typedef enum
 
 } crn_dxt_compressor_type;
 
+// Properties of a texture's source pixels, as found by crn_analyze_texture().
+typedef enum
+{
+   cCRNTextureOpaque      = 1,    // Every alpha (the alpha_component byte) is 255
+   cCRNTextureBinaryAlpha = 2,    // Every alpha is 0 or 255
+   cCRNTextureGrayscale   = 4,    // R == G == B in every pixel
+   cCRNTextureConstant    = 8,    // Every pixel of every face is the same
+   cCRNTextureNormalMap   = 16,   // RGB looks like a tangent space normal map: roughly unit length vectors around +Z
+
+   cCRNTextureForceDWORD = 0xFFFFFFFF
+
+} crn_texture_class;
+
 // Progress callback function.
 // Processing will stop prematurely (and fail) if the callback returns false.
 // phase_index, total_phases - high level progress
@@ -221,6 +267,8 @@ typedef struct
    crn_uint32                 flags;                   // see crn_comp_flags enum
 
    // Array of pointers to 32bpp input images.
+   // For cCRNFmtBC6H each pointer is to 4 floats (RGBA, alpha ignored) per pixel instead, such as crn_load_image_hdr() returns.
+   // With cCRNCompFlagSource16 each pointer is to 4 crn_uint16's (RGBA) per pixel.
    const crn_uint32*          pImages[cCRNMaxFaces][cCRNMaxLevels];
 
    // Target bitrate - if non-zero, the compressor will use an interpolative search to find the
@@ -233,8 +281,8 @@ typedef struct
    crn_uint32                 quality_level;           // [cCRNMinQualityLevel, cCRNMaxQualityLevel]
 
    // DXTn compression parameters.
-   crn_uint32                 dxt1a_alpha_threshold;
-   crn_dxt_quality            dxt_quality;
+   crn_uint32                 dxt1a_alpha_threshold;   // With cCRNCompFlagDXT1AForTransparency, alpha below this is transparent
+   crn_dxt_quality            dxt_quality;             // Defaults to Normal; crunch defaulted to Uber, which is about 15x slower
    crn_dxt_compressor_type    dxt_compressor_type;
 
    // Alpha channel's component. Defaults to 3.
@@ -282,7 +330,7 @@ static inline void crn_comp_params_clear(crn_comp_params* p)
    p->target_bitrate = 0.0f;
    p->quality_level = cCRNMaxQualityLevel;
    p->dxt1a_alpha_threshold = 128;
-   p->dxt_quality = cCRNDXTQualityUber;
+   p->dxt_quality = cCRNDXTQualityNormal;
    p->dxt_compressor_type = cCRNDXTCompressorCRN;
    p->alpha_component = 3;
 
@@ -348,6 +396,8 @@ static inline crn_bool crn_comp_params_check(const crn_comp_params* p)
       ((p->height < 1) || (p->height > cCRNMaxLevelResolution)) ||
       ((p->levels < 1) || (p->levels > cCRNMaxLevels)) ||
       ((p->format < cCRNFmtDXT1) || (p->format >= cCRNFmtTotal)) ||
+      (((p->format == cCRNFmtBC6H) || (p->format == cCRNFmtBC7)) && (p->file_type != cCRNFileTypeDDS)) ||
+      ((p->format == cCRNFmtBC6H) && (p->flags & cCRNCompFlagSource16)) ||
       ((p->crn_color_endpoint_palette_size) && ((p->crn_color_endpoint_palette_size < cCRNMinPaletteSize) || (p->crn_color_endpoint_palette_size > cCRNMaxPaletteSize))) ||
       ((p->crn_color_selector_palette_size) && ((p->crn_color_selector_palette_size < cCRNMinPaletteSize) || (p->crn_color_selector_palette_size > cCRNMaxPaletteSize))) ||
       ((p->crn_alpha_endpoint_palette_size) && ((p->crn_alpha_endpoint_palette_size < cCRNMinPaletteSize) || (p->crn_alpha_endpoint_palette_size > cCRNMaxPaletteSize))) ||
@@ -435,17 +485,23 @@ typedef struct
    crn_uint32     min_mip_size;
 
    crn_bool       renormalize;
+   // Filter with wrapped edges instead of clamped ones, so mips of tiling textures stay seamless.
    crn_bool       tiled;
+   // Filter cubemap faces across their edges, reading neighbor faces, so low mips don't show seams. Overrides tiled.
+   crn_bool       seamless_cube;
 
+   // Top level size: scale_x/y are the size in texels for cCRNSMAbsolute, or a factor for cCRNSMRelative. The pow2 modes round each axis to a power of 2.
    crn_scale_mode scale_mode;
    float          scale_x;
    float          scale_y;
 
+   // Source crop, inclusive. Ignored unless right > left and bottom > top. Cropping and scaling are one filter pass.
    crn_uint32     window_left;
    crn_uint32     window_top;
    crn_uint32     window_right;
    crn_uint32     window_bottom;
 
+   // Upper bound on the scaled size of each axis, if clamp_scale is set (0=no bound).
    crn_bool       clamp_scale;
    crn_uint32     clamp_width;
    crn_uint32     clamp_height;
@@ -463,6 +519,7 @@ static inline void crn_mipmap_params_clear(crn_mipmap_params* p)
    p->blurriness = .9f;
    p->renormalize = crn_false;
    p->tiled = crn_false;
+   p->seamless_cube = crn_false;
    p->max_levels = cCRNMaxLevels;
    p->min_mip_size = 1;
 
@@ -480,7 +537,12 @@ static inline void crn_mipmap_params_clear(crn_mipmap_params* p)
    p->clamp_height = 0;
 }
 
-static inline crn_bool crn_mipmap_params_check(const crn_mipmap_params* p) { return crn_true; }
+static inline crn_bool crn_mipmap_params_check(const crn_mipmap_params* p)
+{
+   if ((p->mode >= cCRNMipModeTotal) || (p->filter >= cCRNMipFilterTotal) || (p->blurriness <= 0.0f) || (p->max_levels < 1))
+      return crn_false;
+   return crn_true;
+}
 
 static inline crn_bool crn_mipmap_params_comp(const crn_mipmap_params* lhs, const crn_mipmap_params* rhs)
 {
@@ -493,6 +555,7 @@ static inline crn_bool crn_mipmap_params_comp(const crn_mipmap_params* lhs, cons
    CRNLIB_COMP(blurriness);
    CRNLIB_COMP(renormalize);
    CRNLIB_COMP(tiled);
+   CRNLIB_COMP(seamless_cube);
    CRNLIB_COMP(max_levels);
    CRNLIB_COMP(min_mip_size);
    CRNLIB_COMP(scale_mode);
@@ -546,15 +609,23 @@ void *crn_compress(const crn_comp_params *comp_params, crn_uint32 *compressed_si
 
 // Like the above function, except this function can also do things like generate mipmaps, and resize or crop the input texture before compression.
 // The actual operations performed are controlled by the crn_mipmap_params struct members.
+// Sources may be up to cCRNMaxSourceResolution on either axis. A cropped or scaled top level replaces any source mipmaps.
 // Be sure to set the "gamma_filtering" member of crn_mipmap_params to false if the input texture is not sRGB.
+// cCRNFmtBC6H's float images are always filtered as they are, in linear light.
+// cCRNCompFlagSource16's 16-bit images are filtered to 16-bit levels, gamma and renormalization included.
 void *crn_compress_ext(const crn_comp_params *comp_params, const crn_mipmap_params *mip_params, crn_uint32 *compressed_size, crn_uint32 *pActual_quality_level, float *pActual_bitrate);
 
 // Transcodes an entire CRN file to DDS using the crn_decomp.h header file library to do most of the heavy lifting.
+// Texture array slices that share the first slice's palettes can't be transcoded alone, and fail.
 // The output DDS file's format is guaranteed to be one of the DXTn formats in the crn_format enum.
 // This is a fast operation, because the CRN format is explicitly designed to be efficiently transcodable to DXTn.
 // For more control over decompression, see the lower-level helper functions in crn_decomp.h, which do not depend at all on crnlib.
 void *crn_decompress_crn_to_dds(const void *pCRN_file_data, crn_uint32 *file_size);
 
+// Like crn_decompress_crn_to_dds(), except mipmap levels are transcoded concurrently on up to num_helper_threads extra threads ([0,cCRNMaxHelperThreads]).
+// All faces of a level share one bitstream, so the available parallelism is bounded by the number of levels.
+void *crn_decompress_crn_to_dds_ext(const void *pCRN_file_data, crn_uint32 *file_size, crn_uint32 num_helper_threads);
+
 // Decompresses an entire DDS file in any supported format to uncompressed 32-bit/pixel image(s).
 // See the crnlib::pixel_format enum in inc/dds_defs.h for a list of the supported DDS formats.
 // You are responsible for freeing each image block, either by calling crn_free_all_images() or manually calling crn_free_block() on each image pointer.
@@ -572,6 +643,58 @@ crn_bool crn_decompress_dds_to_images(const void *pDDS_file_data, crn_uint32 dds
 // Frees all images allocated by crn_decompress_dds_to_images().
 void crn_free_all_images(crn_uint32 **ppImages, const crn_texture_desc *desc);
 
+// -------- Texture arrays.
+
+// Decodes an image file in memory (anything stb_image reads: PNG, JPEG, TGA, BMP, PSD, GIF, HDR, PIC or PNM) to 32-bit RGBA pixels.
+// An animated GIF yields every frame: *pNum_images receives the number of frames, and if ppDelays isn't NULL, *ppDelays
+// receives each frame's delay in milliseconds (free it with crn_free_block()). Other files yield 1 image and no delays.
+// The images are stored back to back, width*height pixels each, ready to pass to crn_compress_array().
+// Returns NULL on failure. The returned block must be freed by calling crn_free_block().
+crn_uint32 *crn_load_image(const void *pSrc_file_data, crn_uint32 src_file_size, crn_uint32 *pWidth, crn_uint32 *pHeight, crn_uint32 *pNum_images, int **ppDelays);
+
+// Compresses num_slices ([1,cCRNMaxArraySlices]) 2D images of the same size, such as the frames of an animated GIF or
+// a numbered image sequence, as one texture array. ppSlices[i] points to slice i's top level, which comp_params
+// describes: comp_params' pImages are ignored and faces must be 1.
+// mip_params may be NULL to only compress the top levels. Otherwise every slice gets the mip chain crn_compress_ext()
+// would build, and the slices may be as large as crn_compress_ext() allows.
+// Slices are compressed together, spread over comp_params' helper threads:
+//  CRN: the slices share one set of palettes, clustered once from the blocks of all of them and sized like a single
+//   texture's of all their blocks. Each slice is written as a CRN file, all of them back to back in the returned block,
+//   and if pSlice_sizes isn't NULL it receives each file's size (num_slices entries). Only the first file stores the
+//   palettes: the others are flagged with cCRNHeaderFlagSharedPalettes and are transcoded by passing the first file to
+//   crnd_unpack_begin_slice(). A target bitrate applies to the slices as a whole. Slices that have few block endpoints
+//   in common, like unrelated images, are instead compressed one by one (several at once) into standalone files.
+//   Either way, crnd_unpack_begin_slice() opens every slice.
+//  DDS: a single DDS file with a DX10 header holding a num_slices texture array. Supports DXT1, DXT3, DXT5 (and the
+//   swizzled DXT5 formats, written as plain BC3), DXT5A, DXN_XY, BC6H and BC7. pSlice_sizes is ignored.
+// Returns NULL on failure, otherwise a block that must be freed by calling crn_free_block().
+void *crn_compress_array(const crn_comp_params *comp_params, const crn_mipmap_params *mip_params, const crn_uint32 *const *ppSlices, crn_uint32 num_slices, crn_uint32 *compressed_size, crn_uint32 *pSlice_sizes);
+
+// Decodes an image file in memory to float RGBA pixels (4 floats per pixel), for cCRNFmtBC6H. Radiance .hdr files keep
+// their values; other files (anything crn_load_image() reads, but only a GIF's first frame) are converted to linear
+// light with a 2.2 gamma, so they land on the same scale.
+// Returns NULL on failure. The returned block must be freed by calling crn_free_block().
+float *crn_load_image_hdr(const void *pSrc_file_data, crn_uint32 src_file_size, crn_uint32 *pWidth, crn_uint32 *pHeight);
+
+// Decodes an image file in memory to 16-bit RGBA pixels (4 crn_uint16's per pixel), for cCRNCompFlagSource16. 16-bit PNG
+// and PNM files keep their precision; 8-bit files (only a GIF's first frame) are widened exactly, each value times 257.
+// Returns NULL on failure. The returned block must be freed by calling crn_free_block().
+crn_uint16 *crn_load_image_16(const void *pSrc_file_data, crn_uint32 src_file_size, crn_uint32 *pWidth, crn_uint32 *pHeight);
+
+// -------- Source analysis.
+
+// Classifies the top level of every face of comp_params' images in a single pass, which stops early once every class
+// is ruled out. Returns a combination of crn_texture_class bits, or 0 for cCRNFmtBC6H's float images and 16-bit images.
+// crn_compress() runs the same analysis on each level it writes to .DDS, to skip work the contents don't need (alpha
+// blocks of opaque levels, the endpoint search on binary alpha, every block but one of a constant level).
+crn_uint32 crn_analyze_texture(const crn_comp_params *comp_params);
+
+// Suggests a format for a texture with the crn_texture_class bits in texture_classes, and adjusts *pFlags (may be NULL)
+// to match: cCRNCompFlagDXT1AForTransparency for binary alpha, no cCRNCompFlagPerceptual for normal maps, and
+// cCRNCompFlagGrayscaleSampling for grayscale textures that aren't constant (their shaders should then sample luma).
+//  Opaque normal maps: DXN_XY. Opaque or binary alpha: DXT1. Anything else: DXT5.
+crn_format crn_get_recommended_format(crn_uint32 texture_classes, crn_uint32 *pFlags);
+
 // -------- crn_format related helpers functions.
 
 // Returns the FOURCC format equivalent to the specified crn_format.
@@ -605,8 +728,12 @@ const char* crn_get_dxt_quality_string(crn_dxt_quality q);
 typedef void *crn_block_compressor_context_t;
 
 // Create a DXTn block compressor.
-// This function only supports the basic/nonswizzled "fundamental" formats: DXT1, DXT3, DXT5, DXT5A, DXN_XY and DXN_YX.
+// This function supports the "fundamental" formats DXT1, DXT3, DXT5, DXT5A, DXN_XY and DXN_YX, the swizzled DXT5 formats, ETC1 and BC7.
+// BC6H takes float pixels, so it is only available through crn_compress().
 // Avoid calling this multiple times if you intend on compressing many blocks, because it allocates some memory.
+// The context keeps its own endpoint cache (unless cCRNCompFlagDisableEndpointCaching is set), so repeated blocks are cheap.
+// A context must only be used by one thread at a time: create one per worker thread.
+// Returns NULL if the format is unsupported or memory runs out.
 crn_block_compressor_context_t crn_create_block_compressor(const crn_comp_params *params);
 
 // Compresses a block of 16 pixels to the destination DXTn block.
@@ -614,6 +741,10 @@ crn_block_compressor_context_t crn_create_block_compressor(const crn_comp_params
 // pPixels should be an array of 16 crn_uint32's. Each crn_uint32 must be r,g,b,a (r is always first) in memory.
 void crn_compress_block(crn_block_compressor_context_t pContext, const crn_uint32 *pPixels, void *pDst_block);
 
+// Compresses num_blocks blocks in one call, which is much cheaper than calling crn_compress_block() per block.
+// pPixels holds num_blocks consecutive blocks of 16 crn_uint32's, and the blocks are written consecutively to pDst_blocks.
+void crn_compress_blocks(crn_block_compressor_context_t pContext, const crn_uint32 *pPixels, crn_uint32 num_blocks, void *pDst_blocks);
+
 // Frees a DXTn block compressor.
 void crn_free_block_compressor(crn_block_compressor_context_t pContext);
 
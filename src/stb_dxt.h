@@ -8,8 +8,12 @@
 //     Alpha channel is not stored if you specify alpha=0 (but you
 //     must supply some constant alpha in the alpha channel).
 //     You can turn on dithering and "high quality" using mode.
+//   stb_compress_dxt_block_weighted() also takes relative weights of the
+//     R, G and B squared errors: the principal axis and the color matching
+//     follow the weighted error. NULL weights are the same as equal ones.
 //
 // version history:
+//   (crunch) stb_compress_dxt_block_weighted(): per channel error weights
 //   v1.12  - (ryg) fix bug in single-color table generator
 //   v1.11  - (ryg) avoid racy global init, better single-color tables, remove dither
 //   v1.10  - (i.c) various small quality improvements
@@ -56,6 +60,7 @@ extern "C" {
 #define STB_DXT_HIGHQUAL  2   // high quality mode, does two refinement steps instead of 1. ~30-40% slower.
 
 STBDDEF void stb_compress_dxt_block(unsigned char *dest, const unsigned char *src_rgba_four_bytes_per_pixel, int alpha, int mode);
+STBDDEF void stb_compress_dxt_block_weighted(unsigned char *dest, const unsigned char *src_rgba_four_bytes_per_pixel, int alpha, int mode, const unsigned char *rgb_weights);
 STBDDEF void stb_compress_bc4_block(unsigned char *dest, const unsigned char *src_r_one_byte_per_pixel);
 STBDDEF void stb_compress_bc5_block(unsigned char *dest, const unsigned char *src_rg_two_byte_per_pixel);
 
@@ -217,7 +222,7 @@ static void stb__EvalColors(unsigned char *color,unsigned short c0,unsigned shor
 }
 
 // The color matching function
-static unsigned int stb__MatchColorsBlock(unsigned char *block, unsigned char *color)
+static unsigned int stb__MatchColorsBlock(unsigned char *block, unsigned char *color, const unsigned char *weights)
 {
    unsigned int mask = 0;
    int dirr = color[0*4+0] - color[1*4+0];
@@ -228,6 +233,14 @@ static unsigned int stb__MatchColorsBlock(unsigned char *block, unsigned char *c
    int i;
    int c0Point, halfPoint, c3Point;
 
+   // with weights, project along the direction scaled by them: that's the
+   // projection onto the line under the weighted distance.
+   if (weights) {
+      dirr *= weights[0];
+      dirg *= weights[1];
+      dirb *= weights[2];
+   }
+
    for(i=0;i<16;i++)
       dots[i] = block[i*4+0]*dirr + block[i*4+1]*dirg + block[i*4+2]*dirb;
 
@@ -260,7 +273,7 @@ static unsigned int stb__MatchColorsBlock(unsigned char *block, unsigned char *c
 }
 
 // The color optimization function. (Clever code, part 1)
-static void stb__OptimizeColorsBlock(unsigned char *block, unsigned short *pmax16, unsigned short *pmin16)
+static void stb__OptimizeColorsBlock(unsigned char *block, unsigned short *pmax16, unsigned short *pmin16, const unsigned char *weights)
 {
   int mind,maxd;
   unsigned char *minp, *maxp;
@@ -268,6 +281,7 @@ static void stb__OptimizeColorsBlock(unsigned char *block, unsigned short *pmax1
   int v_r,v_g,v_b;
   static const int nIterPower = 4;
   float covf[6],vfr,vfg,vfb;
+  float wr = 1.0f, wg = 1.0f, wb = 1.0f;
 
   // determine color distribution
   int cov[6];
@@ -318,11 +332,21 @@ static void stb__OptimizeColorsBlock(unsigned char *block, unsigned short *pmax1
   vfg = (float) (max[1] - min[1]);
   vfb = (float) (max[2] - min[2]);
 
+  // with weights, iterate on weights*covariance, normalized to average 1. its
+  // principal eigenvector v gives the extremes of the weighted principal axis
+  // through plain dot products, so the rest stays as is.
+  if (weights) {
+    float norm = 3.0f / (weights[0] + weights[1] + weights[2]);
+    wr = weights[0] * norm;
+    wg = weights[1] * norm;
+    wb = weights[2] * norm;
+  }
+
   for(iter=0;iter<nIterPower;iter++)
   {
-    float r = vfr*covf[0] + vfg*covf[1] + vfb*covf[2];
-    float g = vfr*covf[1] + vfg*covf[3] + vfb*covf[4];
-    float b = vfr*covf[2] + vfg*covf[4] + vfb*covf[5];
+    float r = (vfr*covf[0] + vfg*covf[1] + vfb*covf[2]) * wr;
+    float g = (vfr*covf[1] + vfg*covf[3] + vfb*covf[4]) * wg;
+    float b = (vfr*covf[2] + vfg*covf[4] + vfb*covf[5]) * wb;
 
     vfr = r;
     vfg = g;
@@ -399,6 +423,8 @@ static unsigned short stb__Quantize6(float x)
 // The refinement function. (Clever code, part 2)
 // Tries to optimize colors to suit block contents better.
 // (By solving a least squares system via normal equations+Cramer's rule)
+// Per channel weights don't change the solution, as the channels are solved
+// separately; they only enter through the matched indices in mask.
 static int stb__RefineBlock(unsigned char *block, unsigned short *pmax16, unsigned short *pmin16, unsigned int mask)
 {
    static const int w1Tab[4] = { 3,0,2,1 };
@@ -476,7 +502,7 @@ static int stb__RefineBlock(unsigned char *block, unsigned short *pmax16, unsign
 }
 
 // Color block compression
-static void stb__CompressColorBlock(unsigned char *dest, unsigned char *block, int mode)
+static void stb__CompressColorBlock(unsigned char *dest, unsigned char *block, int mode, const unsigned char *weights)
 {
    unsigned int mask;
    int i;
@@ -498,10 +524,10 @@ static void stb__CompressColorBlock(unsigned char *dest, unsigned char *block, i
       min16 = (stb__OMatch5[r][1]<<11) | (stb__OMatch6[g][1]<<5) | stb__OMatch5[b][1];
    } else {
       // first step: PCA+map along principal axis
-      stb__OptimizeColorsBlock(block,&max16,&min16);
+      stb__OptimizeColorsBlock(block,&max16,&min16,weights);
       if (max16 != min16) {
          stb__EvalColors(color,max16,min16);
-         mask = stb__MatchColorsBlock(block,color);
+         mask = stb__MatchColorsBlock(block,color,weights);
       } else
          mask = 0;
 
@@ -512,7 +538,7 @@ static void stb__CompressColorBlock(unsigned char *dest, unsigned char *block, i
          if (stb__RefineBlock(block,&max16,&min16,mask)) {
             if (max16 != min16) {
                stb__EvalColors(color,max16,min16);
-               mask = stb__MatchColorsBlock(block,color);
+               mask = stb__MatchColorsBlock(block,color,weights);
             } else {
                mask = 0;
                break;
@@ -597,6 +623,11 @@ static void stb__CompressAlphaBlock(unsigned char *dest,unsigned char *src, int
 }
 
 void stb_compress_dxt_block(unsigned char *dest, const unsigned char *src, int alpha, int mode)
+{
+   stb_compress_dxt_block_weighted(dest, src, alpha, mode, 0);
+}
+
+void stb_compress_dxt_block_weighted(unsigned char *dest, const unsigned char *src, int alpha, int mode, const unsigned char *rgb_weights)
 {
    unsigned char data[16][4];
    if (alpha) {
@@ -611,7 +642,7 @@ void stb_compress_dxt_block(unsigned char *dest, const unsigned char *src, int a
       src = &data[0][0];
    }
 
-   stb__CompressColorBlock(dest,(unsigned char*) src,mode);
+   stb__CompressColorBlock(dest,(unsigned char*) src,mode,rgb_weights);
 }
 
 void stb_compress_bc4_block(unsigned char *dest, const unsigned char *src)
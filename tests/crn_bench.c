@@ -0,0 +1,124 @@
+// File: crn_bench.c - DXT1 throughput and quality of each compressor backend and crn_dxt_quality tier.
+//
+// Run as "crn_bench [size] [flags]". Compresses a synthetic size x size image (256 by default) to a single level .DDS
+// with every backend and tier, on one thread, and prints the best of a few runs in Mpix/s with the RGB PSNR of the
+// output. flags replaces crn_comp_params_clear()'s default flags, e.g. 0 to time the unweighted metric without
+// 3 color blocks.
+#include "crnlib.h"
+#include "crn_core.h"
+#include "crn_dxt.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Same kind of content as crn_test: smooth gradients, a hard edged checkerboard and some noise.
+static crn_uint8* bench_make_image(crn_uint32 size)
+{
+	crn_uint8* pImage = (crn_uint8*)malloc((size_t)size * size * 4);
+	crn_uint32 seed = 1;
+	for (crn_uint32 y = 0; y < size; y++)
+	{
+		for (crn_uint32 x = 0; x < size; x++)
+		{
+			crn_uint8* p = pImage + ((size_t)y * size + x) * 4;
+			const double fx = (double)x / size, fy = (double)y / size;
+			seed = seed * 1664525U + 1013904223U;
+			p[0] = (crn_uint8)(128 + 100 * sin(fx * 12 + 1) + (seed >> 16) % 16);
+			p[1] = (crn_uint8)(128 + 100 * cos(fy * 9) * sin(fx * 3) + (seed >> 24) % 8);
+			p[2] = (crn_uint8)((((x / 16) ^ (y / 16)) & 1) ? 200 : 40);
+			p[3] = 255;
+		}
+	}
+	return pImage;
+}
+
+// Processor time, which is wall time here since nothing runs on helper threads.
+static double bench_now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// RGB PSNR of the DXT1 blocks of a .DDS file against the image.
+static double bench_psnr(const crn_uint8* pImage, crn_uint32 size, const crn_uint8* pDDS)
+{
+	// DXT1 is written without a DX10 header, so the blocks follow the 128 byte header.
+	const crn_uint8* pBlocks = pDDS + 128;
+	const crn_uint32 blocks_x = size >> 2;
+	double error = 0.0;
+
+	for (crn_uint32 b = 0; b < blocks_x * blocks_x; b++)
+	{
+		const crn_uint8* pBlock = pBlocks + b * 8;
+		crn_uint8 colors[4][4];
+		crn_dxt1_get_block_colors((crn_uint16)(pBlock[0] | (pBlock[1] << 8)), (crn_uint16)(pBlock[2] | (pBlock[3] << 8)), colors);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const crn_uint8* pColor = colors[(pBlock[4 + (i >> 2)] >> ((i & 3) * 2)) & 3];
+			const crn_uint8* p = pImage + ((size_t)((b / blocks_x) * 4 + (i >> 2)) * size + (b % blocks_x) * 4 + (i & 3)) * 4;
+			for (crn_uint32 c = 0; c < 3; c++)
+				error += (double)(p[c] - pColor[c]) * (p[c] - pColor[c]);
+		}
+	}
+	error /= (double)size * size * 3;
+	return (error > 1e-10) ? 10.0 * log10(255.0 * 255.0 / error) : 100.0;
+}
+
+int main(int argc, char** argv)
+{
+	static const char* s_compressors[] = { "CRN", "CRNF", "RYG" };
+	static const char* s_qualities[cCRNDXTQualityTotal] = { "SuperFast", "Fast", "Normal", "Better", "Uber" };
+	const crn_uint32 size = (argc > 1) ? (crn_uint32)atoi(argv[1]) & ~3U : 256;
+	crn_uint8* pImage;
+	crn_comp_params params;
+
+	if (size < 4)
+	{
+		fprintf(stderr, "Usage: crn_bench [size] [flags]\n");
+		return EXIT_FAILURE;
+	}
+	pImage = bench_make_image(size);
+	crn_comp_params_clear(&params);
+	params.file_type = cCRNFileTypeDDS;
+	params.width = params.height = size;
+	params.pImages[0][0] = (const crn_uint32*)pImage;
+	if (argc > 2)
+		params.flags = (crn_uint32)strtoul(argv[2], NULL, 0);
+	printf("%ux%u DXT1, flags 0x%X\n", size, size, params.flags);
+
+	for (crn_uint32 c = 0; c < CRN_ARRAY_SIZE(s_compressors); c++)
+	{
+		for (crn_uint32 q = 0; q < cCRNDXTQualityTotal; q++)
+		{
+			double best = 1e30, psnr = -1.0;
+			crn_uint32 runs = 0;
+			params.dxt_compressor_type = (crn_dxt_compressor_type)(cCRNDXTCompressorCRN + c);
+			params.dxt_quality = (crn_dxt_quality)q;
+
+			// At least 3 runs and a quarter second.
+			for (double total = 0.0; runs < 3 || total < 0.25; runs++)
+			{
+				const double start = bench_now();
+				crn_uint32 dds_size = 0;
+				void* pDDS = crn_compress(&params, &dds_size, NULL, NULL);
+				const double t = bench_now() - start;
+				if (!pDDS)
+				{
+					fprintf(stderr, "crn_compress() failed\n");
+					free(pImage);
+					return EXIT_FAILURE;
+				}
+				if (!runs)
+					psnr = bench_psnr(pImage, size, (const crn_uint8*)pDDS);
+				crn_free_block(pDDS);
+				best = CRN_MIN(best, t);
+				total += t;
+			}
+			printf("%-4s %-9s %8.2f Mpix/s %6.2f dB\n", s_compressors[c], s_qualities[q], (double)size * size / best * 1e-6, psnr);
+		}
+	}
+
+	free(pImage);
+	return EXIT_SUCCESS;
+}
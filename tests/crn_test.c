@@ -0,0 +1,1535 @@
+// File: crn_test.c - Round trip quality checks, run by ctest as "crn_test <case>".
+//
+// Each case compresses synthetic images, decodes the result with the library's own block decoders and fails
+// if the PSNR drops below a floor. The floors sit a little under measured values, so they catch regressions
+// without tracking every small change of the encoders. The mipmap, block API and transcoding cases check exact
+// properties instead: references computed here, unit vectors, matching blocks. crn_test_scalar is the same program
+// linked against the library built with CRN_SSE2=0.
+#include "crnlib.h"
+#include "crn_core.h"
+#include "crn_decomp.h"
+#include "crn_bc6h.h"
+#include "crn_bc7.h"
+#include "crn_dxt.h"
+#include "crn_etc.h"
+#include "crn_mipmap.h"
+#include "crn_swizzle.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -------- Images
+
+static crn_uint32 g_test_seed;
+
+static crn_uint32 test_rand(void)
+{
+	g_test_seed = g_test_seed * 1664525U + 1013904223U;
+	return g_test_seed >> 16;
+}
+
+// Smooth gradients, a hard edged checkerboard and some noise, in every channel.
+static crn_uint8* test_make_image(crn_uint32 width, crn_uint32 height, crn_uint32 seed)
+{
+	crn_uint8* pImage = (crn_uint8*)malloc((size_t)width * height * 4);
+	g_test_seed = seed;
+	for (crn_uint32 y = 0; y < height; y++)
+	{
+		for (crn_uint32 x = 0; x < width; x++)
+		{
+			crn_uint8* p = pImage + ((size_t)y * width + x) * 4;
+			const double fx = (double)x / width, fy = (double)y / height;
+			p[0] = (crn_uint8)(128 + 100 * sin(fx * 12 + seed) + test_rand() % 16);
+			p[1] = (crn_uint8)(128 + 100 * cos(fy * 9) * sin(fx * 3) + test_rand() % 8);
+			p[2] = (crn_uint8)((((x / 16) ^ (y / 16)) & 1) ? 200 : 40);
+			p[3] = (crn_uint8)(255 * fx * fy);
+		}
+	}
+	return pImage;
+}
+
+// -------- Decoding
+
+static crn_uint16 test_read16(const crn_uint8* p) { return (crn_uint16)(p[0] | (p[1] << 8)); }
+
+// Decodes one block of any 8-bit format to RGBA. Formats without color leave RGB at 0, without alpha leave it at 255.
+static void test_decode_block(crn_format fmt, const crn_uint8* pBlock, crn_uint8 pixels[16][4])
+{
+	crn_uint8 colors[4][4], values[8];
+	crn_uint64 bits;
+
+	for (crn_uint32 i = 0; i < 16; i++)
+	{
+		pixels[i][0] = pixels[i][1] = pixels[i][2] = 0;
+		pixels[i][3] = 255;
+	}
+
+	switch (crn_get_fundamental_dxt_format(fmt))
+	{
+	case cCRNFmtDXT3:
+		for (crn_uint32 i = 0; i < 16; i++)
+			pixels[i][3] = (crn_uint8)(((pBlock[i >> 1] >> ((i & 1) * 4)) & 15) * 17);
+		pBlock += 8;
+		// The color block follows.
+		/* fall through */
+	case cCRNFmtDXT1:
+		crn_dxt1_get_block_colors(test_read16(pBlock), test_read16(pBlock + 2), colors);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const crn_uint8* pColor = colors[(pBlock[4 + (i >> 2)] >> ((i & 3) * 2)) & 3];
+			pixels[i][0] = pColor[0];
+			pixels[i][1] = pColor[1];
+			pixels[i][2] = pColor[2];
+			if (crn_get_fundamental_dxt_format(fmt) == cCRNFmtDXT1)
+				pixels[i][3] = pColor[3];
+		}
+		break;
+
+	case cCRNFmtDXT5:
+	case cCRNFmtDXT5A:
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+	{
+		// Channel of each 8 byte alpha block, the DXT5 color block follows its alpha block.
+		const crn_uint32 dxn = fmt == cCRNFmtDXN_XY || fmt == cCRNFmtDXN_YX;
+		const crn_uint32 channels[2] = { dxn ? (fmt == cCRNFmtDXN_YX ? 1U : 0U) : 3U, fmt == cCRNFmtDXN_YX ? 0U : 1U };
+		for (crn_uint32 b = 0; b < (dxn ? 2U : 1U); b++)
+		{
+			crn_dxt5_get_block_values(pBlock[b * 8], pBlock[b * 8 + 1], values);
+			bits = 0;
+			for (crn_uint32 i = 0; i < 6; i++)
+				bits |= (crn_uint64)pBlock[b * 8 + 2 + i] << (i * 8);
+			for (crn_uint32 i = 0; i < 16; i++)
+				pixels[i][channels[b]] = values[(bits >> (i * 3)) & 7];
+		}
+		if (crn_get_fundamental_dxt_format(fmt) == cCRNFmtDXT5)
+		{
+			crn_dxt1_get_block_colors(test_read16(pBlock + 8), test_read16(pBlock + 10), colors);
+			for (crn_uint32 i = 0; i < 16; i++)
+			{
+				const crn_uint8* pColor = colors[(pBlock[12 + (i >> 2)] >> ((i & 3) * 2)) & 3];
+				pixels[i][0] = pColor[0];
+				pixels[i][1] = pColor[1];
+				pixels[i][2] = pColor[2];
+			}
+		}
+		break;
+	}
+
+	case cCRNFmtETC1:
+		crn_etc1_decode_block(pBlock, pixels);
+		break;
+
+	case cCRNFmtBC7:
+		crn_bc7_decode_block(pBlock, pixels);
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Decodes a width x height level of tightly packed blocks to RGBA pixels, and returns the blocks after it.
+static const crn_uint8* test_decode_level(crn_format fmt, const crn_uint8* pBlocks, crn_uint32 width, crn_uint32 height, crn_uint8* pImage)
+{
+	const crn_uint32 bpb = crn_get_bytes_per_dxt_block(fmt), blocks_x = (width + 3) >> 2, blocks_y = (height + 3) >> 2;
+
+	for (crn_uint32 b = 0; b < blocks_x * blocks_y; b++, pBlocks += bpb)
+	{
+		crn_uint8 pixels[16][4];
+		test_decode_block(fmt, pBlocks, pixels);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const crn_uint32 x = (b % blocks_x) * 4 + (i & 3), y = (b / blocks_x) * 4 + (i >> 2);
+			if (x < width && y < height)
+				memcpy(pImage + ((size_t)y * width + x) * 4, pixels[i], 4);
+		}
+	}
+	return pBlocks;
+}
+
+// PSNR over the given channels of width x height pixels, between an image and tightly packed blocks of it. The
+// swizzled DXT5 formats are compared against the swizzled image.
+static double test_psnr(crn_format fmt, const crn_uint8* pImage, const crn_uint8* pBlocks, crn_uint32 width, crn_uint32 height, crn_uint32 channel_mask)
+{
+	const crn_uint32 bpb = crn_get_bytes_per_dxt_block(fmt), blocks_x = (width + 3) >> 2, blocks_y = (height + 3) >> 2;
+	double error = 0.0;
+	crn_uint32 samples = 0;
+
+	for (crn_uint32 by = 0; by < blocks_y; by++)
+	{
+		for (crn_uint32 bx = 0; bx < blocks_x; bx++)
+		{
+			crn_uint8 pixels[16][4];
+			test_decode_block(fmt, pBlocks + ((size_t)by * blocks_x + bx) * bpb, pixels);
+			for (crn_uint32 i = 0; i < 16; i++)
+			{
+				const crn_uint32 x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+				crn_uint8 expected[4];
+				if (x >= width || y >= height)
+					continue;
+				crn_swizzle_pixel(fmt, 3, pImage + ((size_t)y * width + x) * 4, expected);
+				for (crn_uint32 c = 0; c < 4; c++)
+				{
+					if (channel_mask & (1U << c))
+					{
+						const double d = (double)expected[c] - pixels[i][c];
+						error += d * d;
+						samples++;
+					}
+				}
+			}
+		}
+	}
+	error /= CRN_MAX(samples, 1U);
+	return (error > 1e-10) ? 10.0 * log10(255.0 * 255.0 / error) : 100.0;
+}
+
+// Channels a format stores, as a mask of RGBA bits.
+static crn_uint32 test_channel_mask(crn_format fmt)
+{
+	switch (fmt)
+	{
+	case cCRNFmtDXT1:
+	case cCRNFmtETC1:
+		return 7;
+	case cCRNFmtDXT5A:
+		return 8;
+	case cCRNFmtDXN_XY:
+	case cCRNFmtDXN_YX:
+		return 3;
+	case cCRNFmtDXT5_CCxY:
+		return 11;
+	case cCRNFmtDXT5_xGxR:
+		return 10;
+	case cCRNFmtDXT5_xGBR:
+		return 14;
+	default:
+		return 15;
+	}
+}
+
+// Compresses a single level image to CRN and returns the PSNR of its transcoded blocks, or -1 on failure.
+static double test_crn_psnr(const crn_comp_params* pParams, const crn_uint8* pImage, crn_uint32* pSize)
+{
+	const crn_uint32 width = pParams->width, height = pParams->height;
+	const crn_uint32 pitch = ((width + 3) >> 2) * crn_get_bytes_per_dxt_block(pParams->format);
+	const crn_uint32 blocks_size = pitch * ((height + 3) >> 2);
+	crn_comp_params params = *pParams;
+	crn_uint32 size = 0;
+	crnd_unpack_context ctx;
+	crn_uint8* pBlocks;
+	void* pCRN;
+	double psnr = -1.0;
+
+	params.pImages[0][0] = (const crn_uint32*)pImage;
+	pCRN = crn_compress(&params, &size, NULL, NULL);
+	if (!pCRN)
+		return -1.0;
+	if (pSize)
+		*pSize = size;
+
+	pBlocks = (crn_uint8*)malloc(blocks_size);
+	ctx = crnd_unpack_begin(pCRN, size);
+	if (ctx && pBlocks && crnd_unpack_level(ctx, (void**)&pBlocks, blocks_size, pitch, 0))
+		psnr = test_psnr(pParams->format, pImage, pBlocks, width, height, test_channel_mask(pParams->format));
+	crnd_unpack_end(ctx);
+	free(pBlocks);
+	crn_free_block(pCRN);
+	return psnr;
+}
+
+// Returns the first level's blocks of a .DDS file written by crn_compress(): they follow the 128 byte header, and its
+// 20 byte DX10 extension if the FOURCC says so.
+static const crn_uint8* test_dds_blocks(const crn_uint8* pDDS)
+{
+	return pDDS + 128 + (crn_read_le32(pDDS + 84) == (crn_uint32)('D' | ('X' << 8) | ('1' << 16) | ('0' << 24)) ? 20 : 0);
+}
+
+// Compresses a single level image to .DDS and returns the PSNR of its blocks, or -1 on failure.
+static double test_dds_psnr(const crn_comp_params* pParams, const crn_uint8* pImage)
+{
+	crn_comp_params params = *pParams;
+	crn_uint32 size = 0;
+	crn_uint8* pDDS;
+	double psnr;
+
+	params.file_type = cCRNFileTypeDDS;
+	params.pImages[0][0] = (const crn_uint32*)pImage;
+	pDDS = (crn_uint8*)crn_compress(&params, &size, NULL, NULL);
+	if (!pDDS)
+		return -1.0;
+	psnr = test_psnr(params.format, pImage, test_dds_blocks(pDDS), params.width, params.height, test_channel_mask(params.format));
+	crn_free_block(pDDS);
+	return psnr;
+}
+
+// -------- Cases
+
+static const crn_format g_test_crn_formats[] = { cCRNFmtDXT1, cCRNFmtDXT5, cCRNFmtDXT5A, cCRNFmtDXN_XY, cCRNFmtDXN_YX };
+
+// Adaptive tiling may cost at most its PSNR derating against fixed 4 tile chunks.
+static int test_hierarchical(void)
+{
+	const crn_uint32 size = 128;
+	crn_uint8* pImage = test_make_image(size, size, 1);
+	int failures = 0;
+
+	for (crn_uint32 f = 0; f < CRN_ARRAY_SIZE(g_test_crn_formats); f++)
+	{
+		crn_comp_params params;
+		double psnr[2];
+		crn_uint32 bytes[2] = { 0, 0 };
+
+		crn_comp_params_clear(&params);
+		params.width = params.height = size;
+		params.format = g_test_crn_formats[f];
+		params.quality_level = cCRNMaxQualityLevel;
+		psnr[0] = test_crn_psnr(&params, pImage, &bytes[0]);
+		params.flags &= ~cCRNCompFlagHierarchical;
+		psnr[1] = test_crn_psnr(&params, pImage, &bytes[1]);
+
+		printf("%-8s hierarchical %6.2f dB %6u bytes, flat %6.2f dB %6u bytes\n", crn_get_format_string(params.format), psnr[0], bytes[0], psnr[1], bytes[1]);
+		if (psnr[0] < 0.0 || psnr[1] < 0.0 || psnr[0] < psnr[1] - params.crn_adaptive_tile_color_psnr_derating)
+			failures++;
+	}
+
+	free(pImage);
+	return failures;
+}
+
+// Every CRN format with each flag combination the compressor reacts to, at a middle quality level, must stay above a
+// floor measured for it.
+static int test_crn(void)
+{
+	static const crn_uint32 s_flags[] =
+	{
+		0,
+		cCRNCompFlagPerceptual,
+		cCRNCompFlagHierarchical,
+		cCRNCompFlagQuick,
+		cCRNCompFlagHierarchical | cCRNCompFlagQuick,
+		cCRNCompFlagPerceptual | cCRNCompFlagHierarchical | cCRNCompFlagUseBothBlockTypes
+	};
+	static const struct
+	{
+		crn_format fmt;
+		float floors[CRN_ARRAY_SIZE(s_flags)];
+	} s_formats[] =
+	{
+		{ cCRNFmtDXT1,      { 34.9f, 34.7f, 33.3f, 34.9f, 33.3f, 32.7f } },
+		{ cCRNFmtDXT5,      { 36.1f, 36.0f, 35.5f, 36.1f, 35.5f, 35.2f } },
+		{ cCRNFmtDXT5_CCxY, { 40.0f, 39.7f, 39.0f, 40.0f, 39.0f, 38.7f } },
+		{ cCRNFmtDXT5_xGxR, { 39.1f, 39.1f, 38.8f, 39.1f, 38.8f, 38.8f } },
+		{ cCRNFmtDXT5_xGBR, { 40.2f, 40.2f, 39.6f, 40.2f, 39.6f, 39.8f } },
+		{ cCRNFmtDXT5_AGBR, { 38.2f, 38.1f, 37.1f, 38.2f, 37.1f, 37.1f } },
+		{ cCRNFmtDXT5A,     { 55.3f, 55.3f, 55.1f, 55.3f, 55.1f, 55.1f } },
+		{ cCRNFmtDXN_XY,    { 39.7f, 39.7f, 39.1f, 39.7f, 39.1f, 39.1f } },
+		{ cCRNFmtDXN_YX,    { 39.7f, 39.7f, 39.1f, 39.7f, 39.1f, 39.1f } }
+	};
+	const crn_uint32 size = 128;
+	crn_uint8* pImage = test_make_image(size, size, 4);
+	int failures = 0;
+
+	for (crn_uint32 f = 0; f < CRN_ARRAY_SIZE(s_formats); f++)
+	{
+		printf("%-8s", crn_get_format_string(s_formats[f].fmt));
+		for (crn_uint32 i = 0; i < CRN_ARRAY_SIZE(s_flags); i++)
+		{
+			crn_comp_params params;
+			double psnr;
+
+			crn_comp_params_clear(&params);
+			params.width = params.height = size;
+			params.format = s_formats[f].fmt;
+			params.flags = s_flags[i];
+			params.quality_level = 128;
+			psnr = test_crn_psnr(&params, pImage, NULL);
+			printf(" 0x%X %6.2f dB", s_flags[i], psnr);
+			if (psnr < s_formats[f].floors[i])
+				failures++;
+		}
+		printf("\n");
+	}
+
+	free(pImage);
+	return failures;
+}
+
+static float test_half_to_float(crn_uint16 h)
+{
+	return (h >> 10) ? ldexpf((float)(1024 + (h & 1023)), (h >> 10) - 25) : ldexpf((float)h, -24);
+}
+
+// Compresses a float image with values up to 4 to BC6H .DDS and returns the RGB PSNR against that peak, or -1 on failure.
+static double test_bc6h_psnr(crn_uint32 size)
+{
+	crn_uint8* pSource = test_make_image(size, size, 5);
+	float* pImage = (float*)malloc((size_t)size * size * 16);
+	crn_comp_params params;
+	crn_uint32 dds_size = 0;
+	crn_uint8* pDDS;
+	double error = 0.0;
+
+	for (crn_uint32 i = 0; i < size * size * 4; i++)
+		pImage[i] = 4.0f * powf(pSource[i] / 255.0f, 2.2f);
+	crn_comp_params_clear(&params);
+	params.file_type = cCRNFileTypeDDS;
+	params.format = cCRNFmtBC6H;
+	params.width = params.height = size;
+	params.pImages[0][0] = (const crn_uint32*)pImage;
+	pDDS = (crn_uint8*)crn_compress(&params, &dds_size, NULL, NULL);
+
+	for (crn_uint32 b = 0; pDDS && b < (size / 4) * (size / 4); b++)
+	{
+		crn_uint16 pixels[16][3];
+		crn_bc6h_decode_block(test_dds_blocks(pDDS) + b * 16, pixels);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const float* p = pImage + ((size_t)((b / (size / 4)) * 4 + (i >> 2)) * size + (b % (size / 4)) * 4 + (i & 3)) * 4;
+			for (crn_uint32 c = 0; c < 3; c++)
+			{
+				const double d = (double)p[c] - test_half_to_float(pixels[i][c]);
+				error += d * d;
+			}
+		}
+	}
+	error /= (double)size * size * 3;
+
+	crn_free_block(pDDS);
+	free(pImage);
+	free(pSource);
+	return !pDDS ? -1.0 : (error > 1e-20) ? 10.0 * log10(16.0 / error) : 100.0;
+}
+
+// .DDS output of the formats CRN doesn't cover, and of the swizzled DXT5 formats, at the default quality tier.
+static int test_dds(void)
+{
+	static const struct
+	{
+		crn_format fmt;
+		crn_uint32 flags;
+		float floor;
+	} s_cases[] =
+	{
+		{ cCRNFmtDXT3,      0,                              36.2f },
+		{ cCRNFmtDXT3,      cCRNCompFlagDXT3AlphaDithering, 35.1f },
+		{ cCRNFmtDXT5_CCxY, 0,                              42.7f },
+		{ cCRNFmtDXT5_xGxR, 0,                              45.2f },
+		{ cCRNFmtDXT5_xGBR, 0,                              44.6f },
+		{ cCRNFmtDXT5_AGBR, 0,                              43.1f },
+		{ cCRNFmtETC1,      0,                              35.7f },
+		{ cCRNFmtBC7,       0,                              44.1f }
+	};
+	const float bc6h_floor = 39.2f;
+	const crn_uint32 size = 128;
+	crn_uint8* pImage = test_make_image(size, size, 5);
+	int failures = 0;
+	double psnr;
+
+	for (crn_uint32 i = 0; i < CRN_ARRAY_SIZE(s_cases); i++)
+	{
+		crn_comp_params params;
+		crn_comp_params_clear(&params);
+		params.width = params.height = size;
+		params.format = s_cases[i].fmt;
+		params.flags |= s_cases[i].flags;
+		psnr = test_dds_psnr(&params, pImage);
+		printf("%-9s flags 0x%-4X %6.2f dB\n", crn_get_format_string(params.format), params.flags, psnr);
+		if (psnr < s_cases[i].floor)
+			failures++;
+	}
+
+	psnr = test_bc6h_psnr(size);
+	printf("%-9s %17.2f dB\n", crn_get_format_string(cCRNFmtBC6H), psnr);
+	if (psnr < bc6h_floor)
+		failures++;
+
+	free(pImage);
+	return failures;
+}
+
+// Each DXT1 quality tier must score at least as well as the one below it, on the unweighted metric the PSNR measures.
+static int test_tiers(void)
+{
+	static const crn_uint32 s_flags[2] = { 0, cCRNCompFlagUseBothBlockTypes };
+	static const char* s_compressors[] = { "CRN ", "CRNF", "RYG " };
+	const crn_uint32 size = 128;
+	crn_uint8* pImage = test_make_image(size, size, 3);
+	int failures = 0;
+
+	for (crn_uint32 i = 0; i < (crn_uint32)size * size; i++)
+		pImage[i * 4 + 3] = 255;
+	for (crn_uint32 f = 0; f < CRN_ARRAY_SIZE(s_flags); f++)
+	{
+		crn_comp_params params;
+		double psnr[CRN_ARRAY_SIZE(s_compressors)][cCRNDXTQualityTotal];
+
+		crn_comp_params_clear(&params);
+		params.width = params.height = size;
+		params.flags = s_flags[f];
+		for (crn_uint32 c = 0; c < CRN_ARRAY_SIZE(s_compressors); c++)
+		{
+			params.dxt_compressor_type = (crn_dxt_compressor_type)(cCRNDXTCompressorCRN + c);
+			printf("DXT1     %s flags 0x%X:", s_compressors[c], s_flags[f]);
+			for (crn_uint32 q = 0; q < cCRNDXTQualityTotal; q++)
+			{
+				params.dxt_quality = (crn_dxt_quality)q;
+				psnr[c][q] = test_dds_psnr(&params, pImage);
+				printf(" %s %.2f dB", crn_get_dxt_quality_string(params.dxt_quality), psnr[c][q]);
+				if (psnr[c][q] < 0.0 || (q && psnr[c][q] < psnr[c][q - 1]))
+					failures++;
+			}
+			printf("\n");
+		}
+
+		// CRNF is meant to run at least as fast as RYG at every tier, so it must not give up quality to it either.
+		for (crn_uint32 q = 0; q < cCRNDXTQualityTotal; q++)
+		{
+			if (psnr[1][q] < psnr[2][q])
+				failures++;
+		}
+	}
+
+	free(pImage);
+	return failures;
+}
+
+// Returns the average PSNR of a CRN array's slices, each transcoded with crnd_unpack_begin_slice(), or -1 on failure.
+static double test_crn_array_psnr(const crn_comp_params* pParams, const crn_uint8* pData, const crn_uint32* pSlice_sizes, crn_uint8* const* ppSlices, crn_uint32 num_slices)
+{
+	const crn_uint32 pitch = ((pParams->width + 3) >> 2) * crn_get_bytes_per_dxt_block(pParams->format);
+	const crn_uint32 blocks_size = pitch * ((pParams->height + 3) >> 2);
+	crn_uint8* pBlocks = (crn_uint8*)malloc(blocks_size);
+	double psnr = 0.0;
+	crn_uint32 ofs = 0;
+
+	for (crn_uint32 s = 0; s < num_slices; s++)
+	{
+		crnd_unpack_context ctx = crnd_unpack_begin_slice(pData + ofs, pSlice_sizes[s], pData, pSlice_sizes[0]);
+		if (!ctx || !crnd_unpack_level(ctx, (void**)&pBlocks, blocks_size, pitch, 0))
+		{
+			crnd_unpack_end(ctx);
+			free(pBlocks);
+			return -1.0;
+		}
+		psnr += test_psnr(pParams->format, ppSlices[s], pBlocks, pParams->width, pParams->height, test_channel_mask(pParams->format)) / num_slices;
+		crnd_unpack_end(ctx);
+		ofs += pSlice_sizes[s];
+	}
+	free(pBlocks);
+	return psnr;
+}
+
+// Slices with mostly the same blocks, like flipbook frames, must compress better as an array than one by one.
+static int test_array(void)
+{
+	enum { cNumSlices = 8, cSize = 128 };
+	crn_uint8* pSource = test_make_image(cSize * 2, cSize * 2, 2);
+	crn_uint8* pSlices[cNumSlices];
+	crn_uint32 slice_sizes[cNumSlices], array_size = 0, separate_size = 0, shared = 0;
+	double array_psnr, separate_psnr = 0.0;
+	crn_comp_params params;
+	crn_uint8* pArray;
+	int failures = 0;
+
+	// Each slice is a crop of the source, a few pixels further along.
+	for (crn_uint32 s = 0; s < cNumSlices; s++)
+	{
+		pSlices[s] = (crn_uint8*)malloc(cSize * cSize * 4);
+		for (crn_uint32 y = 0; y < cSize; y++)
+			memcpy(pSlices[s] + y * cSize * 4, pSource + ((y + s * 2) * cSize * 2 + s * 3) * 4, cSize * 4);
+	}
+
+	crn_comp_params_clear(&params);
+	params.width = params.height = cSize;
+	params.format = cCRNFmtDXT1;
+	params.target_bitrate = 1.5f;
+	pArray = (crn_uint8*)crn_compress_array(&params, NULL, (const crn_uint32* const*)pSlices, cNumSlices, &array_size, slice_sizes);
+	array_psnr = pArray ? test_crn_array_psnr(&params, pArray, slice_sizes, pSlices, cNumSlices) : -1.0;
+	for (crn_uint32 s = 1, ofs = slice_sizes[0]; pArray && s < cNumSlices; ofs += slice_sizes[s++])
+		shared += (crn_read_packed(pArray + ofs + cCRNHdrOfsFlags, 2) & cCRNHeaderFlagSharedPalettes) != 0;
+
+	for (crn_uint32 s = 0; s < cNumSlices; s++)
+	{
+		crn_uint32 size = 0;
+		separate_psnr += test_crn_psnr(&params, pSlices[s], &size) / cNumSlices;
+		separate_size += size;
+	}
+
+	printf("DXT1     array %6.2f dB %6u bytes (%u of %u slices sharing palettes), separate %6.2f dB %6u bytes\n",
+		array_psnr, array_size, shared, cNumSlices - 1, separate_psnr, separate_size);
+	if (array_psnr < 0.0 || array_psnr < separate_psnr || array_size * 8.0f > params.target_bitrate * cSize * cSize * cNumSlices)
+		failures++;
+	crn_free_block(pArray);
+
+	// Slices with nothing in common are compressed one by one, into standalone files.
+	for (crn_uint32 s = 0; s < cNumSlices; s++)
+	{
+		free(pSlices[s]);
+		pSlices[s] = test_make_image(cSize, cSize, 10 + s);
+	}
+	shared = 0;
+	pArray = (crn_uint8*)crn_compress_array(&params, NULL, (const crn_uint32* const*)pSlices, cNumSlices, &array_size, slice_sizes);
+	array_psnr = pArray ? test_crn_array_psnr(&params, pArray, slice_sizes, pSlices, cNumSlices) : -1.0;
+	for (crn_uint32 s = 1, ofs = slice_sizes[0]; pArray && s < cNumSlices; ofs += slice_sizes[s++])
+		shared += (crn_read_packed(pArray + ofs + cCRNHdrOfsFlags, 2) & cCRNHeaderFlagSharedPalettes) != 0;
+	printf("DXT1     unrelated slices %6.2f dB %6u bytes (%u of %u slices sharing palettes)\n", array_psnr, array_size, shared, cNumSlices - 1);
+	if (array_psnr < 0.0 || shared)
+		failures++;
+
+	crn_free_block(pArray);
+	for (crn_uint32 s = 0; s < cNumSlices; s++)
+		free(pSlices[s]);
+	free(pSource);
+	return failures;
+}
+
+// Every class crn_analyze_texture() reports, and the format and flags crn_get_recommended_format() maps it to.
+static int test_classes(void)
+{
+	enum { cKinds = 6, cSize = 64 };
+	static const char* s_names[cKinds] = { "opaque", "binary alpha", "alpha", "grayscale", "constant", "normal map" };
+	static const crn_uint32 s_classes[cKinds] =
+	{
+		cCRNTextureOpaque | cCRNTextureBinaryAlpha,
+		cCRNTextureBinaryAlpha,
+		0,
+		cCRNTextureOpaque | cCRNTextureBinaryAlpha | cCRNTextureGrayscale,
+		cCRNTextureOpaque | cCRNTextureBinaryAlpha | cCRNTextureGrayscale | cCRNTextureConstant,
+		cCRNTextureOpaque | cCRNTextureBinaryAlpha | cCRNTextureNormalMap
+	};
+	static const crn_format s_formats[cKinds] = { cCRNFmtDXT1, cCRNFmtDXT1, cCRNFmtDXT5, cCRNFmtDXT1, cCRNFmtDXT1, cCRNFmtDXN_XY };
+	// Flags added to and removed from the defaults.
+	static const crn_uint32 s_added[cKinds] = { 0, cCRNCompFlagDXT1AForTransparency, 0, cCRNCompFlagGrayscaleSampling, 0, 0 };
+	static const crn_uint32 s_removed[cKinds] = { 0, 0, 0, 0, 0, cCRNCompFlagPerceptual };
+	int failures = 0;
+
+	for (crn_uint32 k = 0; k < cKinds; k++)
+	{
+		crn_uint8* pImage = test_make_image(cSize, cSize, k);
+		crn_comp_params params;
+		crn_uint32 classes, flags;
+		crn_format fmt;
+
+		for (crn_uint32 i = 0; i < cSize * cSize; i++)
+		{
+			crn_uint8* p = pImage + i * 4;
+			const double fx = (double)(i % cSize) / cSize, fy = (double)(i / cSize) / cSize;
+			switch (k)
+			{
+			case 0:
+				p[3] = 255;
+				break;
+			case 1:
+				p[3] = (p[3] & 1) ? 255 : 0;
+				break;
+			case 3:
+				p[1] = p[2] = p[0];
+				p[3] = 255;
+				break;
+			case 4:
+				p[0] = p[1] = p[2] = 90;
+				p[3] = 255;
+				break;
+			case 5:
+			{
+				// Unit vectors tilted by a bumpy height field.
+				const double nx = 0.4 * sin(fx * 20), ny = 0.4 * cos(fy * 14), nz = sqrt(1.0 - nx * nx - ny * ny);
+				p[0] = (crn_uint8)(128 + 127 * nx);
+				p[1] = (crn_uint8)(128 + 127 * ny);
+				p[2] = (crn_uint8)(128 + 127 * nz);
+				p[3] = 255;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		crn_comp_params_clear(&params);
+		params.width = params.height = cSize;
+		params.pImages[0][0] = (const crn_uint32*)pImage;
+		classes = crn_analyze_texture(&params);
+		flags = params.flags;
+		fmt = crn_get_recommended_format(classes, &flags);
+		printf("Classes  %-12s 0x%02X: %s, flags 0x%X\n", s_names[k], classes, crn_get_format_string(fmt), flags);
+		if (classes != s_classes[k] || fmt != s_formats[k] || flags != ((params.flags | s_added[k]) & ~s_removed[k]))
+			failures++;
+		free(pImage);
+	}
+	return failures;
+}
+
+// Rec. 601 luma PSNR of DXT1 blocks against a gray image.
+static double test_luma_psnr(const crn_uint8* pImage, const crn_uint8* pBlocks, crn_uint32 width, crn_uint32 height)
+{
+	double error = 0.0;
+
+	for (crn_uint32 b = 0; b < (width >> 2) * (height >> 2); b++)
+	{
+		const crn_uint32 bx = b % (width >> 2), by = b / (width >> 2);
+		crn_uint8 pixels[16][4];
+		test_decode_block(cCRNFmtDXT1, pBlocks + b * 8, pixels);
+		for (crn_uint32 i = 0; i < 16; i++)
+		{
+			const double luma = 0.299 * pixels[i][0] + 0.587 * pixels[i][1] + 0.114 * pixels[i][2];
+			const double d = luma - pImage[((size_t)(by * 4 + (i >> 2)) * width + bx * 4 + (i & 3)) * 4];
+			error += d * d;
+		}
+	}
+	error /= (double)width * height;
+	return (error > 1e-10) ? 10.0 * log10(255.0 * 255.0 / error) : 100.0;
+}
+
+// A gray image is detected as such, and the flags recommended for it make the luma encoder beat every RGB backend in
+// luma PSNR at every tier.
+static int test_grayscale(void)
+{
+	const crn_uint32 size = 128;
+	crn_uint8* pImage = test_make_image(size, size, 4);
+	crn_comp_params params;
+	crn_uint32 flags;
+	int failures = 0;
+
+	for (crn_uint32 i = 0; i < size * size; i++)
+	{
+		crn_uint8* p = pImage + i * 4;
+		p[0] = p[1] = p[2] = (crn_uint8)((p[0] * 77 + p[1] * 150 + p[2] * 29 + 128) >> 8);
+		p[3] = 255;
+	}
+
+	crn_comp_params_clear(&params);
+	params.file_type = cCRNFileTypeDDS;
+	params.width = params.height = size;
+	params.pImages[0][0] = (const crn_uint32*)pImage;
+	flags = params.flags;
+	params.format = crn_get_recommended_format(crn_analyze_texture(&params), &flags);
+	if (params.format != cCRNFmtDXT1 || !(flags & cCRNCompFlagGrayscaleSampling))
+		failures++;
+
+	for (crn_uint32 q = 0; q < cCRNDXTQualityTotal; q++)
+	{
+		double psnr[4];
+		params.dxt_quality = (crn_dxt_quality)q;
+		// The luma encoder, then the CRN, CRNF and RYG backends on RGB.
+		for (crn_uint32 c = 0; c < 4; c++)
+		{
+			crn_uint32 size_out = 0;
+			crn_uint8* pDDS;
+			params.flags = c ? flags & ~(crn_uint32)cCRNCompFlagGrayscaleSampling : flags;
+			params.dxt_compressor_type = (crn_dxt_compressor_type)(cCRNDXTCompressorCRN + (c ? c - 1 : 0));
+			pDDS = (crn_uint8*)crn_compress(&params, &size_out, NULL, NULL);
+			psnr[c] = pDDS ? test_luma_psnr(pImage, test_dds_blocks(pDDS), size, size) : -1.0;
+			crn_free_block(pDDS);
+		}
+		printf("DXT1     gray %-9s luma %.2f dB, RGB CRN %.2f dB, CRNF %.2f dB, RYG %.2f dB\n", crn_get_dxt_quality_string(params.dxt_quality),
+			psnr[0], psnr[1], psnr[2], psnr[3]);
+		if (psnr[0] <= psnr[1] || psnr[0] <= psnr[2] || psnr[0] <= psnr[3])
+			failures++;
+	}
+
+	free(pImage);
+	return failures;
+}
+
+// Cube face axes in the D3D convention crn_compress_ext() lays faces out in: the direction of point (s, t) in [-1, 1]
+// of face f is g_test_cube_axes[f][0] + s * g_test_cube_axes[f][1] + t * g_test_cube_axes[f][2].
+static const signed char g_test_cube_axes[6][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+	{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+	{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+	{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+	{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+	{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } }
+};
+
+// Texel of an n x n face one step (du, dv) past texel (u, v), which lies on another face if that crosses an edge.
+// Returns the face, and the texel in *pU, *pV.
+static crn_uint32 test_cube_step(crn_uint32 face, crn_uint32 n, crn_uint32 u, crn_uint32 v, int du, int dv, crn_uint32* pU, crn_uint32* pV)
+{
+	const double s = (2.0 * ((int)u + du) + 1.0) / n - 1.0, t = (2.0 * ((int)v + dv) + 1.0) / n - 1.0;
+	double d[3], st[2];
+	crn_uint32 major = 0;
+
+	for (crn_uint32 a = 0; a < 3; a++)
+	{
+		d[a] = g_test_cube_axes[face][0][a] + g_test_cube_axes[face][1][a] * s + g_test_cube_axes[face][2][a] * t;
+		if (fabs(d[a]) > fabs(d[major]))
+			major = a;
+	}
+	face = major * 2 + (d[major] < 0.0);
+	for (crn_uint32 i = 0; i < 2; i++)
+	{
+		const double c = (g_test_cube_axes[face][i + 1][0] * d[0] + g_test_cube_axes[face][i + 1][1] * d[1] + g_test_cube_axes[face][i + 1][2] * d[2]) / fabs(d[major]);
+		st[i] = CRN_CLAMP(floor((c + 1.0) * 0.5 * n), 0.0, n - 1.0);
+	}
+	*pU = (crn_uint32)st[0];
+	*pV = (crn_uint32)st[1];
+	return face;
+}
+
+// With seamless_cube, light on one face must spill over each of its edges onto the neighbor's texels that touch the
+// lit ones, at every level down to 2x2. One face at a time carries a spot at the same asymmetric offset along each of
+// its edges, so a neighbor filtered in the wrong orientation puts its brightest edge texel more than a texel away from
+// the one across from the brightest lit texel.
+static int test_cube(void)
+{
+	enum { cSize = 32, cLevels = 6, cSpot = 4 };
+	static const int s_steps[4][2] = { { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 } };
+	crn_uint8* pFaces[6];
+	crn_uint8* pMips[6][cLevels];
+	int failures = 0;
+
+	for (crn_uint32 f = 0; f < 6; f++)
+	{
+		pFaces[f] = (crn_uint8*)malloc(cSize * cSize * 4);
+		for (crn_uint32 l = 0; l < cLevels; l++)
+			pMips[f][l] = (crn_uint8*)malloc((size_t)(cSize >> l) * (cSize >> l) * 4);
+	}
+
+	for (crn_uint32 lit = 0; lit < 6; lit++)
+	{
+		crn_comp_params params;
+		crn_mipmap_params mip_params;
+		crn_uint32 size = 0;
+		crn_uint8* pDDS;
+		const crn_uint8* pBlocks;
+
+		crn_comp_params_clear(&params);
+		params.file_type = cCRNFileTypeDDS;
+		params.format = cCRNFmtBC7;
+		params.faces = 6;
+		params.width = params.height = cSize;
+		for (crn_uint32 f = 0; f < 6; f++)
+		{
+			for (crn_uint32 i = 0; i < cSize * cSize; i++)
+			{
+				const crn_uint32 x = i % cSize, y = i / cSize;
+				const crn_bool spot = f == lit && (((x < cSpot || x >= cSize - cSpot) && y >= cSpot && y < cSpot * 2) ||
+					((y < cSpot || y >= cSize - cSpot) && x >= cSpot && x < cSpot * 2));
+				pFaces[f][i * 4] = pFaces[f][i * 4 + 1] = pFaces[f][i * 4 + 2] = spot ? 255 : 0;
+				pFaces[f][i * 4 + 3] = 255;
+			}
+			params.pImages[f][0] = (const crn_uint32*)pFaces[f];
+		}
+		crn_mipmap_params_clear(&mip_params);
+		mip_params.seamless_cube = crn_true;
+		pDDS = (crn_uint8*)crn_compress_ext(&params, &mip_params, &size, NULL, NULL);
+		if (!pDDS)
+		{
+			failures++;
+			continue;
+		}
+		pBlocks = test_dds_blocks(pDDS);
+		for (crn_uint32 f = 0; f < 6; f++)
+			for (crn_uint32 l = 0; l < cLevels; l++)
+				pBlocks = test_decode_level(params.format, pBlocks, cSize >> l, cSize >> l, pMips[f][l]);
+		crn_free_block(pDDS);
+
+		for (crn_uint32 l = 1; l < cLevels - 1; l++)
+		{
+			const crn_uint32 n = cSize >> l;
+			for (crn_uint32 f = 0; f < 6; f++)
+			{
+				// Edge texels of f next to the lit face: the brightest one, and the one across from the brightest lit one.
+				crn_uint32 best[2] = { 0, 0 }, at[2][2] = { { 0, 0 }, { 0, 0 } };
+				if ((f >> 1) == (lit >> 1))
+					continue;
+				for (crn_uint32 e = 0; e < 4; e++)
+				{
+					for (crn_uint32 i = 0; i < n; i++)
+					{
+						const crn_uint32 u = s_steps[e][0] ? (s_steps[e][0] < 0 ? 0 : n - 1) : i, v = s_steps[e][1] ? (s_steps[e][1] < 0 ? 0 : n - 1) : i;
+						crn_uint32 lu, lv, value[2];
+						if (test_cube_step(f, n, u, v, s_steps[e][0], s_steps[e][1], &lu, &lv) != lit)
+							continue;
+						value[0] = pMips[f][l][(v * n + u) * 4];
+						value[1] = pMips[lit][l][(lv * n + lu) * 4];
+						for (crn_uint32 k = 0; k < 2; k++)
+						{
+							if (value[k] > best[k])
+							{
+								best[k] = value[k];
+								at[k][0] = u;
+								at[k][1] = v;
+							}
+						}
+					}
+				}
+				if (!best[0] || abs((int)at[0][0] - (int)at[1][0]) + abs((int)at[0][1] - (int)at[1][1]) > 1)
+					failures++;
+			}
+		}
+	}
+
+	for (crn_uint32 f = 0; f < 6; f++)
+	{
+		free(pFaces[f]);
+		for (crn_uint32 l = 0; l < cLevels; l++)
+			free(pMips[f][l]);
+	}
+	printf("Cube     seamless edges: %s\n", failures ? "mismatched" : "matched");
+	return failures;
+}
+
+// Reference 2x2 box downsample of an RGBA image, in linear light with gamma > 0: color channels are decoded with powf()
+// and re-encoded after averaging, alpha stays linear.
+static void test_box_mip(const crn_uint8* pSrc, crn_uint32 width, crn_uint32 height, float gamma, crn_uint8* pDst)
+{
+	for (crn_uint32 y = 0; y < height / 2; y++)
+	{
+		for (crn_uint32 x = 0; x < width / 2; x++)
+		{
+			for (crn_uint32 c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+				for (crn_uint32 i = 0; i < 4; i++)
+				{
+					const float v = pSrc[((size_t)(y * 2 + (i >> 1)) * width + x * 2 + (i & 1)) * 4 + c] / 255.0f;
+					sum += (gamma > 0.0f && c < 3) ? powf(v, gamma) : v;
+				}
+				sum *= 0.25f;
+				pDst[((size_t)y * (width / 2) + x) * 4 + c] = (crn_uint8)(255.0f * ((gamma > 0.0f && c < 3) ? powf(sum, 1.0f / gamma) : sum) + 0.5f);
+			}
+		}
+	}
+}
+
+// Box filtered mips, with and without gamma_filtering, must stay within one 8-bit level of a powf() reference made
+// from the level above. Run by the scalar build as well, which rounds its levels differently.
+static int test_gamma(void)
+{
+	const crn_uint32 size = 64;
+	crn_uint8* pImage = test_make_image(size, size, 6);
+	crn_uint8* pReference = (crn_uint8*)malloc((size_t)size * size);
+	int failures = 0;
+
+	for (crn_uint32 g = 0; g < 2; g++)
+	{
+		crn_comp_params params, mips;
+		crn_mipmap_params mip_params;
+		void* pLevels;
+		int max_error = 0;
+
+		crn_comp_params_clear(&params);
+		params.width = params.height = size;
+		params.pImages[0][0] = (const crn_uint32*)pImage;
+		crn_mipmap_params_clear(&mip_params);
+		mip_params.filter = cCRNMipFilterBox;
+		mip_params.blurriness = 1.0f;
+		mip_params.gamma_filtering = g == 0;
+		if (!crn_mipmap_build(&params, &mip_params, &mips, &pLevels) || mips.levels != 7)
+		{
+			failures++;
+			continue;
+		}
+		for (crn_uint32 l = 1; l < mips.levels; l++)
+		{
+			const crn_uint32 n = size >> l;
+			const crn_uint8* pLevel = (const crn_uint8*)mips.pImages[0][l];
+			test_box_mip((const crn_uint8*)mips.pImages[0][l - 1], n * 2, n * 2, mip_params.gamma_filtering ? mip_params.gamma : 0.0f, pReference);
+			for (crn_uint32 i = 0; i < n * n * 4; i++)
+				max_error = CRN_MAX(max_error, abs((int)pLevel[i] - (int)pReference[i]));
+		}
+		printf("Mips     box, gamma %s: max error %d\n", mip_params.gamma_filtering ? "2.2" : "off", max_error);
+		if (max_error > 1)
+			failures++;
+		crn_free(pLevels);
+	}
+
+	free(pReference);
+	free(pImage);
+	return failures;
+}
+
+// Top level size crn_compress_ext() derives from the source window, scale mode and clamp. With a box filter and no
+// gamma, a top level the size of its window must be the window texel for texel, and one half its size must be within
+// one 8-bit level of a 2x2 box reference.
+static int test_mip_size(void)
+{
+	enum { cWidth = 48, cHeight = 40 };
+	static const char* s_modes[cCRNSMTotal] = { "Disabled", "Absolute", "Relative", "LowerPow2", "NearestPow2", "NextPow2" };
+	static const struct
+	{
+		crn_scale_mode mode;
+		float scale_x, scale_y;
+		crn_uint32 window[4];   // Left, top, right, bottom, inclusive
+		crn_uint32 clamp_width, clamp_height;
+		crn_uint32 width, height;
+	} s_cases[] =
+	{
+		{ cCRNSMDisabled,     1.0f,  1.0f,  { 0, 0, 0, 0 },       0,  0,  48, 40 },
+		{ cCRNSMDisabled,     1.0f,  1.0f,  { 8, 4, 39, 27 },     0,  0,  32, 24 },
+		{ cCRNSMDisabled,     1.0f,  1.0f,  { 40, 30, 99, 99 },   0,  0,  8,  10 },
+		{ cCRNSMAbsolute,     20.0f, 10.0f, { 0, 0, 0, 0 },       0,  0,  20, 10 },
+		{ cCRNSMRelative,     0.5f,  0.5f,  { 8, 4, 39, 27 },     0,  0,  16, 12 },
+		{ cCRNSMRelative,     2.0f,  2.0f,  { 0, 0, 0, 0 },       80, 0,  80, 80 },
+		{ cCRNSMLowerPow2,    1.0f,  1.0f,  { 0, 0, 0, 0 },       0,  0,  32, 32 },
+		{ cCRNSMNearestPow2,  1.0f,  1.0f,  { 0, 0, 0, 0 },       0,  0,  64, 32 },
+		{ cCRNSMNextPow2,     1.0f,  1.0f,  { 0, 0, 0, 0 },       0,  0,  64, 64 },
+		{ cCRNSMNextPow2,     1.0f,  1.0f,  { 0, 0, 0, 0 },       24, 16, 24, 16 }
+	};
+	crn_uint8* pImage = test_make_image(cWidth, cHeight, 7);
+	crn_uint8* pWindow = (crn_uint8*)malloc(cWidth * cHeight * 4);
+	crn_uint8* pReference = (crn_uint8*)malloc(cWidth * cHeight * 4);
+	int failures = 0;
+
+	for (crn_uint32 k = 0; k < CRN_ARRAY_SIZE(s_cases); k++)
+	{
+		const crn_uint32* pWin = s_cases[k].window;
+		const crn_uint32 left = pWin[0], top = pWin[1];
+		const crn_uint32 right = pWin[2] > pWin[0] ? CRN_MIN(pWin[2] + 1, (crn_uint32)cWidth) : cWidth;
+		const crn_uint32 bottom = pWin[3] > pWin[1] ? CRN_MIN(pWin[3] + 1, (crn_uint32)cHeight) : cHeight;
+		const crn_uint32 w = right - left, h = bottom - top;
+		crn_comp_params params, mips;
+		crn_mipmap_params mip_params;
+		void* pLevels;
+		int max_error = -1;
+
+		crn_comp_params_clear(&params);
+		params.width = cWidth;
+		params.height = cHeight;
+		params.pImages[0][0] = (const crn_uint32*)pImage;
+		crn_mipmap_params_clear(&mip_params);
+		mip_params.filter = cCRNMipFilterBox;
+		mip_params.blurriness = 1.0f;
+		mip_params.gamma_filtering = crn_false;
+		mip_params.scale_mode = s_cases[k].mode;
+		mip_params.scale_x = s_cases[k].scale_x;
+		mip_params.scale_y = s_cases[k].scale_y;
+		mip_params.window_left = pWin[0];
+		mip_params.window_top = pWin[1];
+		mip_params.window_right = pWin[2];
+		mip_params.window_bottom = pWin[3];
+		mip_params.clamp_scale = s_cases[k].clamp_width || s_cases[k].clamp_height;
+		mip_params.clamp_width = s_cases[k].clamp_width;
+		mip_params.clamp_height = s_cases[k].clamp_height;
+		if (!crn_mipmap_build(&params, &mip_params, &mips, &pLevels))
+		{
+			failures++;
+			continue;
+		}
+
+		for (crn_uint32 y = 0; y < h; y++)
+			memcpy(pWindow + (size_t)y * w * 4, pImage + ((size_t)(top + y) * cWidth + left) * 4, (size_t)w * 4);
+		if (mips.width == w && mips.height == h)
+		{
+			max_error = memcmp(mips.pImages[0][0], pWindow, (size_t)w * h * 4) ? 255 : 0;
+		}
+		else if (mips.width == w / 2 && mips.height == h / 2)
+		{
+			const crn_uint8* pLevel = (const crn_uint8*)mips.pImages[0][0];
+			test_box_mip(pWindow, w, h, 0.0f, pReference);
+			max_error = 0;
+			for (crn_uint32 i = 0; i < mips.width * mips.height * 4; i++)
+				max_error = CRN_MAX(max_error, abs((int)pLevel[i] - (int)pReference[i]));
+		}
+
+		printf("Mips     %-11s window %2u,%2u %2ux%-2u -> %2ux%-2u", s_modes[s_cases[k].mode], left, top, w, h, mips.width, mips.height);
+		if (max_error >= 0)
+			printf(", max error %d", max_error);
+		printf("\n");
+		if (mips.width != s_cases[k].width || mips.height != s_cases[k].height || max_error > 1)
+			failures++;
+		crn_free(pLevels);
+	}
+
+	free(pReference);
+	free(pWindow);
+	free(pImage);
+	return failures;
+}
+
+// Rolls an RGBA image by (dx, dy), wrapping around.
+static void test_roll(const crn_uint8* pSrc, crn_uint32 width, crn_uint32 height, crn_uint32 dx, crn_uint32 dy, crn_uint8* pDst)
+{
+	for (crn_uint32 y = 0; y < height; y++)
+		for (crn_uint32 x = 0; x < width; x++)
+			memcpy(pDst + ((size_t)((y + dy) % height) * width + (x + dx) % width) * 4, pSrc + ((size_t)y * width + x) * 4, 4);
+}
+
+// Tiled mips must filter across opposite edges as if the texture repeated: rolling the source rolls every level by
+// the same amount, scaled down, with every kernel. Clamped mips must not, or the image would prove nothing; the box
+// filter is the exception, as it never reaches past a texel's own 2x2 footprint.
+static int test_tiled(void)
+{
+	static const char* s_filters[cCRNMipFilterTotal] = { "box", "tent", "lanczos4", "mitchell", "kaiser" };
+	enum { cSize = 64, cRollX = 16, cRollY = 48, cLevels = 5 };
+	crn_uint8* pImages[2];
+	crn_uint8* pRolled = (crn_uint8*)malloc(cSize * cSize * 4);
+	int failures = 0;
+
+	pImages[0] = test_make_image(cSize, cSize, 8);
+	pImages[1] = (crn_uint8*)malloc(cSize * cSize * 4);
+	test_roll(pImages[0], cSize, cSize, cRollX, cRollY, pImages[1]);
+
+	for (crn_uint32 f = 0; f < cCRNMipFilterTotal; f++)
+	{
+		crn_uint32 mismatches[2] = { 0, 0 };
+		for (crn_uint32 tiled = 0; tiled < 2; tiled++)
+		{
+			crn_comp_params params, mips[2];
+			crn_mipmap_params mip_params;
+			void* pLevels[2];
+
+			crn_comp_params_clear(&params);
+			params.width = params.height = cSize;
+			crn_mipmap_params_clear(&mip_params);
+			mip_params.filter = (crn_mip_filter)f;
+			mip_params.tiled = tiled;
+			for (crn_uint32 r = 0; r < 2; r++)
+			{
+				params.pImages[0][0] = (const crn_uint32*)pImages[r];
+				if (!crn_mipmap_build(&params, &mip_params, &mips[r], &pLevels[r]))
+					pLevels[r] = NULL;
+			}
+			if (!pLevels[0] || !pLevels[1])
+			{
+				failures++;
+				crn_free(pLevels[0]);
+				crn_free(pLevels[1]);
+				continue;
+			}
+			// Levels down to 4x4, where the roll is still a whole number of texels.
+			for (crn_uint32 l = 1; l < cLevels; l++)
+			{
+				const crn_uint32 n = cSize >> l;
+				const crn_uint8* pRolled_level = (const crn_uint8*)mips[1].pImages[0][l];
+				test_roll((const crn_uint8*)mips[0].pImages[0][l], n, n, cRollX >> l, cRollY >> l, pRolled);
+				for (crn_uint32 i = 0; i < n * n; i++)
+					mismatches[tiled] += memcmp(pRolled + i * 4, pRolled_level + i * 4, 4) != 0;
+			}
+			crn_free(pLevels[0]);
+			crn_free(pLevels[1]);
+		}
+		printf("Mips     %-8s rolled texels differing: tiled %u, clamped %u\n", s_filters[f], mismatches[1], mismatches[0]);
+		if (mismatches[1] || (!mismatches[0] && f != cCRNMipFilterBox))
+			failures++;
+	}
+
+	free(pImages[0]);
+	free(pImages[1]);
+	free(pRolled);
+	return failures;
+}
+
+// Normal map mips must hold unit vectors, to within 8-bit rounding, for the DXN formats and for renormalize. A plain
+// linear filter shortens the same vectors, or the map would prove nothing. Run by the scalar build as well.
+static int test_normals(void)
+{
+	static const struct
+	{
+		crn_format fmt;
+		crn_bool renormalize;
+	} s_cases[] = { { cCRNFmtDXN_XY, crn_false }, { cCRNFmtDXN_YX, crn_false }, { cCRNFmtDXT5, crn_true }, { cCRNFmtDXT5, crn_false } };
+	const crn_uint32 size = 64;
+	crn_uint8* pImage = (crn_uint8*)malloc((size_t)size * size * 4);
+	int failures = 0;
+
+	// Bumps too fine for the first levels to keep, which they average toward +Z.
+	for (crn_uint32 i = 0; i < size * size; i++)
+	{
+		const double nx = 0.7 * sin((i % size) * 1.7), ny = 0.7 * cos((i / size) * 1.3) * cos((i % size) * 0.4), nz = sqrt(1.0 - nx * nx - ny * ny);
+		pImage[i * 4] = (crn_uint8)(127.5 + 127.5 * nx + 0.5);
+		pImage[i * 4 + 1] = (crn_uint8)(127.5 + 127.5 * ny + 0.5);
+		pImage[i * 4 + 2] = (crn_uint8)(127.5 + 127.5 * nz + 0.5);
+		pImage[i * 4 + 3] = 255;
+	}
+
+	for (crn_uint32 k = 0; k < CRN_ARRAY_SIZE(s_cases); k++)
+	{
+		const crn_bool unit = s_cases[k].renormalize || s_cases[k].fmt != cCRNFmtDXT5;
+		crn_comp_params params, mips;
+		crn_mipmap_params mip_params;
+		void* pLevels;
+		double max_error = 0.0;
+
+		crn_comp_params_clear(&params);
+		params.width = params.height = size;
+		params.format = s_cases[k].fmt;
+		params.pImages[0][0] = (const crn_uint32*)pImage;
+		crn_mipmap_params_clear(&mip_params);
+		mip_params.gamma_filtering = crn_false;
+		mip_params.renormalize = s_cases[k].renormalize;
+		if (!crn_mipmap_build(&params, &mip_params, &mips, &pLevels))
+		{
+			failures++;
+			continue;
+		}
+		for (crn_uint32 l = 1; l < mips.levels; l++)
+		{
+			const crn_uint8* pLevel = (const crn_uint8*)mips.pImages[0][l];
+			for (crn_uint32 i = 0; i < (size >> l) * (size >> l); i++)
+			{
+				double len2 = 0.0;
+				for (crn_uint32 c = 0; c < 3; c++)
+					len2 += (pLevel[i * 4 + c] / 127.5 - 1.0) * (pLevel[i * 4 + c] / 127.5 - 1.0);
+				max_error = CRN_MAX(max_error, fabs(sqrt(len2) - 1.0));
+			}
+		}
+		printf("Normals  %-8s renormalize %u: max length error %.4f\n", crn_get_format_string(params.format), s_cases[k].renormalize, max_error);
+		// Rounding each component moves the length by at most sqrt(3) / 255.
+		if (unit ? max_error > 0.007 : max_error < 0.1)
+			failures++;
+		crn_free(pLevels);
+	}
+
+	free(pImage);
+	return failures;
+}
+
+// Mips of a smooth 16-bit gradient, filtered at 16 bits, must come much closer to the exact box filtered levels than
+// mips of the same gradient rounded to 8 bits, with and without gamma.
+static int test_source16(void)
+{
+	const crn_uint32 size = 64;
+	crn_uint16* pWide = (crn_uint16*)malloc((size_t)size * size * 8);
+	crn_uint8* pNarrow = (crn_uint8*)malloc((size_t)size * size * 4);
+	int failures = 0;
+
+	for (crn_uint32 i = 0; i < size * size * 4; i++)
+	{
+		const double fx = (double)((i >> 2) % size) / size, fy = (double)((i >> 2) / size) / size;
+		pWide[i] = (crn_uint16)(65535.0 * (0.5 + 0.3 * sin(fx * 2.0 + (i & 3)) * cos(fy * 1.5)) + 0.5);
+		pNarrow[i] = crn_narrow16(pWide[i]);
+	}
+
+	for (crn_uint32 g = 0; g < 2; g++)
+	{
+		const double gamma = g ? 2.2 : 1.0;
+		double rms[2] = { 0.0, 0.0 };
+		crn_uint32 samples = 0;
+
+		for (crn_uint32 wide = 0; wide < 2; wide++)
+		{
+			crn_comp_params params, mips;
+			crn_mipmap_params mip_params;
+			void* pLevels;
+
+			crn_comp_params_clear(&params);
+			params.width = params.height = size;
+			params.flags |= wide ? cCRNCompFlagSource16 : 0;
+			params.pImages[0][0] = wide ? (const crn_uint32*)pWide : (const crn_uint32*)pNarrow;
+			crn_mipmap_params_clear(&mip_params);
+			mip_params.filter = cCRNMipFilterBox;
+			mip_params.blurriness = 1.0f;
+			mip_params.gamma_filtering = g == 1;
+			if (!crn_mipmap_build(&params, &mip_params, &mips, &pLevels))
+			{
+				failures++;
+				continue;
+			}
+
+			samples = 0;
+			for (crn_uint32 l = 1; l < mips.levels; l++)
+			{
+				const crn_uint32 n = size >> l, span = 1U << l;
+				for (crn_uint32 i = 0; i < n * n * 4; i++)
+				{
+					// The exact level averages the texel's whole footprint in the source, in linear light.
+					const crn_uint32 x = (i >> 2) % n, y = (i >> 2) / n, c = i & 3;
+					const double e = (c == params.alpha_component) ? 1.0 : gamma;
+					double sum = 0.0, v, d;
+					for (crn_uint32 j = 0; j < span * span; j++)
+						sum += pow(pWide[((size_t)(y * span + j / span) * size + x * span + j % span) * 4 + c] / 65535.0, e);
+					v = 65535.0 * pow(sum / (span * span), 1.0 / e);
+					d = (wide ? ((const crn_uint16*)mips.pImages[0][l])[i] : ((const crn_uint8*)mips.pImages[0][l])[i] * 257.0) - v;
+					rms[wide] += d * d;
+					samples++;
+				}
+			}
+			rms[wide] = sqrt(rms[wide] / samples);
+			crn_free(pLevels);
+		}
+
+		printf("Mips     16-bit gradient, gamma %.1f: RMS error 16-bit %.2f, 8-bit %.2f (16-bit steps)\n", gamma, rms[1], rms[0]);
+		if (rms[1] * 10.0 > rms[0])
+			failures++;
+	}
+
+	free(pNarrow);
+	free(pWide);
+	return failures;
+}
+
+// crn_compress_blocks() must encode each block exactly as crn_compress() does in a .DDS file, in one batch, block by
+// block, and with the endpoint cache off. Some blocks repeat the one before them and some repeat an earlier one, so
+// the repeated-block and cache-hit paths are covered too.
+static int test_blocks(void)
+{
+	static const crn_format s_formats[] =
+	{
+		cCRNFmtDXT1, cCRNFmtDXT5, cCRNFmtDXT5_xGBR, cCRNFmtDXT5A, cCRNFmtDXN_XY, cCRNFmtDXN_YX, cCRNFmtETC1, cCRNFmtBC7
+	};
+	enum { cSize = 64, cBlocks_x = cSize / 4, cBlocks = cBlocks_x * cBlocks_x };
+	crn_uint8* pImage = test_make_image(cSize, cSize, 9);
+	crn_uint32* pBlock_pixels = (crn_uint32*)malloc(cBlocks * 64);
+	crn_uint8* pOut = (crn_uint8*)malloc(cBlocks * 16);
+	int failures = 0;
+
+	// Blocks 1 and 2 repeat block 0, and every 7th block repeats block 5.
+	for (crn_uint32 i = 0; i < cSize * cSize; i++)
+	{
+		const crn_uint32 x = i % cSize, y = i / cSize, b = (y >> 2) * cBlocks_x + (x >> 2);
+		const crn_uint32 src = (b == 1 || b == 2) ? 0 : (b > 5 && b % 7 == 5) ? 5 : b;
+		memcpy(pImage + (size_t)i * 4, pImage + ((size_t)((src / cBlocks_x) * 4 + (y & 3)) * cSize + (src % cBlocks_x) * 4 + (x & 3)) * 4, 4);
+	}
+	for (crn_uint32 b = 0; b < cBlocks; b++)
+		for (crn_uint32 i = 0; i < 16; i++)
+			memcpy(pBlock_pixels + b * 16 + i, pImage + ((size_t)((b / cBlocks_x) * 4 + (i >> 2)) * cSize + (b % cBlocks_x) * 4 + (i & 3)) * 4, 4);
+
+	for (crn_uint32 f = 0; f < CRN_ARRAY_SIZE(s_formats); f++)
+	{
+		const crn_uint32 bpb = crn_get_bytes_per_dxt_block(s_formats[f]);
+		crn_uint32 mismatches = 0, size = 0;
+		crn_comp_params params;
+		crn_uint8* pDDS;
+
+		crn_comp_params_clear(&params);
+		params.file_type = cCRNFileTypeDDS;
+		params.format = s_formats[f];
+		params.width = params.height = cSize;
+		params.pImages[0][0] = (const crn_uint32*)pImage;
+		pDDS = (crn_uint8*)crn_compress(&params, &size, NULL, NULL);
+		if (!pDDS)
+		{
+			failures++;
+			continue;
+		}
+
+		// A batch, block by block, and a batch without the endpoint cache.
+		for (crn_uint32 pass = 0; pass < 3; pass++)
+		{
+			crn_block_compressor_context_t pContext;
+			if (pass == 2)
+				params.flags |= cCRNCompFlagDisableEndpointCaching;
+			pContext = crn_create_block_compressor(&params);
+			if (!pContext)
+			{
+				mismatches++;
+				continue;
+			}
+			memset(pOut, 0, cBlocks * bpb);
+			if (pass == 1)
+			{
+				for (crn_uint32 b = 0; b < cBlocks; b++)
+					crn_compress_block(pContext, pBlock_pixels + b * 16, pOut + b * bpb);
+			}
+			else
+				crn_compress_blocks(pContext, pBlock_pixels, cBlocks, pOut);
+			crn_free_block_compressor(pContext);
+			for (crn_uint32 b = 0; b < cBlocks; b++)
+				mismatches += memcmp(pOut + b * bpb, test_dds_blocks(pDDS) + b * bpb, bpb) != 0;
+		}
+		printf("Blocks   %-9s blocks differing from crn_compress(): %u\n", crn_get_format_string(params.format), mismatches);
+		if (mismatches)
+			failures++;
+		crn_free_block(pDDS);
+	}
+
+	free(pOut);
+	free(pBlock_pixels);
+	free(pImage);
+	return failures;
+}
+
+// With cCRNCompFlagDXT1AForTransparency, every DXT1 pixel below dxt1a_alpha_threshold must decode as transparent and
+// every other pixel as opaque, whatever backend, tier and threshold.
+static int test_dxt1a(void)
+{
+	static const char* s_compressors[] = { "CRN ", "CRNF", "RYG " };
+	static const crn_uint32 s_thresholds[] = { 1, 128, 250 };
+	const crn_uint32 size = 64;
+	crn_uint8* pImage = test_make_image(size, size, 10);
+	int failures = 0;
+
+	for (crn_uint32 t = 0; t < CRN_ARRAY_SIZE(s_thresholds); t++)
+	{
+		for (crn_uint32 c = 0; c < CRN_ARRAY_SIZE(s_compressors); c++)
+		{
+			crn_uint32 wrong = 0;
+			for (crn_uint32 q = 0; q < cCRNDXTQualityTotal; q++)
+			{
+				crn_comp_params params;
+				crn_uint32 size_out = 0;
+				crn_uint8* pDDS;
+
+				crn_comp_params_clear(&params);
+				params.file_type = cCRNFileTypeDDS;
+				params.width = params.height = size;
+				params.flags |= cCRNCompFlagDXT1AForTransparency;
+				params.dxt1a_alpha_threshold = s_thresholds[t];
+				params.dxt_compressor_type = (crn_dxt_compressor_type)(cCRNDXTCompressorCRN + c);
+				params.dxt_quality = (crn_dxt_quality)q;
+				params.pImages[0][0] = (const crn_uint32*)pImage;
+				pDDS = (crn_uint8*)crn_compress(&params, &size_out, NULL, NULL);
+				if (!pDDS)
+				{
+					wrong++;
+					continue;
+				}
+				for (crn_uint32 b = 0; b < (size >> 2) * (size >> 2); b++)
+				{
+					crn_uint8 pixels[16][4];
+					test_decode_block(cCRNFmtDXT1, test_dds_blocks(pDDS) + b * 8, pixels);
+					for (crn_uint32 i = 0; i < 16; i++)
+					{
+						const crn_uint8 alpha = pImage[((size_t)((b / (size >> 2)) * 4 + (i >> 2)) * size + (b % (size >> 2)) * 4 + (i & 3)) * 4 + 3];
+						wrong += pixels[i][3] != ((alpha < params.dxt1a_alpha_threshold) ? 0 : 255);
+					}
+				}
+				crn_free_block(pDDS);
+			}
+			printf("DXT1A    %s threshold %3u: pixels with the wrong alpha %u\n", s_compressors[c], s_thresholds[t], wrong);
+			if (wrong)
+				failures++;
+		}
+	}
+
+	free(pImage);
+	return failures;
+}
+
+// CRN files transcoded to .DDS by crn_decompress_crn_to_dds() and crn_decompress_crn_to_dds_ext(), on and off helper
+// threads, must carry the texture's size, mip count, cube caps and FOURCCs in their header, and exactly the blocks
+// crnd_unpack_level() transcodes, face by face and level by level.
+static int test_transcode(void)
+{
+	static const struct
+	{
+		crn_format fmt;
+		crn_uint32 width, height, faces;
+	} s_cases[] = { { cCRNFmtDXT1, 60, 44, 1 }, { cCRNFmtDXT5_xGBR, 60, 44, 1 }, { cCRNFmtDXN_YX, 32, 32, 6 }, { cCRNFmtDXT5, 16, 16, 6 } };
+	static const crn_uint32 s_threads[] = { 0, 3 };
+	int failures = 0;
+
+	for (crn_uint32 k = 0; k < CRN_ARRAY_SIZE(s_cases); k++)
+	{
+		const crn_uint32 width = s_cases[k].width, height = s_cases[k].height, faces = s_cases[k].faces;
+		const crn_format fmt = s_cases[k].fmt, fundamental = crn_get_fundamental_dxt_format(fmt);
+		crn_uint8* pFaces[cCRNMaxFaces];
+		crn_uint8* pExpected = NULL;
+		crn_comp_params params;
+		crn_mipmap_params mip_params;
+		crnd_texture_info info;
+		crnd_unpack_context ctx;
+		crn_uint32 crn_size = 0, face_size = 0, wrong = 0;
+		void* pCRN;
+
+		crn_comp_params_clear(&params);
+		params.format = fmt;
+		params.width = width;
+		params.height = height;
+		params.faces = faces;
+		for (crn_uint32 f = 0; f < faces; f++)
+		{
+			pFaces[f] = test_make_image(width, height, 11 + f);
+			params.pImages[f][0] = (const crn_uint32*)pFaces[f];
+		}
+		crn_mipmap_params_clear(&mip_params);
+		pCRN = crn_compress_ext(&params, &mip_params, &crn_size, NULL, NULL);
+		for (crn_uint32 f = 0; f < faces; f++)
+			free(pFaces[f]);
+		if (!pCRN || !crnd_get_texture_info(pCRN, crn_size, &info) || info.levels < 2)
+		{
+			failures++;
+			crn_free_block(pCRN);
+			continue;
+		}
+
+		// Each face's chain of levels in turn, in .DDS order.
+		for (crn_uint32 l = 0; l < info.levels; l++)
+			face_size += ((CRN_MAX(width >> l, 1U) + 3) >> 2) * ((CRN_MAX(height >> l, 1U) + 3) >> 2) * info.bytes_per_block;
+		pExpected = (crn_uint8*)malloc((size_t)face_size * faces);
+		ctx = crnd_unpack_begin(pCRN, crn_size);
+		for (crn_uint32 l = 0, level_ofs = 0; ctx && l < info.levels; l++)
+		{
+			const crn_uint32 pitch = ((CRN_MAX(width >> l, 1U) + 3) >> 2) * info.bytes_per_block;
+			const crn_uint32 level_size = pitch * ((CRN_MAX(height >> l, 1U) + 3) >> 2);
+			void* pDst[cCRNMaxFaces];
+			for (crn_uint32 f = 0; f < faces; f++)
+				pDst[f] = pExpected + (size_t)f * face_size + level_ofs;
+			wrong += !crnd_unpack_level(ctx, pDst, level_size, pitch, l);
+			level_ofs += level_size;
+		}
+		wrong += !ctx;
+		crnd_unpack_end(ctx);
+
+		for (crn_uint32 t = 0; t < 1 + CRN_ARRAY_SIZE(s_threads); t++)
+		{
+			crn_uint32 dds_size = crn_size;
+			const crn_uint8* pDDS = (const crn_uint8*)(t ? crn_decompress_crn_to_dds_ext(pCRN, &dds_size, s_threads[t - 1]) : crn_decompress_crn_to_dds(pCRN, &dds_size));
+			if (!pDDS)
+			{
+				wrong++;
+				continue;
+			}
+			wrong += dds_size != 128 + face_size * faces;
+			wrong += crn_read_le32(pDDS) != (crn_uint32)('D' | ('D' << 8) | ('S' << 16) | (' ' << 24)) || crn_read_le32(pDDS + 4) != 124;
+			wrong += crn_read_le32(pDDS + 12) != height || crn_read_le32(pDDS + 16) != width || crn_read_le32(pDDS + 28) != info.levels;
+			wrong += crn_read_le32(pDDS + 84) != crn_get_format_fourcc(fundamental);
+			wrong += crn_read_le32(pDDS + 88) != ((fundamental != fmt) ? crn_get_format_fourcc(fmt) : 0);
+			// DDSCAPS2_CUBEMAP.
+			wrong += ((crn_read_le32(pDDS + 112) & 0x200) != 0) != (faces == 6);
+			if (dds_size == 128 + face_size * faces && memcmp(pDDS + 128, pExpected, (size_t)face_size * faces))
+				wrong++;
+			crn_free_block((void*)pDDS);
+		}
+		printf("CRN->DDS %-9s %ux%u, %u face(s), %u levels: %s\n", crn_get_format_string(fmt), width, height, faces, info.levels, wrong ? "mismatched" : "matched");
+		if (wrong)
+			failures++;
+		free(pExpected);
+		crn_free_block(pCRN);
+	}
+	return failures;
+}
+
+typedef struct
+{
+	const char* pName;
+	int (*pFunc)(void);
+} test_case;
+
+static const test_case g_test_cases[] =
+{
+	{ "crn", test_crn },
+	{ "dds", test_dds },
+	{ "hierarchical", test_hierarchical },
+	{ "tiers", test_tiers },
+	{ "array", test_array },
+	{ "classes", test_classes },
+	{ "grayscale", test_grayscale },
+	{ "cube", test_cube },
+	{ "gamma", test_gamma },
+	{ "mip_size", test_mip_size },
+	{ "tiled", test_tiled },
+	{ "normals", test_normals },
+	{ "source16", test_source16 },
+	{ "blocks", test_blocks },
+	{ "dxt1a", test_dxt1a },
+	{ "transcode", test_transcode }
+};
+
+int main(int argc, char** argv)
+{
+	int failures = 0, found = 0;
+	for (crn_uint32 i = 0; i < CRN_ARRAY_SIZE(g_test_cases); i++)
+	{
+		if (argc > 1 && strcmp(argv[1], g_test_cases[i].pName))
+			continue;
+		found = 1;
+		failures += g_test_cases[i].pFunc();
+	}
+	if (!found)
+	{
+		fprintf(stderr, "Unknown test case: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (failures)
+		printf("%d check(s) failed\n", failures);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}